@@ -0,0 +1,282 @@
+#include "StreamingVolumeApp.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <thread>
+
+
+Hammock::StreamingVolumeApp::StreamingVolumeApp() {
+    // The raymarcher reports the bricks it needs through a storage buffer written by the fragment shader
+    if (!device.getEnabledFeatures().fragmentStoresAndAtomics) {
+        Logger::log(LOG_LEVEL_ERROR, "Error: Volume streaming needs fragmentStoresAndAtomics\n");
+        throw std::runtime_error("Device does not support fragment stores.");
+    }
+    load();
+}
+
+void Hammock::StreamingVolumeApp::run() {
+    pipeline = GraphicsPipeline::createGraphicsPipelinePtr({
+        .debugName = "bricked_forward_pass",
+        .device = device,
+        .VS
+        {
+            .byteCode = Hammock::Filesystem::readFile(compiledShaderPath("fullscreen.vert")),
+            .entryFunc = "main"
+        },
+        .FS
+        {
+            .byteCode = Hammock::Filesystem::readFile(compiledShaderPath("raymarch_bricked.frag")),
+            .entryFunc = "main"
+        },
+        .descriptorSetLayouts =
+        {
+            deviceStorage.getDescriptorSetLayout(descriptorSetLayout).getDescriptorSetLayout()
+        },
+        .pushConstantRanges{
+            {
+                .stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT,
+                .offset = 0,
+                .size = sizeof(PushData)
+            }
+        },
+        .graphicsState
+        {
+            .depthTest = VK_TRUE,
+            .depthTestCompareOp = VK_COMPARE_OP_LESS_OR_EQUAL,
+            .frontFace = VK_FRONT_FACE_CLOCKWISE,
+            .blendAtaAttachmentStates{},
+            .vertexBufferBindings{}
+        },
+        .renderPass = renderContext.getSwapChainRenderPass()
+    });
+
+    UserInterface ui{device, renderContext.getSwapChainRenderPass(), deviceStorage.getDescriptorPool(), window};
+
+    auto currentTime = std::chrono::high_resolution_clock::now();
+
+    while (!window.shouldClose()) {
+        window.pollEvents();
+
+        // gameloop timing
+        auto newTime = std::chrono::high_resolution_clock::now();
+        float frameTime = std::chrono::duration<float, std::chrono::seconds::period>(newTime - currentTime).count();
+        currentTime = newTime;
+
+        if(window.getKeyState(KEY_A) == KeyState::DOWN) azimuth -= 1.f * frameTime;
+        if(window.getKeyState(KEY_D) == KeyState::DOWN) azimuth += 1.f * frameTime;
+        if(window.getKeyState(KEY_W) == KeyState::DOWN) elevation += 1.f * frameTime;
+        if(window.getKeyState(KEY_S) == KeyState::DOWN) elevation -= 1.f * frameTime;
+        if(window.getKeyState(KEY_UP) == KeyState::DOWN) radius -= 1.f * frameTime;
+        if(window.getKeyState(KEY_DOWN) == KeyState::DOWN) radius += 1.f * frameTime;
+        cameraPosition.value = Math::orbitalPosition(cameraTarget.value, HmckClamp(0.f, radius, 10.0f), azimuth,
+                                                     elevation);
+
+        // Bricks the transfer function leaves fully transparent are never loaded
+        updateTransferFunction();
+        float lo, hi;
+        transferFunction.visibleRange(lo, hi);
+        if (lo != visibleRange[0] || hi != visibleRange[1]) {
+            visibleRange[0] = lo;
+            visibleRange[1] = hi;
+            brickCache->setVisibleRange(lo, hi);
+        }
+
+        // start a new frame
+        if (const auto commandBuffer = renderContext.beginFrame()) {
+            const int frameIndex = renderContext.getFrameIndex();
+
+            // Brick uploads are transfers, they have to be recorded before the render pass
+            brickCache->update(commandBuffer, frameIndex);
+
+            renderContext.beginSwapChainRenderPass(commandBuffer);
+
+            draw(frameIndex, commandBuffer); {
+                ui.beginUserInterface();
+                this->ui();
+                ui.showDebugStats(bufferData.inverseView, frameTime);
+                ui.endUserInterface(commandBuffer);
+            }
+
+            renderContext.endRenderPass(commandBuffer);
+            brickCache->recordFeedbackBarrier(commandBuffer);
+            renderContext.endFrame();
+        }
+    }
+    vkDeviceWaitIdle(device.device());
+    destroy();
+}
+
+void Hammock::StreamingVolumeApp::load() {
+    threadPool.setThreadCount(std::max(1u, std::thread::hardware_concurrency()));
+
+    // The slices are bricked once, later runs stream straight from the converted file. A file from an
+    // older version or a broken run is converted again.
+    const std::string path = assetPath("textures/volumes/female_ankle.hbv");
+    if (!BrickedVolume::isValid(path)) {
+        BrickedVolume::convert(Filesystem::ls(assetPath("textures/volumes/female_ankle")), path, 32,
+                               Filesystem::ReadImageLoadingFlags::FLIP_Y);
+    }
+    volume = std::make_unique<BrickedVolume>(path);
+    brickCache = std::make_unique<BrickCache>(device, deviceStorage, BrickCache::CreateInfo{.volume = *volume});
+
+    bufferData.textureDim = {
+        static_cast<float>(volume->sizeX()), static_cast<float>(volume->sizeY()),
+        static_cast<float>(volume->sizeZ()), 1.0f
+    };
+    bufferData.brickDim = {
+        static_cast<float>(volume->bricksX()), static_cast<float>(volume->bricksY()),
+        static_cast<float>(volume->bricksZ()), static_cast<float>(volume->brickSize())
+    };
+
+    // Transparent air, then tissue over fat to bone
+    transferFunction.setControlPoints({
+        {0.1f, {0.0f, 0.0f, 0.0f, 0.0f}},
+        {0.3f, {0.8f, 0.5f, 0.4f, 0.2f}},
+        {0.6f, {1.0f, 0.8f, 0.6f, 0.4f}},
+        {1.0f, {1.0f, 1.0f, 1.0f, 0.8f}}
+    });
+    transferFunction.build(pushData.marchSize, threadPool);
+    lookupTableTexture = deviceStorage.createTexture3D({
+        .buffer = transferFunction.lookupTable().data(),
+        .instanceSize = sizeof(float),
+        .width = TransferFunction::TABLE_SIZE, .height = 1,
+        .channels = 4, .depth = 1,
+        .format = VK_FORMAT_R32G32B32A32_SFLOAT,
+        .imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
+    });
+    preintegratedTableTexture = deviceStorage.createTexture3D({
+        .buffer = transferFunction.preintegratedTable().data(),
+        .instanceSize = sizeof(float),
+        .width = TransferFunction::TABLE_SIZE, .height = TransferFunction::TABLE_SIZE,
+        .channels = 4, .depth = 1,
+        .format = VK_FORMAT_R32G32B32A32_SFLOAT,
+        .imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
+    });
+
+    descriptorSets.resize(SwapChain::MAX_FRAMES_IN_FLIGHT);
+    buffers.resize(SwapChain::MAX_FRAMES_IN_FLIGHT);
+
+    descriptorSetLayout = deviceStorage.createDescriptorSetLayout({
+        .bindings = {
+            {
+                .binding = 0, .descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+                .stageFlags = VK_SHADER_STAGE_ALL_GRAPHICS
+            },
+            {
+                .binding = 1, .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                .stageFlags = VK_SHADER_STAGE_ALL_GRAPHICS
+            },
+            {
+                .binding = 2, .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                .stageFlags = VK_SHADER_STAGE_ALL_GRAPHICS
+            },
+            {
+                .binding = 3, .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                .stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT
+            },
+            {
+                .binding = 4, .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                .stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT
+            },
+            {
+                .binding = 5, .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                .stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT
+            },
+        }
+    });
+
+    for (int i = 0; i < SwapChain::MAX_FRAMES_IN_FLIGHT; i++) {
+        buffers[i] = deviceStorage.createBuffer({
+            .instanceSize = sizeof(BufferData),
+            .instanceCount = 1,
+            .usageFlags = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+            .memoryPropertyFlags = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
+        });
+        descriptorSets[i] = deviceStorage.createDescriptorSet({
+            .descriptorSetLayout = descriptorSetLayout,
+            .bufferWrites = {
+                {0, deviceStorage.getBuffer(buffers[i])->descriptorInfo()},
+                {3, brickCache->feedbackDescriptor(i)}
+            },
+            .imageWrites = {
+                {1, brickCache->atlasDescriptor()}, {2, brickCache->pageTableDescriptor()},
+                {4, deviceStorage.getTexture3DDescriptorImageInfo(lookupTableTexture)},
+                {5, deviceStorage.getTexture3DDescriptorImageInfo(preintegratedTableTexture)}
+            }
+        });
+    }
+}
+
+void Hammock::StreamingVolumeApp::draw(int frameIndex, VkCommandBuffer commandBuffer) {
+    const HmckMat4 projection = Projection().perspective(45.0f, renderContext.getAspectRatio(), 0.1f, 64.0f);
+    bufferData.inverseProjection = HmckInvGeneral(projection);
+    bufferData.view = Projection().view(cameraPosition.value, cameraTarget.value,
+                                        Projection().upNegY());
+    bufferData.inverseView = Projection().inverseView(cameraPosition.value,
+                                                      cameraTarget.value,
+                                                      Projection().upNegY());
+    bufferData.cameraPosition = HmckVec4{cameraPosition.value};
+
+    pipeline->bind(commandBuffer);
+    deviceStorage.getBuffer(buffers[frameIndex])->writeToBuffer(&bufferData);
+
+    deviceStorage.bindDescriptorSet(
+        commandBuffer,
+        VK_PIPELINE_BIND_POINT_GRAPHICS,
+        pipeline->graphicsPipelineLayout,
+        0, 1,
+        descriptorSets[frameIndex],
+        0,
+        nullptr);
+
+    pushData.frameStamp = brickCache->frameStamp(frameIndex);
+
+    vkCmdPushConstants(commandBuffer, pipeline->graphicsPipelineLayout, VK_SHADER_STAGE_FRAGMENT_BIT, 0,
+                       sizeof(PushData), &pushData);
+
+    vkCmdDraw(commandBuffer, 3, 1, 0, 0);
+}
+
+void Hammock::StreamingVolumeApp::destroy() {
+    brickCache->destroy();
+    deviceStorage.destroyTexture3D(lookupTableTexture);
+    deviceStorage.destroyTexture3D(preintegratedTableTexture);
+
+    for (auto &uniformBuffer: buffers)
+        deviceStorage.destroyBuffer(uniformBuffer);
+
+    deviceStorage.destroyDescriptorSetLayout(descriptorSetLayout);
+}
+
+void Hammock::StreamingVolumeApp::ui() {
+    ImGui::Begin("Volume streaming", (bool *) false, ImGuiWindowFlags_AlwaysAutoResize);
+
+    ImGui::Text("Volume: %u x %u x %u in %zu bricks", volume->sizeX(), volume->sizeY(), volume->sizeZ(),
+                volume->brickCount());
+    ImGui::Text("Resident: %u / %u slots", brickCache->residentBricks(), brickCache->slotCount());
+    ImGui::Text("Pending: %u", brickCache->pendingBricks());
+    ImGui::Text("Uploaded: %u, evicted: %u", brickCache->uploadedBricks(), brickCache->evictedBricks());
+
+    ImGui::ColorEdit4("Base sky color", &bufferData.baseSkyColor.Elements[0]);
+
+    ImGui::DragFloat("Max steps", &pushData.maxSteps, 1.0f, 0.001f);
+    ImGui::DragFloat("March size", &pushData.marchSize, 0.0001f, 0.0001f, 100.f, "%.5f");
+
+    transferFunctionDirty |= UserInterface::showTransferFunctionEditor(transferFunction);
+    ImGui::Checkbox("Pre-integrated", (bool*)&pushData.preintegrated);
+
+    ImGui::DragFloat3("Camera position", &cameraPosition.value.Elements[0], 0.1f);
+    ImGui::DragFloat3("Camera target", &cameraTarget.value.Elements[0], 0.1f);
+
+    ImGui::End();
+}
+
+void Hammock::StreamingVolumeApp::updateTransferFunction() {
+    if (!transferFunctionDirty && transferFunction.stepSize() == pushData.marchSize) return;
+    transferFunctionDirty = false;
+
+    transferFunction.build(pushData.marchSize, threadPool);
+    vkDeviceWaitIdle(device.device());
+    deviceStorage.getTexture3D(lookupTableTexture)->update(transferFunction.lookupTable().data());
+    deviceStorage.getTexture3D(preintegratedTableTexture)->update(transferFunction.preintegratedTable().data());
+}
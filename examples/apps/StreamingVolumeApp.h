@@ -0,0 +1,71 @@
+#pragma once
+#include <memory>
+#include <vector>
+#include <chrono>
+
+#include "IApp.h"
+
+namespace Hammock {
+    // Raymarches a bricked volume through a BrickCache, only the bricks rays reach are read from the file
+    // and kept on the device
+    class StreamingVolumeApp final : public IApp {
+    public:
+        StreamingVolumeApp();
+
+        void run() override;
+
+    protected:
+        void load() override;
+
+        void draw(int frameIndex, VkCommandBuffer commandBuffer);
+
+        void destroy();
+
+        void ui();
+
+        // Rebuilds and uploads the transfer function tables when the points or the march size changed
+        void updateTransferFunction();
+
+        RenderContext renderContext{window, device};
+
+        std::vector<ResourceHandle<VkDescriptorSet>> descriptorSets{};
+        ResourceHandle<DescriptorSetLayout> descriptorSetLayout;
+        std::vector<ResourceHandle<Buffer>> buffers{};
+
+        std::unique_ptr<GraphicsPipeline> pipeline{};
+
+        struct BufferData {
+            HmckMat4 inverseProjection{1};
+            HmckMat4 view{1};
+            HmckMat4 inverseView{1};
+            HmckVec4 textureDim{1.f, 1.f, 1.f, 1.0f};
+            HmckVec4 baseSkyColor{0.043f, 0.043f, 0.043f, 0.0f};
+            HmckVec4 cameraPosition{0.f, 0.f, 0.f, 0.f};
+            HmckVec4 brickDim{1.f, 1.f, 1.f, 1.f};
+        } bufferData;
+
+        struct PushData {
+            float resX = IApp::WINDOW_WIDTH;
+            float resY = IApp::WINDOW_HEIGHT;
+            float maxSteps = 1000.f;
+            float marchSize = 0.02f;
+            uint32_t frameStamp = 0;
+            int preintegrated = true;
+        } pushData;
+
+        std::unique_ptr<BrickedVolume> volume{};
+        std::unique_ptr<BrickCache> brickCache{};
+        // Range the cache last marked empty bricks for
+        float visibleRange[2]{0.f, 0.f};
+
+        TransferFunction transferFunction{};
+        ResourceHandle<Texture3D> lookupTableTexture{};
+        ResourceHandle<Texture3D> preintegratedTableTexture{};
+        bool transferFunctionDirty = false;
+        ThreadPool threadPool{};
+
+        float radius = 2.0f, azimuth = 0.0f, elevation = 0.0f;
+        Vec3Padded cameraPosition{0.0f, 0.0f, 2.0f};
+        Vec3Padded cameraTarget{0.0f, 0.0f, -0.8f};
+    };
+}
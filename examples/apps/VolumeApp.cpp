@@ -1,5 +1,8 @@
 #include "VolumeApp.h"
 
+#include <algorithm>
+#include <thread>
+
 
 Hammock::VolumeApp::VolumeApp() {
     load();
@@ -45,6 +48,45 @@ void Hammock::VolumeApp::run() {
         .renderPass = renderContext.getSwapChainRenderPass()
     });
 
+    meshPipeline = GraphicsPipeline::createGraphicsPipelinePtr({
+        .debugName = "isosurface_forward_pass",
+        .device = device,
+        .VS
+        {
+            .byteCode = Hammock::Filesystem::readFile(compiledShaderPath("marching_cubes.vert")),
+            .entryFunc = "main"
+        },
+        .FS
+        {
+            .byteCode = Hammock::Filesystem::readFile(compiledShaderPath("marching_cubes.frag")),
+            .entryFunc = "main"
+        },
+        .descriptorSetLayouts =
+        {
+            deviceStorage.getDescriptorSetLayout(meshDescriptorSetLayout).getDescriptorSetLayout()
+        },
+        .pushConstantRanges{
+            {
+                .stageFlags = VK_SHADER_STAGE_VERTEX_BIT,
+                .offset = 0,
+                .size = sizeof(float)
+            }
+        },
+        .graphicsState
+        {
+            .depthTest = VK_TRUE,
+            .depthTestCompareOp = VK_COMPARE_OP_LESS_OR_EQUAL,
+            .cullMode = VK_CULL_MODE_NONE,
+            .blendAtaAttachmentStates{},
+            .vertexBufferBindings
+            {
+                .vertexBindingDescriptions = Vertex::vertexInputBindingDescriptions(),
+                .vertexAttributeDescriptions = Vertex::vertexInputAttributeDescriptions()
+            }
+        },
+        .renderPass = renderContext.getSwapChainRenderPass()
+    });
+
 
     UserInterface ui{device, renderContext.getSwapChainRenderPass(), deviceStorage.getDescriptorPool(), window};
 
@@ -69,6 +111,14 @@ void Hammock::VolumeApp::run() {
         cameraPosition.value = Math::orbitalPosition(cameraTarget.value, HmckClamp(0.f, radius, 10.0f), azimuth,
                                                      elevation);
 
+        // Meshing and the uploads wait for the device, so they happen between frames
+        if (displayMode == DisplayMode::Mesh && meshDirty) {
+            buildMesh();
+        }
+        if (displayMode == DisplayMode::Raymarched) {
+            updateTransferFunction();
+            updateMacrocells();
+        }
 
         // start a new frame
         if (const auto commandBuffer = renderContext.beginFrame()) {
@@ -98,7 +148,8 @@ void Hammock::VolumeApp::run() {
 }
 
 void Hammock::VolumeApp::load() {
-    
+    threadPool.setThreadCount(std::max(1u, std::thread::hardware_concurrency()));
+
     Loader(geometry, device, deviceStorage).loadglTF(assetPath("models/Sphere/Sphere.glb"));
 
 
@@ -116,9 +167,50 @@ void Hammock::VolumeApp::load() {
                 .binding = 1, .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
                 .stageFlags = VK_SHADER_STAGE_ALL_GRAPHICS
             },
+            {
+                .binding = 2, .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                .stageFlags = VK_SHADER_STAGE_ALL_GRAPHICS
+            },
+            {
+                .binding = 3, .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                .stageFlags = VK_SHADER_STAGE_ALL_GRAPHICS
+            },
+            {
+                .binding = 4, .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                .stageFlags = VK_SHADER_STAGE_ALL_GRAPHICS
+            },
+            {
+                .binding = 5, .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                .stageFlags = VK_SHADER_STAGE_ALL_GRAPHICS
+            },
         }
     });
 
+    meshDescriptorSets.resize(SwapChain::MAX_FRAMES_IN_FLIGHT);
+    meshBuffers.resize(SwapChain::MAX_FRAMES_IN_FLIGHT);
+
+    meshDescriptorSetLayout = deviceStorage.createDescriptorSetLayout({
+        .bindings = {
+            {
+                .binding = 0, .descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+                .stageFlags = VK_SHADER_STAGE_ALL_GRAPHICS
+            },
+        }
+    });
+
+    for (int i = 0; i < SwapChain::MAX_FRAMES_IN_FLIGHT; i++){
+        meshBuffers[i] = deviceStorage.createBuffer({
+                    .instanceSize = sizeof(MeshBufferData),
+                    .instanceCount = 1,
+                    .usageFlags = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+                    .memoryPropertyFlags = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
+                });
+        meshDescriptorSets[i] = deviceStorage.createDescriptorSet({
+            .descriptorSetLayout = meshDescriptorSetLayout,
+            .bufferWrites = {{0, deviceStorage.getBuffer(meshBuffers[i])->descriptorInfo()}}
+        });
+    }
+
     for (int i = 0; i < SwapChain::MAX_FRAMES_IN_FLIGHT; i++){
         buffers[i] = deviceStorage.createBuffer({
                     .instanceSize = sizeof(BufferData),
@@ -130,11 +222,40 @@ void Hammock::VolumeApp::load() {
          
 
     {
-        // Load the volume texture
+        // Transparent air, then tissue over fat to bone. The tables are single slices of 3D textures,
+        // which unlike 2D textures can be updated in place when the points change.
+        transferFunction.setControlPoints({
+            {0.35f, {0.0f, 0.0f, 0.0f, 0.0f}},
+            {0.58f, {0.8f, 0.5f, 0.4f, 0.2f}},
+            {0.79f, {1.0f, 0.8f, 0.6f, 0.4f}},
+            {1.0f, {1.0f, 1.0f, 1.0f, 0.8f}}
+        });
+        transferFunction.build(pushData.marchSize, threadPool);
+        lookupTableTexture = deviceStorage.createTexture3D({
+            .buffer = transferFunction.lookupTable().data(),
+            .instanceSize = sizeof(float),
+            .width = TransferFunction::TABLE_SIZE, .height = 1,
+            .channels = 4, .depth = 1,
+            .format = VK_FORMAT_R32G32B32A32_SFLOAT,
+            .imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
+        });
+        preintegratedTableTexture = deviceStorage.createTexture3D({
+            .buffer = transferFunction.preintegratedTable().data(),
+            .instanceSize = sizeof(float),
+            .width = TransferFunction::TABLE_SIZE, .height = TransferFunction::TABLE_SIZE,
+            .channels = 4, .depth = 1,
+            .format = VK_FORMAT_R32G32B32A32_SFLOAT,
+            .imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
+        });
+    }
+
+    {
+        // Load the volume texture. The slices are 8 bit, so R8_UNORM holds them exactly in a quarter of
+        // the memory R32_SFLOAT would take.
         int w, h, c, d;
         const auto volumeImages = Filesystem::ls(assetPath("textures/volumes/female_ankle"));
-        ScopedMemory volumeData{
-            Filesystem::readVolume(volumeImages, w, h, c, d, Filesystem::ImageFormat::R32_SFLOAT,
+        volumeData = ScopedMemory{
+            Filesystem::readVolume(volumeImages, w, h, c, d, Filesystem::ImageFormat::R8_UNORM,
                                    Filesystem::ReadImageLoadingFlags::FLIP_Y)
         };
         bufferData.textureDim = {
@@ -142,21 +263,73 @@ void Hammock::VolumeApp::load() {
         };
         texture = deviceStorage.createTexture3D({
             .buffer = volumeData.get(),
-            .instanceSize = sizeof(float),
+            .instanceSize = sizeof(uint8_t),
             .width = static_cast<uint32_t>(w), .height = static_cast<uint32_t>(h),
             .channels = static_cast<uint32_t>(c), .depth = static_cast<uint32_t>(d),
-            .format = VK_FORMAT_R32_SFLOAT,
+            .format = VK_FORMAT_R8_UNORM,
             .imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
         });
+        const auto &volumeTexture = deviceStorage.getTexture3D(texture);
+        bufferData.valueTransform = {volumeTexture->valueScale, volumeTexture->valueBias, 0.0f, 0.0f};
+
+        volume = {
+            .data = volumeData.get(),
+            .width = static_cast<uint32_t>(w), .height = static_cast<uint32_t>(h),
+            .depth = static_cast<uint32_t>(d), .channels = static_cast<uint32_t>(c),
+            .type = VolumeView::SampleType::UNorm8,
+            .scale = volumeTexture->valueScale, .bias = volumeTexture->valueBias
+        };
+        isosurfaces.setVolume(volume);
+
+        macrocells.build(volume, threadPool);
+        visibleRange(skipRange[0], skipRange[1]);
+        macrocells.updateSkipDistances(skipRange[0], skipRange[1], threadPool);
+        bufferData.macrocellDim = {
+            static_cast<float>(macrocells.sizeX()), static_cast<float>(macrocells.sizeY()),
+            static_cast<float>(macrocells.sizeZ()), static_cast<float>(MacrocellGrid::CELL_SIZE)
+        };
+        macrocellTexture = deviceStorage.createTexture3D({
+            .buffer = macrocells.skipDistances().data(),
+            .instanceSize = sizeof(float),
+            .width = macrocells.sizeX(), .height = macrocells.sizeY(),
+            .channels = 1, .depth = macrocells.sizeZ(),
+            .format = VK_FORMAT_R32_SFLOAT,
+            .imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+            .samplerInfo = {.filter = VK_FILTER_NEAREST}
+        });
+
+        // Gradients in texture space, like the differences the shader would take itself. The packed
+        // texels are only needed until the upload.
+        GradientVolume gradients;
+        const HmckVec3 spacing{
+            1.0f / static_cast<float>(w), 1.0f / static_cast<float>(h), 1.0f / static_cast<float>(d)
+        };
+        gradients.build(volume, spacing, threadPool);
+        gradientTexture = deviceStorage.createTexture3D({
+            .buffer = gradients.texels().data(),
+            .instanceSize = sizeof(uint8_t),
+            .width = gradients.sizeX(), .height = gradients.sizeY(),
+            .channels = 4, .depth = gradients.sizeZ(),
+            .format = VK_FORMAT_R8G8B8A8_UNORM,
+            .imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+            .valueScale = gradients.maxMagnitude()
+        });
     }
 
     for (int i = 0; i < SwapChain::MAX_FRAMES_IN_FLIGHT; i++) {
         auto fbufferInfo = deviceStorage.getBuffer(buffers[i])->descriptorInfo();
         auto imageInfo = deviceStorage.getTexture3DDescriptorImageInfo(texture);
+        auto macrocellInfo = deviceStorage.getTexture3DDescriptorImageInfo(macrocellTexture);
+        auto gradientInfo = deviceStorage.getTexture3DDescriptorImageInfo(gradientTexture);
+        auto lookupTableInfo = deviceStorage.getTexture3DDescriptorImageInfo(lookupTableTexture);
+        auto preintegratedTableInfo = deviceStorage.getTexture3DDescriptorImageInfo(preintegratedTableTexture);
         descriptorSets[i] = deviceStorage.createDescriptorSet({
             .descriptorSetLayout = descriptorSetLayout,
             .bufferWrites = {{0, fbufferInfo}},
-            .imageWrites = {{1, imageInfo}}
+            .imageWrites = {
+                {1, imageInfo}, {2, macrocellInfo}, {3, gradientInfo}, {4, lookupTableInfo},
+                {5, preintegratedTableInfo}
+            }
         });
     }
 
@@ -174,17 +347,49 @@ void Hammock::VolumeApp::load() {
 }
 
 void Hammock::VolumeApp::draw(int frameIndex, float elapsedTime, VkCommandBuffer commandBuffer) {
-    deviceStorage.bindVertexBuffer(vertexBuffer, indexBuffer, commandBuffer);
-    pipeline->bind(commandBuffer);
-
-    bufferData.inverseProjection = HmckInvGeneral(
-        Projection().perspective(45.0f, renderContext.getAspectRatio(), 0.1f, 64.0f));
+    const HmckMat4 projection = Projection().perspective(45.0f, renderContext.getAspectRatio(), 0.1f, 64.0f);
+    bufferData.inverseProjection = HmckInvGeneral(projection);
     bufferData.view = Projection().view(cameraPosition.value, cameraTarget.value,
                                         Projection().upNegY());
     bufferData.inverseView = Projection().inverseView(cameraPosition.value,
                                                       cameraTarget.value,
                                                       Projection().upNegY());
     bufferData.cameraPosition = HmckVec4{cameraPosition.value};
+
+    if (displayMode == DisplayMode::Mesh) {
+        // The raymarch shader builds rays from half the NDC range and rotates them by the view matrix
+        // itself, the mesh camera does the same so that both modes frame the volume identically
+        HmckMat4 meshProjection = projection;
+        meshProjection[0][0] *= 2.0f;
+        meshProjection[1][1] *= 2.0f;
+        HmckMat4 rotation = bufferData.view;
+        rotation[3] = HmckVec4{0.0f, 0.0f, 0.0f, 1.0f};
+        const HmckMat4 meshView = HmckMul(HmckTransposeM4(rotation), HmckTranslate(-cameraPosition.value));
+
+        meshBufferData.mvp = HmckMul(meshProjection, meshView);
+        meshBufferData.lightPos = bufferData.sunPosition;
+        deviceStorage.getBuffer(meshBuffers[frameIndex])->writeToBuffer(&meshBufferData);
+
+        if (meshIndexCount == 0) return;
+
+        meshPipeline->bind(commandBuffer);
+        deviceStorage.bindDescriptorSet(
+            commandBuffer,
+            VK_PIPELINE_BIND_POINT_GRAPHICS,
+            meshPipeline->graphicsPipelineLayout,
+            0, 1,
+            meshDescriptorSets[frameIndex],
+            0,
+            nullptr);
+        vkCmdPushConstants(commandBuffer, meshPipeline->graphicsPipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0,
+                           sizeof(float), &elapsedTime);
+        deviceStorage.bindVertexBuffer(meshVertexBuffer, meshIndexBuffer, commandBuffer);
+        vkCmdDrawIndexed(commandBuffer, meshIndexCount, 1, 0, 0, 0);
+        return;
+    }
+
+    deviceStorage.bindVertexBuffer(vertexBuffer, indexBuffer, commandBuffer);
+    pipeline->bind(commandBuffer);
     deviceStorage.getBuffer(buffers[frameIndex])->writeToBuffer(&bufferData);
 
     deviceStorage.bindDescriptorSet(
@@ -204,8 +409,87 @@ void Hammock::VolumeApp::draw(int frameIndex, float elapsedTime, VkCommandBuffer
     vkCmdDraw(commandBuffer, 3, 1, 0, 0);
 }
 
+void Hammock::VolumeApp::buildMesh() {
+    meshDirty = false;
+
+    // Texel centers of the raymarched texture: x and y span [-1, 1], z keeps the aspect of the volume
+    const float w = static_cast<float>(volume.width), h = static_cast<float>(volume.height);
+    const IsosurfaceMesh &mesh = isosurfaces.get({
+        .isovalue = isovalue,
+        .scale = {2.0f / w, 2.0f / h, 2.0f / w},
+        .offset = {1.0f / w - 1.0f, 1.0f / h - 1.0f, 1.0f / w - 1.0f}
+    });
+
+    // The previous mesh may still be read by a frame in flight
+    vkDeviceWaitIdle(device.device());
+    if (meshVertexBuffer.isValid()) {
+        deviceStorage.destroyBuffer(meshVertexBuffer);
+        deviceStorage.destroyBuffer(meshIndexBuffer);
+        meshVertexBuffer.invalidate();
+        meshIndexBuffer.invalidate();
+    }
+    meshIndexCount = static_cast<uint32_t>(mesh.indices.size());
+    if (meshIndexCount == 0) return;
+
+    meshVertexBuffer = deviceStorage.createVertexBuffer({
+        .vertexSize = sizeof(mesh.vertices[0]),
+        .vertexCount = static_cast<uint32_t>(mesh.vertices.size()),
+        .data = const_cast<Vertex *>(mesh.vertices.data())
+    });
+    meshIndexBuffer = deviceStorage.createIndexBuffer({
+        .indexSize = sizeof(mesh.indices[0]),
+        .indexCount = meshIndexCount,
+        .data = const_cast<uint32_t *>(mesh.indices.data())
+    });
+}
+
+void Hammock::VolumeApp::visibleRange(float &lo, float &hi) const {
+    // The Blinn-Phong mode only stops at tissue, the composited mode wherever the transfer function is visible
+    if (pushData.nDotL) {
+        lo = pushData.airTrheshold;
+        hi = pushData.tissueThreshold;
+        return;
+    }
+    transferFunction.visibleRange(lo, hi);
+}
+
+void Hammock::VolumeApp::updateMacrocells() {
+    float lo, hi;
+    visibleRange(lo, hi);
+    if (lo == skipRange[0] && hi == skipRange[1]) return;
+    skipRange[0] = lo;
+    skipRange[1] = hi;
+
+    // Only touches the macrocells, the volume is not read again
+    macrocells.updateSkipDistances(lo, hi, threadPool);
+    vkDeviceWaitIdle(device.device());
+    deviceStorage.getTexture3D(macrocellTexture)->update(macrocells.skipDistances().data());
+}
+
+void Hammock::VolumeApp::updateTransferFunction() {
+    if (!transferFunctionDirty && transferFunction.stepSize() == pushData.marchSize) return;
+    transferFunctionDirty = false;
+
+    transferFunction.build(pushData.marchSize, threadPool);
+    vkDeviceWaitIdle(device.device());
+    deviceStorage.getTexture3D(lookupTableTexture)->update(transferFunction.lookupTable().data());
+    deviceStorage.getTexture3D(preintegratedTableTexture)->update(transferFunction.preintegratedTable().data());
+}
+
 void Hammock::VolumeApp::destroy() {
+    if (meshVertexBuffer.isValid()) {
+        deviceStorage.destroyBuffer(meshVertexBuffer);
+        deviceStorage.destroyBuffer(meshIndexBuffer);
+    }
+    for (auto &uniformBuffer: meshBuffers)
+        deviceStorage.destroyBuffer(uniformBuffer);
+    deviceStorage.destroyDescriptorSetLayout(meshDescriptorSetLayout);
+
     deviceStorage.destroyTexture3D(texture);
+    deviceStorage.destroyTexture3D(macrocellTexture);
+    deviceStorage.destroyTexture3D(gradientTexture);
+    deviceStorage.destroyTexture3D(lookupTableTexture);
+    deviceStorage.destroyTexture3D(preintegratedTableTexture);
 
     for (auto &uniformBuffer: buffers)
         deviceStorage.destroyBuffer(uniformBuffer);
@@ -221,21 +505,43 @@ void Hammock::VolumeApp::ui() {
     ImGui::Begin("Volume editor", (bool *) false, ImGuiWindowFlags_AlwaysAutoResize);
     ImGui::Text("Edit rendering properties", window_flags);
 
+    int mode = static_cast<int>(displayMode);
+    if (ImGui::Combo("Display", &mode, "Raymarched\0Isosurface mesh\0")) {
+        displayMode = static_cast<DisplayMode>(mode);
+    }
+    if (displayMode == DisplayMode::Mesh) {
+        // Remesh once the value is released, not on every step of a drag
+        ImGui::DragFloat("Isovalue", &isovalue, 0.005f, 0.0f, 1.0f);
+        if (ImGui::IsItemDeactivatedAfterEdit()) meshDirty = true;
+        if (ImGui::Button("Skin")) {
+            isovalue = pushData.airTrheshold;
+            meshDirty = true;
+        }
+        ImGui::SameLine();
+        if (ImGui::Button("Bone")) {
+            isovalue = boneIsovalue;
+            meshDirty = true;
+        }
+        ImGui::Text("Triangles: %u", meshIndexCount / 3);
+    }
+
 
     ImGui::ColorEdit4("Base sky color", &bufferData.baseSkyColor.Elements[0]);
 
     ImGui::DragFloat("Max steps", &pushData.maxSteps, 1.0f, 0.001f);
     ImGui::DragFloat("March size", &pushData.marchSize, 0.0001f, 0.0001f, 100.f, "%.5f");
-    ImGui::DragFloat("Air threshold", &pushData.airTrheshold, 0.01f, 0.001f, 1.0f);
-    ImGui::DragFloat("Tissue threshold", &pushData.tissueThreshold, 0.01f, 0.001f, 1.0f);
-    ImGui::DragFloat("Fat threshold", &pushData.fatThreshold, 0.01f, 0.001f, 1.0f);
 
+    transferFunctionDirty |= UserInterface::showTransferFunctionEditor(transferFunction);
+    ImGui::Checkbox("Pre-integrated", (bool*)&pushData.preintegrated);
 
-    ImGui::ColorEdit4("Tissue color", &bufferData.tissueColor.Elements[0]);
-    ImGui::ColorEdit4("Fat color", &bufferData.fatColor.Elements[0]);
-    ImGui::ColorEdit4("Bone color", &bufferData.boneColor.Elements[0]);
 
+    // The Blinn-Phong mode shades the first sample between the air and the tissue threshold
     ImGui::Checkbox("Blinn-phong", (bool*)&pushData.nDotL);
+    ImGui::DragFloat("Air threshold", &pushData.airTrheshold, 0.01f, 0.001f, 1.0f);
+    ImGui::DragFloat("Tissue threshold", &pushData.tissueThreshold, 0.01f, 0.001f, 1.0f);
+    ImGui::ColorEdit4("Tissue color", &bufferData.tissueColor.Elements[0]);
+    ImGui::Checkbox("Empty space skipping", (bool*)&pushData.emptySpaceSkipping);
+    ImGui::Checkbox("Precomputed gradients", (bool*)&pushData.precomputedGradients);
     
 
     ImGui::DragFloat3("Camera position", &cameraPosition.value.Elements[0], 0.1f);
@@ -21,7 +21,22 @@ namespace Hammock {
 
         void ui();
 
+        // Uploads the isosurface at the current isovalue, meshing the volume unless it is cached
+        void buildMesh();
 
+        // Range the transfer function of the current mode does not map to fully transparent
+        void visibleRange(float &lo, float &hi) const;
+
+        // Recomputes and uploads the macrocell skip distances when the visible range changed
+        void updateMacrocells();
+
+        // Rebuilds and uploads the transfer function tables when the points or the march size changed
+        void updateTransferFunction();
+
+        enum class DisplayMode : int {
+            Raymarched,
+            Mesh
+        };
 
         RenderContext renderContext{window, device};
 
@@ -42,9 +57,9 @@ namespace Hammock {
             HmckVec4 sunPosition{-10.f, -10.f, 10.f, 1.f};
             HmckVec4 baseSkyColor{0.043f, 0.043f, 0.043f, 0.0f};
             HmckVec4 tissueColor{0.8f, 0.5f, 0.4f, 0.2f};
-            HmckVec4 fatColor{1.0f, 0.8f, 0.6f, 0.4f};
-            HmckVec4 boneColor{1.0f, 1.0f, 1.0f, 0.8f};
             HmckVec4 cameraPosition{0.f, 0.f, 0.f, 0.f};
+            HmckVec4 macrocellDim{1.f, 1.f, 1.f, 1.f};
+            HmckVec4 valueTransform{1.f, 0.f, 0.f, 0.f};
         } bufferData;
 
 
@@ -53,14 +68,54 @@ namespace Hammock {
             float resY = IApp::WINDOW_HEIGHT;
             float elapsedTime = 0.0f;
             float maxSteps = 1000.f;
-            float marchSize = 0.01f;
-            float airTrheshold = 0.1f;
-            float tissueThreshold = 0.3f;
-            float fatThreshold = 0.6f;
+            float marchSize = 0.02f;
+            float airTrheshold = 0.35f;
+            float tissueThreshold = 0.58f;
             int  nDotL = false;
+            int emptySpaceSkipping = true;
+            int precomputedGradients = true;
+            int preintegrated = true;
         } pushData;
 
         ResourceHandle<Texture3D> texture{};
+        // Packed gradients of the volume, one fetch per shaded sample, see GradientVolume
+        ResourceHandle<Texture3D> gradientTexture{};
+
+        // Empty space skipping, the ranges are built once and the skip distances follow the thresholds
+        MacrocellGrid macrocells{};
+        ResourceHandle<Texture3D> macrocellTexture{};
+        float skipRange[2]{0.f, 0.f};
+
+        // Classification of the raymarched samples, tabulated for the shader
+        TransferFunction transferFunction{};
+        ResourceHandle<Texture3D> lookupTableTexture{};
+        ResourceHandle<Texture3D> preintegratedTableTexture{};
+        bool transferFunctionDirty = false;
+
+        // Samples stay on the host after the upload so that isosurfaces can be meshed from them
+        ScopedMemory volumeData{};
+        VolumeView volume{};
+        ThreadPool threadPool{};
+        IsosurfaceCache isosurfaces{threadPool};
+
+        DisplayMode displayMode = DisplayMode::Raymarched;
+        float isovalue = 0.58f;
+        float boneIsovalue = 0.79f;
+        bool meshDirty = true;
+
+        ResourceHandle<Buffer> meshVertexBuffer{};
+        ResourceHandle<Buffer> meshIndexBuffer{};
+        uint32_t meshIndexCount = 0;
+
+        std::unique_ptr<GraphicsPipeline> meshPipeline{};
+        ResourceHandle<DescriptorSetLayout> meshDescriptorSetLayout;
+        std::vector<ResourceHandle<VkDescriptorSet>> meshDescriptorSets{};
+        std::vector<ResourceHandle<Buffer>> meshBuffers{};
+
+        struct MeshBufferData {
+            HmckMat4 mvp{1};
+            HmckVec4 lightPos{-10.f, -10.f, 10.f, 1.f};
+        } meshBufferData;
 
         float radius = 2.0f, azimuth = 0.0f, elevation = 0.0f;
         Vec3Padded cameraPosition{0.0f, 0.0f, 2.0f};
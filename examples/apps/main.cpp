@@ -2,6 +2,7 @@
 #include <iostream>
 
 #include "PBRApp.h"
+#include "StreamingVolumeApp.h"
 #include "VolumeApp.h"
 
 
@@ -11,7 +12,8 @@ int main() {
         while (true) {
             int demo;
             std::cout <<
-                    "Enter a demo ID:\n0 - Exit\n1 - PBR Demo\n2 - Volume data rendering from 3D texture\n";
+                    "Enter a demo ID:\n0 - Exit\n1 - PBR Demo\n2 - Volume data rendering from 3D texture\n"
+                    "3 - Out-of-core volume streaming\n";
             std::cin >> demo;
 
             if (demo == 0) {
@@ -22,6 +24,9 @@ int main() {
             } else if (demo == 2) {
                 Hammock::VolumeApp app{};
                 app.run();
+            } else if (demo == 3) {
+                Hammock::StreamingVolumeApp app{};
+                app.run();
             }
 
         }
@@ -0,0 +1,591 @@
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <new>
+#include <optional>
+#include <random>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#if defined(_WIN32)
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+#include <hammock/utils/ArgParser.h>
+#include <hammock/utils/Logger.h>
+
+#include "MarchingCubes.h"
+#include "MortonSort.h"
+#include "Particle.h"
+#include "ParticleSplatting.h"
+#include "SpanSpaceIndex.h"
+
+// Headless marching cubes benchmark
+// Generates reproducible synthetic fields (a few large spheres, a gyroid, value noise and many small
+// blobs) at several resolutions and runs every extractor on them. Synthetic particle clouds cover the
+// field construction of Particle.h and MortonSort.h. Reports time, cells and triangles per second, bytes
+// allocated by the run and the peak resident set size of the process as CSV or JSON.
+
+namespace {
+    // Every allocation of the process goes through here, a run reports the bytes it requested
+    std::atomic<std::size_t> allocatedBytes{0};
+}
+
+void *operator new(std::size_t size) {
+    allocatedBytes.fetch_add(size, std::memory_order_relaxed);
+    if (void *p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+
+void *operator new(std::size_t size, std::align_val_t alignment) {
+    allocatedBytes.fetch_add(size, std::memory_order_relaxed);
+    const auto align = static_cast<std::size_t>(alignment);
+#if defined(_MSC_VER)
+    if (void *p = _aligned_malloc(size ? size : 1, align)) return p;
+#else
+    if (void *p = std::aligned_alloc(align, (std::max<std::size_t>(size, 1) + align - 1) / align * align)) return p;
+#endif
+    throw std::bad_alloc();
+}
+
+// GCC cannot tell that these replace the operator new above and warns about free on memory from new
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete(void *p, std::size_t) noexcept { operator delete(p); }
+
+void operator delete(void *p, std::align_val_t) noexcept {
+#if defined(_MSC_VER)
+    _aligned_free(p);
+#else
+    std::free(p);
+#endif
+}
+
+void operator delete(void *p, std::size_t, std::align_val_t alignment) noexcept { operator delete(p, alignment); }
+
+namespace {
+    constexpr std::string_view FIELDS[] = {"spheres", "gyroid", "noise", "blobs", "particles"};
+
+    template<typename T>
+    T argumentOr(const Hammock::ArgParser &parser, const std::string &name, T fallback) {
+        try {
+            return parser.get<T>(name);
+        } catch (const std::invalid_argument &) {
+            return fallback;
+        }
+    }
+
+    std::vector<std::string> split(const std::string &list) {
+        std::vector<std::string> items;
+        std::stringstream stream(list);
+        for (std::string item; std::getline(stream, item, ',');) {
+            if (!item.empty()) items.push_back(item);
+        }
+        return items;
+    }
+
+    std::size_t peakResidentBytes() {
+#if defined(_WIN32)
+        PROCESS_MEMORY_COUNTERS counters{};
+        GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters));
+        return counters.PeakWorkingSetSize;
+#else
+        rusage usage{};
+        getrusage(RUSAGE_SELF, &usage);
+#if defined(__APPLE__)
+        return static_cast<std::size_t>(usage.ru_maxrss);
+#else
+        return static_cast<std::size_t>(usage.ru_maxrss) * 1024;
+#endif
+#endif
+    }
+
+    // Uniform floats in [0, 1) that are the same on every standard library, unlike the distributions
+    class Random {
+    public:
+        explicit Random(uint32_t seed) : engine(seed) {
+        }
+
+        float next() { return static_cast<float>(engine() >> 8) * (1.0f / 16777216.0f); }
+        float next(float lo, float hi) { return lo + (hi - lo) * next(); }
+
+    private:
+        std::mt19937 engine;
+    };
+
+    struct SyntheticField {
+        ScalarField3D dense;
+        SparseScalarField3D sparse;
+        float isovalue;
+    };
+
+    // Adds the compactly supported bump (1 - d^2 / r^2)^2 around every center, background stays 0
+    void addBumps(ScalarField3D &field, const std::vector<std::array<float, 4> > &bumps) {
+        const int n = static_cast<int>(field.sizeX());
+        for (const auto &[cx, cy, cz, radius]: bumps) {
+            const float c[3] = {cx * n, cy * n, cz * n}, r = radius * n;
+            int lo[3], hi[3];
+            for (int a = 0; a < 3; ++a) {
+                lo[a] = std::max(0, static_cast<int>(std::ceil(c[a] - r)));
+                hi[a] = std::min(n - 1, static_cast<int>(std::floor(c[a] + r)));
+            }
+            for (int z = lo[2]; z <= hi[2]; ++z) {
+                for (int y = lo[1]; y <= hi[1]; ++y) {
+                    float *row = field.row(y, z);
+                    for (int x = lo[0]; x <= hi[0]; ++x) {
+                        const float dx = x - c[0], dy = y - c[1], dz = z - c[2];
+                        const float t = 1.0f - (dx * dx + dy * dy + dz * dz) / (r * r);
+                        if (t > 0.0f) row[x] += t * t;
+                    }
+                }
+            }
+        }
+    }
+
+    float latticeValue(uint32_t x, uint32_t y, uint32_t z, uint32_t seed) {
+        uint32_t h = x * 0x8da6b343u ^ y * 0xd8163841u ^ z * 0xcb1ab31fu ^ seed * 0x165667b1u;
+        h = (h ^ h >> 15) * 0x2c1b3c6du;
+        h = (h ^ h >> 12) * 0x297a2d39u;
+        return static_cast<float>((h ^ h >> 15) >> 8) * (1.0f / 16777216.0f);
+    }
+
+    // Trilinearly interpolated value noise, smoothstep between lattice points
+    float valueNoise(float x, float y, float z, uint32_t seed) {
+        const float fx = std::floor(x), fy = std::floor(y), fz = std::floor(z);
+        const auto ix = static_cast<uint32_t>(fx), iy = static_cast<uint32_t>(fy), iz = static_cast<uint32_t>(fz);
+        auto smooth = [](float t) { return t * t * (3.0f - 2.0f * t); };
+        const float u = smooth(x - fx), v = smooth(y - fy), w = smooth(z - fz);
+        auto lerp = [](float a, float b, float t) { return a + (b - a) * t; };
+        return lerp(
+            lerp(lerp(latticeValue(ix, iy, iz, seed), latticeValue(ix + 1, iy, iz, seed), u),
+                 lerp(latticeValue(ix, iy + 1, iz, seed), latticeValue(ix + 1, iy + 1, iz, seed), u), v),
+            lerp(lerp(latticeValue(ix, iy, iz + 1, seed), latticeValue(ix + 1, iy, iz + 1, seed), u),
+                 lerp(latticeValue(ix, iy + 1, iz + 1, seed), latticeValue(ix + 1, iy + 1, iz + 1, seed), u), v),
+            w);
+    }
+
+    // Fields are defined over the unit cube, so the surface is the same at every resolution
+    std::optional<SyntheticField> createField(const std::string &name, uint32_t resolution) {
+        ScalarField3D field(resolution, resolution, resolution);
+        const float r = static_cast<float>(resolution);
+        Random random(1);
+        float isovalue;
+
+        if (name == "spheres") {
+            // A few large spheres, most of the volume is empty
+            std::vector<std::array<float, 4> > bumps;
+            for (int i = 0; i < 8; ++i) {
+                bumps.push_back({random.next(0.2f, 0.8f), random.next(0.2f, 0.8f), random.next(0.2f, 0.8f),
+                                 random.next(0.08f, 0.2f)});
+            }
+            addBumps(field, bumps);
+            isovalue = 0.25f;
+        } else if (name == "blobs") {
+            // Many small blobs, like a sparse particle fluid
+            std::vector<std::array<float, 4> > bumps;
+            for (int i = 0; i < 400; ++i) {
+                bumps.push_back({random.next(0.05f, 0.95f), random.next(0.05f, 0.95f), random.next(0.05f, 0.95f),
+                                 random.next(0.01f, 0.04f)});
+            }
+            addBumps(field, bumps);
+            isovalue = 0.25f;
+        } else if (name == "gyroid") {
+            // Surface everywhere, four periods per axis
+            constexpr float FREQUENCY = 2.0f * 3.14159265f * 4.0f;
+            for (uint32_t z = 0; z < resolution; ++z) {
+                for (uint32_t y = 0; y < resolution; ++y) {
+                    float *row = field.row(y, z);
+                    const float py = y / r * FREQUENCY, pz = z / r * FREQUENCY;
+                    for (uint32_t x = 0; x < resolution; ++x) {
+                        const float px = x / r * FREQUENCY;
+                        row[x] = std::sin(px) * std::cos(py) + std::sin(py) * std::cos(pz) + std::sin(pz) * std::cos(px);
+                    }
+                }
+            }
+            isovalue = 0.0f;
+        } else if (name == "noise") {
+            // Three octaves of value noise, a dense and irregular surface
+            for (uint32_t z = 0; z < resolution; ++z) {
+                for (uint32_t y = 0; y < resolution; ++y) {
+                    float *row = field.row(y, z);
+                    for (uint32_t x = 0; x < resolution; ++x) {
+                        float value = 0.0f, amplitude = 0.5f, frequency = 8.0f;
+                        for (uint32_t octave = 0; octave < 3; ++octave) {
+                            value += amplitude * valueNoise(x / r * frequency, y / r * frequency, z / r * frequency,
+                                                            octave);
+                            amplitude *= 0.5f;
+                            frequency *= 2.0f;
+                        }
+                        row[x] = value / 0.875f;
+                    }
+                }
+            }
+            isovalue = 0.5f;
+        } else {
+            return std::nullopt;
+        }
+
+        // Samples equal to the background are not written, only bricks with a surface nearby are allocated
+        SparseScalarField3D sparse(resolution, resolution, resolution, 0.0f);
+        for (uint32_t z = 0; z < resolution; ++z) {
+            for (uint32_t y = 0; y < resolution; ++y) {
+                const float *row = field.row(y, z);
+                for (uint32_t x = 0; x < resolution; ++x) {
+                    if (row[x] != 0.0f) sparse.at(x, y, z) = row[x];
+                }
+            }
+        }
+        sparse.updateRanges();
+
+        return SyntheticField{std::move(field), std::move(sparse), isovalue};
+    }
+
+    // Clustered particles in field units, one grid cell per unit
+    std::vector<Particle> createParticles(uint32_t resolution) {
+        const std::size_t count = static_cast<std::size_t>(resolution) * resolution * resolution / 16;
+        const float extent = static_cast<float>(resolution);
+        Random random(resolution);
+
+        std::vector<std::array<float, 4> > clusters;
+        for (int i = 0; i < 32; ++i) {
+            clusters.push_back({random.next(0.2f, 0.8f), random.next(0.2f, 0.8f), random.next(0.2f, 0.8f),
+                                random.next(0.05f, 0.15f)});
+        }
+
+        std::vector<Particle> particles(count);
+        for (std::size_t i = 0; i < count; ++i) {
+            const auto &[cx, cy, cz, spread] = clusters[i % clusters.size()];
+            const float position[3] = {
+                (cx + spread * (random.next() * 2.0f - 1.0f) - 0.5f) * extent,
+                (cy + spread * (random.next() * 2.0f - 1.0f) - 0.5f) * extent,
+                (cz + spread * (random.next() * 2.0f - 1.0f) - 0.5f) * extent
+            };
+            Particle &p = particles[i];
+            p.position_x = half_float::half(position[0]);
+            p.position_y = half_float::half(position[1]);
+            p.position_z = half_float::half(position[2]);
+            p.velocity_x = p.velocity_y = p.velocity_z = half_float::half(0.0f);
+            p.rho = half_float::half(1.0f);
+            p.pressure = half_float::half(0.0f);
+            p.radius = half_float::half(1.0f);
+        }
+        return particles;
+    }
+
+    struct Output {
+        std::size_t triangles = 0;
+        std::size_t bytes = 0;
+    };
+
+    Output outputOf(const std::vector<Hammock::Triangle> &triangles) {
+        return {triangles.size(), triangles.size() * sizeof(Hammock::Triangle)};
+    }
+
+    Output outputOf(const IndexedMesh &mesh) {
+        return {
+            mesh.indices.size() / 3,
+            mesh.vertices.size() * sizeof(Hammock::Vertex) + mesh.indices.size() * sizeof(uint32_t)
+        };
+    }
+
+    Output outputOf(const SparseScalarField3D &field) {
+        return {0, field.bytes()};
+    }
+
+    struct Result {
+        std::string field;
+        uint32_t resolution;
+        std::string variant;
+        uint32_t threads;
+        double ms;
+        std::size_t cells;
+        std::size_t triangles;
+        std::size_t allocatedBytes;
+        std::size_t outputBytes;
+        std::size_t peakResidentBytes;
+        std::optional<bool> identical; // to the reference of the variant, if it has one
+    };
+
+    // Best time over the iterations, the allocations of the first one
+    template<typename Func>
+    Result measure(int iterations, Func &&func) {
+        Result result{};
+        result.ms = std::numeric_limits<double>::max();
+        for (int i = 0; i < iterations; ++i) {
+            const std::size_t allocatedBefore = allocatedBytes.load(std::memory_order_relaxed);
+            const auto start = std::chrono::high_resolution_clock::now();
+            const Output output = func();
+            const auto end = std::chrono::high_resolution_clock::now();
+            if (i == 0) {
+                result.allocatedBytes = allocatedBytes.load(std::memory_order_relaxed) - allocatedBefore;
+                result.triangles = output.triangles;
+                result.outputBytes = output.bytes;
+            }
+            result.ms = std::min(result.ms, std::chrono::duration<double, std::milli>(end - start).count());
+        }
+        result.peakResidentBytes = peakResidentBytes();
+        return result;
+    }
+
+    template<typename T>
+    bool sameBytes(const std::vector<T> &a, const std::vector<T> &b) {
+        return a.size() == b.size() && std::memcmp(a.data(), b.data(), a.size() * sizeof(T)) == 0;
+    }
+
+    bool sameMesh(const IndexedMesh &a, const IndexedMesh &b) {
+        return sameBytes(a.vertices, b.vertices) && a.indices == b.indices;
+    }
+
+    // Bricks may be allocated in a different order, samples are compared brick by brick
+    bool sameField(const SparseScalarField3D &a, const SparseScalarField3D &b) {
+        if (a.brickCount() != b.brickCount() || a.allocatedBricks() != b.allocatedBricks()) return false;
+        for (std::size_t brick = 0; brick < a.brickCount(); ++brick) {
+            const float *x = a.brickData(brick), *y = b.brickData(brick);
+            if ((x == nullptr) != (y == nullptr)) return false;
+            if (x && std::memcmp(x, y, SparseScalarField3D::BRICK_VOLUME * sizeof(float)) != 0) return false;
+        }
+        return true;
+    }
+
+    double perSecond(std::size_t count, double ms) {
+        return ms > 0.0 ? static_cast<double>(count) * 1000.0 / ms : 0.0;
+    }
+
+    void printCsv(const std::vector<Result> &results) {
+        std::cout << "field,resolution,variant,threads,ms,cells,cells_per_s,triangles,triangles_per_s,"
+                "allocated_bytes,output_bytes,peak_rss_bytes,identical\n";
+        for (const Result &r: results) {
+            std::cout << r.field << "," << r.resolution << "," << r.variant << "," << r.threads << "," << r.ms << ","
+                    << r.cells << "," << perSecond(r.cells, r.ms) << "," << r.triangles << ","
+                    << perSecond(r.triangles, r.ms) << "," << r.allocatedBytes << "," << r.outputBytes << ","
+                    << r.peakResidentBytes << "," << (r.identical ? (*r.identical ? "1" : "0") : "") << "\n";
+        }
+    }
+
+    void printJson(const std::vector<Result> &results) {
+        std::cout << "[\n";
+        for (std::size_t i = 0; i < results.size(); ++i) {
+            const Result &r = results[i];
+            std::cout << "  {\"field\": \"" << r.field << "\", \"resolution\": " << r.resolution
+                    << ", \"variant\": \"" << r.variant << "\", \"threads\": " << r.threads << ", \"ms\": " << r.ms
+                    << ", \"cells\": " << r.cells << ", \"cells_per_s\": " << perSecond(r.cells, r.ms)
+                    << ", \"triangles\": " << r.triangles << ", \"triangles_per_s\": "
+                    << perSecond(r.triangles, r.ms) << ", \"allocated_bytes\": " << r.allocatedBytes
+                    << ", \"output_bytes\": " << r.outputBytes << ", \"peak_rss_bytes\": " << r.peakResidentBytes
+                    << ", \"identical\": " << (r.identical ? (*r.identical ? "true" : "false") : "null") << "}"
+                    << (i + 1 < results.size() ? ",\n" : "\n");
+        }
+        std::cout << "]\n";
+    }
+
+    void benchmarkField(const std::string &name, uint32_t resolution, int iterations,
+                        Hammock::ThreadPool &threadPool, std::optional<float> isovalueOverride,
+                        std::vector<Result> &results) {
+        const uint32_t threads = static_cast<uint32_t>(threadPool.threads.size());
+        const std::size_t cells = static_cast<std::size_t>(resolution - 1) * (resolution - 1) * (resolution - 1);
+        auto add = [&](const std::string &variant, uint32_t variantThreads, Result result,
+                       std::optional<bool> identical = std::nullopt) {
+            result.field = name;
+            result.resolution = resolution;
+            result.variant = variant;
+            result.threads = variantThreads;
+            result.cells = cells;
+            result.identical = identical;
+            results.push_back(std::move(result));
+        };
+
+        std::optional<SyntheticField> field = createField(name, resolution);
+        if (!field) return;
+        const float isovalue = isovalueOverride.value_or(field->isovalue);
+
+        // Variants with a reference are compared to it after they ran
+        std::vector<Hammock::Triangle> soup, soupParallel;
+        add("soup", 1, measure(iterations, [&] {
+            soup = marchingCubes(field->dense, isovalue, 1.0f);
+            return outputOf(soup);
+        }));
+        Result result = measure(iterations, [&] {
+            soupParallel = marchingCubesParallel(field->dense, isovalue, 1.0f, threadPool);
+            return outputOf(soupParallel);
+        });
+        add("soup_parallel", threads, result, sameBytes(soup, soupParallel));
+        soup = {};
+        soupParallel = {};
+
+        IndexedMesh sparse, mesh;
+        add("indexed", 1, measure(iterations, [&] {
+            mesh = marchingCubesIndexed(field->dense, isovalue, 1.0f);
+            return outputOf(mesh);
+        }));
+        add("indexed_parallel", threads, measure(iterations, [&] {
+            mesh = marchingCubesIndexedParallel(field->dense, isovalue, 1.0f, threadPool);
+            return outputOf(mesh);
+        }));
+
+        // Sparse extractors start from the sparse field, which covers what the dense field would have cost
+        // Vertices on brick faces are duplicated, so the mesh is not comparable to the dense one
+        add("sparse", threads, measure(iterations, [&] {
+            sparse = marchingCubesSparse(field->sparse, isovalue, 1.0f, threadPool);
+            return outputOf(sparse);
+        }));
+        add("surface_nets", threads, measure(iterations, [&] {
+            mesh = extractIsosurfaceSparse(field->sparse, isovalue, 1.0f, threadPool, IsosurfaceMethod::SurfaceNets);
+            return outputOf(mesh);
+        }));
+        add("dual_contouring", threads, measure(iterations, [&] {
+            mesh = extractIsosurfaceSparse(field->sparse, isovalue, 1.0f, threadPool,
+                                           IsosurfaceMethod::DualContouring);
+            return outputOf(mesh);
+        }));
+
+        SpanSpaceIndex index;
+        add("span_space_build", 1, measure(iterations, [&] {
+            index = SpanSpaceIndex(field->sparse);
+            return Output{0, index.bytes()};
+        }));
+        result = measure(iterations, [&] {
+            mesh = extractIsosurfaceIndexed(field->sparse, index, isovalue, 1.0f, threadPool);
+            return outputOf(mesh);
+        });
+        add("span_space", threads, result, sameMesh(sparse, mesh));
+    }
+
+    void benchmarkParticles(uint32_t resolution, int iterations, Hammock::ThreadPool &threadPool,
+                            std::vector<Result> &results) {
+        const std::vector<Particle> records = createParticles(resolution);
+        const std::size_t cells = static_cast<std::size_t>(resolution - 1) * (resolution - 1) * (resolution - 1);
+        auto add = [&](const std::string &variant, uint32_t threads, Result result,
+                       std::optional<bool> identical = std::nullopt) {
+            result.field = "particles";
+            result.resolution = resolution;
+            result.variant = variant;
+            result.threads = threads;
+            result.cells = cells;
+            result.identical = identical;
+            results.push_back(std::move(result));
+        };
+
+        ParticleArrays particles;
+        add("particles_convert", 1, measure(iterations, [&] {
+            particles.assign(records.data(), records.size());
+            return Output{0, particles.size() * 9 * sizeof(float)};
+        }));
+
+        // One cell per unit, the field spans the particle positions
+        const float fieldSize = static_cast<float>(resolution);
+        SparseScalarField3D grid, sorted;
+        add("particles_grid", 1, measure(iterations, [&] {
+            grid = createSparseScalarField(particles, 1.0f, fieldSize);
+            return outputOf(grid);
+        }));
+        const uint32_t threads = static_cast<uint32_t>(threadPool.threads.size());
+        Result result = measure(iterations, [&] {
+            MortonSorter sorter;
+            sorted = createSparseScalarFieldSorted(particles, 1.0f, fieldSize, sorter, threadPool);
+            return outputOf(sorted);
+        });
+        add("particles_grid_sorted", threads, result, sameField(grid, sorted));
+        // The same particles every iteration, measures the reuse of the previous permutation
+        MortonSorter sorter;
+        sorter.sort(particles, fieldSize, static_cast<int>(resolution), threadPool);
+        result = measure(iterations, [&] {
+            sorted = createSparseScalarFieldSorted(particles, 1.0f, fieldSize, sorter, threadPool);
+            return outputOf(sorted);
+        });
+        add("particles_grid_sorted_reuse", threads, result, sameField(grid, sorted));
+        grid = {};
+        sorted = {};
+        add("particles_splat", static_cast<uint32_t>(threadPool.threads.size()), measure(iterations, [&] {
+            return outputOf(createSparseScalarFieldSplat(particles, 1.0f, fieldSize, threadPool));
+        }));
+    }
+}
+
+int main(int argc, char *argv[]) {
+    Hammock::ArgParser parser;
+    parser.addArgument<std::string>("resolutions", "Comma separated field resolutions per axis (default 64,128,256)");
+    parser.addArgument<std::string>("fields",
+                                    "Comma separated fields out of spheres, gyroid, noise, blobs and particles "
+                                    "(default all)");
+    parser.addArgument<int>("iterations", "Runs per configuration, the best one is reported (default 3)");
+    parser.addArgument<uint32_t>("threads", "Threads of the parallel variants (default hardware concurrency)");
+    parser.addArgument<float>("isovalue", "Isovalue of the extracted surface (default chosen per field)");
+    parser.addArgument<std::string>("format", "csv or json (default csv)");
+
+    try {
+        parser.parse(argc, argv);
+    } catch (const std::exception &e) {
+        Hammock::Logger::log(Hammock::LOG_LEVEL_ERROR, "%s\n", e.what());
+        parser.printHelp();
+        return EXIT_FAILURE;
+    }
+
+    const std::vector<std::string> fields = split(argumentOr<std::string>(parser, "fields",
+                                                                          "spheres,gyroid,noise,blobs,particles"));
+    const int iterations = std::max(1, argumentOr<int>(parser, "iterations", 3));
+    const uint32_t threads = argumentOr<uint32_t>(parser, "threads", std::max(1u, std::thread::hardware_concurrency()));
+    const std::string format = argumentOr<std::string>(parser, "format", "csv");
+    std::optional<float> isovalue;
+    if (const float value = argumentOr<float>(parser, "isovalue", std::numeric_limits<float>::quiet_NaN());
+        !std::isnan(value)) {
+        isovalue = value;
+    }
+
+    std::vector<uint32_t> resolutions;
+    for (const std::string &item: split(argumentOr<std::string>(parser, "resolutions", "64,128,256"))) {
+        const unsigned long resolution = std::strtoul(item.c_str(), nullptr, 10);
+        if (resolution < 2) {
+            Hammock::Logger::log(Hammock::LOG_LEVEL_ERROR, "Invalid resolution %s\n", item.c_str());
+            return EXIT_FAILURE;
+        }
+        resolutions.push_back(static_cast<uint32_t>(resolution));
+    }
+    for (const std::string &field: fields) {
+        if (std::ranges::find(FIELDS, field) == std::end(FIELDS)) {
+            Hammock::Logger::log(Hammock::LOG_LEVEL_ERROR, "Unknown field %s\n", field.c_str());
+            return EXIT_FAILURE;
+        }
+    }
+    if (format != "csv" && format != "json") {
+        Hammock::Logger::log(Hammock::LOG_LEVEL_ERROR, "Unknown format %s\n", format.c_str());
+        return EXIT_FAILURE;
+    }
+
+    Hammock::ThreadPool threadPool;
+    threadPool.setThreadCount(threads);
+
+    std::vector<Result> results;
+    for (const uint32_t resolution: resolutions) {
+        for (const std::string &field: fields) {
+            if (field == "particles") {
+                benchmarkParticles(resolution, iterations, threadPool, results);
+            } else {
+                benchmarkField(field, resolution, iterations, threadPool, isovalue, results);
+            }
+        }
+    }
+
+    if (format == "json") {
+        printJson(results);
+    } else {
+        printCsv(results);
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,162 @@
+#include "BrickMeshBuffer.h"
+
+#include <algorithm>
+
+BrickMeshBuffer::BrickMeshBuffer(Hammock::DeviceStorage &deviceStorage, bool multiDrawIndirect,
+                                 uint32_t vertexCapacity, uint32_t indexCapacity): deviceStorage(deviceStorage),
+                                                          multiDrawIndirect(multiDrawIndirect),
+                                                          vertexRanges(vertexCapacity),
+                                                          indexRanges(indexCapacity),
+                                                          commandSlots(Hammock::SwapChain::MAX_FRAMES_IN_FLIGHT) {
+    vertexBuffer = createBuffer(sizeof(Hammock::Vertex), vertexCapacity, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT);
+    indexBuffer = createBuffer(sizeof(uint32_t), indexCapacity, VK_BUFFER_USAGE_INDEX_BUFFER_BIT);
+}
+
+void BrickMeshBuffer::apply(BrickPatch &patch, uint64_t frame) {
+    if (patch.reset) {
+        while (!bricks.empty()) retire(bricks.begin()->first, frame);
+    }
+    for (const uint32_t brick: patch.removed) {
+        retire(brick, frame);
+    }
+
+    for (auto &[brick, mesh]: patch.updated) {
+        retire(brick, frame);
+
+        const auto vertexCount = static_cast<uint32_t>(mesh.vertices.size());
+        const auto indexCount = static_cast<uint32_t>(mesh.indices.size());
+        const BrickRange range = allocate(vertexCount, indexCount, frame);
+
+        deviceStorage.getBuffer(vertexBuffer)->writeToBuffer(mesh.vertices.data(),
+                                                             vertexCount * sizeof(Hammock::Vertex),
+                                                             range.firstVertex * sizeof(Hammock::Vertex));
+        deviceStorage.getBuffer(indexBuffer)->writeToBuffer(mesh.indices.data(), indexCount * sizeof(uint32_t),
+                                                            range.firstIndex * sizeof(uint32_t));
+        bricks[brick] = range;
+    }
+    ++version;
+}
+
+void BrickMeshBuffer::collect(uint64_t frame) {
+    std::erase_if(retiredRanges, [this, frame](const RetiredRange &retired) {
+        if (frame < retired.retiredAt + Hammock::SwapChain::MAX_FRAMES_IN_FLIGHT) return false;
+        vertexRanges.release(retired.range.firstVertex, retired.range.vertexCount);
+        indexRanges.release(retired.range.firstIndex, retired.range.indexCount);
+        return true;
+    });
+
+    std::erase_if(retiredBuffers, [this, frame](const RetiredBuffer &retired) {
+        if (frame < retired.retiredAt + Hammock::SwapChain::MAX_FRAMES_IN_FLIGHT) return false;
+        deviceStorage.destroyBuffer(retired.buffer);
+        return true;
+    });
+}
+
+void BrickMeshBuffer::draw(VkCommandBuffer commandBuffer, uint32_t slot) {
+    if (bricks.empty()) return;
+
+    if (commandsVersion != version) {
+        // Brick indices start at zero, the vertex offset moves them to the brick's range. Commands are
+        // ordered by their index range, so the draw walks the index buffer front to back.
+        commands.clear();
+        commands.reserve(bricks.size());
+        for (const auto &[brick, range]: bricks) {
+            commands.push_back({range.indexCount, 1, range.firstIndex, static_cast<int32_t>(range.firstVertex), 0});
+        }
+        std::sort(commands.begin(), commands.end(),
+                  [](const VkDrawIndexedIndirectCommand &a, const VkDrawIndexedIndirectCommand &b) {
+                      return a.firstIndex < b.firstIndex;
+                  });
+        commandsVersion = version;
+    }
+
+    // The previous frame that used this slot has completed, so its commands can be overwritten in place
+    CommandSlot &current = commandSlots[slot];
+    if (current.version != version) {
+        const auto count = static_cast<uint32_t>(commands.size());
+        if (current.capacity < count) {
+            if (current.buffer.isValid()) deviceStorage.destroyBuffer(current.buffer);
+            current.capacity = std::max(count + count / 2, 64u);
+            current.buffer = createBuffer(sizeof(VkDrawIndexedIndirectCommand), current.capacity,
+                                          VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT);
+        }
+        deviceStorage.getBuffer(current.buffer)->writeToBuffer(commands.data(),
+                                                               count * sizeof(VkDrawIndexedIndirectCommand), 0);
+        current.version = version;
+    }
+
+    deviceStorage.bindVertexBuffer(vertexBuffer, indexBuffer, commandBuffer);
+    const VkBuffer buffer = deviceStorage.getBuffer(current.buffer)->getBuffer();
+    if (multiDrawIndirect) {
+        vkCmdDrawIndexedIndirect(commandBuffer, buffer, 0, static_cast<uint32_t>(commands.size()),
+                                 sizeof(VkDrawIndexedIndirectCommand));
+        return;
+    }
+    // A draw count above one needs the feature
+    for (std::size_t i = 0; i < commands.size(); ++i) {
+        vkCmdDrawIndexedIndirect(commandBuffer, buffer, i * sizeof(VkDrawIndexedIndirectCommand), 1,
+                                 sizeof(VkDrawIndexedIndirectCommand));
+    }
+}
+
+void BrickMeshBuffer::destroy() {
+    for (const auto &retired: retiredBuffers) deviceStorage.destroyBuffer(retired.buffer);
+    retiredBuffers.clear();
+    retiredRanges.clear();
+    bricks.clear();
+    for (CommandSlot &slot: commandSlots) {
+        if (slot.buffer.isValid()) deviceStorage.destroyBuffer(slot.buffer);
+        slot = CommandSlot{};
+    }
+    if (vertexBuffer.isValid()) deviceStorage.destroyBuffer(vertexBuffer);
+    if (indexBuffer.isValid()) deviceStorage.destroyBuffer(indexBuffer);
+    vertexBuffer = {};
+    indexBuffer = {};
+}
+
+void BrickMeshBuffer::retire(uint32_t brick, uint64_t frame) {
+    const auto it = bricks.find(brick);
+    if (it == bricks.end()) return;
+    retiredRanges.push_back({it->second, frame});
+    bricks.erase(it);
+}
+
+BrickMeshBuffer::BrickRange BrickMeshBuffer::allocate(uint32_t vertexCount, uint32_t indexCount, uint64_t frame) {
+    auto firstVertex = vertexRanges.allocate(vertexCount);
+    if (!firstVertex) {
+        grow(vertexBuffer, vertexRanges, sizeof(Hammock::Vertex), vertexCount, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+             frame);
+        firstVertex = vertexRanges.allocate(vertexCount);
+    }
+
+    auto firstIndex = indexRanges.allocate(indexCount);
+    if (!firstIndex) {
+        grow(indexBuffer, indexRanges, sizeof(uint32_t), indexCount, VK_BUFFER_USAGE_INDEX_BUFFER_BIT, frame);
+        firstIndex = indexRanges.allocate(indexCount);
+    }
+
+    return {*firstVertex, vertexCount, *firstIndex, indexCount};
+}
+
+Hammock::ResourceHandle<Hammock::Buffer> BrickMeshBuffer::createBuffer(VkDeviceSize elementSize, uint32_t count,
+                                                                       VkBufferUsageFlags usage) {
+    return deviceStorage.createBuffer({
+        .instanceSize = elementSize,
+        .instanceCount = count,
+        .usageFlags = usage,
+        .memoryPropertyFlags = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
+    });
+}
+
+void BrickMeshBuffer::grow(Hammock::ResourceHandle<Hammock::Buffer> &buffer, RangeAllocator &ranges,
+                           VkDeviceSize elementSize, uint32_t required, VkBufferUsageFlags usage, uint64_t frame) {
+    // Live ranges keep their offsets, the old buffer is still read by frames in flight
+    const uint32_t capacity = std::max(ranges.capacity() * 2, ranges.capacity() + required);
+    const auto grown = createBuffer(elementSize, capacity, usage);
+    deviceStorage.getBuffer(grown)->writeToBuffer(deviceStorage.getBuffer(buffer)->getMappedMemory(),
+                                                  ranges.capacity() * elementSize, 0);
+
+    retiredBuffers.push_back({buffer, frame});
+    buffer = grown;
+    ranges.grow(capacity);
+}
@@ -0,0 +1,137 @@
+#pragma once
+#include <cstdint>
+#include <map>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+#include <hammock/hammock.h>
+
+#include "IncrementalMesher.h"
+
+// First fit allocator of element ranges, adjacent free ranges are merged when released
+class RangeAllocator {
+public:
+    explicit RangeAllocator(uint32_t capacity = 0) { grow(capacity); }
+
+    std::optional<uint32_t> allocate(uint32_t count) {
+        for (auto it = freeRanges.begin(); it != freeRanges.end(); ++it) {
+            if (it->second < count) continue;
+            const uint32_t offset = it->first;
+            const uint32_t remaining = it->second - count;
+            freeRanges.erase(it);
+            if (remaining > 0) freeRanges.emplace(offset + count, remaining);
+            used_ += count;
+            return offset;
+        }
+        return std::nullopt;
+    }
+
+    void release(uint32_t offset, uint32_t count) {
+        used_ -= count;
+        auto next = freeRanges.lower_bound(offset);
+        if (next != freeRanges.end() && offset + count == next->first) {
+            count += next->second;
+            next = freeRanges.erase(next);
+        }
+        if (next != freeRanges.begin()) {
+            auto previous = std::prev(next);
+            if (previous->first + previous->second == offset) {
+                previous->second += count;
+                return;
+            }
+        }
+        freeRanges.emplace(offset, count);
+    }
+
+    // Appends [capacity, newCapacity) to the free ranges
+    void grow(uint32_t newCapacity) {
+        if (newCapacity <= capacity_) return;
+        const uint32_t added = newCapacity - capacity_;
+        const uint32_t offset = capacity_;
+        capacity_ = newCapacity;
+        used_ += added;
+        release(offset, added);
+    }
+
+    [[nodiscard]] uint32_t capacity() const { return capacity_; }
+    [[nodiscard]] uint32_t used() const { return used_; }
+
+private:
+    std::map<uint32_t, uint32_t> freeRanges; // offset -> count
+    uint32_t capacity_ = 0;
+    uint32_t used_ = 0;
+};
+
+// Brick meshes of an IncrementalMesher living in one shared vertex and index buffer.
+// Patches write the new brick meshes into free ranges of the buffers, ranges of replaced or removed
+// bricks are only released once no frame in flight can read them anymore. The buffers are host visible,
+// so a patch is a plain memcpy of the changed bricks, and grow by copying when they run out of space.
+// All bricks are drawn by one indirect draw, every frame in flight has its own list of draw commands
+// that is rewritten when a patch changed the bricks. Without multiDrawIndirect the same commands are
+// drawn one at a time.
+class BrickMeshBuffer {
+public:
+    BrickMeshBuffer(Hammock::DeviceStorage &deviceStorage, bool multiDrawIndirect, uint32_t vertexCapacity = 1 << 16,
+                    uint32_t indexCapacity = 1 << 18);
+
+    // frame is the number of the frame that is rendered next
+    void apply(BrickPatch &patch, uint64_t frame);
+
+    // Releases ranges and buffers that frames in flight stopped using. frame is the number of the frame
+    // being recorded, called once beginFrame waited for the fence of frame - MAX_FRAMES_IN_FLIGHT.
+    void collect(uint64_t frame);
+
+    // Binds the buffers and draws every brick, slot is the frame in flight the command buffer belongs to
+    void draw(VkCommandBuffer commandBuffer, uint32_t slot);
+
+    void destroy();
+
+    [[nodiscard]] std::size_t brickCount() const { return bricks.size(); }
+    [[nodiscard]] uint32_t vertexCount() const { return vertexRanges.used(); }
+
+private:
+    struct BrickRange {
+        uint32_t firstVertex, vertexCount;
+        uint32_t firstIndex, indexCount;
+    };
+
+    struct RetiredRange {
+        BrickRange range;
+        uint64_t retiredAt;
+    };
+
+    struct RetiredBuffer {
+        Hammock::ResourceHandle<Hammock::Buffer> buffer;
+        uint64_t retiredAt;
+    };
+
+    // Draw commands of one frame in flight
+    struct CommandSlot {
+        Hammock::ResourceHandle<Hammock::Buffer> buffer{};
+        uint32_t capacity = 0;
+        uint64_t version = 0;
+    };
+
+    void retire(uint32_t brick, uint64_t frame);
+    BrickRange allocate(uint32_t vertexCount, uint32_t indexCount, uint64_t frame);
+    Hammock::ResourceHandle<Hammock::Buffer> createBuffer(VkDeviceSize elementSize, uint32_t count,
+                                                          VkBufferUsageFlags usage);
+    void grow(Hammock::ResourceHandle<Hammock::Buffer> &buffer, RangeAllocator &ranges, VkDeviceSize elementSize,
+              uint32_t required, VkBufferUsageFlags usage, uint64_t frame);
+
+    Hammock::DeviceStorage &deviceStorage;
+    bool multiDrawIndirect;
+    Hammock::ResourceHandle<Hammock::Buffer> vertexBuffer{};
+    Hammock::ResourceHandle<Hammock::Buffer> indexBuffer{};
+    RangeAllocator vertexRanges;
+    RangeAllocator indexRanges;
+    std::unordered_map<uint32_t, BrickRange> bricks;
+    std::vector<RetiredRange> retiredRanges;
+    std::vector<RetiredBuffer> retiredBuffers;
+    // Bumped by every patch, slots with an older version rewrite their commands before drawing
+    uint64_t version = 1;
+    std::vector<VkDrawIndexedIndirectCommand> commands;
+    uint64_t commandsVersion = 0;
+    std::vector<CommandSlot> commandSlots;
+};
@@ -0,0 +1,174 @@
+#pragma once
+#include <bit>
+#include <cstdint>
+#include <vector>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define MC_CLASSIFY_AVX2
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define MC_CLASSIFY_SSE2
+#endif
+
+#include "ScalarField3D.h"
+
+// Classifies a whole row of marching cubes cells at once and compacts the cells that intersect the
+// surface into a list. Most cells of a typical field are fully inside or outside, so the rest of the
+// pipeline only ever touches the active ones.
+//
+// The vector width is chosen at compile time: AVX2 when the compiler targets it (see the
+// MARCHING_CUBES_AVX2 CMake option), SSE2 on any other x86-64 build and a scalar loop elsewhere.
+class CellClassifier {
+public:
+    explicit CellClassifier(const ScalarField3D &scalarField)
+        : cellCount(scalarField.sizeX() > 0 ? static_cast<int>(scalarField.sizeX() - 1) : 0) {
+        activeCells.resize(cellCount);
+        cubeIndices.resize(cellCount);
+        if (scalarField.layout() != ScalarField3D::Layout::Linear) {
+            // Rows of a z-order field are not contiguous, they are gathered here first
+            gathered.resize(4 * static_cast<std::size_t>(scalarField.sizeX()));
+        }
+    }
+
+    // Classifies cells (0..nx-1, y, z), returns the number of active cells. Their x coordinates are
+    // in activeCells and their cube indices in cubeIndices.
+    int classify(const ScalarField3D &scalarField, uint32_t y, uint32_t z, float isovalue) {
+        const float *r00, *r10, *r01, *r11;
+        if (scalarField.layout() == ScalarField3D::Layout::Linear) {
+            r00 = scalarField.row(y, z);
+            r10 = scalarField.row(y + 1, z);
+            r01 = scalarField.row(y, z + 1);
+            r11 = scalarField.row(y + 1, z + 1);
+        } else {
+            const uint32_t nx = scalarField.sizeX();
+            float *rows = gathered.data();
+            for (uint32_t x = 0; x < nx; ++x) {
+                rows[x] = scalarField.at(x, y, z);
+                rows[nx + x] = scalarField.at(x, y + 1, z);
+                rows[2 * nx + x] = scalarField.at(x, y, z + 1);
+                rows[3 * nx + x] = scalarField.at(x, y + 1, z + 1);
+            }
+            r00 = rows;
+            r10 = rows + nx;
+            r01 = rows + 2 * nx;
+            r11 = rows + 3 * nx;
+        }
+        return classifyRow(r00, r10, r01, r11, cellCount, isovalue, activeCells.data(), cubeIndices.data());
+    }
+
+    // Rows hold samples (x, y, z), (x, y + 1, z), (x, y, z + 1) and (x, y + 1, z + 1), each with
+    // cellCount + 1 valid entries
+    static int classifyRow(const float *r00, const float *r10, const float *r01, const float *r11, int cellCount,
+                           float isovalue, int *activeCells, uint8_t *cubeIndices) {
+        int active = 0;
+        int x = 0;
+
+#if defined(MC_CLASSIFY_AVX2)
+        const __m256 iso = _mm256_set1_ps(isovalue);
+        alignas(32) int32_t indices[8];
+        for (; x + 8 <= cellCount; x += 8) {
+            const __m256 c0 = _mm256_cmp_ps(_mm256_loadu_ps(r00 + x), iso, _CMP_LT_OQ);
+            const __m256 c1 = _mm256_cmp_ps(_mm256_loadu_ps(r00 + x + 1), iso, _CMP_LT_OQ);
+            const __m256 c2 = _mm256_cmp_ps(_mm256_loadu_ps(r10 + x + 1), iso, _CMP_LT_OQ);
+            const __m256 c3 = _mm256_cmp_ps(_mm256_loadu_ps(r10 + x), iso, _CMP_LT_OQ);
+            const __m256 c4 = _mm256_cmp_ps(_mm256_loadu_ps(r01 + x), iso, _CMP_LT_OQ);
+            const __m256 c5 = _mm256_cmp_ps(_mm256_loadu_ps(r01 + x + 1), iso, _CMP_LT_OQ);
+            const __m256 c6 = _mm256_cmp_ps(_mm256_loadu_ps(r11 + x + 1), iso, _CMP_LT_OQ);
+            const __m256 c7 = _mm256_cmp_ps(_mm256_loadu_ps(r11 + x), iso, _CMP_LT_OQ);
+
+            // A cell is active when some but not all of its corners are below the isovalue
+            const __m256 any = _mm256_or_ps(_mm256_or_ps(_mm256_or_ps(c0, c1), _mm256_or_ps(c2, c3)),
+                                            _mm256_or_ps(_mm256_or_ps(c4, c5), _mm256_or_ps(c6, c7)));
+            const __m256 all = _mm256_and_ps(_mm256_and_ps(_mm256_and_ps(c0, c1), _mm256_and_ps(c2, c3)),
+                                             _mm256_and_ps(_mm256_and_ps(c4, c5), _mm256_and_ps(c6, c7)));
+            unsigned mask = static_cast<unsigned>(_mm256_movemask_ps(_mm256_andnot_ps(all, any)));
+            if (mask == 0) continue;
+
+            __m256i index = _mm256_and_si256(_mm256_castps_si256(c0), _mm256_set1_epi32(1));
+            index = _mm256_or_si256(index, _mm256_and_si256(_mm256_castps_si256(c1), _mm256_set1_epi32(2)));
+            index = _mm256_or_si256(index, _mm256_and_si256(_mm256_castps_si256(c2), _mm256_set1_epi32(4)));
+            index = _mm256_or_si256(index, _mm256_and_si256(_mm256_castps_si256(c3), _mm256_set1_epi32(8)));
+            index = _mm256_or_si256(index, _mm256_and_si256(_mm256_castps_si256(c4), _mm256_set1_epi32(16)));
+            index = _mm256_or_si256(index, _mm256_and_si256(_mm256_castps_si256(c5), _mm256_set1_epi32(32)));
+            index = _mm256_or_si256(index, _mm256_and_si256(_mm256_castps_si256(c6), _mm256_set1_epi32(64)));
+            index = _mm256_or_si256(index, _mm256_and_si256(_mm256_castps_si256(c7), _mm256_set1_epi32(128)));
+            _mm256_store_si256(reinterpret_cast<__m256i *>(indices), index);
+
+            while (mask) {
+                const int i = std::countr_zero(mask);
+                activeCells[active] = x + i;
+                cubeIndices[active] = static_cast<uint8_t>(indices[i]);
+                ++active;
+                mask &= mask - 1;
+            }
+        }
+#elif defined(MC_CLASSIFY_SSE2)
+        const __m128 iso = _mm_set1_ps(isovalue);
+        alignas(16) int32_t indices[4];
+        for (; x + 4 <= cellCount; x += 4) {
+            const __m128 c0 = _mm_cmplt_ps(_mm_loadu_ps(r00 + x), iso);
+            const __m128 c1 = _mm_cmplt_ps(_mm_loadu_ps(r00 + x + 1), iso);
+            const __m128 c2 = _mm_cmplt_ps(_mm_loadu_ps(r10 + x + 1), iso);
+            const __m128 c3 = _mm_cmplt_ps(_mm_loadu_ps(r10 + x), iso);
+            const __m128 c4 = _mm_cmplt_ps(_mm_loadu_ps(r01 + x), iso);
+            const __m128 c5 = _mm_cmplt_ps(_mm_loadu_ps(r01 + x + 1), iso);
+            const __m128 c6 = _mm_cmplt_ps(_mm_loadu_ps(r11 + x + 1), iso);
+            const __m128 c7 = _mm_cmplt_ps(_mm_loadu_ps(r11 + x), iso);
+
+            // A cell is active when some but not all of its corners are below the isovalue
+            const __m128 any = _mm_or_ps(_mm_or_ps(_mm_or_ps(c0, c1), _mm_or_ps(c2, c3)),
+                                         _mm_or_ps(_mm_or_ps(c4, c5), _mm_or_ps(c6, c7)));
+            const __m128 all = _mm_and_ps(_mm_and_ps(_mm_and_ps(c0, c1), _mm_and_ps(c2, c3)),
+                                          _mm_and_ps(_mm_and_ps(c4, c5), _mm_and_ps(c6, c7)));
+            unsigned mask = static_cast<unsigned>(_mm_movemask_ps(_mm_andnot_ps(all, any)));
+            if (mask == 0) continue;
+
+            __m128i index = _mm_and_si128(_mm_castps_si128(c0), _mm_set1_epi32(1));
+            index = _mm_or_si128(index, _mm_and_si128(_mm_castps_si128(c1), _mm_set1_epi32(2)));
+            index = _mm_or_si128(index, _mm_and_si128(_mm_castps_si128(c2), _mm_set1_epi32(4)));
+            index = _mm_or_si128(index, _mm_and_si128(_mm_castps_si128(c3), _mm_set1_epi32(8)));
+            index = _mm_or_si128(index, _mm_and_si128(_mm_castps_si128(c4), _mm_set1_epi32(16)));
+            index = _mm_or_si128(index, _mm_and_si128(_mm_castps_si128(c5), _mm_set1_epi32(32)));
+            index = _mm_or_si128(index, _mm_and_si128(_mm_castps_si128(c6), _mm_set1_epi32(64)));
+            index = _mm_or_si128(index, _mm_and_si128(_mm_castps_si128(c7), _mm_set1_epi32(128)));
+            _mm_store_si128(reinterpret_cast<__m128i *>(indices), index);
+
+            while (mask) {
+                const int i = std::countr_zero(mask);
+                activeCells[active] = x + i;
+                cubeIndices[active] = static_cast<uint8_t>(indices[i]);
+                ++active;
+                mask &= mask - 1;
+            }
+        }
+#endif
+
+        // Scalar fallback and remainder
+        for (; x < cellCount; ++x) {
+            int cubeIndex = 0;
+            if (r00[x] < isovalue) cubeIndex |= 1;
+            if (r00[x + 1] < isovalue) cubeIndex |= 2;
+            if (r10[x + 1] < isovalue) cubeIndex |= 4;
+            if (r10[x] < isovalue) cubeIndex |= 8;
+            if (r01[x] < isovalue) cubeIndex |= 16;
+            if (r01[x + 1] < isovalue) cubeIndex |= 32;
+            if (r11[x + 1] < isovalue) cubeIndex |= 64;
+            if (r11[x] < isovalue) cubeIndex |= 128;
+            if (cubeIndex == 0 || cubeIndex == 255) continue;
+
+            activeCells[active] = x;
+            cubeIndices[active] = static_cast<uint8_t>(cubeIndex);
+            ++active;
+        }
+
+        return active;
+    }
+
+    std::vector<int> activeCells;
+    std::vector<uint8_t> cubeIndices;
+
+private:
+    int cellCount;
+    std::vector<float> gathered;
+};
@@ -0,0 +1,80 @@
+#include "GeometryRing.h"
+
+#include <algorithm>
+
+GeometryRing::GeometryRing(Hammock::DeviceStorage &deviceStorage, VkDeviceSize capacity)
+    : deviceStorage(deviceStorage), capacity_((capacity + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT) {
+    buffer_ = deviceStorage.createBuffer({
+        .instanceSize = ALIGNMENT,
+        .instanceCount = static_cast<uint32_t>(capacity_ / ALIGNMENT),
+        .usageFlags = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT |
+                      VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+        .memoryPropertyFlags = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
+    });
+    mapped = static_cast<uint8_t *>(deviceStorage.getBuffer(buffer_)->getMappedMemory());
+}
+
+std::optional<GeometryRing::Allocation> GeometryRing::allocate(VkDeviceSize size) {
+    size = std::max<VkDeviceSize>((size + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT, ALIGNMENT);
+    if (size > capacity_) return std::nullopt;
+
+    std::unique_lock<std::mutex> lock(mutex);
+    std::optional<VkDeviceSize> offset;
+    rangeReleased.wait(lock, [&] {
+        offset = fit(size);
+        return offset || closed;
+    });
+    if (closed) return std::nullopt;
+
+    ranges.push_back({*offset, size, false});
+    head = *offset + size == capacity_ ? 0 : *offset + size;
+    return Allocation{firstId + ranges.size() - 1, *offset, size};
+}
+
+void GeometryRing::release(const Allocation &allocation) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (allocation.id < firstId || allocation.id - firstId >= ranges.size()) return;
+
+    ranges[allocation.id - firstId].released = true;
+    while (!ranges.empty() && ranges.front().released) {
+        ranges.pop_front();
+        ++firstId;
+    }
+    if (ranges.empty()) head = 0;
+    rangeReleased.notify_all();
+}
+
+void GeometryRing::close() {
+    std::lock_guard<std::mutex> lock(mutex);
+    closed = true;
+    rangeReleased.notify_all();
+}
+
+void GeometryRing::destroy() {
+    close();
+    if (buffer_.isValid()) deviceStorage.destroyBuffer(buffer_);
+    buffer_ = {};
+    mapped = nullptr;
+}
+
+VkDeviceSize GeometryRing::used() {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (ranges.empty()) return 0;
+    const VkDeviceSize tail = ranges.front().offset;
+    return head > tail ? head - tail : capacity_ - tail + head;
+}
+
+std::optional<VkDeviceSize> GeometryRing::fit(VkDeviceSize size) const {
+    if (ranges.empty()) return 0;
+
+    // With live ranges, head == tail means the ring is full
+    const VkDeviceSize tail = ranges.front().offset;
+    if (head > tail) {
+        if (capacity_ - head >= size) return head;
+        // Skip the rest of the buffer, it is reclaimed together with the ranges before it
+        if (tail >= size) return 0;
+        return std::nullopt;
+    }
+    if (head < tail && tail - head >= size) return head;
+    return std::nullopt;
+}
@@ -0,0 +1,70 @@
+#pragma once
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <optional>
+
+#include <hammock/hammock.h>
+
+// Persistently mapped ring of geometry for streamed frames, one host visible buffer that is used as
+// vertex, index and storage buffer at once. Producers on any thread allocate ranges and write straight into
+// the mapping, so a frame needs neither a staging buffer nor a transfer and playback memory stays
+// constant however long the sequence is. Ranges are handed out and reclaimed in ring order. A range
+// that is released early is only reclaimed once every range allocated before it is released too.
+//
+// Releasing is left to the owner, which has to wait for the in-flight fence of the last frame that read the
+// range. The mesher may overwrite it as soon as it is released.
+class GeometryRing {
+public:
+    struct Allocation {
+        uint64_t id;
+        VkDeviceSize offset;
+        VkDeviceSize size;
+    };
+
+    // Allocations start at multiples of this, which keeps the mapped writes cache line aligned
+    static constexpr VkDeviceSize ALIGNMENT = 64;
+
+    GeometryRing(Hammock::DeviceStorage &deviceStorage, VkDeviceSize capacity);
+
+    // Blocks until size bytes are free. Nothing if the ring was closed while waiting or the request
+    // could never fit.
+    std::optional<Allocation> allocate(VkDeviceSize size);
+
+    void release(const Allocation &allocation);
+
+    // Wakes every producer waiting in allocate, allocate fails from now on
+    void close();
+
+    void destroy();
+
+    [[nodiscard]] uint8_t *data(const Allocation &allocation) const { return mapped + allocation.offset; }
+    [[nodiscard]] Hammock::ResourceHandle<Hammock::Buffer> buffer() const { return buffer_; }
+    [[nodiscard]] VkDeviceSize capacity() const { return capacity_; }
+
+    // Bytes between the oldest live range and the write position, including skipped space at the end
+    [[nodiscard]] VkDeviceSize used();
+
+private:
+    struct Range {
+        VkDeviceSize offset;
+        VkDeviceSize size;
+        bool released;
+    };
+
+    // Offset of a new range of the given size, the caller holds the mutex
+    [[nodiscard]] std::optional<VkDeviceSize> fit(VkDeviceSize size) const;
+
+    Hammock::DeviceStorage &deviceStorage;
+    Hammock::ResourceHandle<Hammock::Buffer> buffer_{};
+    uint8_t *mapped = nullptr;
+    VkDeviceSize capacity_;
+
+    std::mutex mutex;
+    std::condition_variable rangeReleased;
+    std::deque<Range> ranges; // in allocation order, the front is the oldest
+    uint64_t firstId = 0; // id of ranges.front()
+    VkDeviceSize head = 0; // where the next range starts if it fits before the end
+    bool closed = false;
+};
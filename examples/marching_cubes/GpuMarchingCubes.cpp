@@ -0,0 +1,271 @@
+#include "GpuMarchingCubes.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "MarchingCubes.h"
+
+// The generate pass writes vertices as 12 floats
+static_assert(sizeof(Hammock::Vertex) == 12 * sizeof(float));
+
+GpuMarchingCubes::GpuMarchingCubes(Hammock::Device &device, Hammock::DeviceStorage &deviceStorage,
+                                   uint32_t slotCount): device(device), deviceStorage(deviceStorage),
+                                                        slots(slotCount) {
+    std::vector<Hammock::DeviceStorage::DescriptorSetLayoutCreateInfo::DescriptorSetLayoutBindingCreateInfo> bindings;
+    for (uint32_t binding = 0; binding < 5; ++binding) {
+        bindings.push_back({
+            .binding = binding, .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+            .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT
+        });
+    }
+    descriptorSetLayout = deviceStorage.createDescriptorSetLayout({.bindings = bindings});
+
+    // Triangles per case followed by the triangle table, as laid out by the Tables block of the shaders
+    std::vector<int32_t> tables(256 + 256 * 16);
+    for (int cubeIndex = 0; cubeIndex < 256; ++cubeIndex) {
+        int triangles = 0;
+        while (triangles < 5 && triTable[cubeIndex][triangles * 3] != -1) ++triangles;
+        tables[cubeIndex] = triangles;
+        std::memcpy(&tables[256 + cubeIndex * 16], triTable[cubeIndex], 16 * sizeof(int32_t));
+    }
+    tableBuffer = deviceStorage.createBuffer({
+        .instanceSize = sizeof(int32_t),
+        .instanceCount = static_cast<uint32_t>(tables.size()),
+        .usageFlags = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+        .memoryPropertyFlags = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
+    });
+    deviceStorage.getBuffer(tableBuffer)->writeToBuffer(tables.data());
+
+    // Read back for the triangle count, written by one invocation per frame
+    for (Slot &slot: slots) {
+        slot.drawBuffer = deviceStorage.createBuffer({
+            .instanceSize = sizeof(DrawData),
+            .instanceCount = 1,
+            .usageFlags = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+            .memoryPropertyFlags = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
+        });
+        const DrawData empty{{0, 1, 0, 0}, 0};
+        deviceStorage.getBuffer(slot.drawBuffer)->writeToBuffer(&empty);
+    }
+
+    classifyPipeline = createPipeline("mc_classify", "mc_classify.comp");
+    scanPipeline = createPipeline("mc_scan", "mc_scan.comp");
+    scanAddPipeline = createPipeline("mc_scan_add", "mc_scan_add.comp");
+    generatePipeline = createPipeline("mc_generate", "mc_generate.comp");
+}
+
+void GpuMarchingCubes::extract(VkCommandBuffer commandBuffer, uint32_t slot, const Field &field, float isovalue,
+                               float cubeSize) {
+    Slot &current = slots[slot];
+    if (field.size[0] < 2 || field.size[1] < 2 || field.size[2] < 2) {
+        // Nothing to march, the slot is not in flight so the host can clear its draw
+        const DrawData empty{{0, 1, 0, 0}, 0};
+        deviceStorage.getBuffer(current.drawBuffer)->writeToBuffer(&empty);
+        return;
+    }
+
+    const uint32_t cellCount = (field.size[0] - 1) * (field.size[1] - 1) * (field.size[2] - 1);
+    const std::vector<ScanLevel> levels = scanLevels(cellCount);
+    reserve(slot, field, levels.back().sumsOffset + 1);
+
+    PushData push{
+        .size = {field.size[0], field.size[1], field.size[2]},
+        .firstSample = field.firstSample,
+        .isovalue = isovalue,
+        .cubeSize = cubeSize,
+        .vertexCapacity = current.vertexCapacity,
+        .count = 0, .offset = 0, .sumsOffset = 0,
+        .totalOffset = levels.back().sumsOffset
+    };
+    const uint32_t cellGroups = (cellCount + GROUP_SIZE - 1) / GROUP_SIZE;
+
+    dispatch(commandBuffer, *classifyPipeline, current, push, cellGroups);
+    computeBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                   VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT);
+
+    // Up the levels until one block holds everything, then the block offsets are added back down
+    for (const ScanLevel &level: levels) {
+        push.count = level.count;
+        push.offset = level.offset;
+        push.sumsOffset = level.sumsOffset;
+        dispatch(commandBuffer, *scanPipeline, current, push, (level.count + SCAN_BLOCK - 1) / SCAN_BLOCK);
+        computeBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                       VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT);
+    }
+    for (auto level = levels.rbegin() + 1; level < levels.rend(); ++level) {
+        push.count = level->count;
+        push.offset = level->offset;
+        push.sumsOffset = level->sumsOffset;
+        dispatch(commandBuffer, *scanAddPipeline, current, push, (level->count + SCAN_BLOCK - 1) / SCAN_BLOCK);
+        computeBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                       VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT);
+    }
+
+    dispatch(commandBuffer, *generatePipeline, current, push, cellGroups);
+    computeBarrier(commandBuffer,
+                   VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT |
+                   VK_PIPELINE_STAGE_HOST_BIT,
+                   VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDIRECT_COMMAND_READ_BIT |
+                   VK_ACCESS_HOST_READ_BIT);
+}
+
+void GpuMarchingCubes::draw(VkCommandBuffer commandBuffer, uint32_t slot) {
+    const Slot &current = slots[slot];
+    if (!current.vertexBuffer.isValid()) return;
+
+    deviceStorage.bindVertexBuffer(current.vertexBuffer, commandBuffer);
+    vkCmdDrawIndirect(commandBuffer, deviceStorage.getBuffer(current.drawBuffer)->getBuffer(), 0, 1,
+                      sizeof(VkDrawIndirectCommand));
+}
+
+uint32_t GpuMarchingCubes::triangleCount(uint32_t slot) const {
+    return static_cast<const DrawData *>(
+        deviceStorage.getBuffer(slots[slot].drawBuffer)->getMappedMemory())->triangleCount;
+}
+
+std::vector<Hammock::Vertex> GpuMarchingCubes::readVertices(uint32_t slot) {
+    const Slot &current = slots[slot];
+    const uint32_t vertexCount = static_cast<const DrawData *>(
+        deviceStorage.getBuffer(current.drawBuffer)->getMappedMemory())->command.vertexCount;
+    std::vector<Hammock::Vertex> vertices(vertexCount);
+    if (vertexCount == 0) return vertices;
+
+    const auto staging = deviceStorage.createBuffer({
+        .instanceSize = sizeof(Hammock::Vertex),
+        .instanceCount = vertexCount,
+        .usageFlags = VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+        .memoryPropertyFlags = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
+    });
+    device.copyBuffer(deviceStorage.getBuffer(current.vertexBuffer)->getBuffer(),
+                      deviceStorage.getBuffer(staging)->getBuffer(), vertexCount * sizeof(Hammock::Vertex));
+    std::memcpy(vertices.data(), deviceStorage.getBuffer(staging)->getMappedMemory(),
+                vertexCount * sizeof(Hammock::Vertex));
+    deviceStorage.destroyBuffer(staging);
+    return vertices;
+}
+
+void GpuMarchingCubes::destroy() {
+    for (Slot &slot: slots) {
+        if (slot.scanBuffer.isValid()) deviceStorage.destroyBuffer(slot.scanBuffer);
+        if (slot.vertexBuffer.isValid()) deviceStorage.destroyBuffer(slot.vertexBuffer);
+        if (slot.drawBuffer.isValid()) deviceStorage.destroyBuffer(slot.drawBuffer);
+        slot = Slot{};
+    }
+    if (tableBuffer.isValid()) deviceStorage.destroyBuffer(tableBuffer);
+    tableBuffer = {};
+    if (descriptorSetLayout.isValid()) deviceStorage.destroyDescriptorSetLayout(descriptorSetLayout);
+    descriptorSetLayout = {};
+}
+
+std::vector<GpuMarchingCubes::ScanLevel> GpuMarchingCubes::scanLevels(uint32_t cellCount) {
+    // The block sums of a level follow its values and are the values of the next level
+    std::vector<ScanLevel> levels;
+    uint32_t count = cellCount, offset = 0;
+    while (true) {
+        levels.push_back({count, offset, offset + count});
+        if (count <= SCAN_BLOCK) return levels;
+        offset += count;
+        count = (count + SCAN_BLOCK - 1) / SCAN_BLOCK;
+    }
+}
+
+std::unique_ptr<Hammock::ComputePipeline> GpuMarchingCubes::createPipeline(const std::string &debugName,
+                                                                           const std::string &shader) {
+    return Hammock::ComputePipeline::createComputePipelinePtr({
+        .debugName = debugName,
+        .device = device,
+        .CS
+        {
+            .byteCode = Hammock::Filesystem::readFile(compiledShaderPath(shader)),
+            .entryFunc = "main"
+        },
+        .descriptorSetLayouts =
+        {
+            deviceStorage.getDescriptorSetLayout(descriptorSetLayout).getDescriptorSetLayout()
+        },
+        .pushConstantRanges{
+            {
+                .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+                .offset = 0,
+                .size = sizeof(PushData)
+            }
+        }
+    });
+}
+
+void GpuMarchingCubes::reserve(uint32_t index, const Field &field, uint32_t scanValues) {
+    Slot &slot = slots[index];
+    bool changed = !slot.descriptorSet.isValid() || slot.boundField != field.buffer;
+
+    if (slot.scanCapacity < scanValues) {
+        if (slot.scanBuffer.isValid()) deviceStorage.destroyBuffer(slot.scanBuffer);
+        slot.scanCapacity = scanValues;
+        slot.scanBuffer = deviceStorage.createBuffer({
+            .instanceSize = sizeof(uint32_t),
+            .instanceCount = slot.scanCapacity,
+            .usageFlags = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+            .memoryPropertyFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+            .map = false
+        });
+        changed = true;
+    }
+
+    // The count of the last extraction into this slot is the best guess for this one
+    const uint32_t vertexCount = 3 * triangleCount(index);
+    if (slot.vertexCapacity < std::max(vertexCount, INITIAL_VERTEX_CAPACITY)) {
+        if (slot.vertexBuffer.isValid()) deviceStorage.destroyBuffer(slot.vertexBuffer);
+        slot.vertexCapacity = std::max(vertexCount + vertexCount / 2, INITIAL_VERTEX_CAPACITY);
+        slot.vertexCapacity -= slot.vertexCapacity % 3;
+        slot.vertexBuffer = deviceStorage.createBuffer({
+            .instanceSize = sizeof(Hammock::Vertex),
+            .instanceCount = slot.vertexCapacity,
+            .usageFlags = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT |
+                          VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+            .memoryPropertyFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+            .map = false
+        });
+        changed = true;
+    }
+    if (!changed) return;
+
+    // Every slot allocates its set once, later it is only rewritten when a buffer grows or the field moves
+    // to another buffer. The slot is not in flight, so its set is not in use.
+    slot.boundField = field.buffer;
+    const Hammock::DeviceStorage::DescriptorSetCreateInfo descriptorSetInfo{
+        .descriptorSetLayout = descriptorSetLayout,
+        .bufferWrites = {
+            {0, deviceStorage.getBuffer(field.buffer)->descriptorInfo()},
+            {1, deviceStorage.getBuffer(tableBuffer)->descriptorInfo()},
+            {2, deviceStorage.getBuffer(slot.scanBuffer)->descriptorInfo()},
+            {3, deviceStorage.getBuffer(slot.vertexBuffer)->descriptorInfo()},
+            {4, deviceStorage.getBuffer(slot.drawBuffer)->descriptorInfo()},
+        }
+    };
+    if (slot.descriptorSet.isValid()) {
+        deviceStorage.updateDescriptorSet(slot.descriptorSet, descriptorSetInfo);
+    } else {
+        slot.descriptorSet = deviceStorage.createDescriptorSet(descriptorSetInfo);
+    }
+}
+
+void GpuMarchingCubes::dispatch(VkCommandBuffer commandBuffer, Hammock::ComputePipeline &pipeline,
+                                const Slot &slot, const PushData &push, uint32_t groups) {
+    pipeline.bind(commandBuffer);
+    deviceStorage.bindDescriptorSet(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline.computePipelineLayout,
+                                    0, 1, slot.descriptorSet, 0, nullptr);
+    vkCmdPushConstants(commandBuffer, pipeline.computePipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0,
+                       sizeof(PushData), &push);
+    // Groups past the limit of one dimension wrap into rows, the shaders skip what is past the end
+    const uint32_t groupsX = std::min(groups, MAX_GROUPS_X);
+    pipeline.dispatch(commandBuffer, groupsX, (groups + groupsX - 1) / groupsX);
+}
+
+void GpuMarchingCubes::computeBarrier(VkCommandBuffer commandBuffer, VkPipelineStageFlags dstStage,
+                                      VkAccessFlags dstAccess) {
+    VkMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    barrier.dstAccessMask = dstAccess;
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, dstStage, 0, 1, &barrier, 0, nullptr,
+                         0, nullptr);
+}
@@ -0,0 +1,113 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <hammock/hammock.h>
+
+// Marching cubes in compute shaders. Every cell of a dense field in a storage buffer is classified, an
+// exclusive prefix sum over the triangle counts gives every cell the offset of its triangles and the
+// cells then write them there. That leaves a triangle soup and the indirect draw command for it on the
+// GPU, nothing has to come back to the host to draw the surface.
+//
+// Cases, interpolation and normals are those of createEdgeVertex, the triangles come out in the cell
+// order of marchingCubesIndexed. Every slot has its own buffers, so the slot of a frame in flight can
+// be extracted into while another one is drawn. The triangle count of a slot reaches the host once its
+// frame is done and decides when the vertex buffer grows, a surface that outgrows it is clipped for
+// that one frame.
+class GpuMarchingCubes {
+public:
+    // Dense field in a storage buffer, samples are x-fastest without padding
+    struct Field {
+        Hammock::ResourceHandle<Hammock::Buffer> buffer;
+        uint32_t firstSample = 0;
+        uint32_t size[3]{};
+    };
+
+    GpuMarchingCubes(Hammock::Device &device, Hammock::DeviceStorage &deviceStorage, uint32_t slotCount);
+
+    // Records the extraction into slot, the slot must not be used by a frame in flight
+    void extract(VkCommandBuffer commandBuffer, uint32_t slot, const Field &field, float isovalue, float cubeSize);
+
+    // Draws the vertices of slot in the Hammock::Vertex layout, the pipeline has to be bound already
+    void draw(VkCommandBuffer commandBuffer, uint32_t slot);
+
+    // Triangles of the last completed extraction into slot, including those that did not fit
+    [[nodiscard]] uint32_t triangleCount(uint32_t slot) const;
+
+    // Copies the vertices of the last completed extraction into slot to the host
+    [[nodiscard]] std::vector<Hammock::Vertex> readVertices(uint32_t slot);
+
+    void destroy();
+
+private:
+    struct PushData {
+        uint32_t size[3];
+        uint32_t firstSample;
+        float isovalue;
+        float cubeSize;
+        uint32_t vertexCapacity;
+        // Level of the prefix sum
+        uint32_t count;
+        uint32_t offset;
+        uint32_t sumsOffset;
+        uint32_t totalOffset;
+    };
+
+    // VkDrawIndirectCommand followed by the triangle count before clamping
+    struct DrawData {
+        VkDrawIndirectCommand command;
+        uint32_t triangleCount;
+    };
+
+    struct ScanLevel {
+        uint32_t count;
+        uint32_t offset;
+        uint32_t sumsOffset;
+    };
+
+    struct Slot {
+        Hammock::ResourceHandle<Hammock::Buffer> scanBuffer{};
+        uint32_t scanCapacity = 0; // in values
+        Hammock::ResourceHandle<Hammock::Buffer> vertexBuffer{};
+        uint32_t vertexCapacity = 0;
+        Hammock::ResourceHandle<Hammock::Buffer> drawBuffer{};
+        // Allocated once, rewritten whenever one of its buffers changes
+        Hammock::ResourceHandle<VkDescriptorSet> descriptorSet{};
+        Hammock::ResourceHandle<Hammock::Buffer> boundField{};
+    };
+
+    // Values per block of the prefix sum, two per invocation
+    static constexpr uint32_t SCAN_BLOCK = 512;
+    static constexpr uint32_t GROUP_SIZE = 256;
+    static constexpr uint32_t MAX_GROUPS_X = 65535;
+    static constexpr uint32_t INITIAL_VERTEX_CAPACITY = 3 << 16;
+
+    static std::string compiledShaderPath(const std::string &shader) {
+        return "../../../src/hammock/shaders/compiled/" + shader + ".spv";
+    }
+
+    static std::vector<ScanLevel> scanLevels(uint32_t cellCount);
+
+    std::unique_ptr<Hammock::ComputePipeline> createPipeline(const std::string &debugName,
+                                                             const std::string &shader);
+    void reserve(uint32_t slot, const Field &field, uint32_t scanValues);
+    void dispatch(VkCommandBuffer commandBuffer, Hammock::ComputePipeline &pipeline, const Slot &slot,
+                  const PushData &push, uint32_t groups);
+    static void computeBarrier(VkCommandBuffer commandBuffer, VkPipelineStageFlags dstStage,
+                               VkAccessFlags dstAccess);
+
+    Hammock::Device &device;
+    Hammock::DeviceStorage &deviceStorage;
+
+    Hammock::ResourceHandle<Hammock::DescriptorSetLayout> descriptorSetLayout{};
+    // Triangles per case and the triangle table
+    Hammock::ResourceHandle<Hammock::Buffer> tableBuffer{};
+    std::vector<Slot> slots;
+
+    std::unique_ptr<Hammock::ComputePipeline> classifyPipeline{};
+    std::unique_ptr<Hammock::ComputePipeline> scanPipeline{};
+    std::unique_ptr<Hammock::ComputePipeline> scanAddPipeline{};
+    std::unique_ptr<Hammock::ComputePipeline> generatePipeline{};
+};
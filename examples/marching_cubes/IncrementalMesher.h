@@ -0,0 +1,129 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <utility>
+#include <vector>
+
+#include <hammock/core/ThreadPool.h>
+
+#include "SurfaceNets.h"
+
+// Changes to the per-brick meshes between two consecutive fields
+struct BrickPatch {
+    // Bricks with a new mesh, replacing their previous one if they had any
+    std::vector<std::pair<uint32_t, IndexedMesh> > updated;
+    // Bricks whose mesh is gone
+    std::vector<uint32_t> removed;
+    // Every brick mesh has to be thrown away first, the field layout or the extraction parameters changed
+    bool reset = false;
+};
+
+// Incremental isosurface extraction over a sequence of sparse fields.
+// Consecutive SPH frames mostly differ where the fluid moved. Every new field is diffed brick by brick
+// against the previous one and only the bricks whose cells read a changed sample are re-meshed, the
+// meshes of all other bricks are kept as they are. Brick meshes are self-contained (indices start at
+// zero), so they can be patched in place in a GPU buffer.
+class IncrementalMesher {
+public:
+    BrickPatch update(SparseScalarField3D scalarField, float isovalue, float cubeSize,
+                      Hammock::ThreadPool &threadPool,
+                      IsosurfaceMethod method = IsosurfaceMethod::MarchingCubes) {
+        BrickPatch patch;
+        const bool sameLayout = hasPrevious && previous.sizeX() == scalarField.sizeX() &&
+                                previous.sizeY() == scalarField.sizeY() &&
+                                previous.sizeZ() == scalarField.sizeZ() &&
+                                previous.backgroundValue() == scalarField.backgroundValue() &&
+                                previousIsovalue == isovalue && previousCubeSize == cubeSize &&
+                                previousMethod == method;
+
+        std::vector<uint8_t> dirty;
+        if (sameLayout) {
+            dirty = dirtyBricks(previous, scalarField);
+        } else {
+            patch.reset = true;
+            meshed.assign(scalarField.brickCount(), 0);
+            dirty.assign(scalarField.brickCount(), 1);
+        }
+
+        // Active bricks that are new or read changed samples
+        std::vector<uint8_t> active(scalarField.brickCount(), 0);
+        std::vector<uint32_t> remesh;
+        for (const uint32_t brick: activeBricks(scalarField, isovalue)) {
+            active[brick] = 1;
+            if (dirty[brick] || !meshed[brick]) remesh.push_back(brick);
+        }
+
+        for (uint32_t brick = 0; brick < meshed.size(); ++brick) {
+            if (meshed[brick] && !active[brick]) {
+                patch.removed.push_back(brick);
+                meshed[brick] = 0;
+            }
+        }
+
+        std::vector<IndexedMesh> meshes(remesh.size());
+        // Bricks are dealt out round robin, changed bricks tend to be neighbours
+        const auto workerCount = std::max(1u, static_cast<uint32_t>(threadPool.threads.size()));
+        threadPool.parallelFor(workerCount, [&](uint32_t begin, uint32_t end) {
+            for (uint32_t worker = begin; worker < end; ++worker) {
+                for (std::size_t i = worker; i < remesh.size(); i += workerCount) {
+                    meshBrickIndexed(scalarField, remesh[i], isovalue, cubeSize, method, meshes[i]);
+                }
+            }
+        });
+
+        for (std::size_t i = 0; i < remesh.size(); ++i) {
+            const uint32_t brick = remesh[i];
+            if (meshes[i].indices.empty()) {
+                // The range straddles the isovalue but no cell does
+                if (meshed[brick]) patch.removed.push_back(brick);
+                meshed[brick] = 0;
+                continue;
+            }
+            meshed[brick] = 1;
+            patch.updated.emplace_back(brick, std::move(meshes[i]));
+        }
+
+        previous = std::move(scalarField);
+        previousIsovalue = isovalue;
+        previousCubeSize = cubeSize;
+        previousMethod = method;
+        hasPrevious = true;
+        return patch;
+    }
+
+private:
+    // Bricks whose cells read a sample that differs between the two fields. Cells of a brick read
+    // samples of the neighbouring bricks, so every changed brick dirties its 26 neighbours as well.
+    static std::vector<uint8_t> dirtyBricks(const SparseScalarField3D &before, const SparseScalarField3D &after) {
+        const uint32_t bricksX = after.bricksX(), bricksY = after.bricksY(), bricksZ = after.bricksZ();
+        std::vector<uint8_t> dirty(after.brickCount(), 0);
+
+        for (uint32_t bz = 0; bz < bricksZ; ++bz) {
+            for (uint32_t by = 0; by < bricksY; ++by) {
+                for (uint32_t bx = 0; bx < bricksX; ++bx) {
+                    const std::size_t brick = after.brickIndex(bx, by, bz);
+                    const float *a = before.brickData(brick);
+                    const float *b = after.brickData(brick);
+                    if (!a && !b) continue;
+                    if (a && b && std::memcmp(a, b, SparseScalarField3D::BRICK_VOLUME * sizeof(float)) == 0) continue;
+
+                    for (uint32_t z = bz > 0 ? bz - 1 : 0; z <= std::min(bz + 1, bricksZ - 1); ++z) {
+                        for (uint32_t y = by > 0 ? by - 1 : 0; y <= std::min(by + 1, bricksY - 1); ++y) {
+                            for (uint32_t x = bx > 0 ? bx - 1 : 0; x <= std::min(bx + 1, bricksX - 1); ++x) {
+                                dirty[after.brickIndex(x, y, z)] = 1;
+                            }
+                        }
+                    }
+                }
+            }
+        }
+        return dirty;
+    }
+
+    SparseScalarField3D previous;
+    float previousIsovalue = 0.0f;
+    float previousCubeSize = 0.0f;
+    IsosurfaceMethod previousMethod = IsosurfaceMethod::MarchingCubes;
+    bool hasPrevious = false;
+    std::vector<uint8_t> meshed; // per brick, whether the consumer holds a mesh for it
+};
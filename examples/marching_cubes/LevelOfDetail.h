@@ -0,0 +1,329 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <unordered_map>
+#include <vector>
+
+#include <hammock/core/ThreadPool.h>
+
+#include "SurfaceNets.h"
+
+struct LodSettings {
+    int chunkSize = 16; // cells per chunk and axis at full resolution, a multiple of 2^(levels - 1)
+    int levels = 3;
+    // Chunks closer to the camera than this are meshed at full resolution, every doubling of the
+    // distance halves the resolution
+    float distance = 32.0f;
+};
+
+// Level of detail of a chunk at the given distance from the camera
+inline uint8_t lodLevel(float distance, const LodSettings &settings) {
+    if (distance < settings.distance) return 0;
+    const int level = 1 + static_cast<int>(std::floor(std::log2(distance / settings.distance)));
+    return static_cast<uint8_t>(std::min(level, settings.levels - 1));
+}
+
+// Chunks per axis of a field with the given number of samples along that axis
+inline uint32_t lodChunkCount(uint32_t points, const LodSettings &settings) {
+    return points > 1 ? (points - 1 + settings.chunkSize - 1) / settings.chunkSize : 0;
+}
+
+// One level of a LodPyramid. The field is padded with its background value up to whole chunks, so
+// the chunks of every level tile the same volume.
+class LodLevel {
+public:
+    LodLevel(const SparseScalarField3D &field, uint32_t nx, uint32_t ny, uint32_t nz)
+        : field(&field), nx(nx), ny(ny), nz(nz) {
+    }
+
+    [[nodiscard]] uint32_t sizeX() const { return nx; }
+    [[nodiscard]] uint32_t sizeY() const { return ny; }
+    [[nodiscard]] uint32_t sizeZ() const { return nz; }
+
+    [[nodiscard]] float at(uint32_t x, uint32_t y, uint32_t z) const {
+        if (x >= field->sizeX() || y >= field->sizeY() || z >= field->sizeZ()) return field->backgroundValue();
+        return field->at(x, y, z);
+    }
+
+    [[nodiscard]] const SparseScalarField3D &source() const { return *field; }
+
+private:
+    const SparseScalarField3D *field;
+    uint32_t nx, ny, nz;
+};
+
+// A sparse field and its subsampled copies, level l keeps every 2^l-th sample along each axis.
+// Samples are picked rather than averaged, so a grid point reads the same value on every level it
+// exists on and neighbouring chunks of different levels agree on which side of the surface it lies.
+// Level 0 is the field itself, which has to outlive the pyramid.
+class LodPyramid {
+public:
+    LodPyramid(const SparseScalarField3D &field, const LodSettings &settings) : chunkSize_(settings.chunkSize) {
+        const uint32_t points[3] = {field.sizeX(), field.sizeY(), field.sizeZ()};
+        uint32_t cells[3];
+        for (int a = 0; a < 3; ++a) {
+            chunks[a] = lodChunkCount(points[a], settings);
+            cells[a] = chunks[a] * settings.chunkSize;
+        }
+
+        subsampled.reserve(std::max(settings.levels - 1, 0));
+        for (int level = 1; level < settings.levels; ++level) {
+            SparseScalarField3D &coarse = subsampled.emplace_back(
+                (cells[0] >> level) + 1, (cells[1] >> level) + 1, (cells[2] >> level) + 1, field.backgroundValue());
+            const uint32_t mask = (1u << level) - 1;
+
+            // Only allocated bricks can hold anything but the background
+            field.forEachAllocatedBrick([&](std::size_t brick) {
+                constexpr uint32_t BRICK_SIZE = SparseScalarField3D::BRICK_SIZE;
+                const uint32_t x0 = brick % field.bricksX() * BRICK_SIZE;
+                const uint32_t y0 = brick / field.bricksX() % field.bricksY() * BRICK_SIZE;
+                const uint32_t z0 = brick / (static_cast<std::size_t>(field.bricksX()) * field.bricksY()) * BRICK_SIZE;
+                const float *data = field.brickData(brick);
+                for (uint32_t z = z0; z < std::min(z0 + BRICK_SIZE, points[2]); ++z) {
+                    if (z & mask) continue;
+                    for (uint32_t y = y0; y < std::min(y0 + BRICK_SIZE, points[1]); ++y) {
+                        if (y & mask) continue;
+                        for (uint32_t x = x0; x < std::min(x0 + BRICK_SIZE, points[0]); ++x) {
+                            if (x & mask) continue;
+                            coarse.at(x >> level, y >> level, z >> level) =
+                                    data[(x - x0) + ((y - y0) + (z - z0) * BRICK_SIZE) * BRICK_SIZE];
+                        }
+                    }
+                }
+            });
+            coarse.updateRanges();
+        }
+
+        levels.emplace_back(field, cells[0] + 1, cells[1] + 1, cells[2] + 1);
+        for (int level = 1; level < settings.levels; ++level) {
+            levels.emplace_back(subsampled[level - 1], (cells[0] >> level) + 1, (cells[1] >> level) + 1,
+                                (cells[2] >> level) + 1);
+        }
+    }
+
+    LodPyramid(const LodPyramid &) = delete;
+
+    LodPyramid &operator=(const LodPyramid &) = delete;
+
+    [[nodiscard]] const LodLevel &level(int level) const { return levels[level]; }
+    [[nodiscard]] int levelCount() const { return static_cast<int>(levels.size()); }
+    [[nodiscard]] int chunkSize() const { return chunkSize_; }
+
+    [[nodiscard]] uint32_t chunksX() const { return chunks[0]; }
+    [[nodiscard]] uint32_t chunksY() const { return chunks[1]; }
+    [[nodiscard]] uint32_t chunksZ() const { return chunks[2]; }
+    [[nodiscard]] std::size_t chunkCount() const { return static_cast<std::size_t>(chunks[0]) * chunks[1] * chunks[2]; }
+
+    [[nodiscard]] uint32_t chunkIndex(uint32_t cx, uint32_t cy, uint32_t cz) const {
+        return cx + chunks[0] * (cy + chunks[1] * cz);
+    }
+
+private:
+    int chunkSize_;
+    uint32_t chunks[3] = {0, 0, 0};
+    std::vector<SparseScalarField3D> subsampled;
+    std::vector<LodLevel> levels;
+};
+
+// Whether any sample of the chunk, including its far faces, may lie on either side of the isovalue
+inline bool lodChunkMayCross(const LodPyramid &pyramid, uint32_t chunk, int level, float isovalue) {
+    const SparseScalarField3D &field = pyramid.level(level).source();
+    const int cells = pyramid.chunkSize() >> level;
+    const uint32_t chunk3[3] = {
+        chunk % pyramid.chunksX(), chunk / pyramid.chunksX() % pyramid.chunksY(),
+        chunk / (pyramid.chunksX() * pyramid.chunksY())
+    };
+    const uint32_t fieldSize[3] = {field.sizeX(), field.sizeY(), field.sizeZ()};
+    const uint32_t bricks[3] = {field.bricksX(), field.bricksY(), field.bricksZ()};
+
+    float lo = std::numeric_limits<float>::max(), hi = std::numeric_limits<float>::lowest();
+    uint32_t first[3], last[3];
+    for (int a = 0; a < 3; ++a) {
+        const uint32_t begin = chunk3[a] * cells, end = begin + cells;
+        if (end >= fieldSize[a]) {
+            // Padding
+            lo = std::min(lo, field.backgroundValue());
+            hi = std::max(hi, field.backgroundValue());
+        }
+        first[a] = std::min(begin, fieldSize[a] - 1) >> SparseScalarField3D::BRICK_SHIFT;
+        last[a] = std::min(std::min(end, fieldSize[a] - 1) >> SparseScalarField3D::BRICK_SHIFT, bricks[a] - 1);
+    }
+
+    for (uint32_t bz = first[2]; bz <= last[2]; ++bz) {
+        for (uint32_t by = first[1]; by <= last[1]; ++by) {
+            for (uint32_t bx = first[0]; bx <= last[0]; ++bx) {
+                float brickLo, brickHi;
+                field.cellRange(bx, by, bz, brickLo, brickHi);
+                lo = std::min(lo, brickLo);
+                hi = std::max(hi, brickHi);
+            }
+        }
+    }
+    return lo < isovalue && hi >= isovalue;
+}
+
+// Surface nets over one chunk on the level chunkLevels assigns to it, appends an indexed mesh to out.
+// The chunk contributes the edges of its level that start inside it or on its faces. Edges between
+// chunks of different levels are taken at the finest of the adjacent levels, by the chunk of that level
+// with the highest index, and join the cells of whatever level surround them: a quad, or a triangle
+// where two of the four cells are the same coarse cell. This is the minimal edge rule of dual
+// contouring on octrees. It stitches the levels without transition cells and without cracks, since
+// every grid point has a single value on all levels. Vertices of neighbouring chunks' cells are
+// duplicated, like the brick faces of netBrickIndexed.
+inline void netLodChunkIndexed(const LodPyramid &pyramid, const std::vector<uint8_t> &chunkLevels, uint32_t chunk,
+                               float isovalue, float cubeSize, bool dualContouring, IndexedMesh &out) {
+    const int level = chunkLevels[chunk];
+    const LodLevel &field = pyramid.level(level);
+    const int chunkSize = pyramid.chunkSize();
+    const int cells = chunkSize >> level;
+    const int points = cells + 1;
+    const uint32_t chunks[3] = {pyramid.chunksX(), pyramid.chunksY(), pyramid.chunksZ()};
+    const int origin[3] = {
+        static_cast<int>(chunk % chunks[0]) * cells,
+        static_cast<int>(chunk / chunks[0] % chunks[1]) * cells,
+        static_cast<int>(chunk / (chunks[0] * chunks[1])) * cells
+    };
+
+    std::vector<float> samples(static_cast<std::size_t>(points) * points * points);
+    for (int z = 0; z < points; ++z) {
+        for (int y = 0; y < points; ++y) {
+            for (int x = 0; x < points; ++x) {
+                samples[x + points * (y + points * z)] = field.at(origin[0] + x, origin[1] + y, origin[2] + z);
+            }
+        }
+    }
+
+    // Keyed by level and cell, the cells around boundary edges may belong to other chunks and levels
+    std::unordered_map<uint64_t, uint32_t> cellVertex;
+    auto vertexOf = [&](int cellLevel, const int cell[3]) {
+        const uint64_t key = static_cast<uint64_t>(cellLevel) << 60 | static_cast<uint64_t>(cell[0]) << 40 |
+                             static_cast<uint64_t>(cell[1]) << 20 | static_cast<uint64_t>(cell[2]);
+        const auto [it, inserted] = cellVertex.emplace(key, static_cast<uint32_t>(out.vertices.size()));
+        if (inserted) {
+            const LodLevel &cellField = pyramid.level(cellLevel);
+            float v[8];
+            HmckVec3 g[8];
+            for (int c = 0; c < 8; ++c) {
+                const uint32_t x = cell[0] + cornerOffset[c][0], y = cell[1] + cornerOffset[c][1],
+                        z = cell[2] + cornerOffset[c][2];
+                v[c] = cellField.at(x, y, z);
+                g[c] = fieldGradient(cellField, x, y, z);
+            }
+            out.vertices.push_back(createCellVertex(cell[0], cell[1], cell[2], v, g, isovalue,
+                                                    cubeSize * static_cast<float>(1 << cellLevel), dualContouring));
+        }
+        return it->second;
+    };
+
+    // Cells around an edge, counter clockwise when looking down the axis as in netBrickIndexed
+    static constexpr int du[4] = {-1, 1, 1, -1}, dw[4] = {-1, -1, 1, 1};
+    const int fullCells[3] = {
+        static_cast<int>(chunks[0]) * chunkSize, static_cast<int>(chunks[1]) * chunkSize,
+        static_cast<int>(chunks[2]) * chunkSize
+    };
+
+    for (int z = 0; z < points; ++z) {
+        for (int y = 0; y < points; ++y) {
+            for (int x = 0; x < points; ++x) {
+                const int point[3] = {x, y, z};
+                const bool inside = samples[x + points * (y + points * z)] < isovalue;
+
+                for (int axis = 0; axis < 3; ++axis) {
+                    if (point[axis] == cells) continue; // the edge leaves the chunk
+                    const int next = (x + (axis == 0)) + points * ((y + (axis == 1)) + points * (z + (axis == 2)));
+                    if (inside == (samples[next] < isovalue)) continue;
+
+                    const int u = (axis + 1) % 3, w = (axis + 2) % 3;
+                    int cellLevels[4], cell[4][3];
+                    if (point[u] > 0 && point[u] < cells && point[w] > 0 && point[w] < cells) {
+                        // Inside the chunk, all four cells are on its level
+                        for (int c = 0; c < 4; ++c) {
+                            cellLevels[c] = level;
+                            for (int a = 0; a < 3; ++a) cell[c][a] = origin[a] + point[a];
+                            if (du[c] < 0) cell[c][u] -= 1;
+                            if (dw[c] < 0) cell[c][w] -= 1;
+                        }
+                    } else {
+                        // Points just beside the middle of the edge, in doubled full resolution coordinates
+                        int quadrant[4][3];
+                        int minLevel = level;
+                        uint32_t owner = 0;
+                        bool outside = false;
+                        for (int c = 0; c < 4 && !outside; ++c) {
+                            for (int a = 0; a < 3; ++a) quadrant[c][a] = (origin[a] + point[a]) << (level + 1);
+                            quadrant[c][axis] += 1 << level;
+                            quadrant[c][u] += du[c];
+                            quadrant[c][w] += dw[c];
+                            if (quadrant[c][u] < 0 || quadrant[c][u] > 2 * fullCells[u] ||
+                                quadrant[c][w] < 0 || quadrant[c][w] > 2 * fullCells[w]) {
+                                outside = true; // a border edge has fewer than four cells
+                                break;
+                            }
+
+                            const uint32_t neighbour = pyramid.chunkIndex(quadrant[c][0] / 2 / chunkSize,
+                                                                          quadrant[c][1] / 2 / chunkSize,
+                                                                          quadrant[c][2] / 2 / chunkSize);
+                            cellLevels[c] = chunkLevels[neighbour];
+                            minLevel = std::min(minLevel, cellLevels[c]);
+                            if (cellLevels[c] == level) owner = std::max(owner, neighbour);
+                        }
+                        // A finer neighbour meshes this part of the boundary with its own edges
+                        if (outside || minLevel < level || owner != chunk) continue;
+
+                        for (int c = 0; c < 4; ++c) {
+                            for (int a = 0; a < 3; ++a) cell[c][a] = (quadrant[c][a] / 2) >> cellLevels[c];
+                        }
+                    }
+
+                    uint32_t polygon[4];
+                    int count = 0;
+                    for (int c = 0; c < 4; ++c) {
+                        const uint32_t vertex = vertexOf(cellLevels[c], cell[c]);
+                        if (count == 0 || polygon[count - 1] != vertex) polygon[count++] = vertex;
+                    }
+                    if (count > 1 && polygon[count - 1] == polygon[0]) --count;
+                    if (count < 3) continue;
+
+                    // Facing towards lower values, like the marching cubes triangles
+                    if (inside) std::reverse(polygon + 1, polygon + count);
+
+                    if (count == 3) {
+                        out.indices.insert(out.indices.end(), {polygon[0], polygon[1], polygon[2]});
+                        continue;
+                    }
+                    const HmckVec3 &p0 = out.vertices[polygon[0]].position, &p1 = out.vertices[polygon[1]].position;
+                    const HmckVec3 &p2 = out.vertices[polygon[2]].position, &p3 = out.vertices[polygon[3]].position;
+                    if (HmckLenSqrV3(HmckSubV3(p0, p2)) <= HmckLenSqrV3(HmckSubV3(p1, p3))) {
+                        out.indices.insert(out.indices.end(),
+                                           {polygon[0], polygon[1], polygon[2], polygon[0], polygon[2], polygon[3]});
+                    } else {
+                        out.indices.insert(out.indices.end(),
+                                           {polygon[0], polygon[1], polygon[3], polygon[1], polygon[2], polygon[3]});
+                    }
+                }
+            }
+        }
+    }
+}
+
+// Surface nets over chunks of individually chosen resolution, see netLodChunkIndexed. chunkLevels
+// holds the level of every chunk of the pyramid, in chunk index order.
+inline IndexedMesh lodSurfaceNets(
+    const LodPyramid &pyramid,
+    const std::vector<uint8_t> &chunkLevels,
+    float isovalue,
+    float cubeSize,
+    Hammock::ThreadPool &threadPool,
+    bool dualContouring = false) {
+
+    std::vector<uint32_t> chunks;
+    for (uint32_t chunk = 0; chunk < pyramid.chunkCount(); ++chunk) {
+        if (lodChunkMayCross(pyramid, chunk, chunkLevels[chunk], isovalue)) chunks.push_back(chunk);
+    }
+
+    return meshBricks(chunks, threadPool, [&](uint32_t chunk, IndexedMesh &out) {
+        netLodChunkIndexed(pyramid, chunkLevels, chunk, isovalue, cubeSize, dualContouring, out);
+    });
+}
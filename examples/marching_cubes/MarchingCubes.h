@@ -1,307 +1,22 @@
 #pragma once
 #include <vector>
 #include <array>
+#include <algorithm>
+#include <cstdint>
 #include <cmath>
 #include <iostream>
 
 
 #include <hammock/scene/scene.h>
+#include <hammock/core/ThreadPool.h>
+#include "ScalarField3D.h"
+#include "CellClassifier.h"
 
-static inline const int edgeTable[256] =
-{
-    0x0, 0x109, 0x203, 0x30a, 0x406, 0x50f, 0x605, 0x70c,
-    0x80c, 0x905, 0xa0f, 0xb06, 0xc0a, 0xd03, 0xe09, 0xf00,
-    0x190, 0x99, 0x393, 0x29a, 0x596, 0x49f, 0x795, 0x69c,
-    0x99c, 0x895, 0xb9f, 0xa96, 0xd9a, 0xc93, 0xf99, 0xe90,
-    0x230, 0x339, 0x33, 0x13a, 0x636, 0x73f, 0x435, 0x53c,
-    0xa3c, 0xb35, 0x83f, 0x936, 0xe3a, 0xf33, 0xc39, 0xd30,
-    0x3a0, 0x2a9, 0x1a3, 0xaa, 0x7a6, 0x6af, 0x5a5, 0x4ac,
-    0xbac, 0xaa5, 0x9af, 0x8a6, 0xfaa, 0xea3, 0xda9, 0xca0,
-    0x460, 0x569, 0x663, 0x76a, 0x66, 0x16f, 0x265, 0x36c,
-    0xc6c, 0xd65, 0xe6f, 0xf66, 0x86a, 0x963, 0xa69, 0xb60,
-    0x5f0, 0x4f9, 0x7f3, 0x6fa, 0x1f6, 0xff, 0x3f5, 0x2fc,
-    0xdfc, 0xcf5, 0xfff, 0xef6, 0x9fa, 0x8f3, 0xbf9, 0xaf0,
-    0x650, 0x759, 0x453, 0x55a, 0x256, 0x35f, 0x55, 0x15c,
-    0xe5c, 0xf55, 0xc5f, 0xd56, 0xa5a, 0xb53, 0x859, 0x950,
-    0x7c0, 0x6c9, 0x5c3, 0x4ca, 0x3c6, 0x2cf, 0x1c5, 0xcc,
-    0xfcc, 0xec5, 0xdcf, 0xcc6, 0xbca, 0xac3, 0x9c9, 0x8c0,
-    0x8c0, 0x9c9, 0xac3, 0xbca, 0xcc6, 0xdcf, 0xec5, 0xfcc,
-    0xcc, 0x1c5, 0x2cf, 0x3c6, 0x4ca, 0x5c3, 0x6c9, 0x7c0,
-    0x950, 0x859, 0xb53, 0xa5a, 0xd56, 0xc5f, 0xf55, 0xe5c,
-    0x15c, 0x55, 0x35f, 0x256, 0x55a, 0x453, 0x759, 0x650,
-    0xaf0, 0xbf9, 0x8f3, 0x9fa, 0xef6, 0xfff, 0xcf5, 0xdfc,
-    0x2fc, 0x3f5, 0xff, 0x1f6, 0x6fa, 0x7f3, 0x4f9, 0x5f0,
-    0xb60, 0xa69, 0x963, 0x86a, 0xf66, 0xe6f, 0xd65, 0xc6c,
-    0x36c, 0x265, 0x16f, 0x66, 0x76a, 0x663, 0x569, 0x460,
-    0xca0, 0xda9, 0xea3, 0xfaa, 0x8a6, 0x9af, 0xaa5, 0xbac,
-    0x4ac, 0x5a5, 0x6af, 0x7a6, 0xaa, 0x1a3, 0x2a9, 0x3a0,
-    0xd30, 0xc39, 0xf33, 0xe3a, 0x936, 0x83f, 0xb35, 0xa3c,
-    0x53c, 0x435, 0x73f, 0x636, 0x13a, 0x33, 0x339, 0x230,
-    0xe90, 0xf99, 0xc93, 0xd9a, 0xa96, 0xb9f, 0x895, 0x99c,
-    0x69c, 0x795, 0x49f, 0x596, 0x29a, 0x393, 0x99, 0x190,
-    0xf00, 0xe09, 0xd03, 0xc0a, 0xb06, 0xa0f, 0x905, 0x80c,
-    0x70c, 0x605, 0x50f, 0x406, 0x30a, 0x203, 0x109, 0x0
-};
-
-static inline const int triTable[256][16] =
-{
-    {-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-    {0, 8, 3, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-    {0, 1, 9, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-    {1, 8, 3, 9, 8, 1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-    {1, 2, 10, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-    {0, 8, 3, 1, 2, 10, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-    {9, 2, 10, 0, 2, 9, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-    {2, 8, 3, 2, 10, 8, 10, 9, 8, -1, -1, -1, -1, -1, -1, -1},
-    {3, 11, 2, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-    {0, 11, 2, 8, 11, 0, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-    {1, 9, 0, 2, 3, 11, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-    {1, 11, 2, 1, 9, 11, 9, 8, 11, -1, -1, -1, -1, -1, -1, -1},
-    {3, 10, 1, 11, 10, 3, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-    {0, 10, 1, 0, 8, 10, 8, 11, 10, -1, -1, -1, -1, -1, -1, -1},
-    {3, 9, 0, 3, 11, 9, 11, 10, 9, -1, -1, -1, -1, -1, -1, -1},
-    {9, 8, 10, 10, 8, 11, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-    {4, 7, 8, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-    {4, 3, 0, 7, 3, 4, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-    {0, 1, 9, 8, 4, 7, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-    {4, 1, 9, 4, 7, 1, 7, 3, 1, -1, -1, -1, -1, -1, -1, -1},
-    {1, 2, 10, 8, 4, 7, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-    {3, 4, 7, 3, 0, 4, 1, 2, 10, -1, -1, -1, -1, -1, -1, -1},
-    {9, 2, 10, 9, 0, 2, 8, 4, 7, -1, -1, -1, -1, -1, -1, -1},
-    {2, 10, 9, 2, 9, 7, 2, 7, 3, 7, 9, 4, -1, -1, -1, -1},
-    {8, 4, 7, 3, 11, 2, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-    {11, 4, 7, 11, 2, 4, 2, 0, 4, -1, -1, -1, -1, -1, -1, -1},
-    {9, 0, 1, 8, 4, 7, 2, 3, 11, -1, -1, -1, -1, -1, -1, -1},
-    {4, 7, 11, 9, 4, 11, 9, 11, 2, 9, 2, 1, -1, -1, -1, -1},
-    {3, 10, 1, 3, 11, 10, 7, 8, 4, -1, -1, -1, -1, -1, -1, -1},
-    {1, 11, 10, 1, 4, 11, 1, 0, 4, 7, 11, 4, -1, -1, -1, -1},
-    {4, 7, 8, 9, 0, 11, 9, 11, 10, 11, 0, 3, -1, -1, -1, -1},
-    {4, 7, 11, 4, 11, 9, 9, 11, 10, -1, -1, -1, -1, -1, -1, -1},
-    {9, 5, 4, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-    {9, 5, 4, 0, 8, 3, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-    {0, 5, 4, 1, 5, 0, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-    {8, 5, 4, 8, 3, 5, 3, 1, 5, -1, -1, -1, -1, -1, -1, -1},
-    {1, 2, 10, 9, 5, 4, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-    {3, 0, 8, 1, 2, 10, 4, 9, 5, -1, -1, -1, -1, -1, -1, -1},
-    {5, 2, 10, 5, 4, 2, 4, 0, 2, -1, -1, -1, -1, -1, -1, -1},
-    {2, 10, 5, 3, 2, 5, 3, 5, 4, 3, 4, 8, -1, -1, -1, -1},
-    {9, 5, 4, 2, 3, 11, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-    {0, 11, 2, 0, 8, 11, 4, 9, 5, -1, -1, -1, -1, -1, -1, -1},
-    {0, 5, 4, 0, 1, 5, 2, 3, 11, -1, -1, -1, -1, -1, -1, -1},
-    {2, 1, 5, 2, 5, 8, 2, 8, 11, 4, 8, 5, -1, -1, -1, -1},
-    {10, 3, 11, 10, 1, 3, 9, 5, 4, -1, -1, -1, -1, -1, -1, -1},
-    {4, 9, 5, 0, 8, 1, 8, 10, 1, 8, 11, 10, -1, -1, -1, -1},
-    {5, 4, 0, 5, 0, 11, 5, 11, 10, 11, 0, 3, -1, -1, -1, -1},
-    {5, 4, 8, 5, 8, 10, 10, 8, 11, -1, -1, -1, -1, -1, -1, -1},
-    {9, 7, 8, 5, 7, 9, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-    {9, 3, 0, 9, 5, 3, 5, 7, 3, -1, -1, -1, -1, -1, -1, -1},
-    {0, 7, 8, 0, 1, 7, 1, 5, 7, -1, -1, -1, -1, -1, -1, -1},
-    {1, 5, 3, 3, 5, 7, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-    {9, 7, 8, 9, 5, 7, 10, 1, 2, -1, -1, -1, -1, -1, -1, -1},
-    {10, 1, 2, 9, 5, 0, 5, 3, 0, 5, 7, 3, -1, -1, -1, -1},
-    {8, 0, 2, 8, 2, 5, 8, 5, 7, 10, 5, 2, -1, -1, -1, -1},
-    {2, 10, 5, 2, 5, 3, 3, 5, 7, -1, -1, -1, -1, -1, -1, -1},
-    {7, 9, 5, 7, 8, 9, 3, 11, 2, -1, -1, -1, -1, -1, -1, -1},
-    {9, 5, 7, 9, 7, 2, 9, 2, 0, 2, 7, 11, -1, -1, -1, -1},
-    {2, 3, 11, 0, 1, 8, 1, 7, 8, 1, 5, 7, -1, -1, -1, -1},
-    {11, 2, 1, 11, 1, 7, 7, 1, 5, -1, -1, -1, -1, -1, -1, -1},
-    {9, 5, 8, 8, 5, 7, 10, 1, 3, 10, 3, 11, -1, -1, -1, -1},
-    {5, 7, 0, 5, 0, 9, 7, 11, 0, 1, 0, 10, 11, 10, 0, -1},
-    {11, 10, 0, 11, 0, 3, 10, 5, 0, 8, 0, 7, 5, 7, 0, -1},
-    {11, 10, 5, 7, 11, 5, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-    {10, 6, 5, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-    {0, 8, 3, 5, 10, 6, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-    {9, 0, 1, 5, 10, 6, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-    {1, 8, 3, 1, 9, 8, 5, 10, 6, -1, -1, -1, -1, -1, -1, -1},
-    {1, 6, 5, 2, 6, 1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-    {1, 6, 5, 1, 2, 6, 3, 0, 8, -1, -1, -1, -1, -1, -1, -1},
-    {9, 6, 5, 9, 0, 6, 0, 2, 6, -1, -1, -1, -1, -1, -1, -1},
-    {5, 9, 8, 5, 8, 2, 5, 2, 6, 3, 2, 8, -1, -1, -1, -1},
-    {2, 3, 11, 10, 6, 5, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-    {11, 0, 8, 11, 2, 0, 10, 6, 5, -1, -1, -1, -1, -1, -1, -1},
-    {0, 1, 9, 2, 3, 11, 5, 10, 6, -1, -1, -1, -1, -1, -1, -1},
-    {5, 10, 6, 1, 9, 2, 9, 11, 2, 9, 8, 11, -1, -1, -1, -1},
-    {6, 3, 11, 6, 5, 3, 5, 1, 3, -1, -1, -1, -1, -1, -1, -1},
-    {0, 8, 11, 0, 11, 5, 0, 5, 1, 5, 11, 6, -1, -1, -1, -1},
-    {3, 11, 6, 0, 3, 6, 0, 6, 5, 0, 5, 9, -1, -1, -1, -1},
-    {6, 5, 9, 6, 9, 11, 11, 9, 8, -1, -1, -1, -1, -1, -1, -1},
-    {5, 10, 6, 4, 7, 8, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-    {4, 3, 0, 4, 7, 3, 6, 5, 10, -1, -1, -1, -1, -1, -1, -1},
-    {1, 9, 0, 5, 10, 6, 8, 4, 7, -1, -1, -1, -1, -1, -1, -1},
-    {10, 6, 5, 1, 9, 7, 1, 7, 3, 7, 9, 4, -1, -1, -1, -1},
-    {6, 1, 2, 6, 5, 1, 4, 7, 8, -1, -1, -1, -1, -1, -1, -1},
-    {1, 2, 5, 5, 2, 6, 3, 0, 4, 3, 4, 7, -1, -1, -1, -1},
-    {8, 4, 7, 9, 0, 5, 0, 6, 5, 0, 2, 6, -1, -1, -1, -1},
-    {7, 3, 9, 7, 9, 4, 3, 2, 9, 5, 9, 6, 2, 6, 9, -1},
-    {3, 11, 2, 7, 8, 4, 10, 6, 5, -1, -1, -1, -1, -1, -1, -1},
-    {5, 10, 6, 4, 7, 2, 4, 2, 0, 2, 7, 11, -1, -1, -1, -1},
-    {0, 1, 9, 4, 7, 8, 2, 3, 11, 5, 10, 6, -1, -1, -1, -1},
-    {9, 2, 1, 9, 11, 2, 9, 4, 11, 7, 11, 4, 5, 10, 6, -1},
-    {8, 4, 7, 3, 11, 5, 3, 5, 1, 5, 11, 6, -1, -1, -1, -1},
-    {5, 1, 11, 5, 11, 6, 1, 0, 11, 7, 11, 4, 0, 4, 11, -1},
-    {0, 5, 9, 0, 6, 5, 0, 3, 6, 11, 6, 3, 8, 4, 7, -1},
-    {6, 5, 9, 6, 9, 11, 4, 7, 9, 7, 11, 9, -1, -1, -1, -1},
-    {10, 4, 9, 6, 4, 10, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-    {4, 10, 6, 4, 9, 10, 0, 8, 3, -1, -1, -1, -1, -1, -1, -1},
-    {10, 0, 1, 10, 6, 0, 6, 4, 0, -1, -1, -1, -1, -1, -1, -1},
-    {8, 3, 1, 8, 1, 6, 8, 6, 4, 6, 1, 10, -1, -1, -1, -1},
-    {1, 4, 9, 1, 2, 4, 2, 6, 4, -1, -1, -1, -1, -1, -1, -1},
-    {3, 0, 8, 1, 2, 9, 2, 4, 9, 2, 6, 4, -1, -1, -1, -1},
-    {0, 2, 4, 4, 2, 6, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-    {8, 3, 2, 8, 2, 4, 4, 2, 6, -1, -1, -1, -1, -1, -1, -1},
-    {10, 4, 9, 10, 6, 4, 11, 2, 3, -1, -1, -1, -1, -1, -1, -1},
-    {0, 8, 2, 2, 8, 11, 4, 9, 10, 4, 10, 6, -1, -1, -1, -1},
-    {3, 11, 2, 0, 1, 6, 0, 6, 4, 6, 1, 10, -1, -1, -1, -1},
-    {6, 4, 1, 6, 1, 10, 4, 8, 1, 2, 1, 11, 8, 11, 1, -1},
-    {9, 6, 4, 9, 3, 6, 9, 1, 3, 11, 6, 3, -1, -1, -1, -1},
-    {8, 11, 1, 8, 1, 0, 11, 6, 1, 9, 1, 4, 6, 4, 1, -1},
-    {3, 11, 6, 3, 6, 0, 0, 6, 4, -1, -1, -1, -1, -1, -1, -1},
-    {6, 4, 8, 11, 6, 8, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-    {7, 10, 6, 7, 8, 10, 8, 9, 10, -1, -1, -1, -1, -1, -1, -1},
-    {0, 7, 3, 0, 10, 7, 0, 9, 10, 6, 7, 10, -1, -1, -1, -1},
-    {10, 6, 7, 1, 10, 7, 1, 7, 8, 1, 8, 0, -1, -1, -1, -1},
-    {10, 6, 7, 10, 7, 1, 1, 7, 3, -1, -1, -1, -1, -1, -1, -1},
-    {1, 2, 6, 1, 6, 8, 1, 8, 9, 8, 6, 7, -1, -1, -1, -1},
-    {2, 6, 9, 2, 9, 1, 6, 7, 9, 0, 9, 3, 7, 3, 9, -1},
-    {7, 8, 0, 7, 0, 6, 6, 0, 2, -1, -1, -1, -1, -1, -1, -1},
-    {7, 3, 2, 6, 7, 2, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-    {2, 3, 11, 10, 6, 8, 10, 8, 9, 8, 6, 7, -1, -1, -1, -1},
-    {2, 0, 7, 2, 7, 11, 0, 9, 7, 6, 7, 10, 9, 10, 7, -1},
-    {1, 8, 0, 1, 7, 8, 1, 10, 7, 6, 7, 10, 2, 3, 11, -1},
-    {11, 2, 1, 11, 1, 7, 10, 6, 1, 6, 7, 1, -1, -1, -1, -1},
-    {8, 9, 6, 8, 6, 7, 9, 1, 6, 11, 6, 3, 1, 3, 6, -1},
-    {0, 9, 1, 11, 6, 7, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-    {7, 8, 0, 7, 0, 6, 3, 11, 0, 11, 6, 0, -1, -1, -1, -1},
-    {7, 11, 6, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-    {7, 6, 11, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-    {3, 0, 8, 11, 7, 6, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-    {0, 1, 9, 11, 7, 6, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-    {8, 1, 9, 8, 3, 1, 11, 7, 6, -1, -1, -1, -1, -1, -1, -1},
-    {10, 1, 2, 6, 11, 7, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-    {1, 2, 10, 3, 0, 8, 6, 11, 7, -1, -1, -1, -1, -1, -1, -1},
-    {2, 9, 0, 2, 10, 9, 6, 11, 7, -1, -1, -1, -1, -1, -1, -1},
-    {6, 11, 7, 2, 10, 3, 10, 8, 3, 10, 9, 8, -1, -1, -1, -1},
-    {7, 2, 3, 6, 2, 7, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-    {7, 0, 8, 7, 6, 0, 6, 2, 0, -1, -1, -1, -1, -1, -1, -1},
-    {2, 7, 6, 2, 3, 7, 0, 1, 9, -1, -1, -1, -1, -1, -1, -1},
-    {1, 6, 2, 1, 8, 6, 1, 9, 8, 8, 7, 6, -1, -1, -1, -1},
-    {10, 7, 6, 10, 1, 7, 1, 3, 7, -1, -1, -1, -1, -1, -1, -1},
-    {10, 7, 6, 1, 7, 10, 1, 8, 7, 1, 0, 8, -1, -1, -1, -1},
-    {0, 3, 7, 0, 7, 10, 0, 10, 9, 6, 10, 7, -1, -1, -1, -1},
-    {7, 6, 10, 7, 10, 8, 8, 10, 9, -1, -1, -1, -1, -1, -1, -1},
-    {6, 8, 4, 11, 8, 6, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-    {3, 6, 11, 3, 0, 6, 0, 4, 6, -1, -1, -1, -1, -1, -1, -1},
-    {8, 6, 11, 8, 4, 6, 9, 0, 1, -1, -1, -1, -1, -1, -1, -1},
-    {9, 4, 6, 9, 6, 3, 9, 3, 1, 11, 3, 6, -1, -1, -1, -1},
-    {6, 8, 4, 6, 11, 8, 2, 10, 1, -1, -1, -1, -1, -1, -1, -1},
-    {1, 2, 10, 3, 0, 11, 0, 6, 11, 0, 4, 6, -1, -1, -1, -1},
-    {4, 11, 8, 4, 6, 11, 0, 2, 9, 2, 10, 9, -1, -1, -1, -1},
-    {10, 9, 3, 10, 3, 2, 9, 4, 3, 11, 3, 6, 4, 6, 3, -1},
-    {8, 2, 3, 8, 4, 2, 4, 6, 2, -1, -1, -1, -1, -1, -1, -1},
-    {0, 4, 2, 4, 6, 2, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-    {1, 9, 0, 2, 3, 4, 2, 4, 6, 4, 3, 8, -1, -1, -1, -1},
-    {1, 9, 4, 1, 4, 2, 2, 4, 6, -1, -1, -1, -1, -1, -1, -1},
-    {8, 1, 3, 8, 6, 1, 8, 4, 6, 6, 10, 1, -1, -1, -1, -1},
-    {10, 1, 0, 10, 0, 6, 6, 0, 4, -1, -1, -1, -1, -1, -1, -1},
-    {4, 6, 3, 4, 3, 8, 6, 10, 3, 0, 3, 9, 10, 9, 3, -1},
-    {10, 9, 4, 6, 10, 4, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-    {4, 9, 5, 7, 6, 11, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-    {0, 8, 3, 4, 9, 5, 11, 7, 6, -1, -1, -1, -1, -1, -1, -1},
-    {5, 0, 1, 5, 4, 0, 7, 6, 11, -1, -1, -1, -1, -1, -1, -1},
-    {11, 7, 6, 8, 3, 4, 3, 5, 4, 3, 1, 5, -1, -1, -1, -1},
-    {9, 5, 4, 10, 1, 2, 7, 6, 11, -1, -1, -1, -1, -1, -1, -1},
-    {6, 11, 7, 1, 2, 10, 0, 8, 3, 4, 9, 5, -1, -1, -1, -1},
-    {7, 6, 11, 5, 4, 10, 4, 2, 10, 4, 0, 2, -1, -1, -1, -1},
-    {3, 4, 8, 3, 5, 4, 3, 2, 5, 10, 5, 2, 11, 7, 6, -1},
-    {7, 2, 3, 7, 6, 2, 5, 4, 9, -1, -1, -1, -1, -1, -1, -1},
-    {9, 5, 4, 0, 8, 6, 0, 6, 2, 6, 8, 7, -1, -1, -1, -1},
-    {3, 6, 2, 3, 7, 6, 1, 5, 0, 5, 4, 0, -1, -1, -1, -1},
-    {6, 2, 8, 6, 8, 7, 2, 1, 8, 4, 8, 5, 1, 5, 8, -1},
-    {9, 5, 4, 10, 1, 6, 1, 7, 6, 1, 3, 7, -1, -1, -1, -1},
-    {1, 6, 10, 1, 7, 6, 1, 0, 7, 8, 7, 0, 9, 5, 4, -1},
-    {4, 0, 10, 4, 10, 5, 0, 3, 10, 6, 10, 7, 3, 7, 10, -1},
-    {7, 6, 10, 7, 10, 8, 5, 4, 10, 4, 8, 10, -1, -1, -1, -1},
-    {6, 9, 5, 6, 11, 9, 11, 8, 9, -1, -1, -1, -1, -1, -1, -1},
-    {3, 6, 11, 0, 6, 3, 0, 5, 6, 0, 9, 5, -1, -1, -1, -1},
-    {0, 11, 8, 0, 5, 11, 0, 1, 5, 5, 6, 11, -1, -1, -1, -1},
-    {6, 11, 3, 6, 3, 5, 5, 3, 1, -1, -1, -1, -1, -1, -1, -1},
-    {1, 2, 10, 9, 5, 11, 9, 11, 8, 11, 5, 6, -1, -1, -1, -1},
-    {0, 11, 3, 0, 6, 11, 0, 9, 6, 5, 6, 9, 1, 2, 10, -1},
-    {11, 8, 5, 11, 5, 6, 8, 0, 5, 10, 5, 2, 0, 2, 5, -1},
-    {6, 11, 3, 6, 3, 5, 2, 10, 3, 10, 5, 3, -1, -1, -1, -1},
-    {5, 8, 9, 5, 2, 8, 5, 6, 2, 3, 8, 2, -1, -1, -1, -1},
-    {9, 5, 6, 9, 6, 0, 0, 6, 2, -1, -1, -1, -1, -1, -1, -1},
-    {1, 5, 8, 1, 8, 0, 5, 6, 8, 3, 8, 2, 6, 2, 8, -1},
-    {1, 5, 6, 2, 1, 6, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-    {1, 3, 6, 1, 6, 10, 3, 8, 6, 5, 6, 9, 8, 9, 6, -1},
-    {10, 1, 0, 10, 0, 6, 9, 5, 0, 5, 6, 0, -1, -1, -1, -1},
-    {0, 3, 8, 5, 6, 10, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-    {10, 5, 6, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-    {11, 5, 10, 7, 5, 11, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-    {11, 5, 10, 11, 7, 5, 8, 3, 0, -1, -1, -1, -1, -1, -1, -1},
-    {5, 11, 7, 5, 10, 11, 1, 9, 0, -1, -1, -1, -1, -1, -1, -1},
-    {10, 7, 5, 10, 11, 7, 9, 8, 1, 8, 3, 1, -1, -1, -1, -1},
-    {11, 1, 2, 11, 7, 1, 7, 5, 1, -1, -1, -1, -1, -1, -1, -1},
-    {0, 8, 3, 1, 2, 7, 1, 7, 5, 7, 2, 11, -1, -1, -1, -1},
-    {9, 7, 5, 9, 2, 7, 9, 0, 2, 2, 11, 7, -1, -1, -1, -1},
-    {7, 5, 2, 7, 2, 11, 5, 9, 2, 3, 2, 8, 9, 8, 2, -1},
-    {2, 5, 10, 2, 3, 5, 3, 7, 5, -1, -1, -1, -1, -1, -1, -1},
-    {8, 2, 0, 8, 5, 2, 8, 7, 5, 10, 2, 5, -1, -1, -1, -1},
-    {9, 0, 1, 5, 10, 3, 5, 3, 7, 3, 10, 2, -1, -1, -1, -1},
-    {9, 8, 2, 9, 2, 1, 8, 7, 2, 10, 2, 5, 7, 5, 2, -1},
-    {1, 3, 5, 3, 7, 5, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-    {0, 8, 7, 0, 7, 1, 1, 7, 5, -1, -1, -1, -1, -1, -1, -1},
-    {9, 0, 3, 9, 3, 5, 5, 3, 7, -1, -1, -1, -1, -1, -1, -1},
-    {9, 8, 7, 5, 9, 7, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-    {5, 8, 4, 5, 10, 8, 10, 11, 8, -1, -1, -1, -1, -1, -1, -1},
-    {5, 0, 4, 5, 11, 0, 5, 10, 11, 11, 3, 0, -1, -1, -1, -1},
-    {0, 1, 9, 8, 4, 10, 8, 10, 11, 10, 4, 5, -1, -1, -1, -1},
-    {10, 11, 4, 10, 4, 5, 11, 3, 4, 9, 4, 1, 3, 1, 4, -1},
-    {2, 5, 1, 2, 8, 5, 2, 11, 8, 4, 5, 8, -1, -1, -1, -1},
-    {0, 4, 11, 0, 11, 3, 4, 5, 11, 2, 11, 1, 5, 1, 11, -1},
-    {0, 2, 5, 0, 5, 9, 2, 11, 5, 4, 5, 8, 11, 8, 5, -1},
-    {9, 4, 5, 2, 11, 3, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-    {2, 5, 10, 3, 5, 2, 3, 4, 5, 3, 8, 4, -1, -1, -1, -1},
-    {5, 10, 2, 5, 2, 4, 4, 2, 0, -1, -1, -1, -1, -1, -1, -1},
-    {3, 10, 2, 3, 5, 10, 3, 8, 5, 4, 5, 8, 0, 1, 9, -1},
-    {5, 10, 2, 5, 2, 4, 1, 9, 2, 9, 4, 2, -1, -1, -1, -1},
-    {8, 4, 5, 8, 5, 3, 3, 5, 1, -1, -1, -1, -1, -1, -1, -1},
-    {0, 4, 5, 1, 0, 5, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-    {8, 4, 5, 8, 5, 3, 9, 0, 5, 0, 3, 5, -1, -1, -1, -1},
-    {9, 4, 5, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-    {4, 11, 7, 4, 9, 11, 9, 10, 11, -1, -1, -1, -1, -1, -1, -1},
-    {0, 8, 3, 4, 9, 7, 9, 11, 7, 9, 10, 11, -1, -1, -1, -1},
-    {1, 10, 11, 1, 11, 4, 1, 4, 0, 7, 4, 11, -1, -1, -1, -1},
-    {3, 1, 4, 3, 4, 8, 1, 10, 4, 7, 4, 11, 10, 11, 4, -1},
-    {4, 11, 7, 9, 11, 4, 9, 2, 11, 9, 1, 2, -1, -1, -1, -1},
-    {9, 7, 4, 9, 11, 7, 9, 1, 11, 2, 11, 1, 0, 8, 3, -1},
-    {11, 7, 4, 11, 4, 2, 2, 4, 0, -1, -1, -1, -1, -1, -1, -1},
-    {11, 7, 4, 11, 4, 2, 8, 3, 4, 3, 2, 4, -1, -1, -1, -1},
-    {2, 9, 10, 2, 7, 9, 2, 3, 7, 7, 4, 9, -1, -1, -1, -1},
-    {9, 10, 7, 9, 7, 4, 10, 2, 7, 8, 7, 0, 2, 0, 7, -1},
-    {3, 7, 10, 3, 10, 2, 7, 4, 10, 1, 10, 0, 4, 0, 10, -1},
-    {1, 10, 2, 8, 7, 4, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-    {4, 9, 1, 4, 1, 7, 7, 1, 3, -1, -1, -1, -1, -1, -1, -1},
-    {4, 9, 1, 4, 1, 7, 0, 8, 1, 8, 7, 1, -1, -1, -1, -1},
-    {4, 0, 3, 7, 4, 3, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-    {4, 8, 7, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-    {9, 10, 8, 10, 11, 8, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-    {3, 0, 9, 3, 9, 11, 11, 9, 10, -1, -1, -1, -1, -1, -1, -1},
-    {0, 1, 10, 0, 10, 8, 8, 10, 11, -1, -1, -1, -1, -1, -1, -1},
-    {3, 1, 10, 11, 3, 10, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-    {1, 2, 11, 1, 11, 9, 9, 11, 8, -1, -1, -1, -1, -1, -1, -1},
-    {3, 0, 9, 3, 9, 11, 1, 2, 9, 2, 11, 9, -1, -1, -1, -1},
-    {0, 2, 11, 8, 0, 11, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-    {3, 2, 11, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-    {2, 3, 8, 2, 8, 10, 10, 8, 9, -1, -1, -1, -1, -1, -1, -1},
-    {9, 10, 2, 0, 9, 2, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-    {2, 3, 8, 2, 8, 10, 0, 1, 8, 1, 10, 8, -1, -1, -1, -1},
-    {1, 10, 2, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-    {1, 3, 8, 9, 1, 8, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-    {0, 9, 1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-    {0, 3, 8, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-    {-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1}
-};
+// Case tables and corner/edge layout are shared with the engine isosurface module
+using Hammock::edgeTable;
+using Hammock::triTable;
+using Hammock::cornerOffset;
+using Hammock::edgeCorners;
 
 inline Hammock::Vertex interpolate(const Hammock::Vertex& p1, const Hammock::Vertex& p2,
                                     float val1, float val2, float isovalue) {
@@ -323,97 +38,199 @@ inline Hammock::Vertex interpolate(const Hammock::Vertex& p1, const Hammock::Ver
     };
 }
 
+// Emits the triangles of cell (x, y, z), emit is called once per triangle
+template<typename Emit>
+inline void polygonizeCell(int x, int y, int z, const float v[8], int cubeIndex, float isovalue, float cubeSize,
+                           Emit &&emit) {
+    // Define cube vertices in 3D space
+    std::array<Hammock::Vertex, 8> cubeVerts = {{
+        {{x * cubeSize, y * cubeSize, z * cubeSize}},
+        {{(x + 1) * cubeSize, y * cubeSize, z * cubeSize}},
+        {{(x + 1) * cubeSize, (y + 1) * cubeSize, z * cubeSize}},
+        {{x * cubeSize, (y + 1) * cubeSize, z * cubeSize}},
+        {{x * cubeSize, y * cubeSize, (z + 1) * cubeSize}},
+        {{(x + 1) * cubeSize, y * cubeSize, (z + 1) * cubeSize}},
+        {{(x + 1) * cubeSize, (y + 1) * cubeSize, (z + 1) * cubeSize}},
+        {{x * cubeSize, (y + 1) * cubeSize, (z + 1) * cubeSize}}
+    }};
+
+    // Intersect vertices
+    std::array<Hammock::Vertex, 12> intersectVerts;
+    if (edgeTable[cubeIndex] & 1)
+        intersectVerts[0] = interpolate(cubeVerts[0], cubeVerts[1], v[0], v[1], isovalue);
+    if (edgeTable[cubeIndex] & 2)
+        intersectVerts[1] = interpolate(cubeVerts[1], cubeVerts[2], v[1], v[2], isovalue);
+    if (edgeTable[cubeIndex] & 4)
+        intersectVerts[2] = interpolate(cubeVerts[2], cubeVerts[3], v[2], v[3], isovalue);
+    if (edgeTable[cubeIndex] & 8)
+        intersectVerts[3] = interpolate(cubeVerts[3], cubeVerts[0], v[3], v[0], isovalue);
+    if (edgeTable[cubeIndex] & 16)
+        intersectVerts[4] = interpolate(cubeVerts[4], cubeVerts[5], v[4], v[5], isovalue);
+    if (edgeTable[cubeIndex] & 32)
+        intersectVerts[5] = interpolate(cubeVerts[5], cubeVerts[6], v[5], v[6], isovalue);
+    if (edgeTable[cubeIndex] & 64)
+        intersectVerts[6] = interpolate(cubeVerts[6], cubeVerts[7], v[6], v[7], isovalue);
+    if (edgeTable[cubeIndex] & 128)
+        intersectVerts[7] = interpolate(cubeVerts[7], cubeVerts[4], v[7], v[4], isovalue);
+    if (edgeTable[cubeIndex] & 256)
+        intersectVerts[8] = interpolate(cubeVerts[0], cubeVerts[4], v[0], v[4], isovalue);
+    if (edgeTable[cubeIndex] & 512)
+        intersectVerts[9] = interpolate(cubeVerts[1], cubeVerts[5], v[1], v[5], isovalue);
+    if (edgeTable[cubeIndex] & 1024)
+        intersectVerts[10] = interpolate(cubeVerts[2], cubeVerts[6], v[2], v[6], isovalue);
+    if (edgeTable[cubeIndex] & 2048)
+        intersectVerts[11] = interpolate(cubeVerts[3], cubeVerts[7], v[3], v[7], isovalue);
+
+    // Form triangles
+    for (int i = 0; triTable[cubeIndex][i] != -1; i += 3) {
+        emit(Hammock::Triangle{
+            intersectVerts[triTable[cubeIndex][i]],
+            intersectVerts[triTable[cubeIndex][i + 1]],
+            intersectVerts[triTable[cubeIndex][i + 2]]
+        });
+    }
+}
+
+// Marches all cells with z in [zBegin, zEnd) in memory order
+template<typename Emit>
+inline void marchSlab(const ScalarField3D &scalarField, float isovalue, float cubeSize, int zBegin, int zEnd,
+                      Emit &&emit) {
+    const int ny = static_cast<int>(scalarField.sizeY() - 1);
+    CellClassifier classifier(scalarField);
+
+    // x is the fastest axis of the field, so whole rows of cells are classified at once and only
+    // cells that are neither fully inside nor fully outside are polygonized
+    for (int z = zBegin; z < zEnd; ++z) {
+        for (int y = 0; y < ny; ++y) {
+            const int activeCount = classifier.classify(scalarField, y, z, isovalue);
+            for (int i = 0; i < activeCount; ++i) {
+                const int x = classifier.activeCells[i];
+
+                // Cube vertices in scalar field
+                float v[8];
+                scalarField.cellCorners(x, y, z, v);
+
+                polygonizeCell(x, y, z, v, classifier.cubeIndices[i], isovalue, cubeSize, emit);
+            }
+        }
+    }
+}
+
 inline std::vector<Hammock::Triangle> marchingCubes(
-    const std::vector<std::vector<std::vector<float>>>& scalarField,
+    const ScalarField3D &scalarField,
     float isovalue,
     float cubeSize) {
 
-    if (scalarField.empty() || scalarField[0].empty() || scalarField[0][0].empty()) {
+    if (scalarField.sizeX() < 2 || scalarField.sizeY() < 2 || scalarField.sizeZ() < 2) {
         return {};
     }
 
     std::vector<Hammock::Triangle> triangles;
-    const int nx = static_cast<int>(scalarField.size() - 1);
-    const int ny = static_cast<int>(scalarField[0].size() - 1);
-    const int nz = static_cast<int>(scalarField[0][0].size() - 1);
+    marchSlab(scalarField, isovalue, cubeSize, 0, static_cast<int>(scalarField.sizeZ() - 1),
+              [&triangles](const Hammock::Triangle &triangle) { triangles.push_back(triangle); });
 
-    for (int x = 0; x < nx; ++x) {
-        for (int y = 0; y < ny; ++y) {
-            for (int z = 0; z < nz; ++z) {
-                // Cube vertices in scalar field
-                float v0 = scalarField[x][y][z];
-                float v1 = scalarField[x + 1][y][z];
-                float v2 = scalarField[x + 1][y + 1][z];
-                float v3 = scalarField[x][y + 1][z];
-                float v4 = scalarField[x][y][z + 1];
-                float v5 = scalarField[x + 1][y][z + 1];
-                float v6 = scalarField[x + 1][y + 1][z + 1];
-                float v7 = scalarField[x][y + 1][z + 1];
+    return triangles;
+}
 
-                // Determine cube index
-                int cubeIndex = 0;
-                if (v0 < isovalue) cubeIndex |= 1;
-                if (v1 < isovalue) cubeIndex |= 2;
-                if (v2 < isovalue) cubeIndex |= 4;
-                if (v3 < isovalue) cubeIndex |= 8;
-                if (v4 < isovalue) cubeIndex |= 16;
-                if (v5 < isovalue) cubeIndex |= 32;
-                if (v6 < isovalue) cubeIndex |= 64;
-                if (v7 < isovalue) cubeIndex |= 128;
+// Slab parallel marching cubes
+// The field is split into z-slabs that are distributed over the threads of the pool. Every slab is
+// extracted into its own buffer, an exclusive prefix sum over the slab sizes gives each slab its range
+// in the output, and the slabs are copied into one buffer in parallel. Slabs are laid out in z order,
+// so the result is bit-identical to marchingCubes() regardless of the thread count.
+inline std::vector<Hammock::Triangle> marchingCubesParallel(
+    const ScalarField3D &scalarField,
+    float isovalue,
+    float cubeSize,
+    Hammock::ThreadPool &threadPool) {
 
-                // Skip cube if fully inside or outside
-                if (edgeTable[cubeIndex] == 0) continue;
+    if (scalarField.sizeX() < 2 || scalarField.sizeY() < 2 || scalarField.sizeZ() < 2) {
+        return {};
+    }
 
-                // Define cube vertices in 3D space
-                std::array<Hammock::Vertex, 8> cubeVerts = {{
-                    {{x * cubeSize, y * cubeSize, z * cubeSize}},
-                    {{(x + 1) * cubeSize, y * cubeSize, z * cubeSize}},
-                    {{(x + 1) * cubeSize, (y + 1) * cubeSize, z * cubeSize}},
-                    {{x * cubeSize, (y + 1) * cubeSize, z * cubeSize}},
-                    {{x * cubeSize, y * cubeSize, (z + 1) * cubeSize}},
-                    {{(x + 1) * cubeSize, y * cubeSize, (z + 1) * cubeSize}},
-                    {{(x + 1) * cubeSize, (y + 1) * cubeSize, (z + 1) * cubeSize}},
-                    {{x * cubeSize, (y + 1) * cubeSize, (z + 1) * cubeSize}}
-                }};
+    const int nz = static_cast<int>(scalarField.sizeZ() - 1);
+    const auto threadCount = static_cast<uint32_t>(threadPool.threads.size());
+    if (threadCount == 0) {
+        return marchingCubes(scalarField, isovalue, cubeSize);
+    }
 
-                // Intersect vertices
-                std::array<Hammock::Vertex, 12> intersectVerts;
-                if (edgeTable[cubeIndex] & 1)
-                    intersectVerts[0] = interpolate(cubeVerts[0], cubeVerts[1], v0, v1, isovalue);
-                if (edgeTable[cubeIndex] & 2)
-                    intersectVerts[1] = interpolate(cubeVerts[1], cubeVerts[2], v1, v2, isovalue);
-                if (edgeTable[cubeIndex] & 4)
-                    intersectVerts[2] = interpolate(cubeVerts[2], cubeVerts[3], v2, v3, isovalue);
-                if (edgeTable[cubeIndex] & 8)
-                    intersectVerts[3] = interpolate(cubeVerts[3], cubeVerts[0], v3, v0, isovalue);
-                if (edgeTable[cubeIndex] & 16)
-                    intersectVerts[4] = interpolate(cubeVerts[4], cubeVerts[5], v4, v5, isovalue);
-                if (edgeTable[cubeIndex] & 32)
-                    intersectVerts[5] = interpolate(cubeVerts[5], cubeVerts[6], v5, v6, isovalue);
-                if (edgeTable[cubeIndex] & 64)
-                    intersectVerts[6] = interpolate(cubeVerts[6], cubeVerts[7], v6, v7, isovalue);
-                if (edgeTable[cubeIndex] & 128)
-                    intersectVerts[7] = interpolate(cubeVerts[7], cubeVerts[4], v7, v4, isovalue);
-                if (edgeTable[cubeIndex] & 256)
-                    intersectVerts[8] = interpolate(cubeVerts[0], cubeVerts[4], v0, v4, isovalue);
-                if (edgeTable[cubeIndex] & 512)
-                    intersectVerts[9] = interpolate(cubeVerts[1], cubeVerts[5], v1, v5, isovalue);
-                if (edgeTable[cubeIndex] & 1024)
-                    intersectVerts[10] = interpolate(cubeVerts[2], cubeVerts[6], v2, v6, isovalue);
-                if (edgeTable[cubeIndex] & 2048)
-                    intersectVerts[11] = interpolate(cubeVerts[3], cubeVerts[7], v3, v7, isovalue);
+    // Oversubscribe slabs a bit so that threads with empty slabs do not idle
+    const int slabCount = std::min(nz, static_cast<int>(threadCount) * 4);
+    std::vector<int> slabBegin(slabCount + 1);
+    for (int i = 0; i <= slabCount; ++i) {
+        slabBegin[i] = static_cast<int>(static_cast<int64_t>(nz) * i / slabCount);
+    }
 
-                // Form triangles
-                for (int i = 0; triTable[cubeIndex][i] != -1; i += 3) {
-                    triangles.push_back({
-                        intersectVerts[triTable[cubeIndex][i]],
-                        intersectVerts[triTable[cubeIndex][i + 1]],
-                        intersectVerts[triTable[cubeIndex][i + 2]]
-                    });
-                }
+    // Pass 1: extract every slab into its own buffer
+    // Slabs are dealt out round robin, so every thread gets slabs from all over the field
+    std::vector<std::vector<Hammock::Triangle> > slabTriangles(slabCount);
+    threadPool.parallelFor(threadCount, [&](uint32_t begin, uint32_t end) {
+        for (uint32_t t = begin; t < end; ++t) {
+            for (int i = static_cast<int>(t); i < slabCount; i += static_cast<int>(threadCount)) {
+                auto &out = slabTriangles[i];
+                marchSlab(scalarField, isovalue, cubeSize, slabBegin[i], slabBegin[i + 1],
+                          [&out](const Hammock::Triangle &triangle) { out.push_back(triangle); });
             }
         }
+    });
+
+    // Exclusive prefix sum, offsets[i] is where slab i starts in the output
+    std::vector<std::size_t> offsets(slabCount + 1, 0);
+    for (int i = 0; i < slabCount; ++i) {
+        offsets[i + 1] = offsets[i] + slabTriangles[i].size();
     }
 
+    // Pass 2: merge into one buffer
+    std::vector<Hammock::Triangle> triangles(offsets[slabCount]);
+    threadPool.parallelFor(slabCount, [&](uint32_t begin, uint32_t end) {
+        for (uint32_t i = begin; i < end; ++i) {
+            std::copy(slabTriangles[i].begin(), slabTriangles[i].end(), triangles.begin() + offsets[i]);
+            std::vector<Hammock::Triangle>().swap(slabTriangles[i]);
+        }
+    });
+
     return triangles;
 }
+
+// Indexed triangle mesh, vertices are shared between neighbouring cells
+using IndexedMesh = Hammock::IsosurfaceMesh;
+
+// Indexed meshes come from the engine extractor. The example meshes in grid units scaled by cubeSize
+// and mirrors normals in Y for the Y-down convention of the engine.
+inline Hammock::Isosurface::ExtractInfo extractInfo(float isovalue, float cubeSize) {
+    Hammock::Isosurface::ExtractInfo info;
+    info.isovalue = isovalue;
+    info.scale = HmckVec3{cubeSize, cubeSize, cubeSize};
+    info.flipNormalY = true;
+    return info;
+}
+
+// Central difference gradient of the field at a grid point, one sided at the borders
+template<typename Field>
+inline HmckVec3 fieldGradient(const Field &scalarField, uint32_t x, uint32_t y, uint32_t z) {
+    return Hammock::Isosurface::gradient(scalarField, x, y, z);
+}
+
+// Vertex where edge e of cell (x, y, z) crosses the isovalue, v holds the corners of the cell.
+// The normal is interpolated from the field gradient and points towards lower values, mirrored in Y.
+template<typename Field>
+inline Hammock::Vertex createEdgeVertex(const Field &scalarField, int x, int y, int z, int e, const float v[8],
+                                        float isovalue, float cubeSize) {
+    return Hammock::Isosurface::edgeVertex(scalarField, extractInfo(isovalue, cubeSize), x, y, z, e, v);
+}
+
+inline IndexedMesh marchingCubesIndexed(
+    const ScalarField3D &scalarField,
+    float isovalue,
+    float cubeSize) {
+    return Hammock::Isosurface::extract(scalarField, extractInfo(isovalue, cubeSize));
+}
+
+// Slab parallel variant of marchingCubesIndexed, merged in slab order like marchingCubesParallel.
+// Vertices on the boundary between two slabs are duplicated, everything else is shared.
+inline IndexedMesh marchingCubesIndexedParallel(
+    const ScalarField3D &scalarField,
+    float isovalue,
+    float cubeSize,
+    Hammock::ThreadPool &threadPool) {
+    return Hammock::Isosurface::extractParallel(scalarField, extractInfo(isovalue, cubeSize), threadPool);
+}
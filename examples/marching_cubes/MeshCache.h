@@ -0,0 +1,270 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include <vulkan/vulkan.h>
+#include <hammock/utils/MappedFile.h>
+
+#include "MarchingCubes.h"
+
+// 12 byte vertex: position quantized to 16 bits per axis inside the mesh bounds and an octahedral
+// encoded normal. Decoded in marching_cubes_compact.vert.
+struct CompactVertex {
+    uint16_t position[4]; // unorm, w unused
+    int16_t normal[2]; // snorm, octahedral
+
+    static std::vector<VkVertexInputAttributeDescription> vertexInputAttributeDescriptions() {
+        return {
+            {0, 0, VK_FORMAT_R16G16B16A16_UNORM, offsetof(CompactVertex, position)},
+            {1, 0, VK_FORMAT_R16G16_SNORM, offsetof(CompactVertex, normal)}
+        };
+    }
+
+    static std::vector<VkVertexInputBindingDescription> vertexInputBindingDescriptions() {
+        return {
+            {
+                .binding = 0,
+                .stride = sizeof(CompactVertex),
+                .inputRate = VK_VERTEX_INPUT_RATE_VERTEX
+            }
+        };
+    }
+};
+
+static_assert(sizeof(CompactVertex) == 12);
+
+// Maps a unit vector onto the octahedron and unfolds it into the [-1, 1] square
+inline void encodeOctahedral(const HmckVec3 &n, int16_t out[2]) {
+    const float l1 = std::abs(n.X) + std::abs(n.Y) + std::abs(n.Z);
+    float x = l1 > 0.0f ? n.X / l1 : 0.0f;
+    float y = l1 > 0.0f ? n.Y / l1 : 0.0f;
+    if (n.Z < 0.0f) {
+        const float fx = (1.0f - std::abs(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+        const float fy = (1.0f - std::abs(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+        x = fx;
+        y = fy;
+    }
+    out[0] = static_cast<int16_t>(std::lround(std::clamp(x, -1.0f, 1.0f) * 32767.0f));
+    out[1] = static_cast<int16_t>(std::lround(std::clamp(y, -1.0f, 1.0f) * 32767.0f));
+}
+
+inline HmckVec3 decodeOctahedral(const int16_t in[2]) {
+    float x = std::max(in[0] / 32767.0f, -1.0f);
+    float y = std::max(in[1] / 32767.0f, -1.0f);
+    const float z = 1.0f - std::abs(x) - std::abs(y);
+    if (z < 0.0f) {
+        const float fx = (1.0f - std::abs(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+        const float fy = (1.0f - std::abs(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+        x = fx;
+        y = fy;
+    }
+    const float length = std::sqrt(x * x + y * y + z * z);
+    return HmckVec3{x / length, y / length, z / length};
+}
+
+// 64 bit FNV-1a over whole words, fast enough to key caches by the contents of large files
+class Hasher {
+public:
+    Hasher &add(const void *data, std::size_t size) {
+        const auto *bytes = static_cast<const uint8_t *>(data);
+        std::size_t i = 0;
+        for (; i + 8 <= size; i += 8) {
+            uint64_t word;
+            std::memcpy(&word, bytes + i, 8);
+            hash = (hash ^ word) * PRIME;
+        }
+        for (; i < size; ++i) {
+            hash = (hash ^ bytes[i]) * PRIME;
+        }
+        return *this;
+    }
+
+    template<typename T>
+    Hasher &add(const T &value) { return add(&value, sizeof(T)); }
+
+    [[nodiscard]] uint64_t value() const { return hash; }
+
+private:
+    static constexpr uint64_t PRIME = 0x100000001b3ull;
+    uint64_t hash = 0xcbf29ce484222325ull;
+};
+
+// Indexed mesh in the compact vertex format, either owned or backed by a memory mapped cache file
+class CompactMesh {
+public:
+    static constexpr char MAGIC[4] = {'H', 'M', 'C', 'C'};
+    static constexpr uint32_t VERSION = 1;
+
+    struct Header {
+        char magic[4];
+        uint32_t version;
+        uint64_t key;
+        uint32_t vertexCount;
+        uint32_t indexCount;
+        float boundsMin[4];
+        float boundsExtent[4];
+    };
+
+    CompactMesh() = default;
+
+    // Header of the mesh quantized into its bounding box, without a key
+    static Header describe(const IndexedMesh &mesh) {
+        Header header{};
+        std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+        header.version = VERSION;
+        header.vertexCount = static_cast<uint32_t>(mesh.vertices.size());
+        header.indexCount = static_cast<uint32_t>(mesh.indices.size());
+
+        float lo[3] = {0.0f, 0.0f, 0.0f}, hi[3] = {0.0f, 0.0f, 0.0f};
+        if (!mesh.vertices.empty()) {
+            const HmckVec3 &first = mesh.vertices[0].position;
+            lo[0] = hi[0] = first.X;
+            lo[1] = hi[1] = first.Y;
+            lo[2] = hi[2] = first.Z;
+        }
+        for (const auto &vertex: mesh.vertices) {
+            for (int a = 0; a < 3; ++a) {
+                lo[a] = std::min(lo[a], vertex.position.Elements[a]);
+                hi[a] = std::max(hi[a], vertex.position.Elements[a]);
+            }
+        }
+        for (int a = 0; a < 3; ++a) {
+            header.boundsMin[a] = lo[a];
+            header.boundsExtent[a] = hi[a] > lo[a] ? hi[a] - lo[a] : 1.0f;
+        }
+        return header;
+    }
+
+    // Quantizes count vertices into the bounds of header, out may be a mapped buffer
+    static void encode(const Header &header, const Hammock::Vertex *vertices, std::size_t count, CompactVertex *out) {
+        for (std::size_t i = 0; i < count; ++i) {
+            for (int a = 0; a < 3; ++a) {
+                const float t = (vertices[i].position.Elements[a] - header.boundsMin[a]) / header.boundsExtent[a];
+                out[i].position[a] = static_cast<uint16_t>(std::lround(std::clamp(t, 0.0f, 1.0f) * 65535.0f));
+            }
+            out[i].position[3] = 0;
+            encodeOctahedral(vertices[i].normal, out[i].normal);
+        }
+    }
+
+    // Quantizes the mesh into its bounding box
+    static CompactMesh fromIndexedMesh(const IndexedMesh &mesh) {
+        CompactMesh compact;
+        compact.header = describe(mesh);
+        compact.ownedVertices.resize(mesh.vertices.size());
+        encode(compact.header, mesh.vertices.data(), mesh.vertices.size(), compact.ownedVertices.data());
+        compact.ownedIndices = mesh.indices;
+        return compact;
+    }
+
+    // Maps a cache file, nothing if it is missing, truncated or was written for another key
+    static std::optional<CompactMesh> load(const std::string &path, uint64_t key) {
+        auto file = std::make_shared<Hammock::MappedFile>(path);
+        if (!file->isOpen() || file->size() < sizeof(Header)) return std::nullopt;
+
+        CompactMesh compact;
+        std::memcpy(&compact.header, file->data(), sizeof(Header));
+        const Header &header = compact.header;
+        const std::size_t expectedSize = sizeof(Header) + header.vertexCount * sizeof(CompactVertex) +
+                                         header.indexCount * sizeof(uint32_t);
+        if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.version != VERSION ||
+            header.key != key || file->size() != expectedSize) {
+            return std::nullopt;
+        }
+
+        compact.mapping = std::move(file);
+        return compact;
+    }
+
+    // Writes the cache file of fromIndexedMesh(mesh) without keeping the quantized vertices around, they
+    // are encoded a block at a time on the way to the file. Writes to a temporary file first, so a crash
+    // never leaves a truncated cache entry behind.
+    static bool save(const std::string &path, uint64_t key, const IndexedMesh &mesh) {
+        Header header = describe(mesh);
+        header.key = key;
+        const std::string temporary = path + ".tmp";
+        {
+            std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+            if (!file) return false;
+            file.write(reinterpret_cast<const char *>(&header), sizeof(Header));
+            CompactVertex block[4096];
+            for (std::size_t first = 0; first < mesh.vertices.size(); first += std::size(block)) {
+                const std::size_t count = std::min(std::size(block), mesh.vertices.size() - first);
+                encode(header, mesh.vertices.data() + first, count, block);
+                file.write(reinterpret_cast<const char *>(block), count * sizeof(CompactVertex));
+            }
+            file.write(reinterpret_cast<const char *>(mesh.indices.data()), mesh.indices.size() * sizeof(uint32_t));
+            if (!file) return false;
+        }
+        std::error_code error;
+        std::filesystem::rename(temporary, path, error);
+        return !error;
+    }
+
+    [[nodiscard]] uint32_t vertexCount() const { return header.vertexCount; }
+    [[nodiscard]] uint32_t indexCount() const { return header.indexCount; }
+
+    [[nodiscard]] const CompactVertex *vertices() const {
+        if (mapping) return reinterpret_cast<const CompactVertex *>(mapping->data() + sizeof(Header));
+        return ownedVertices.data();
+    }
+
+    [[nodiscard]] const uint32_t *indices() const {
+        if (mapping) {
+            return reinterpret_cast<const uint32_t *>(mapping->data() + sizeof(Header) +
+                                                      header.vertexCount * sizeof(CompactVertex));
+        }
+        return ownedIndices.data();
+    }
+
+    [[nodiscard]] HmckVec4 boundsMin() const {
+        return HmckVec4{header.boundsMin[0], header.boundsMin[1], header.boundsMin[2], 0.0f};
+    }
+
+    [[nodiscard]] HmckVec4 boundsExtent() const {
+        return HmckVec4{header.boundsExtent[0], header.boundsExtent[1], header.boundsExtent[2], 0.0f};
+    }
+
+    [[nodiscard]] bool isMapped() const { return mapping != nullptr; }
+
+private:
+    Header header{};
+    std::vector<CompactVertex> ownedVertices;
+    std::vector<uint32_t> ownedIndices;
+    std::shared_ptr<Hammock::MappedFile> mapping;
+};
+
+// Directory of compact meshes keyed by a hash of the source data and the extraction parameters
+class MeshCache {
+public:
+    explicit MeshCache(std::string directory) : directory(std::move(directory)) {
+        std::error_code error;
+        std::filesystem::create_directories(this->directory, error);
+    }
+
+    [[nodiscard]] std::string path(uint64_t key) const {
+        char name[32];
+        std::snprintf(name, sizeof(name), "%016llx.mcc", static_cast<unsigned long long>(key));
+        return (std::filesystem::path(directory) / name).string();
+    }
+
+    [[nodiscard]] std::optional<CompactMesh> find(uint64_t key) const {
+        return CompactMesh::load(path(key), key);
+    }
+
+    bool store(const IndexedMesh &mesh, uint64_t key) const {
+        return CompactMesh::save(path(key), key, mesh);
+    }
+
+private:
+    std::string directory;
+};
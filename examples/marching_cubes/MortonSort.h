@@ -0,0 +1,321 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include <hammock/core/ThreadPool.h>
+
+#include "Particle.h"
+#include "ScalarField3D.h"
+#include "SparseScalarField3D.h"
+
+// Morton ordered particle scatter
+//
+// Particles arrive in simulation order, so writing them into the field jumps across the whole grid.
+// Sorted by the Morton code of their cell, consecutive particles land in the same or neighbouring cells
+// and the 8^3 bricks of the sparse field fill up one after the other. The low 9 bits of a code are the
+// position inside a brick, so a run of equal code >> 9 is exactly one brick. Threads split the sorted
+// particles at brick boundaries and never share a voxel or a brick.
+//
+// The radix sort is stable, particles of one cell keep their input order and every voxel sums them in
+// the same order as createScalarField does, the fields are identical bit for bit.
+//
+// Simulations keep the particle order between frames and particles only move a few cells, so the
+// permutation of the previous frame is nearly sorted for the next one. It is reused when only a few
+// particles end up out of place, those are sorted on their own and merged back in.
+
+namespace MortonSortDetail {
+    // Inverse of the bit spreading of ScalarField3D::morton
+    inline uint32_t compactBits(uint64_t x) {
+        x &= 0x1249249249249249ull;
+        x = (x | x >> 2) & 0x10c30c30c30c30c3ull;
+        x = (x | x >> 4) & 0x100f00f00f00f00full;
+        x = (x | x >> 8) & 0x1f0000ff0000ffull;
+        x = (x | x >> 16) & 0x1f00000000ffffull;
+        x = (x | x >> 32) & 0x1fffffull;
+        return static_cast<uint32_t>(x);
+    }
+
+    inline void decode(uint64_t code, uint32_t &x, uint32_t &y, uint32_t &z) {
+        x = compactBits(code);
+        y = compactBits(code >> 1);
+        z = compactBits(code >> 2);
+    }
+}
+
+class MortonSorter {
+public:
+    // Codes of up to 10 bits per axis and the particle index share one 64 bit entry
+    static constexpr int MAX_GRID_DIM = 1024;
+    // Key of particles off the grid, its low bits already sort it after every cell
+    static constexpr uint32_t OUTSIDE = std::numeric_limits<uint32_t>::max();
+
+    // Reuse the previous permutation while at most this fraction of the particles is out of place
+    float reuseThreshold = 0.1f;
+
+    // Sorts the particles by the cell createScalarField maps them to, false if the grid is too large
+    bool sort(const ParticleArrays &particles, float fieldSize, int gridDim, Hammock::ThreadPool &threadPool) {
+        if (gridDim <= 0 || gridDim > MAX_GRID_DIM) return false;
+        const std::size_t count = particles.size();
+        const int jobs = jobCount(count, threadPool);
+        computeKeys(particles, fieldSize, gridDim, threadPool, jobs);
+
+        reusedLast = gridDim == sortedGridDim && sorted.size() == count && repair(particles, threadPool, jobs);
+        if (!reusedLast) {
+            // Bits of the largest code and one more to tell OUTSIDE apart
+            const uint32_t axisBits = gridDim > 1 ? std::bit_width(static_cast<uint32_t>(gridDim - 1)) : 1;
+            radixSort(particles, (3 * axisBits + 1 + RADIX_BITS - 1) / RADIX_BITS, threadPool, jobs);
+        }
+        sortedGridDim = gridDim;
+        return true;
+    }
+
+    // Key in the high and particle index in the low half, ordered by key and then by index
+    [[nodiscard]] const std::vector<uint64_t> &entries() const { return sorted; }
+
+    // Densities in the order of entries(), moved along with them so the scatter reads them in order
+    [[nodiscard]] const std::vector<float> &densities() const { return sortedRho; }
+
+    static uint32_t key(uint64_t entry) { return static_cast<uint32_t>(entry >> 32); }
+    static uint32_t index(uint64_t entry) { return static_cast<uint32_t>(entry); }
+
+    // Particles that fall into the grid, they come first
+    [[nodiscard]] std::size_t insideCount() const {
+        return std::lower_bound(sorted.begin(), sorted.end(), uint64_t{OUTSIDE} << 32) - sorted.begin();
+    }
+
+    // Whether the last sort reused the permutation of the frame before
+    [[nodiscard]] bool reused() const { return reusedLast; }
+
+private:
+    // 11 bits sort the codes of grids up to 128 points per axis in two passes, all others in three
+    static constexpr uint32_t RADIX_BITS = 11;
+    static constexpr std::size_t RADICES = std::size_t{1} << RADIX_BITS;
+
+    static int jobCount(std::size_t count, Hammock::ThreadPool &threadPool) {
+        // Small inputs are not worth the synchronization
+        constexpr std::size_t MIN_PER_JOB = 16384;
+        const std::size_t threads = std::max<std::size_t>(1, threadPool.threads.size());
+        return static_cast<int>(std::clamp<std::size_t>(count / MIN_PER_JOB, 1, threads));
+    }
+
+    static std::pair<std::size_t, std::size_t> jobRange(std::size_t count, int jobs, int job) {
+        return {count * job / jobs, count * (job + 1) / jobs};
+    }
+
+    void computeKeys(const ParticleArrays &particles, float fieldSize, int gridDim, Hammock::ThreadPool &threadPool,
+                     int jobs) {
+        keys.resize(particles.size());
+        threadPool.parallelFor(static_cast<uint32_t>(jobs), [&](uint32_t firstJob, uint32_t lastJob) {
+            for (uint32_t job = firstJob; job < lastJob; ++job) {
+                const auto [begin, end] = jobRange(particles.size(), jobs, job);
+                for (std::size_t i = begin; i < end; ++i) {
+                    // The same mapping as createScalarField, so both agree on the cell of every particle
+                    const int x = static_cast<int>((particles.positionX[i] + fieldSize / 2.0f) / fieldSize * gridDim);
+                    const int y = static_cast<int>((particles.positionY[i] + fieldSize / 2.0f) / fieldSize * gridDim);
+                    const int z = static_cast<int>((particles.positionZ[i] + fieldSize / 2.0f) / fieldSize * gridDim);
+                    keys[i] = x >= 0 && x < gridDim && y >= 0 && y < gridDim && z >= 0 && z < gridDim
+                                  ? static_cast<uint32_t>(ScalarField3D::morton(x, y, z))
+                                  : OUTSIDE;
+                }
+            }
+        });
+    }
+
+    // Stable LSD radix sort by key, RADIX_BITS per pass. Every job histograms its slice, the offsets are laid
+    // out digit by digit and job by job within a digit, so the scatter keeps the index order.
+    void radixSort(const ParticleArrays &particles, uint32_t passes, Hammock::ThreadPool &threadPool, int jobs) {
+        const std::size_t count = keys.size();
+        sorted.resize(count);
+        scratch.resize(count);
+        sortedRho.assign(particles.rho.begin(), particles.rho.end());
+        scratchRho.resize(count);
+        threadPool.parallelFor(static_cast<uint32_t>(jobs), [&](uint32_t firstJob, uint32_t lastJob) {
+            for (uint32_t job = firstJob; job < lastJob; ++job) {
+                const auto [begin, end] = jobRange(count, jobs, job);
+                for (std::size_t i = begin; i < end; ++i) sorted[i] = uint64_t{keys[i]} << 32 | i;
+            }
+        });
+
+        std::vector<std::array<std::size_t, RADICES> > histograms(jobs);
+        for (uint32_t pass = 0; pass < passes; ++pass) {
+            const uint32_t shift = 32 + pass * RADIX_BITS;
+            threadPool.parallelFor(static_cast<uint32_t>(jobs), [&](uint32_t firstJob, uint32_t lastJob) {
+                for (uint32_t job = firstJob; job < lastJob; ++job) {
+                    auto &histogram = histograms[job];
+                    histogram.fill(0);
+                    const auto [begin, end] = jobRange(count, jobs, job);
+                    for (std::size_t i = begin; i < end; ++i) ++histogram[sorted[i] >> shift & (RADICES - 1)];
+                }
+            });
+
+            std::size_t offset = 0;
+            for (std::size_t digit = 0; digit < RADICES; ++digit) {
+                for (auto &histogram: histograms) {
+                    const std::size_t n = histogram[digit];
+                    histogram[digit] = offset;
+                    offset += n;
+                }
+            }
+
+            threadPool.parallelFor(static_cast<uint32_t>(jobs), [&](uint32_t firstJob, uint32_t lastJob) {
+                for (uint32_t job = firstJob; job < lastJob; ++job) {
+                    auto &cursor = histograms[job];
+                    const auto [begin, end] = jobRange(count, jobs, job);
+                    for (std::size_t i = begin; i < end; ++i) {
+                        const std::size_t target = cursor[sorted[i] >> shift & (RADICES - 1)]++;
+                        scratch[target] = sorted[i];
+                        scratchRho[target] = sortedRho[i];
+                    }
+                }
+            });
+            sorted.swap(scratch);
+            sortedRho.swap(scratchRho);
+        }
+    }
+
+    // Brings the previous permutation up to date with the new keys. Particles that are out of place
+    // are pulled out, sorted and merged back into the rest, which is still in order. Entries order by
+    // key and then by index, so the result is exactly what the radix sort gives. False if too many
+    // particles moved.
+    bool repair(const ParticleArrays &particles, Hammock::ThreadPool &threadPool, int jobs) {
+        const std::size_t count = sorted.size();
+        threadPool.parallelFor(static_cast<uint32_t>(jobs), [&](uint32_t firstJob, uint32_t lastJob) {
+            for (uint32_t job = firstJob; job < lastJob; ++job) {
+                const auto [begin, end] = jobRange(count, jobs, job);
+                for (std::size_t i = begin; i < end; ++i) {
+                    const uint32_t particle = index(sorted[i]);
+                    scratch[i] = uint64_t{keys[particle]} << 32 | particle;
+                }
+            }
+        });
+
+        // A particle that is larger than its successor or smaller than the last kept one has moved,
+        // a single particle jumping either way costs one move
+        const std::size_t maxMoved = static_cast<std::size_t>(reuseThreshold * static_cast<float>(count));
+        std::vector<uint64_t> moved;
+        std::size_t kept = 0;
+        for (std::size_t i = 0; i < count; ++i) {
+            const uint64_t entry = scratch[i];
+            if ((i + 1 < count && scratch[i + 1] < entry) || (kept > 0 && entry < sorted[kept - 1])) {
+                moved.push_back(entry);
+                if (moved.size() > maxMoved) return false;
+            } else {
+                sorted[kept++] = entry;
+            }
+        }
+
+        std::ranges::sort(moved);
+        std::ranges::merge(sorted.begin(), sorted.begin() + static_cast<std::ptrdiff_t>(kept), moved.begin(),
+                           moved.end(), scratch.begin());
+        sorted.swap(scratch);
+
+        // The densities are new every frame, they follow the permutation
+        sortedRho.resize(count);
+        threadPool.parallelFor(static_cast<uint32_t>(jobs), [&](uint32_t firstJob, uint32_t lastJob) {
+            for (uint32_t job = firstJob; job < lastJob; ++job) {
+                const auto [begin, end] = jobRange(count, jobs, job);
+                for (std::size_t i = begin; i < end; ++i) sortedRho[i] = particles.rho[index(sorted[i])];
+            }
+        });
+        return true;
+    }
+
+    std::vector<uint32_t> keys; // in particle order
+    std::vector<uint64_t> sorted;
+    std::vector<uint64_t> scratch;
+    std::vector<float> sortedRho;
+    std::vector<float> scratchRho;
+    int sortedGridDim = -1;
+    bool reusedLast = false;
+};
+
+// Adds the density of the sorted particles to their cells, parallelized over ranges of bricks. Bricks
+// of a sparse field have to be allocated already.
+template<typename Field>
+inline void scatterSorted(const MortonSorter &sorter, Hammock::ThreadPool &threadPool, Field &scalarField) {
+    const std::vector<uint64_t> &entries = sorter.entries();
+    const std::vector<float> &densities = sorter.densities();
+    const std::size_t count = sorter.insideCount();
+    constexpr uint32_t BRICK_BITS = 3 * SparseScalarField3D::BRICK_SHIFT;
+    auto brick = [&entries](std::size_t i) { return MortonSorter::key(entries[i]) >> BRICK_BITS; };
+
+    // Ranges of about equal size that end where a brick ends
+    const int jobs = static_cast<int>(std::clamp<std::size_t>(count / 16384, 1,
+                                                              std::max<std::size_t>(1, threadPool.threads.size())));
+    std::vector<std::size_t> bounds(jobs + 1, count);
+    bounds[0] = 0;
+    for (int job = 1; job < jobs; ++job) {
+        std::size_t bound = std::max(bounds[job - 1], count * job / jobs);
+        while (bound > 0 && bound < count && brick(bound) == brick(bound - 1)) ++bound;
+        bounds[job] = bound;
+    }
+
+    threadPool.parallelFor(static_cast<uint32_t>(jobs), [&](uint32_t firstJob, uint32_t lastJob) {
+        for (uint32_t job = firstJob; job < lastJob; ++job) {
+            for (std::size_t i = bounds[job]; i < bounds[job + 1]; ++i) {
+                uint32_t x, y, z;
+                MortonSortDetail::decode(MortonSorter::key(entries[i]), x, y, z);
+                scalarField.at(x, y, z) += densities[i];
+            }
+        }
+    });
+}
+
+// createScalarField with the particles written in Morton order of their cells
+inline ScalarField3D createScalarFieldSorted(
+    const ParticleArrays &particles,
+    const float gridSize, // Grid resolution (distance between grid points)
+    const float fieldSize, // Size of the field (bounding box dimensions)
+    MortonSorter &sorter,
+    Hammock::ThreadPool &threadPool,
+    const ScalarField3D::Layout layout = ScalarField3D::Layout::Linear
+) {
+    const int gridDim = static_cast<int>(fieldSize / gridSize);
+    ScalarField3D scalarField(gridDim, gridDim, gridDim, layout, 0.0f);
+    if (gridDim <= 0) return scalarField;
+
+    if (!sorter.sort(particles, fieldSize, gridDim, threadPool)) {
+        return createScalarField(particles, gridSize, fieldSize, layout);
+    }
+    scatterSorted(sorter, threadPool, scalarField);
+    return scalarField;
+}
+
+// createSparseScalarField with the particles written in Morton order of their cells
+inline SparseScalarField3D createSparseScalarFieldSorted(
+    const ParticleArrays &particles,
+    const float gridSize, // Grid resolution (distance between grid points)
+    const float fieldSize, // Size of the field (bounding box dimensions)
+    MortonSorter &sorter,
+    Hammock::ThreadPool &threadPool
+) {
+    const int gridDim = static_cast<int>(fieldSize / gridSize);
+    SparseScalarField3D scalarField(gridDim, gridDim, gridDim, 0.0f);
+    if (gridDim <= 0) return scalarField;
+
+    if (!sorter.sort(particles, fieldSize, gridDim, threadPool)) {
+        return createSparseScalarField(particles, gridSize, fieldSize);
+    }
+
+    // Allocate up front, one brick per run of equal brick codes, the jobs then only write into them
+    constexpr uint32_t BRICK_BITS = 3 * SparseScalarField3D::BRICK_SHIFT;
+    const std::vector<uint64_t> &entries = sorter.entries();
+    const std::size_t count = sorter.insideCount();
+    uint32_t previous = MortonSorter::OUTSIDE;
+    for (std::size_t i = 0; i < count; ++i) {
+        const uint32_t brick = MortonSorter::key(entries[i]) >> BRICK_BITS;
+        if (brick == previous) continue;
+        previous = brick;
+        uint32_t bx, by, bz;
+        MortonSortDetail::decode(brick, bx, by, bz);
+        scalarField.allocateBrick(scalarField.brickIndex(bx, by, bz));
+    }
+
+    scatterSorted(sorter, threadPool, scalarField);
+    scalarField.updateRanges();
+    return scalarField;
+}
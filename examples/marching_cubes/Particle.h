@@ -1,10 +1,18 @@
 #pragma once
 #include "half.hpp"
+#include <algorithm>
+#include <array>
+#include <cstring>
 #include <iostream>
 #include <fstream>
 #include <vector>
 #include <iomanip>
 
+#include <hammock/utils/HalfFloat.h>
+
+#include "ScalarField3D.h"
+#include "SparseScalarField3D.h"
+
 struct Particle
 {
    half_float::half position_x;
@@ -18,6 +26,60 @@ struct Particle
    half_float::half radius;
 };
 
+static_assert(sizeof(Particle) == 9 * sizeof(uint16_t));
+
+// Particles as one float array per attribute, what the field builders consume
+struct ParticleArrays {
+    std::vector<float> positionX, positionY, positionZ;
+    std::vector<float> velocityX, velocityY, velocityZ;
+    std::vector<float> rho, pressure, radius;
+
+    [[nodiscard]] std::size_t size() const { return positionX.size(); }
+
+    void resize(std::size_t count) {
+        for (auto *array: arrays()) array->resize(count);
+    }
+
+    // Deinterleaves count records in the .bin layout (9 halves each, see Particle) into [first, first + count)
+    void convert(const void *records, std::size_t first, std::size_t count) {
+        const auto fields = arrays();
+        constexpr std::size_t FIELDS = std::tuple_size_v<decltype(fields)>;
+        // Convert a chunk that fits into L1 in one go, then scatter it into the arrays
+        constexpr std::size_t CHUNK = 256;
+        uint16_t halves[CHUNK * FIELDS];
+        float floats[CHUNK * FIELDS];
+        const auto *bytes = static_cast<const uint8_t *>(records);
+        for (std::size_t done = 0; done < count; done += CHUNK) {
+            const std::size_t n = std::min(CHUNK, count - done);
+            std::memcpy(halves, bytes + done * sizeof(Particle), n * sizeof(Particle));
+            Hammock::halfToFloat(halves, floats, n * FIELDS);
+            for (std::size_t field = 0; field < FIELDS; ++field) {
+                float *out = fields[field]->data() + first + done;
+                for (std::size_t i = 0; i < n; ++i) {
+                    out[i] = floats[i * FIELDS + field];
+                }
+            }
+        }
+    }
+
+    void assign(const void *records, std::size_t count) {
+        resize(count);
+        convert(records, 0, count);
+    }
+
+    static ParticleArrays fromParticles(const std::vector<Particle> &particles) {
+        ParticleArrays arrays;
+        arrays.assign(particles.data(), particles.size());
+        return arrays;
+    }
+
+private:
+    // Same order as the attributes of Particle
+    std::array<std::vector<float> *, 9> arrays() {
+        return {&positionX, &positionY, &positionZ, &velocityX, &velocityY, &velocityZ, &rho, &pressure, &radius};
+    }
+};
+
 // Debug function to print raw bytes of a particle
 inline void printParticleBytes(const Particle& p) {
     const unsigned char* bytes = reinterpret_cast<const unsigned char*>(&p);
@@ -49,20 +111,42 @@ inline bool loadParticles(const std::string& filename, std::vector<Particle>& pa
     return true;
 }
 
-inline std::vector<std::vector<std::vector<float>>> createScalarField(
-    const std::vector<Particle>& particles,
+// Reads a .bin file straight into float arrays, the half records only pass through a small staging buffer
+inline bool loadParticleArrays(const std::string& filename, ParticleArrays& particles) {
+    std::ifstream file(filename, std::ios::binary | std::ios::ate);
+    if (!file) {
+        std::cerr << "Error opening file: " << filename << std::endl;
+        return false;
+    }
+
+    const std::size_t numParticles = static_cast<std::size_t>(file.tellg()) / sizeof(Particle);
+    file.seekg(0, std::ios::beg);
+    particles.resize(numParticles);
+
+    constexpr std::size_t CHUNK = 1 << 14;
+    std::vector<Particle> records(std::min(CHUNK, numParticles));
+    for (std::size_t first = 0; first < numParticles; first += CHUNK) {
+        const std::size_t count = std::min(CHUNK, numParticles - first);
+        if (!file.read(reinterpret_cast<char*>(records.data()), count * sizeof(Particle))) {
+            std::cerr << "Error reading file: " << filename << std::endl;
+            return false;
+        }
+        particles.convert(records.data(), first, count);
+    }
+    return true;
+}
+
+inline ScalarField3D createScalarField(
+    const ParticleArrays& particles,
     const float gridSize,   // Grid resolution (distance between grid points)
-    const float fieldSize   // Size of the field (bounding box dimensions)
+    const float fieldSize,  // Size of the field (bounding box dimensions)
+    const ScalarField3D::Layout layout = ScalarField3D::Layout::Linear
 ) {
     // Calculate grid dimensions based on the field size and grid resolution
     int gridDim = static_cast<int>(fieldSize / gridSize);
 
     // Initialize a scalar field with zero values
-    std::vector<std::vector<std::vector<float>>> scalarField(
-        gridDim, std::vector<std::vector<float>>(
-            gridDim, std::vector<float>(gridDim, 0.0f)
-        )
-    );
+    ScalarField3D scalarField(gridDim, gridDim, gridDim, layout, 0.0f);
 
     // Track min/max values for debugging
     float minDensity = std::numeric_limits<float>::max();
@@ -71,12 +155,11 @@ inline std::vector<std::vector<std::vector<float>>> createScalarField(
     int particlesSkipped = 0;
 
     // Populate the scalar field with values based on particle positions
-    for (const Particle& particle : particles) {
-        // Convert half_float to float for the scalar field calculation
-        float x = static_cast<float>(particle.position_x);
-        float y = static_cast<float>(particle.position_y);
-        float z = static_cast<float>(particle.position_z);
-        float rho = static_cast<float>(particle.rho);
+    for (std::size_t i = 0; i < particles.size(); ++i) {
+        float x = particles.positionX[i];
+        float y = particles.positionY[i];
+        float z = particles.positionZ[i];
+        float rho = particles.rho[i];
 
         // Map from [-fieldSize/2, fieldSize/2] to [0, gridDim]
         float normalizedX = (x + fieldSize/2.0f) / fieldSize * gridDim;
@@ -93,11 +176,12 @@ inline std::vector<std::vector<std::vector<float>>> createScalarField(
             yIdx >= 0 && yIdx < gridDim &&
             zIdx >= 0 && zIdx < gridDim) {
             // Assign the particle's density to the corresponding grid point
-            scalarField[xIdx][yIdx][zIdx] += rho;
+            float &value = scalarField.at(xIdx, yIdx, zIdx);
+            value += rho;
 
             // Update min/max values
-            minDensity = std::min(minDensity, scalarField[xIdx][yIdx][zIdx]);
-            maxDensity = std::max(maxDensity, scalarField[xIdx][yIdx][zIdx]);
+            minDensity = std::min(minDensity, value);
+            maxDensity = std::max(maxDensity, value);
             particlesAdded++;
         } else {
             particlesSkipped++;
@@ -105,4 +189,29 @@ inline std::vector<std::vector<std::vector<float>>> createScalarField(
     }
 
     return scalarField;
-}
\ No newline at end of file
+}
+
+// Same mapping as createScalarField, but only the bricks that particles fall into are allocated
+inline SparseScalarField3D createSparseScalarField(
+    const ParticleArrays& particles,
+    const float gridSize,   // Grid resolution (distance between grid points)
+    const float fieldSize   // Size of the field (bounding box dimensions)
+) {
+    int gridDim = static_cast<int>(fieldSize / gridSize);
+    SparseScalarField3D scalarField(gridDim, gridDim, gridDim, 0.0f);
+
+    for (std::size_t i = 0; i < particles.size(); ++i) {
+        int xIdx = static_cast<int>((particles.positionX[i] + fieldSize/2.0f) / fieldSize * gridDim);
+        int yIdx = static_cast<int>((particles.positionY[i] + fieldSize/2.0f) / fieldSize * gridDim);
+        int zIdx = static_cast<int>((particles.positionZ[i] + fieldSize/2.0f) / fieldSize * gridDim);
+
+        if (xIdx >= 0 && xIdx < gridDim &&
+            yIdx >= 0 && yIdx < gridDim &&
+            zIdx >= 0 && zIdx < gridDim) {
+            scalarField.at(xIdx, yIdx, zIdx) += particles.rho[i];
+        }
+    }
+
+    scalarField.updateRanges();
+    return scalarField;
+}
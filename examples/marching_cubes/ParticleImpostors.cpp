@@ -0,0 +1,224 @@
+#include "ParticleImpostors.h"
+
+ParticleImpostors::ParticleImpostors(Hammock::Device &device, Hammock::DeviceStorage &deviceStorage,
+                                     VkRenderPass renderPass,
+                                     Hammock::ResourceHandle<Hammock::DescriptorSetLayout> sceneLayout,
+                                     uint32_t width, uint32_t height): device(device), deviceStorage(deviceStorage),
+                                                                       sceneLayout(sceneLayout) {
+    imageLayout = deviceStorage.createDescriptorSetLayout({
+        .bindings = {
+            {
+                .binding = 0, .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                .stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT
+            },
+        }
+    });
+    createTargets(width, height);
+
+    // Rebuilt targets keep their formats, so their render passes stay compatible with these pipelines
+    spherePipeline = createPipeline("particle_impostors", "particle_impostor.vert", "particle_impostor.frag", true,
+                                    renderPass);
+    depthPipeline = createPipeline("particle_depth", "particle_impostor.vert", "particle_depth.frag", true,
+                                   depthPass->renderPass);
+    smoothPipeline = createPipeline("fluid_smooth", "fullscreen_headless.vert", "fluid_smooth.frag", false,
+                                    smoothPass->renderPass);
+    compositePipeline = createPipeline("fluid_composite", "fullscreen_headless.vert", "fluid_composite.frag", false,
+                                       renderPass);
+}
+
+void ParticleImpostors::destroy() {
+    spherePipeline.reset();
+    depthPipeline.reset();
+    smoothPipeline.reset();
+    compositePipeline.reset();
+    depthPass.reset();
+    smoothPass.reset();
+    if (depthSet.isValid()) deviceStorage.destroyDescriptorSet(depthSet);
+    if (smoothedSet.isValid()) deviceStorage.destroyDescriptorSet(smoothedSet);
+    if (imageLayout.isValid()) deviceStorage.destroyDescriptorSetLayout(imageLayout);
+    depthSet = {};
+    smoothedSet = {};
+    imageLayout = {};
+}
+
+void ParticleImpostors::prepare(Hammock::RenderContext &renderContext, VkCommandBuffer commandBuffer,
+                                Hammock::ResourceHandle<VkDescriptorSet> sceneSet,
+                                Hammock::ResourceHandle<Hammock::Buffer> particles, uint32_t firstParticle,
+                                uint32_t particleCount) {
+    if (!smoothing) return;
+
+    // The targets follow the swapchain, the old ones may still be read by a frame in flight
+    const VkExtent2D extent = renderContext.getSwapChainExtent();
+    if (extent.width != depthPass->width || extent.height != depthPass->height) {
+        vkDeviceWaitIdle(device.device());
+        createTargets(extent.width, extent.height);
+    }
+
+    renderContext.beginRenderPass(depthPass, commandBuffer, {
+                                      {.color = {0.0f, 0.0f, 0.0f, 0.0f}},
+                                      {.depthStencil = {1.0f, 0}}
+                                  });
+    drawSpheres(commandBuffer, *depthPipeline, sceneSet, particles, firstParticle, particleCount);
+    renderContext.endRenderPass(commandBuffer);
+
+    renderContext.beginRenderPass(smoothPass, commandBuffer, {{.color = {0.0f, 0.0f, 0.0f, 0.0f}}});
+    drawFullscreen(commandBuffer, *smoothPipeline, sceneSet, depthSet);
+    renderContext.endRenderPass(commandBuffer);
+}
+
+void ParticleImpostors::draw(VkCommandBuffer commandBuffer, Hammock::ResourceHandle<VkDescriptorSet> sceneSet,
+                             Hammock::ResourceHandle<Hammock::Buffer> particles, uint32_t firstParticle,
+                             uint32_t particleCount) {
+    if (smoothing) {
+        drawFullscreen(commandBuffer, *compositePipeline, sceneSet, smoothedSet);
+    } else {
+        drawSpheres(commandBuffer, *spherePipeline, sceneSet, particles, firstParticle, particleCount);
+    }
+}
+
+void ParticleImpostors::createTargets(uint32_t width, uint32_t height) {
+    pushData.texelSizeX = 1.f / static_cast<float>(width);
+    pushData.texelSizeY = 1.f / static_cast<float>(height);
+
+    const VkFormat depthFormat = device.findSupportedFormat(
+        {VK_FORMAT_D32_SFLOAT, VK_FORMAT_D32_SFLOAT_S8_UINT, VK_FORMAT_D24_UNORM_S8_UINT},
+        VK_IMAGE_TILING_OPTIMAL,
+        VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT);
+
+    depthPass = Hammock::Framebuffer::createFramebufferPtr({
+        .device = device,
+        .width = width, .height = height,
+        .sampler = {.magFilter = VK_FILTER_NEAREST, .minFilter = VK_FILTER_NEAREST},
+        .attachments{
+            // 0 linear view depth, zero where there is no particle
+            {
+                .width = width, .height = height,
+                .layerCount = 1,
+                .format = VK_FORMAT_R32_SFLOAT,
+                .usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+            },
+            // 1 depth
+            {
+                .width = width, .height = height,
+                .layerCount = 1,
+                .format = depthFormat,
+                .usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT,
+            },
+        }
+    });
+
+    smoothPass = Hammock::Framebuffer::createFramebufferPtr({
+        .device = device,
+        .width = width, .height = height,
+        .sampler = {.magFilter = VK_FILTER_NEAREST, .minFilter = VK_FILTER_NEAREST},
+        .attachments{
+            // 0 smoothed linear view depth
+            {
+                .width = width, .height = height,
+                .layerCount = 1,
+                .format = VK_FORMAT_R32_SFLOAT,
+                .usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+            },
+        }
+    });
+
+    // The sets are allocated with the first targets and rewritten for every later one
+    const auto imageSet = [&](Hammock::ResourceHandle<VkDescriptorSet> &set, Hammock::Framebuffer &framebuffer) {
+        const Hammock::DeviceStorage::DescriptorSetCreateInfo setInfo{
+            .descriptorSetLayout = imageLayout,
+            .imageWrites = {
+                {
+                    0, {
+                        .sampler = framebuffer.sampler,
+                        .imageView = framebuffer.attachments[0].view,
+                        .imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
+                    }
+                }
+            }
+        };
+        if (set.isValid()) deviceStorage.updateDescriptorSet(set, setInfo);
+        else set = deviceStorage.createDescriptorSet(setInfo);
+    };
+    imageSet(depthSet, *depthPass);
+    imageSet(smoothedSet, *smoothPass);
+}
+
+std::unique_ptr<Hammock::GraphicsPipeline> ParticleImpostors::createPipeline(
+    const std::string &debugName, const std::string &vertexShader, const std::string &fragmentShader,
+    bool instanced, VkRenderPass renderPass) {
+    // One particle per instance, the quad corners come from the vertex index
+    std::vector<VkVertexInputBindingDescription> bindings{};
+    std::vector<VkVertexInputAttributeDescription> attributes{};
+    if (instanced) {
+        bindings.push_back({0, sizeof(ImpostorParticle), VK_VERTEX_INPUT_RATE_INSTANCE});
+        attributes.push_back({0, 0, VK_FORMAT_R16G16B16A16_SFLOAT, 0});
+    }
+
+    return Hammock::GraphicsPipeline::createGraphicsPipelinePtr({
+        .debugName = debugName,
+        .device = device,
+        .VS
+        {
+            .byteCode = Hammock::Filesystem::readFile(compiledShaderPath(vertexShader)),
+            .entryFunc = "main"
+        },
+        .FS
+        {
+            .byteCode = Hammock::Filesystem::readFile(compiledShaderPath(fragmentShader)),
+            .entryFunc = "main"
+        },
+        .descriptorSetLayouts =
+        {
+            deviceStorage.getDescriptorSetLayout(sceneLayout).getDescriptorSetLayout(),
+            deviceStorage.getDescriptorSetLayout(imageLayout).getDescriptorSetLayout()
+        },
+        .pushConstantRanges{
+            {
+                .stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
+                .offset = 0,
+                .size = sizeof(PushData)
+            }
+        },
+        .graphicsState
+        {
+            .depthTest = VK_TRUE,
+            .cullMode = VK_CULL_MODE_NONE,
+            .blendAtaAttachmentStates{},
+            .vertexBufferBindings
+            {
+                .vertexBindingDescriptions = bindings,
+                .vertexAttributeDescriptions = attributes
+            }
+        },
+        .renderPass = renderPass
+    });
+}
+
+void ParticleImpostors::drawSpheres(VkCommandBuffer commandBuffer, Hammock::GraphicsPipeline &pipeline,
+                                    Hammock::ResourceHandle<VkDescriptorSet> sceneSet,
+                                    Hammock::ResourceHandle<Hammock::Buffer> particles, uint32_t firstParticle,
+                                    uint32_t particleCount) {
+    if (particleCount == 0) return;
+
+    pipeline.bind(commandBuffer);
+    deviceStorage.bindDescriptorSet(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline.graphicsPipelineLayout,
+                                    0, 1, sceneSet, 0, nullptr);
+    vkCmdPushConstants(commandBuffer, pipeline.graphicsPipelineLayout,
+                       VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(PushData), &pushData);
+    deviceStorage.bindVertexBuffer(particles, commandBuffer);
+    // The first instance offsets the instance rate attributes, particles are addressed like indices
+    vkCmdDraw(commandBuffer, 6, particleCount, 0, firstParticle);
+}
+
+void ParticleImpostors::drawFullscreen(VkCommandBuffer commandBuffer, Hammock::GraphicsPipeline &pipeline,
+                                       Hammock::ResourceHandle<VkDescriptorSet> sceneSet,
+                                       Hammock::ResourceHandle<VkDescriptorSet> imageSet) {
+    pipeline.bind(commandBuffer);
+    deviceStorage.bindDescriptorSet(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline.graphicsPipelineLayout,
+                                    0, 1, sceneSet, 0, nullptr);
+    deviceStorage.bindDescriptorSet(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline.graphicsPipelineLayout,
+                                    1, 1, imageSet, 0, nullptr);
+    vkCmdPushConstants(commandBuffer, pipeline.graphicsPipelineLayout,
+                       VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(PushData), &pushData);
+    vkCmdDraw(commandBuffer, 3, 1, 0, 0);
+}
@@ -0,0 +1,102 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include <hammock/hammock.h>
+
+#include "Particle.h"
+
+// What the impostor pipelines read per particle, position and radius as halves
+struct ImpostorParticle {
+    uint16_t position[3];
+    uint16_t radius;
+};
+
+static_assert(sizeof(ImpostorParticle) == 4 * sizeof(uint16_t));
+
+// Packs the attributes the impostors need, a chunk of every array is converted at once and then interleaved
+inline void packImpostorParticles(const ParticleArrays &particles, ImpostorParticle *out) {
+    constexpr std::size_t CHUNK = 256;
+    uint16_t halves[4][CHUNK];
+    const float *arrays[4] = {
+        particles.positionX.data(), particles.positionY.data(), particles.positionZ.data(), particles.radius.data()
+    };
+    for (std::size_t first = 0; first < particles.size(); first += CHUNK) {
+        const std::size_t n = std::min(CHUNK, particles.size() - first);
+        for (int array = 0; array < 4; ++array) Hammock::floatToHalf(arrays[array] + first, halves[array], n);
+        for (std::size_t i = 0; i < n; ++i) {
+            out[first + i] = {{halves[0][i], halves[1][i], halves[2][i]}, halves[3][i]};
+        }
+    }
+}
+
+// Draws particles as instanced, ray cast sphere impostors, one screen aligned quad per particle.
+// With smoothing, the spheres are first rendered to a linear depth target, the depth is blurred with a
+// bilateral filter that keeps silhouettes sharp and the surface is shaded from the normals of the
+// smoothed depth, which gives a continuous fluid surface without building a field or a mesh.
+class ParticleImpostors {
+public:
+    struct PushData {
+        // Particle positions to mesh coordinates, w of the scale is applied to the radius
+        alignas(16) HmckVec4 positionOffset{};
+        alignas(16) HmckVec4 positionScale{1.f, 1.f, 1.f, 1.f};
+        float texelSizeX = 0.f, texelSizeY = 0.f;
+        int32_t filterRadius = 6; // in pixels
+        float depthFalloff = 4.f; // how fast the filter weight drops with the depth difference
+    } pushData;
+
+    bool smoothing = false;
+
+    // sceneLayout is the layout of the set with the view and projection, bound at set 0 by every pipeline
+    ParticleImpostors(Hammock::Device &device, Hammock::DeviceStorage &deviceStorage, VkRenderPass renderPass,
+                      Hammock::ResourceHandle<Hammock::DescriptorSetLayout> sceneLayout, uint32_t width,
+                      uint32_t height);
+
+    void destroy();
+
+    // Renders the depth and smooths it, has to be recorded before the render pass the particles are drawn in.
+    // Rebuilds the targets when the swapchain was resized.
+    void prepare(Hammock::RenderContext &renderContext, VkCommandBuffer commandBuffer,
+                 Hammock::ResourceHandle<VkDescriptorSet> sceneSet, Hammock::ResourceHandle<Hammock::Buffer> particles,
+                 uint32_t firstParticle, uint32_t particleCount);
+
+    // Draws the spheres or the smoothed surface into the current render pass
+    void draw(VkCommandBuffer commandBuffer, Hammock::ResourceHandle<VkDescriptorSet> sceneSet,
+              Hammock::ResourceHandle<Hammock::Buffer> particles, uint32_t firstParticle, uint32_t particleCount);
+
+private:
+    static std::string compiledShaderPath(const std::string &shader) {
+        return "../../../src/hammock/shaders/compiled/" + shader + ".spv";
+    }
+
+    // Depth targets of the given size, their descriptor sets and the texel size of the filter
+    void createTargets(uint32_t width, uint32_t height);
+    std::unique_ptr<Hammock::GraphicsPipeline> createPipeline(
+        const std::string &debugName, const std::string &vertexShader, const std::string &fragmentShader,
+        bool instanced, VkRenderPass renderPass);
+    void drawSpheres(VkCommandBuffer commandBuffer, Hammock::GraphicsPipeline &pipeline,
+                     Hammock::ResourceHandle<VkDescriptorSet> sceneSet,
+                     Hammock::ResourceHandle<Hammock::Buffer> particles, uint32_t firstParticle,
+                     uint32_t particleCount);
+    void drawFullscreen(VkCommandBuffer commandBuffer, Hammock::GraphicsPipeline &pipeline,
+                        Hammock::ResourceHandle<VkDescriptorSet> sceneSet,
+                        Hammock::ResourceHandle<VkDescriptorSet> imageSet);
+
+    Hammock::Device &device;
+    Hammock::DeviceStorage &deviceStorage;
+    Hammock::ResourceHandle<Hammock::DescriptorSetLayout> sceneLayout;
+
+    // Linear view depth of the spheres and its smoothed version
+    std::unique_ptr<Hammock::Framebuffer> depthPass{};
+    std::unique_ptr<Hammock::Framebuffer> smoothPass{};
+    Hammock::ResourceHandle<Hammock::DescriptorSetLayout> imageLayout{};
+    Hammock::ResourceHandle<VkDescriptorSet> depthSet{};
+    Hammock::ResourceHandle<VkDescriptorSet> smoothedSet{};
+
+    std::unique_ptr<Hammock::GraphicsPipeline> spherePipeline{};
+    std::unique_ptr<Hammock::GraphicsPipeline> depthPipeline{};
+    std::unique_ptr<Hammock::GraphicsPipeline> smoothPipeline{};
+    std::unique_ptr<Hammock::GraphicsPipeline> compositePipeline{};
+};
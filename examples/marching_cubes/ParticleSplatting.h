@@ -0,0 +1,239 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <numbers>
+#include <vector>
+
+#include <hammock/core/ThreadPool.h>
+
+#include "Particle.h"
+#include "ScalarField3D.h"
+#include "SparseScalarField3D.h"
+
+// Kernel based particle splatting
+//
+// Instead of dropping each particle's density into a single voxel, every particle is spread over the
+// grid points inside its support with the SPH poly6 kernel
+//     W(r, h) = 315 / (64 pi h^3) * (1 - r^2 / h^2)^3,   r < h
+// whose integral is 1, so a particle still adds its rho to the field in total, just smoothly.
+//
+// Particles are binned into a uniform grid with a counting sort. The field is then written in tiles,
+// each tile is owned by exactly one job, which gathers the particles of the bins overlapping the tile
+// and its kernel apron. No two jobs write the same voxel, so no atomics are needed, and every voxel
+// sums its particles in the same order regardless of the thread count.
+
+struct SplatSettings {
+    // Kernel support radius in multiples of the particle radius, never less than one voxel
+    float kernelScale = 2.0f;
+
+    bool operator==(const SplatSettings &) const = default;
+};
+
+// Particle in voxel coordinates with its kernel already normalized
+struct SplatParticle {
+    float x, y, z;
+    float h;
+    float weight;
+};
+
+// Particles sorted into a uniform grid of cubic bins
+struct ParticleGrid {
+    int binSize = 1; // in voxels
+    int dim[3] = {0, 0, 0};
+    std::vector<uint32_t> binStart; // particles of bin b are [binStart[b], binStart[b + 1])
+    std::vector<SplatParticle> particles; // sorted by bin
+
+    [[nodiscard]] std::size_t binIndex(int bx, int by, int bz) const {
+        return bx + dim[0] * (by + static_cast<std::size_t>(dim[1]) * bz);
+    }
+
+    // Stable counting sort of the particles by bin
+    void build(const std::vector<SplatParticle> &input, int gridDim, int binSize) {
+        this->binSize = std::max(1, binSize);
+        dim[0] = dim[1] = dim[2] = (gridDim + this->binSize - 1) / this->binSize;
+        const std::size_t binCount = static_cast<std::size_t>(dim[0]) * dim[1] * dim[2];
+
+        std::vector<uint32_t> keys(input.size());
+        binStart.assign(binCount + 1, 0);
+        for (std::size_t i = 0; i < input.size(); ++i) {
+            const auto &p = input[i];
+            const int bx = std::clamp(static_cast<int>(p.x) / this->binSize, 0, dim[0] - 1);
+            const int by = std::clamp(static_cast<int>(p.y) / this->binSize, 0, dim[1] - 1);
+            const int bz = std::clamp(static_cast<int>(p.z) / this->binSize, 0, dim[2] - 1);
+            keys[i] = static_cast<uint32_t>(binIndex(bx, by, bz));
+            binStart[keys[i] + 1]++;
+        }
+
+        for (std::size_t b = 0; b < binCount; ++b) {
+            binStart[b + 1] += binStart[b];
+        }
+
+        particles.resize(input.size());
+        std::vector<uint32_t> cursor(binStart.begin(), binStart.end() - 1);
+        for (std::size_t i = 0; i < input.size(); ++i) {
+            particles[cursor[keys[i]]++] = input[i];
+        }
+    }
+};
+
+// Converts particles to voxel space, drops those whose support misses the grid entirely
+inline std::vector<SplatParticle> prepareSplatParticles(const ParticleArrays &particles, float fieldSize,
+                                                        int gridDim, const SplatSettings &settings) {
+    const float voxelsPerUnit = static_cast<float>(gridDim) / fieldSize;
+    const float normalization = 315.0f / (64.0f * std::numbers::pi_v<float>);
+
+    std::vector<SplatParticle> result;
+    result.reserve(particles.size());
+    for (std::size_t i = 0; i < particles.size(); ++i) {
+        const float x = (particles.positionX[i] + fieldSize / 2.0f) * voxelsPerUnit;
+        const float y = (particles.positionY[i] + fieldSize / 2.0f) * voxelsPerUnit;
+        const float z = (particles.positionZ[i] + fieldSize / 2.0f) * voxelsPerUnit;
+        const float h = std::max(settings.kernelScale * particles.radius[i] * voxelsPerUnit, 1.0f);
+
+        if (x + h < 0.0f || y + h < 0.0f || z + h < 0.0f ||
+            x - h > gridDim - 1 || y - h > gridDim - 1 || z - h > gridDim - 1) {
+            continue;
+        }
+
+        result.push_back({x, y, z, h, particles.rho[i] * normalization / (h * h * h)});
+    }
+    return result;
+}
+
+// Adds the kernels of all particles overlapping the tile [lo, hi) to the field
+template<typename Field>
+inline void splatTile(const ParticleGrid &grid, float maxSupport, const int lo[3], const int hi[3],
+                      Field &scalarField) {
+    int binLo[3], binHi[3];
+    for (int a = 0; a < 3; ++a) {
+        binLo[a] = std::clamp(static_cast<int>(std::floor((lo[a] - maxSupport) / grid.binSize)), 0, grid.dim[a] - 1);
+        binHi[a] = std::clamp(static_cast<int>(std::floor((hi[a] - 1 + maxSupport) / grid.binSize)), 0,
+                              grid.dim[a] - 1);
+    }
+
+    for (int bz = binLo[2]; bz <= binHi[2]; ++bz) {
+        for (int by = binLo[1]; by <= binHi[1]; ++by) {
+            for (int bx = binLo[0]; bx <= binHi[0]; ++bx) {
+                const std::size_t bin = grid.binIndex(bx, by, bz);
+                for (uint32_t i = grid.binStart[bin]; i < grid.binStart[bin + 1]; ++i) {
+                    const SplatParticle &p = grid.particles[i];
+
+                    // Support box clipped to the tile
+                    const int x0 = std::max(lo[0], static_cast<int>(std::ceil(p.x - p.h)));
+                    const int x1 = std::min(hi[0] - 1, static_cast<int>(std::floor(p.x + p.h)));
+                    const int y0 = std::max(lo[1], static_cast<int>(std::ceil(p.y - p.h)));
+                    const int y1 = std::min(hi[1] - 1, static_cast<int>(std::floor(p.y + p.h)));
+                    const int z0 = std::max(lo[2], static_cast<int>(std::ceil(p.z - p.h)));
+                    const int z1 = std::min(hi[2] - 1, static_cast<int>(std::floor(p.z + p.h)));
+                    if (x0 > x1 || y0 > y1 || z0 > z1) continue;
+
+                    const float invH2 = 1.0f / (p.h * p.h);
+                    for (int z = z0; z <= z1; ++z) {
+                        const float dz2 = (z - p.z) * (z - p.z);
+                        for (int y = y0; y <= y1; ++y) {
+                            const float dyz2 = dz2 + (y - p.y) * (y - p.y);
+                            if (dyz2 * invH2 >= 1.0f) continue;
+                            for (int x = x0; x <= x1; ++x) {
+                                const float q = (dyz2 + (x - p.x) * (x - p.x)) * invH2;
+                                if (q >= 1.0f) continue;
+                                const float w = 1.0f - q;
+                                scalarField.at(x, y, z) += p.weight * w * w * w;
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+// Splats the particles into a gridDim^3 field, parallelized over tiles of the field
+template<typename Field>
+inline void splatParticles(const std::vector<SplatParticle> &particles, int gridDim,
+                           Hammock::ThreadPool &threadPool, Field &scalarField) {
+    // Multiple of the sparse field brick size, so no two tiles share a brick
+    constexpr int TILE_SIZE = 32;
+
+    float maxSupport = 1.0f;
+    for (const auto &p: particles) maxSupport = std::max(maxSupport, p.h);
+
+    // Bins as large as the largest support, a tile only has to look one bin beyond its border
+    ParticleGrid grid;
+    grid.build(particles, gridDim, static_cast<int>(std::ceil(maxSupport)));
+
+    const int tilesPerAxis = (gridDim + TILE_SIZE - 1) / TILE_SIZE;
+    const int tileCount = tilesPerAxis * tilesPerAxis * tilesPerAxis;
+    const int workerCount = std::max(1, static_cast<int>(threadPool.threads.size()));
+
+    auto splat = [&](int tile) {
+        const int t[3] = {tile % tilesPerAxis, (tile / tilesPerAxis) % tilesPerAxis, tile / (tilesPerAxis * tilesPerAxis)};
+        int lo[3], hi[3];
+        for (int a = 0; a < 3; ++a) {
+            lo[a] = t[a] * TILE_SIZE;
+            hi[a] = std::min(gridDim, lo[a] + TILE_SIZE);
+        }
+        splatTile(grid, maxSupport, lo, hi, scalarField);
+    };
+
+    // Tiles are dealt out round robin, so dense regions are spread over the threads
+    threadPool.parallelFor(workerCount, [&](uint32_t begin, uint32_t end) {
+        for (int worker = static_cast<int>(begin); worker < static_cast<int>(end); ++worker) {
+            for (int tile = worker; tile < tileCount; tile += workerCount) splat(tile);
+        }
+    });
+}
+
+// Scalar field from particles splatted with the poly6 kernel
+inline ScalarField3D createScalarFieldSplat(
+    const ParticleArrays &particles,
+    const float gridSize, // Grid resolution (distance between grid points)
+    const float fieldSize, // Size of the field (bounding box dimensions)
+    Hammock::ThreadPool &threadPool,
+    const SplatSettings &settings = {},
+    const ScalarField3D::Layout layout = ScalarField3D::Layout::Linear
+) {
+    const int gridDim = static_cast<int>(fieldSize / gridSize);
+    ScalarField3D scalarField(gridDim, gridDim, gridDim, layout, 0.0f);
+    if (gridDim <= 0) return scalarField;
+
+    splatParticles(prepareSplatParticles(particles, fieldSize, gridDim, settings), gridDim, threadPool, scalarField);
+    return scalarField;
+}
+
+// Sparse variant of createScalarFieldSplat, only bricks inside some particle's support are allocated
+inline SparseScalarField3D createSparseScalarFieldSplat(
+    const ParticleArrays &particles,
+    const float gridSize, // Grid resolution (distance between grid points)
+    const float fieldSize, // Size of the field (bounding box dimensions)
+    Hammock::ThreadPool &threadPool,
+    const SplatSettings &settings = {}
+) {
+    const int gridDim = static_cast<int>(fieldSize / gridSize);
+    SparseScalarField3D scalarField(gridDim, gridDim, gridDim, 0.0f);
+    if (gridDim <= 0) return scalarField;
+
+    const std::vector<SplatParticle> prepared = prepareSplatParticles(particles, fieldSize, gridDim, settings);
+
+    // Allocate up front, the tiles then only write into existing bricks
+    constexpr int SHIFT = SparseScalarField3D::BRICK_SHIFT;
+    for (const SplatParticle &p: prepared) {
+        int lo[3], hi[3];
+        const float position[3] = {p.x, p.y, p.z};
+        for (int a = 0; a < 3; ++a) {
+            lo[a] = std::max(0, static_cast<int>(std::ceil(position[a] - p.h))) >> SHIFT;
+            hi[a] = std::min(gridDim - 1, static_cast<int>(std::floor(position[a] + p.h))) >> SHIFT;
+        }
+        for (int bz = lo[2]; bz <= hi[2]; ++bz) {
+            for (int by = lo[1]; by <= hi[1]; ++by) {
+                for (int bx = lo[0]; bx <= hi[0]; ++bx) {
+                    scalarField.allocateBrick(scalarField.brickIndex(bx, by, bz));
+                }
+            }
+        }
+    }
+
+    splatParticles(prepared, gridDim, threadPool, scalarField);
+    scalarField.updateRanges();
+    return scalarField;
+}
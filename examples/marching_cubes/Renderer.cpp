@@ -1,10 +1,18 @@
 #include "Renderer.h"
+#include <filesystem>
 #include "MarchingCubes.h"
+#include "SurfaceNets.h"
 
-Renderer::Renderer(): window{instance, "Marching cubes", 1920, 1080},
-                      device(instance, window.getSurface()) {
+Renderer::Renderer(PlaybackMode playbackMode): window{instance, "Marching cubes", 1920, 1080},
+                                               device(instance, window.getSurface()),
+                                               playbackMode(playbackMode) {
+    threadPool.setThreadCount(std::max(1u, std::thread::hardware_concurrency()));
     init();
-    loadSph();
+    if (playbackMode == PlaybackMode::Preload) {
+        loadSph();
+    } else {
+        startStream();
+    }
 }
 
 void Renderer::draw() {
@@ -34,21 +42,19 @@ void Renderer::draw() {
         }
 
 
+        if (playbackMode == PlaybackMode::Preload) {
+            updatePreloaded();
+        } else {
+            updateStream();
+        }
+
         if (const auto commandBuffer = renderContext.beginFrame()) {
             const int frameIndex = renderContext.getFrameIndex();
+            destroyRetiredFrames();
+            if (brickMeshBuffer) brickMeshBuffer->collect(renderedFrames);
 
 
-            renderContext.beginSwapChainRenderPass(commandBuffer);
-
-            if (loop) {
-                if (vertexBufferId >= vertexBuffers.size()) {
-                    vertexBufferId = 0;
-                }
-            }
-
-            deviceStorage.bindVertexBuffer(vertexBuffers[vertexBufferId], commandBuffer);
-
-            pipeline->bind(commandBuffer);
+            const GpuFrame *frame = currentFrame();
 
             HmckMat4 m0 = HmckMat4{
                 1.0f, 0.0f, 0.0f, 0.0f,
@@ -72,12 +78,44 @@ void Renderer::draw() {
             HmckMat4 model = HmckMul(translation, HmckMul(rotation, HmckMul(scale, m0)));
 
             bufferData.mvp = HmckMul(perspective, HmckMul(view, model));
+            bufferData.modelView = HmckMul(view, model);
+            bufferData.projection = perspective;
+            bufferData.viewLightPos = HmckMulM4V4(view, HmckVec4{
+                                                      bufferData.lightPos.X, bufferData.lightPos.Y,
+                                                      bufferData.lightPos.Z, 1.0f
+                                                  });
+            updateChunkLevels(model);
             deviceStorage.getBuffer(buffers[frameIndex])->writeToBuffer(&bufferData);
 
+            if (impostors && frame) {
+                impostors->pushData.positionOffset = frame->boundsMin;
+                impostors->pushData.positionScale = frame->boundsExtent;
+                impostors->pushData.positionScale.W *= particleScale;
+                // Smoothing renders its own passes before the swap chain pass
+                impostors->prepare(renderContext, commandBuffer, descriptorSets[frameIndex], frame->vertexBuffer,
+                                   frame->firstParticle, frame->particleCount);
+            }
+
+            if (gpuMarchingCubes && frame) {
+                // The field stays in the ring while the frame is displayed, the surface is extracted again
+                // every frame into the buffers of this frame in flight
+                gpuMarchingCubes->extract(commandBuffer, frameIndex, {
+                                              geometryRing->buffer(), frame->firstSample,
+                                              {frame->fieldSize[0], frame->fieldSize[1], frame->fieldSize[2]}
+                                          }, currentMeshSettings().isovalue, cubeSize);
+            }
+
+            renderContext.beginSwapChainRenderPass(commandBuffer);
+
+            Hammock::GraphicsPipeline &activePipeline = brickMeshBuffer || gpuMarchingCubes
+                                                            ? *brickPipeline
+                                                            : *pipeline;
+            activePipeline.bind(commandBuffer);
+
             deviceStorage.bindDescriptorSet(
                 commandBuffer,
                 VK_PIPELINE_BIND_POINT_GRAPHICS,
-                pipeline->graphicsPipelineLayout,
+                activePipeline.graphicsPipelineLayout,
                 0, 1,
                 descriptorSets[frameIndex],
                 0,
@@ -85,18 +123,33 @@ void Renderer::draw() {
 
 
             pushData.elapsedTime = elapsedTime;
-            vkCmdPushConstants(commandBuffer, pipeline->graphicsPipelineLayout,
+            if (frame) {
+                pushData.boundsMin = frame->boundsMin;
+                pushData.boundsExtent = frame->boundsExtent;
+            }
+            vkCmdPushConstants(commandBuffer, activePipeline.graphicsPipelineLayout,
                                VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_VERTEX_BIT, 0,
                                sizeof(PushData), &pushData);
 
 
-            vkCmdDraw(commandBuffer, vertices[vertexBufferId].size(), 1, 0, 0);
+            if (impostors) {
+                if (frame) {
+                    impostors->draw(commandBuffer, descriptorSets[frameIndex], frame->vertexBuffer,
+                                    frame->firstParticle, frame->particleCount);
+                }
+            } else if (brickMeshBuffer) {
+                brickMeshBuffer->draw(commandBuffer, frameIndex);
+            } else if (gpuMarchingCubes) {
+                if (frame) gpuMarchingCubes->draw(commandBuffer, frameIndex);
+            } else if (frame && frame->indexCount > 0) {
+                deviceStorage.bindVertexBuffer(frame->vertexBuffer, frame->indexBuffer, commandBuffer);
+                vkCmdDrawIndexed(commandBuffer, frame->indexCount, 1, frame->firstIndex, frame->vertexOffset, 0);
+            }
 
 
             if (loop) {
                 frameCount++;
-                if (frameCount >= framing) {
-                    vertexBufferId++;
+                if (frameCount >= framing && advanceFrame()) {
                     frameCount=0;
                 }
             }
@@ -108,76 +161,578 @@ void Renderer::draw() {
 
             renderContext.endRenderPass(commandBuffer);
             renderContext.endFrame();
+            renderedFrames++;
+        }
+    }
+    shutdown();
+}
+
+bool Renderer::checkCompute(uint32_t frameCount) {
+    if (!gpuMarchingCubes) {
+        Hammock::Logger::log(Hammock::LOG_LEVEL_ERROR, "The compute check needs the compute playback mode\n");
+        shutdown();
+        return false;
+    }
+
+    const SphSource source = sphSource();
+    MeshSettings settings = currentMeshSettings();
+    // The sorter and the thread pool belong to the mesher thread of the stream, which keeps running meanwhile
+    settings.mortonSort = false;
+    Hammock::ThreadPool checkPool;
+    checkPool.setThreadCount(std::max(1u, std::thread::hardware_concurrency()));
+
+    bool passed = source.frameCount > 0;
+    Hammock::ResourceHandle<Hammock::Buffer> fieldBuffer{};
+    for (std::size_t frame = 0; passed && frame < std::min<std::size_t>(frameCount, source.frameCount); ++frame) {
+        ParticleArrays particles;
+        if (!source.load(frame, particles)) {
+            Hammock::Logger::log(Hammock::LOG_LEVEL_ERROR, "Failed to load particles\n");
+            passed = false;
+            break;
+        }
+        const SparseScalarField3D field = createField(particles, settings, checkPool);
+
+        // The CPU reference marches the cells in the order the compute shaders write them
+        ScalarField3D dense(field.sizeX(), field.sizeY(), field.sizeZ());
+        for (uint32_t z = 0; z < field.sizeZ(); ++z) {
+            for (uint32_t y = 0; y < field.sizeY(); ++y) {
+                for (uint32_t x = 0; x < field.sizeX(); ++x) dense.at(x, y, z) = field.at(x, y, z);
+            }
+        }
+        const IndexedMesh expected = marchingCubesIndexed(dense, settings.isovalue, cubeSize);
+
+        if (fieldBuffer.isValid()) deviceStorage.destroyBuffer(fieldBuffer);
+        fieldBuffer = deviceStorage.createBuffer({
+            .instanceSize = sizeof(float),
+            .instanceCount = static_cast<uint32_t>(std::max<std::size_t>(
+                1, static_cast<std::size_t>(field.sizeX()) * field.sizeY() * field.sizeZ())),
+            .usageFlags = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+            .memoryPropertyFlags = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
+        });
+        field.copyDense(static_cast<float *>(deviceStorage.getBuffer(fieldBuffer)->getMappedMemory()));
+
+        // A surface larger than the vertex buffer is clipped once and fits after the buffer grew
+        std::vector<Hammock::Vertex> vertices;
+        for (int attempt = 0; attempt < 2; ++attempt) {
+            const VkCommandBuffer commandBuffer = device.beginSingleTimeCommands();
+            gpuMarchingCubes->extract(commandBuffer, 0, {
+                                          fieldBuffer, 0, {field.sizeX(), field.sizeY(), field.sizeZ()}
+                                      }, settings.isovalue, cubeSize);
+            device.endSingleTimeCommands(commandBuffer);
+            vertices = gpuMarchingCubes->readVertices(0);
+            if (vertices.size() == 3 * static_cast<std::size_t>(gpuMarchingCubes->triangleCount(0))) break;
+        }
+
+        const std::size_t triangles = gpuMarchingCubes->triangleCount(0);
+        std::size_t mismatches = 0;
+        if (triangles * 3 != expected.indices.size() || vertices.size() != expected.indices.size()) {
+            mismatches = std::max<std::size_t>({expected.indices.size(), vertices.size(), 1});
+        } else {
+            // Positions to a thousandth of a cell, the shaders may round the interpolation differently
+            const float tolerance = 1e-3f * cubeSize;
+            for (std::size_t i = 0; i < vertices.size(); ++i) {
+                const Hammock::Vertex &cpu = expected.vertices[expected.indices[i]];
+                const Hammock::Vertex &gpu = vertices[i];
+                const HmckVec3 offset = HmckSubV3(cpu.position, gpu.position);
+                if (std::abs(offset.X) > tolerance || std::abs(offset.Y) > tolerance ||
+                    std::abs(offset.Z) > tolerance || HmckDotV3(cpu.normal, gpu.normal) < 0.99f) {
+                    ++mismatches;
+                }
+            }
         }
+
+        Hammock::Logger::log(mismatches ? Hammock::LOG_LEVEL_ERROR : Hammock::LOG_LEVEL_DEBUG,
+                             "Frame %zu: %zu compute triangles, %zu CPU triangles, %zu mismatched vertices\n",
+                             frame, triangles, expected.indices.size() / 3, mismatches);
+        passed = mismatches == 0;
     }
+    if (fieldBuffer.isValid()) deviceStorage.destroyBuffer(fieldBuffer);
+
+    shutdown();
+    return passed;
+}
+
+void Renderer::shutdown() {
     device.waitIdle();
+
+    // Stop the background threads before the buffers they feed are destroyed, a mesher waiting for
+    // ring space is woken up first
+    if (geometryRing) geometryRing->close();
+    stream.reset();
+    patchStream.reset();
+    if (brickMeshBuffer) brickMeshBuffer->destroy();
+    if (impostors) impostors->destroy();
+    if (gpuMarchingCubes) gpuMarchingCubes->destroy();
+    for (auto &retired: retiredFrames) destroyFrame(retired.frame);
+    for (auto &resident: residentFrames) destroyFrame(resident);
+    for (auto &preloaded: frames) destroyFrame(preloaded);
+    if (geometryRing) geometryRing->destroy();
 }
 
-void Renderer::loadSph() {
-    auto files = Hammock::Filesystem::ls(assetPath("sph/"));
+Renderer::MeshSettings Renderer::currentMeshSettings() {
+    std::lock_guard<std::mutex> lock(meshSettingsMutex);
+    return meshSettings;
+}
+
+uint32_t Renderer::fieldPoints() const {
+    // Matches the grid of createSparseScalarField
+    const float gridSize = fieldSize / static_cast<float>(gridResolution);
+    return static_cast<uint32_t>(fieldSize / gridSize);
+}
+
+void Renderer::updateChunkLevels(const HmckMat4 &model) {
+    std::lock_guard<std::mutex> lock(meshSettingsMutex);
+    if (!meshSettings.levelOfDetail) return;
+
+    const LodSettings &lod = meshSettings.lod;
+    const uint32_t chunks = lodChunkCount(fieldPoints(), lod);
+    meshSettings.chunkLevels.resize(static_cast<std::size_t>(chunks) * chunks * chunks);
+
+    // Distance from the camera to the chunk centers, mesh coordinates go through the model matrix
+    const float chunkExtent = static_cast<float>(lod.chunkSize) * cubeSize;
+    for (uint32_t cz = 0; cz < chunks; ++cz) {
+        for (uint32_t cy = 0; cy < chunks; ++cy) {
+            for (uint32_t cx = 0; cx < chunks; ++cx) {
+                const HmckVec4 center = HmckMulM4V4(model, HmckVec4{
+                                                        (cx + 0.5f) * chunkExtent, (cy + 0.5f) * chunkExtent,
+                                                        (cz + 0.5f) * chunkExtent, 1.0f
+                                                    });
+                const float distance = HmckLenV3(HmckSubV3(center.XYZ, cameraPosition));
+                meshSettings.chunkLevels[cx + chunks * (cy + chunks * cz)] = lodLevel(distance, lod);
+            }
+        }
+    }
+}
+
+SparseScalarField3D Renderer::createField(const ParticleArrays &particles, const MeshSettings &settings) {
+    return createField(particles, settings, threadPool);
+}
 
-    int f = 0;
-    for (const auto &file: files) {
-        if (!file.contains(".bin")) { continue; }
+SparseScalarField3D Renderer::createField(const ParticleArrays &particles, const MeshSettings &settings,
+                                          Hammock::ThreadPool &pool) {
+    // Create a scalar field
+    const float gridSize = fieldSize / static_cast<float>(gridResolution);
+
+    //Hammock::Logger::log(Hammock::LOG_LEVEL_DEBUG, "Creating scalar field...\n");
+    if (settings.kernelSplatting) {
+        return createSparseScalarFieldSplat(particles, gridSize, fieldSize, pool, settings.splat);
+    }
+    return settings.mortonSort
+               ? createSparseScalarFieldSorted(particles, gridSize, fieldSize, mortonSorter, pool)
+               : createSparseScalarField(particles, gridSize, fieldSize);
+}
+
+uint64_t Renderer::meshCacheKey(const ParticleArrays &particles, const MeshSettings &settings) const {
+    // Only the attributes the field is built from, velocities and pressure do not change the mesh
+    Hasher hasher;
+    for (const auto *array: {&particles.positionX, &particles.positionY, &particles.positionZ, &particles.rho,
+                             &particles.radius}) {
+        hasher.add(array->data(), array->size() * sizeof(float));
+    }
+    return hasher
+            .add(settings.isovalue)
+            .add(static_cast<uint8_t>(settings.kernelSplatting))
+            .add(settings.splat.kernelScale)
+            .add(settings.method)
+            .add(fieldSize)
+            .add(gridResolution)
+            .add(cubeSize)
+            .value();
+}
+
+std::optional<CompactMesh> Renderer::findMesh(const ParticleArrays &particles, const MeshSettings &settings,
+                                              std::optional<uint64_t> &key) {
+    // The chunk levels follow the camera, such meshes are not worth caching
+    if (settings.levelOfDetail) return std::nullopt;
+
+    key = meshCacheKey(particles, settings);
+    auto cached = meshCache.find(*key);
+    if (cached) {
+        ++meshCacheHits;
+    } else {
+        ++meshCacheMisses;
+    }
+    return cached;
+}
+
+IndexedMesh Renderer::extractMesh(const ParticleArrays &particles, const MeshSettings &settings,
+                                  std::optional<uint64_t> key, std::optional<SparseScalarField3D> *field) {
+    auto scalarField = createField(particles, settings);
+    if (settings.levelOfDetail) {
+        const LodPyramid pyramid(scalarField, settings.lod);
+        std::vector<uint8_t> chunkLevels = settings.chunkLevels;
+        if (chunkLevels.size() != pyramid.chunkCount()) chunkLevels.assign(pyramid.chunkCount(), 0);
+        return lodSurfaceNets(pyramid, chunkLevels, settings.isovalue, cubeSize, threadPool,
+                              settings.method == IsosurfaceMethod::DualContouring);
+    }
+
+    // marching cubes
+    //Hammock::Logger::log(Hammock::LOG_LEVEL_DEBUG, "Marching cubes...\n");
+    IndexedMesh mesh = extractIsosurfaceSparse(scalarField, settings.isovalue, cubeSize, threadPool, settings.method);
+    if (key && !meshCache.store(mesh, *key)) {
+        Hammock::Logger::log(Hammock::LOG_LEVEL_WARN, "Failed to write mesh cache entry %s\n",
+                             meshCache.path(*key).c_str());
+    }
+    if (field) *field = std::move(scalarField);
+    return mesh;
+}
+
+CompactMesh Renderer::meshParticles(const ParticleArrays &particles, std::optional<SparseScalarField3D> *field) {
+    const MeshSettings settings = currentMeshSettings();
+    std::optional<uint64_t> key;
+    if (auto cached = findMesh(particles, settings, key)) return std::move(*cached);
+    return CompactMesh::fromIndexedMesh(extractMesh(particles, settings, key, field));
+}
+
+Renderer::GpuFrame Renderer::meshParticlesToRing(const ParticleArrays &particles) {
+    const MeshSettings settings = currentMeshSettings();
+    std::optional<uint64_t> key;
+    if (auto cached = findMesh(particles, settings, key)) return writeToRing(*cached);
+    return writeToRing(extractMesh(particles, settings, key));
+}
+
+BrickPatch Renderer::meshParticlesIncremental(IncrementalMesher &mesher, const ParticleArrays &particles) {
+    const MeshSettings settings = currentMeshSettings();
+    return mesher.update(createField(particles, settings), settings.isovalue, cubeSize, threadPool, settings.method);
+}
+
+Renderer::GpuFrame Renderer::uploadMesh(const CompactMesh &mesh) {
+    GpuFrame frame{};
+    if (mesh.indexCount() == 0) {
+        // Nothing to draw, empty buffers are not allowed
+        return frame;
+    }
+
+    // Cached meshes are uploaded straight from the mapped file
+    frame.vertexBuffer = deviceStorage.createVertexBuffer({
+        .vertexSize = sizeof(CompactVertex),
+        .vertexCount = mesh.vertexCount(),
+        .data = const_cast<CompactVertex *>(mesh.vertices())
+    });
 
+    frame.indexBuffer = deviceStorage.createIndexBuffer({
+        .indexSize = sizeof(uint32_t),
+        .indexCount = mesh.indexCount(),
+        .data = const_cast<uint32_t *>(mesh.indices())
+    });
+
+    frame.indexCount = mesh.indexCount();
+    frame.boundsMin = mesh.boundsMin();
+    frame.boundsExtent = mesh.boundsExtent();
+    return frame;
+}
+
+Renderer::GpuFrame Renderer::allocateRingMesh(uint32_t vertexCount, uint32_t indexCount, CompactVertex *&vertices,
+                                              uint32_t *&indices) {
+    GpuFrame frame{};
+    if (indexCount == 0) return frame;
+
+    // Indices first, the vertices follow at a multiple of the vertex size so that the draw reaches them
+    // through the vertex offset
+    const VkDeviceSize indexBytes = indexCount * sizeof(uint32_t);
+    const VkDeviceSize vertexBytes = vertexCount * sizeof(CompactVertex);
+    const VkDeviceSize size = indexBytes + sizeof(CompactVertex) + vertexBytes;
+    if (size > geometryRing->capacity() / 2) {
+        Hammock::Logger::log(Hammock::LOG_LEVEL_ERROR,
+                             "Frame of %llu bytes does not fit the geometry ring of %llu bytes, skipping it\n",
+                             static_cast<unsigned long long>(size),
+                             static_cast<unsigned long long>(geometryRing->capacity()));
+        return frame;
+    }
+
+    const auto allocation = geometryRing->allocate(size);
+    if (!allocation) return frame; // shutting down
+
+    const VkDeviceSize vertexStart = (allocation->offset + indexBytes + sizeof(CompactVertex) - 1) /
+                                     sizeof(CompactVertex) * sizeof(CompactVertex);
+    uint8_t *data = geometryRing->data(*allocation);
+    indices = reinterpret_cast<uint32_t *>(data);
+    vertices = reinterpret_cast<CompactVertex *>(data + (vertexStart - allocation->offset));
+
+    frame.vertexBuffer = geometryRing->buffer();
+    frame.indexBuffer = geometryRing->buffer();
+    frame.indexCount = indexCount;
+    frame.firstIndex = static_cast<uint32_t>(allocation->offset / sizeof(uint32_t));
+    frame.vertexOffset = static_cast<int32_t>(vertexStart / sizeof(CompactVertex));
+    frame.ringAllocation = allocation;
+    return frame;
+}
+
+Renderer::GpuFrame Renderer::writeToRing(const CompactMesh &mesh) {
+    CompactVertex *vertices = nullptr;
+    uint32_t *indices = nullptr;
+    GpuFrame frame = allocateRingMesh(mesh.vertexCount(), mesh.indexCount(), vertices, indices);
+    if (!frame.ringAllocation) return frame;
+
+    // Cached meshes are copied straight from the mapped file
+    std::memcpy(indices, mesh.indices(), mesh.indexCount() * sizeof(uint32_t));
+    std::memcpy(vertices, mesh.vertices(), mesh.vertexCount() * sizeof(CompactVertex));
+    frame.boundsMin = mesh.boundsMin();
+    frame.boundsExtent = mesh.boundsExtent();
+    return frame;
+}
+
+Renderer::GpuFrame Renderer::writeToRing(const IndexedMesh &mesh) {
+    const CompactMesh::Header header = CompactMesh::describe(mesh);
+    CompactVertex *vertices = nullptr;
+    uint32_t *indices = nullptr;
+    GpuFrame frame = allocateRingMesh(header.vertexCount, header.indexCount, vertices, indices);
+    if (!frame.ringAllocation) return frame;
+
+    // Quantized straight into the mapping, the extracted mesh is the only copy on the CPU
+    std::memcpy(indices, mesh.indices.data(), mesh.indices.size() * sizeof(uint32_t));
+    CompactMesh::encode(header, mesh.vertices.data(), mesh.vertices.size(), vertices);
+    frame.boundsMin = HmckVec4{header.boundsMin[0], header.boundsMin[1], header.boundsMin[2], 0.0f};
+    frame.boundsExtent = HmckVec4{header.boundsExtent[0], header.boundsExtent[1], header.boundsExtent[2], 0.0f};
+    return frame;
+}
+
+Renderer::GpuFrame Renderer::writeParticlesToRing(const ParticleArrays &particles) {
+    GpuFrame frame{};
+    if (particles.size() == 0) return frame;
+
+    const VkDeviceSize size = particles.size() * sizeof(ImpostorParticle);
+    if (size > geometryRing->capacity() / 2) {
+        Hammock::Logger::log(Hammock::LOG_LEVEL_ERROR,
+                             "Frame of %llu bytes does not fit the geometry ring of %llu bytes, skipping it\n",
+                             static_cast<unsigned long long>(size),
+                             static_cast<unsigned long long>(geometryRing->capacity()));
+        return frame;
+    }
+
+    const auto allocation = geometryRing->allocate(size);
+    if (!allocation) return frame; // shutting down
+
+    // Packed straight into the mapping, allocations are aligned to the particle size
+    packImpostorParticles(particles, reinterpret_cast<ImpostorParticle *>(geometryRing->data(*allocation)));
+
+    frame.vertexBuffer = geometryRing->buffer();
+    frame.firstParticle = static_cast<uint32_t>(allocation->offset / sizeof(ImpostorParticle));
+    frame.particleCount = static_cast<uint32_t>(particles.size());
+    frame.ringAllocation = allocation;
+
+    // Same mapping as the fields, particle positions end up where the meshes of the other modes would be
+    const auto gridDim = static_cast<float>(fieldPoints());
+    const float scale = gridDim * cubeSize / fieldSize;
+    frame.boundsMin = HmckVec4{fieldSize / 2.0f * scale, fieldSize / 2.0f * scale, fieldSize / 2.0f * scale, 0.0f};
+    frame.boundsExtent = HmckVec4{scale, scale, scale, scale};
+    return frame;
+}
+
+Renderer::GpuFrame Renderer::writeFieldToRing(const SparseScalarField3D &field) {
+    GpuFrame frame{};
+    if (field.empty()) return frame;
+
+    const VkDeviceSize size = static_cast<VkDeviceSize>(field.sizeX()) * field.sizeY() * field.sizeZ() *
+                              sizeof(float);
+    if (size > geometryRing->capacity() / 2) {
+        Hammock::Logger::log(Hammock::LOG_LEVEL_ERROR,
+                             "Frame of %llu bytes does not fit the geometry ring of %llu bytes, skipping it\n",
+                             static_cast<unsigned long long>(size),
+                             static_cast<unsigned long long>(geometryRing->capacity()));
+        return frame;
+    }
+
+    const auto allocation = geometryRing->allocate(size);
+    if (!allocation) return frame; // shutting down
+
+    // The compute shaders read the samples straight from the mapping
+    field.copyDense(reinterpret_cast<float *>(geometryRing->data(*allocation)));
+
+    frame.firstSample = static_cast<uint32_t>(allocation->offset / sizeof(float));
+    frame.fieldSize[0] = field.sizeX();
+    frame.fieldSize[1] = field.sizeY();
+    frame.fieldSize[2] = field.sizeZ();
+    frame.ringAllocation = allocation;
+    return frame;
+}
+
+void Renderer::destroyFrame(GpuFrame &frame) {
+    if (frame.ringAllocation) {
+        geometryRing->release(*frame.ringAllocation);
+        frame = GpuFrame{};
+        return;
+    }
+    if (frame.vertexBuffer.isValid()) deviceStorage.destroyBuffer(frame.vertexBuffer);
+    if (frame.indexBuffer.isValid()) deviceStorage.destroyBuffer(frame.indexBuffer);
+    frame = GpuFrame{};
+}
+
+SphSource Renderer::sphSource() {
+    // A sequence file written by sph_convert takes precedence over the .bin files it was made from
+    if (const std::string sequence = assetPath("sph/sequence.hsph"); std::filesystem::exists(sequence)) {
+        return SphSource::sequence(std::make_shared<SphSequence>(sequence));
+    }
+    std::vector<std::string> files;
+    for (const auto &file: Hammock::Filesystem::ls(assetPath("sph/"))) {
+        if (file.contains(".bin")) files.push_back(file);
+    }
+    return SphSource::files(std::move(files));
+}
+
+void Renderer::loadSph() {
+    preloadSource = sphSource();
+    for (std::size_t frame = 0; frame < preloadSource.frameCount; ++frame) {
         // Load particles
-        std::vector<Particle> particles;
+        ParticleArrays particles;
         //Hammock::Logger::log(Hammock::LOG_LEVEL_DEBUG, "Loading particles...\n");
-        if (loadParticles(file, particles)) {
+        if (preloadSource.load(frame, particles)) {
             //Hammock::Logger::log(Hammock::LOG_LEVEL_DEBUG, "Loaded %d particles\n", particles.size());
         } else {
             Hammock::Logger::log(Hammock::LOG_LEVEL_ERROR, "Failed to load particles\n");
             throw std::runtime_error("Failed to load particles");
         }
 
+        std::optional<SparseScalarField3D> field;
+        CompactMesh mesh = meshParticles(particles, &field);
+        //Hammock::Logger::log(Hammock::LOG_LEVEL_DEBUG, "Marched surface of %d triangles\n", mesh.indices.size() / 3);
 
-        // Create a scalar field
-        float fieldSize = 1.0f; // Total domain size from -0.5 to 0.5
-        float gridSize = fieldSize / 40.0f; // To get 40x40x40 grid
-        //Hammock::Logger::log(Hammock::LOG_LEVEL_DEBUG, "Creating scalar field...\n");
-        auto scalarField = createScalarField(particles, gridSize, fieldSize);
-        //Hammock::Logger::log(Hammock::LOG_LEVEL_DEBUG, "Created scalar field of %d x %d x %d\n", scalarField.size(),
-         //                    scalarField[0].size(), scalarField[0][0].size());
+        // create buffers
+        frames.push_back(uploadMesh(mesh));
 
-        // marching cubes
-        //Hammock::Logger::log(Hammock::LOG_LEVEL_DEBUG, "Marching cubes...\n");
-        std::vector<Hammock::Triangle> triangles = marchingCubes(scalarField, isovalue, cubeSize);
-        //Hammock::Logger::log(Hammock::LOG_LEVEL_DEBUG, "Marched surface of %d triangles\n", triangles.size());
+        const MeshSettings settings = currentMeshSettings();
+        preloadedFields.push_back({
+            std::move(field), std::nullopt, settings.isovalue, settings.method, settings.kernelSplatting,
+            settings.splat
+        });
+    }
 
-        // create buffers
-        std::vector<Hammock::Vertex> v;
-        for (auto &triangle: triangles) {
-            HmckVec3 v1 = HmckSub(triangle.v1.position, triangle.v0.position);
-            HmckVec3 v2 = HmckSub(triangle.v2.position, triangle.v0.position);
-
-            HmckVec3 normal = HmckNorm(HmckMul(HmckCross(v1, v2), {1.0f, -1.0f, 1.f}));
-            triangle.v0.normal = normal;
-            triangle.v1.normal = normal;
-            triangle.v2.normal = normal;
-
-            v.push_back(triangle.v0);
-            v.push_back(triangle.v1);
-            v.push_back(triangle.v2);
+    Hammock::Logger::log(Hammock::LOG_LEVEL_DEBUG, "Created %d frames \n", frames.size());
+}
+
+void Renderer::updatePreloaded() {
+    if (frames.empty()) return;
+    if (vertexBufferId >= static_cast<int>(frames.size())) vertexBufferId = 0;
+
+    // Frames are brought up to date when they are displayed, the index makes that cheap enough to do
+    // on the render thread while the isovalue is dragged
+    const MeshSettings settings = currentMeshSettings();
+    PreloadedField &preloaded = preloadedFields[vertexBufferId];
+    // The kernel settings only matter while splatting
+    const bool fieldChanged = preloaded.kernelSplatting != settings.kernelSplatting ||
+                              (settings.kernelSplatting && preloaded.splat != settings.splat);
+    if (!fieldChanged && preloaded.isovalue == settings.isovalue && preloaded.method == settings.method) return;
+    if (fieldChanged) {
+        preloaded.field.reset();
+        preloaded.index.reset();
+    }
+
+    if (!preloaded.field) {
+        // The mesh came from the cache, the particles are read again the first time the frame is re-meshed
+        ParticleArrays particles;
+        if (!preloadSource.load(vertexBufferId, particles)) {
+            Hammock::Logger::log(Hammock::LOG_LEVEL_ERROR, "Failed to load particles\n");
+            throw std::runtime_error("Failed to load particles");
         }
+        preloaded.field = createField(particles, settings);
+    }
+    if (!preloaded.index) preloaded.index.emplace(*preloaded.field);
+
+    const CompactMesh mesh = CompactMesh::fromIndexedMesh(extractIsosurfaceIndexed(
+        *preloaded.field, *preloaded.index, settings.isovalue, cubeSize, threadPool, settings.method));
+    retiredFrames.push_back({frames[vertexBufferId], renderedFrames});
+    frames[vertexBufferId] = uploadMesh(mesh);
+    preloaded.isovalue = settings.isovalue;
+    preloaded.method = settings.method;
+    preloaded.kernelSplatting = settings.kernelSplatting;
+    preloaded.splat = settings.splat;
+}
 
-        vertices.push_back(v);
+void Renderer::startStream() {
+    if (playbackMode == PlaybackMode::Incremental) {
+        brickMeshBuffer = std::make_unique<BrickMeshBuffer>(
+            deviceStorage, device.getEnabledFeatures().multiDrawIndirect == VK_TRUE);
+        // The mesher keeps the previous field, it lives on the stream's mesher thread
+        auto mesher = std::make_shared<IncrementalMesher>();
+        patchStream = std::make_unique<SphStream<BrickPatch> >(
+            sphSource(), [this, mesher](const ParticleArrays &particles) {
+                return meshParticlesIncremental(*mesher, particles);
+            }, streamLookahead);
+
+        Hammock::Logger::log(Hammock::LOG_LEVEL_DEBUG, "Streaming %d frames incrementally\n",
+                             patchStream->frameCount());
+        return;
+    }
 
+    geometryRing = std::make_unique<GeometryRing>(deviceStorage, geometryRingCapacity);
+    if (playbackMode == PlaybackMode::Particles) {
+        stream = std::make_unique<SphStream<GpuFrame> >(sphSource(), [this](const ParticleArrays &particles) {
+            return writeParticlesToRing(particles);
+        }, streamLookahead);
+    } else if (playbackMode == PlaybackMode::Compute) {
+        stream = std::make_unique<SphStream<GpuFrame> >(sphSource(), [this](const ParticleArrays &particles) {
+            return writeFieldToRing(createField(particles, currentMeshSettings()));
+        }, streamLookahead);
+    } else {
+        stream = std::make_unique<SphStream<GpuFrame> >(sphSource(), [this](const ParticleArrays &particles) {
+            return meshParticlesToRing(particles);
+        }, streamLookahead);
+    }
+
+    Hammock::Logger::log(Hammock::LOG_LEVEL_DEBUG, "Streaming %d frames \n", stream->frameCount());
+}
 
-        vertexBuffers.push_back( deviceStorage.createVertexBuffer({
-            .vertexSize = sizeof(vertices[f][0]),
-            .vertexCount = static_cast<uint32_t>(vertices[f].size()),
-            .data = static_cast<void *>(vertices[f].data())
-        }));
+void Renderer::updateStream() {
+    if (playbackMode == PlaybackMode::Incremental) {
+        // Show the first frame right away instead of waiting for the animation to advance
+        if (!firstPatchApplied) firstPatchApplied = advanceFrame();
+        return;
+    }
 
+    // Frames arrive already written to the ring
+    while (residentFrames.size() < maxResidentFrames) {
+        auto meshed = stream->tryPop();
+        if (!meshed) break;
+        residentFrames.push_back(meshed->mesh);
+    }
+}
 
-        //Hammock::Logger::log(Hammock::LOG_LEVEL_DEBUG, "Vertex buffer created with %d vertices \n",
-         //                    vertices[f].size());
+void Renderer::destroyRetiredFrames() {
+    // Buffers of frames that are no longer displayed may still be used by frames in flight. Runs right
+    // after beginFrame waited for the fence of frame renderedFrames - MAX_FRAMES_IN_FLIGHT, a frame retired
+    // at retiredAt was last drawn by frame retiredAt.
+    std::erase_if(retiredFrames, [this](RetiredFrame &retired) {
+        if (renderedFrames < retired.retiredAt + Hammock::SwapChain::MAX_FRAMES_IN_FLIGHT) return false;
+        destroyFrame(retired.frame);
+        return true;
+    });
+}
 
-        f++;
+const Renderer::GpuFrame *Renderer::currentFrame() {
+    if (streamsFrames()) {
+        return residentFrames.empty() ? nullptr : &residentFrames.front();
     }
 
-    Hammock::Logger::log(Hammock::LOG_LEVEL_DEBUG, "Created %d vertex buffers \n",
-                             vertexBuffers.size());
+    if (frames.empty()) return nullptr;
+    if (vertexBufferId >= static_cast<int>(frames.size())) vertexBufferId = 0;
+    return &frames[vertexBufferId];
+}
+
+bool Renderer::advanceFrame() {
+    if (playbackMode == PlaybackMode::Incremental) {
+        // Patches build on each other, none of them can be skipped
+        auto patch = patchStream->tryPop();
+        if (!patch) return false;
+        brickMeshBuffer->apply(patch->mesh, renderedFrames);
+        return true;
+    }
+
+    if (streamsFrames()) {
+        // Keep showing the current frame until the next one is uploaded
+        if (residentFrames.size() < 2) return false;
+        retiredFrames.push_back({residentFrames.front(), renderedFrames});
+        residentFrames.pop_front();
+        return true;
+    }
+
+    vertexBufferId++;
+    return true;
+}
+
+bool Renderer::streamsFrames() const {
+    // Whole frames through the geometry ring
+    return playbackMode == PlaybackMode::Stream || playbackMode == PlaybackMode::Particles ||
+           playbackMode == PlaybackMode::Compute;
 }
 
 void Renderer::init() {
@@ -210,13 +765,34 @@ void Renderer::init() {
             .bufferWrites = {{0, fbufferInfo}}
         });
     }
-    // pipeline
-    pipeline = Hammock::GraphicsPipeline::createGraphicsPipelinePtr({
-        .debugName = "marching_cubes",
+    // pipelines
+    pipeline = createPipeline("marching_cubes_compact", "marching_cubes_compact.vert",
+                              CompactVertex::vertexInputBindingDescriptions(),
+                              CompactVertex::vertexInputAttributeDescriptions());
+    brickPipeline = createPipeline("marching_cubes", "marching_cubes.vert",
+                                   Hammock::Vertex::vertexInputBindingDescriptions(),
+                                   Hammock::Vertex::vertexInputAttributeDescriptions());
+    if (playbackMode == PlaybackMode::Particles) {
+        const VkExtent2D extent = window.getExtent();
+        impostors = std::make_unique<ParticleImpostors>(device, deviceStorage, renderContext.getSwapChainRenderPass(),
+                                                        descriptorSetLayout, extent.width, extent.height);
+    }
+    if (playbackMode == PlaybackMode::Compute) {
+        gpuMarchingCubes = std::make_unique<GpuMarchingCubes>(device, deviceStorage,
+                                                              Hammock::SwapChain::MAX_FRAMES_IN_FLIGHT);
+    }
+}
+
+std::unique_ptr<Hammock::GraphicsPipeline> Renderer::createPipeline(
+    const std::string &debugName, const std::string &vertexShader,
+    const std::vector<VkVertexInputBindingDescription> &bindings,
+    const std::vector<VkVertexInputAttributeDescription> &attributes) {
+    return Hammock::GraphicsPipeline::createGraphicsPipelinePtr({
+        .debugName = debugName,
         .device = device,
         .VS
         {
-            .byteCode = Hammock::Filesystem::readFile(compiledShaderPath("marching_cubes.vert")),
+            .byteCode = Hammock::Filesystem::readFile(compiledShaderPath(vertexShader)),
             .entryFunc = "main"
         },
         .FS
@@ -242,8 +818,8 @@ void Renderer::init() {
             .blendAtaAttachmentStates{},
             .vertexBufferBindings
             {
-                .vertexBindingDescriptions = Hammock::Vertex::vertexInputBindingDescriptions(),
-                .vertexAttributeDescriptions = Hammock::Vertex::vertexInputAttributeDescriptions()
+                .vertexBindingDescriptions = bindings,
+                .vertexAttributeDescriptions = attributes
             }
         },
         .renderPass = renderContext.getSwapChainRenderPass()
@@ -264,5 +840,62 @@ void Renderer::drawUi() {
     ImGui::DragFloat("Elevation", &elevation, 0.01f);
     ImGui::DragFloat("Radius", &radius);
     ImGui::DragInt("Animation speed", &framing);
+
+    if (impostors) {
+        ImGui::DragFloat("Particle scale", &particleScale, 0.05f, 0.1f, 10.0f);
+        ImGui::Checkbox("Fluid smoothing", &impostors->smoothing);
+        ImGui::DragInt("Smoothing radius", &impostors->pushData.filterRadius, 0.1f, 1, 16);
+        ImGui::DragFloat("Depth falloff", &impostors->pushData.depthFalloff, 0.1f, 0.0f, 100.0f);
+    } else {
+        std::lock_guard<std::mutex> lock(meshSettingsMutex);
+        ImGui::DragFloat("Isovalue", &meshSettings.isovalue, 0.0001f, 0.0f, 1000.0f, "%.4f");
+        ImGui::Checkbox("Kernel splatting", &meshSettings.kernelSplatting);
+        ImGui::Checkbox("Morton sorted scatter", &meshSettings.mortonSort);
+        ImGui::DragFloat("Kernel scale", &meshSettings.splat.kernelScale, 0.05f, 0.5f, 8.0f);
+        // Chunks of different levels only meet without cracks with the dual methods, so marching cubes is
+        // not offered while level of detail is on
+        const bool levelOfDetail = meshSettings.levelOfDetail && playbackMode == PlaybackMode::Stream;
+        if (levelOfDetail && meshSettings.method == IsosurfaceMethod::MarchingCubes) {
+            meshSettings.method = IsosurfaceMethod::SurfaceNets;
+        }
+        const char *methods[] = {"Marching cubes", "Surface nets", "Dual contouring"};
+        if (!gpuMarchingCubes && ImGui::BeginCombo("Extractor", methods[static_cast<int>(meshSettings.method)])) {
+            for (int method = 0; method < IM_ARRAYSIZE(methods); ++method) {
+                const bool available = !levelOfDetail || method != static_cast<int>(IsosurfaceMethod::MarchingCubes);
+                if (ImGui::Selectable(methods[method], method == static_cast<int>(meshSettings.method),
+                                      available ? 0 : ImGuiSelectableFlags_Disabled)) {
+                    meshSettings.method = static_cast<IsosurfaceMethod>(method);
+                }
+            }
+            ImGui::EndCombo();
+        }
+
+        // Preloaded and incremental frames are meshed once, they cannot follow the camera
+        ImGui::BeginDisabled(playbackMode != PlaybackMode::Stream);
+        ImGui::Checkbox("Level of detail (stream only, surface nets)", &meshSettings.levelOfDetail);
+        ImGui::DragFloat("LOD distance", &meshSettings.lod.distance, 0.5f, 1.0f, 1000.0f);
+        ImGui::EndDisabled();
+    }
+    if (streamsFrames()) {
+        ImGui::Text("Resident frames: %d / %d", static_cast<int>(residentFrames.size()),
+                    static_cast<int>(maxResidentFrames));
+        if (geometryRing) {
+            ImGui::Text("Geometry ring: %.1f / %.1f MB", static_cast<double>(geometryRing->used()) / (1 << 20),
+                        static_cast<double>(geometryRing->capacity()) / (1 << 20));
+        }
+    }
+    if (playbackMode == PlaybackMode::Preload || playbackMode == PlaybackMode::Stream) {
+        ImGui::Text("Mesh cache hits: %d, misses: %d", static_cast<int>(meshCacheHits.load()),
+                    static_cast<int>(meshCacheMisses.load()));
+    }
+    if (gpuMarchingCubes) {
+        // Count of the extraction that last finished in this frame's slot
+        ImGui::Text("Compute triangles: %d",
+                    static_cast<int>(gpuMarchingCubes->triangleCount(renderContext.getFrameIndex())));
+    }
+    if (brickMeshBuffer) {
+        ImGui::Text("Bricks: %d, vertices: %d", static_cast<int>(brickMeshBuffer->brickCount()),
+                    static_cast<int>(brickMeshBuffer->vertexCount()));
+    }
     ImGui::End();
 }
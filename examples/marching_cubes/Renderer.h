@@ -1,22 +1,62 @@
 #pragma once
+#include <atomic>
+#include <deque>
+#include <mutex>
+#include <optional>
 #include <hammock/hammock.h>
+#include "BrickMeshBuffer.h"
+#include "GeometryRing.h"
+#include "GpuMarchingCubes.h"
+#include "IncrementalMesher.h"
+#include "LevelOfDetail.h"
+#include "MeshCache.h"
+#include "MortonSort.h"
+#include "ParticleImpostors.h"
 #include "Particle.h"
+#include "ParticleSplatting.h"
+#include "SpanSpaceIndex.h"
+#include "SphStream.h"
 
 
 class Renderer {
 public:
     struct PushData {
         float elapsedTime;
+        // Dequantization of compact vertices
+        alignas(16) HmckVec4 boundsMin{};
+        alignas(16) HmckVec4 boundsExtent{1.f, 1.f, 1.f, 0.f};
     } pushData;
     struct BufferData {
         alignas(16) HmckMat4 mvp{};
         alignas(16) HmckVec4 lightPos {100.f,100.f, 100.f};
+        // Particle impostors work in view space
+        alignas(16) HmckMat4 modelView{};
+        alignas(16) HmckMat4 projection{};
+        alignas(16) HmckVec4 viewLightPos{};
     } bufferData;
 
-    Renderer();
+    enum class PlaybackMode {
+        // Mesh and upload every frame of the sequence before the window shows
+        Preload,
+        // Load, mesh and upload frames in the background a few frames ahead of playback
+        Stream,
+        // Like Stream, but only the bricks that changed since the previous frame are re-meshed and
+        // patched into one persistent buffer
+        Incremental,
+        // Stream the particles themselves and draw them as sphere impostors, no field or mesh is built
+        Particles,
+        // Stream the fields and extract the displayed one with compute shaders every frame, the isovalue
+        // applies right away
+        Compute
+    };
+
+    explicit Renderer(PlaybackMode playbackMode = PlaybackMode::Stream);
 
     void draw();
 
+    // Instead of draw, extracts the first frames with the compute shaders and the CPU and compares the
+    // triangles, true if they match
+    bool checkCompute(uint32_t frameCount);
 
 private:
 
@@ -28,8 +68,101 @@ private:
         return "../../../src/hammock/shaders/compiled/" + shader + ".spv";
     }
 
+    struct GpuFrame {
+        Hammock::ResourceHandle<Hammock::Buffer> vertexBuffer{};
+        Hammock::ResourceHandle<Hammock::Buffer> indexBuffer{};
+        uint32_t indexCount = 0;
+        // Streamed frames share the geometry ring and are addressed by offset
+        uint32_t firstIndex = 0;
+        int32_t vertexOffset = 0;
+        std::optional<GeometryRing::Allocation> ringAllocation{};
+        // Particles mode, impostor particles instead of a mesh
+        uint32_t firstParticle = 0;
+        uint32_t particleCount = 0;
+        // Compute mode, dense field in the ring
+        uint32_t firstSample = 0;
+        uint32_t fieldSize[3]{};
+        HmckVec4 boundsMin{};
+        HmckVec4 boundsExtent{};
+    };
+
+    struct RetiredFrame {
+        GpuFrame frame;
+        uint64_t retiredAt;
+    };
+
+    // Field of a preloaded frame and the isosurface its buffers hold. A frame meshed on a cache miss keeps
+    // the field it was meshed from, the index and the fields of cache hits are only built once the frame
+    // is displayed with another isovalue or method. Other field settings drop the field and index, the
+    // field is then built again like the fields of cache hits.
+    struct PreloadedField {
+        std::optional<SparseScalarField3D> field;
+        std::optional<SpanSpaceIndex> index;
+        float isovalue;
+        IsosurfaceMethod method;
+        // Settings the field and the mesh were built with
+        bool kernelSplatting;
+        SplatSettings splat;
+    };
+
+    struct MeshSettings {
+        float isovalue = .001f; // Threshold value for surface extraction
+        // Spread particles with a smoothing kernel instead of writing each into a single voxel
+        bool kernelSplatting = false;
+        SplatSettings splat{};
+        // Write particles into the field in Morton order of their cells, same field, better locality
+        bool mortonSort = false;
+        IsosurfaceMethod method = IsosurfaceMethod::MarchingCubes;
+        // Mesh chunks far from the camera from subsampled fields, surface nets only
+        bool levelOfDetail = false;
+        LodSettings lod{};
+        std::vector<uint8_t> chunkLevels{}; // per chunk of the field, updated from the camera every frame
+    };
+
+    static SphSource sphSource();
+    MeshSettings currentMeshSettings();
+    uint32_t fieldPoints() const;
+    void updateChunkLevels(const HmckMat4 &model);
+    SparseScalarField3D createField(const ParticleArrays &particles, const MeshSettings &settings);
+    SparseScalarField3D createField(const ParticleArrays &particles, const MeshSettings &settings,
+                                    Hammock::ThreadPool &pool);
+    uint64_t meshCacheKey(const ParticleArrays &particles, const MeshSettings &settings) const;
+    // Cached mesh of the particles, nothing on a miss. key is set when the mesh belongs in the cache.
+    std::optional<CompactMesh> findMesh(const ParticleArrays &particles, const MeshSettings &settings,
+                                        std::optional<uint64_t> &key);
+    // Extracts the mesh and stores it in the cache under key. The field it was extracted from is moved
+    // into field if set, level of detail meshes leave it empty.
+    IndexedMesh extractMesh(const ParticleArrays &particles, const MeshSettings &settings, std::optional<uint64_t> key,
+                            std::optional<SparseScalarField3D> *field = nullptr);
+    // A field built on a cache miss is moved to field when it is given
+    CompactMesh meshParticles(const ParticleArrays &particles, std::optional<SparseScalarField3D> *field = nullptr);
+    GpuFrame meshParticlesToRing(const ParticleArrays &particles);
+    BrickPatch meshParticlesIncremental(IncrementalMesher &mesher, const ParticleArrays &particles);
+    GpuFrame uploadMesh(const CompactMesh &mesh);
+    // Ring range for a mesh, indices and vertices point at the mapping. Empty if the mesh is empty or
+    // does not fit.
+    GpuFrame allocateRingMesh(uint32_t vertexCount, uint32_t indexCount, CompactVertex *&vertices,
+                              uint32_t *&indices);
+    GpuFrame writeToRing(const CompactMesh &mesh);
+    GpuFrame writeToRing(const IndexedMesh &mesh);
+    GpuFrame writeParticlesToRing(const ParticleArrays &particles);
+    GpuFrame writeFieldToRing(const SparseScalarField3D &field);
+    void destroyFrame(GpuFrame &frame);
+    const GpuFrame *currentFrame();
+    bool advanceFrame();
+    bool streamsFrames() const;
+
     void loadSph();
+    void updatePreloaded();
+    void startStream();
+    void updateStream();
+    void destroyRetiredFrames();
     void init();
+    void shutdown();
+    std::unique_ptr<Hammock::GraphicsPipeline> createPipeline(
+        const std::string &debugName, const std::string &vertexShader,
+        const std::vector<VkVertexInputBindingDescription> &bindings,
+        const std::vector<VkVertexInputAttributeDescription> &attributes);
     void drawUi();
 
     Hammock::VulkanInstance instance;
@@ -38,22 +171,68 @@ private:
     Hammock::DeviceStorage deviceStorage{device};
     Hammock::RenderContext renderContext{window, device};
     Hammock::UserInterface ui{device, renderContext.getSwapChainRenderPass(), deviceStorage.getDescriptorPool(), window};
+    Hammock::ThreadPool threadPool{};
+
+
+    PlaybackMode playbackMode;
+
+    // Preload mode, every frame of the sequence. Fields are kept with a span space index once built, so
+    // an isovalue change re-meshes the displayed frame right away from the cells that intersect it.
+    std::vector<GpuFrame> frames;
+    std::vector<PreloadedField> preloadedFields;
+    // Particles of frames whose field has not been built yet are read again from here
+    SphSource preloadSource{};
+
+    // Stream mode, front is the displayed frame. The mesher thread writes frames straight into the ring,
+    // it has to hold at least two frames for playback to advance, more let the mesher run further ahead.
+    std::unique_ptr<SphStream<GpuFrame> > stream{};
+    std::unique_ptr<GeometryRing> geometryRing{};
+    VkDeviceSize geometryRingCapacity = VkDeviceSize{256} << 20;
+    std::deque<GpuFrame> residentFrames;
+    std::vector<RetiredFrame> retiredFrames;
+    uint64_t renderedFrames = 0;
+    uint32_t streamLookahead = 4;
+    uint32_t maxResidentFrames = 3;
+
+    // Incremental mode, patches are applied in sequence order when the animation advances
+    std::unique_ptr<SphStream<BrickPatch> > patchStream{};
+    std::unique_ptr<BrickMeshBuffer> brickMeshBuffer{};
+    bool firstPatchApplied = false;
+
+    // Particles mode, shares the stream and the ring with the Stream mode
+    std::unique_ptr<ParticleImpostors> impostors{};
+    float particleScale = 1.0f;
+
+    // Compute mode, shares the stream and the ring with the Stream mode, one extraction slot per frame in flight
+    std::unique_ptr<GpuMarchingCubes> gpuMarchingCubes{};
+
+    // Extracted meshes of the Preload and Stream modes, keyed by particles and mesh settings
+    MeshCache meshCache{assetPath("sph/cache/")};
+    std::atomic<uint32_t> meshCacheHits = 0;
+    std::atomic<uint32_t> meshCacheMisses = 0;
 
+    // Permutation of the last frame the fields were built from, only touched by the thread building them
+    MortonSorter mortonSorter{};
 
-    std::vector<Hammock::ResourceHandle<Hammock::Buffer>> vertexBuffers;
-    std::vector<std::vector<Hammock::Vertex>> vertices;
+    // Read by the mesher thread while streaming, changes apply to frames meshed afterwards
+    MeshSettings meshSettings{};
+    std::mutex meshSettingsMutex;
 
     std::vector<Hammock::ResourceHandle<VkDescriptorSet>> descriptorSets{};
     Hammock::ResourceHandle<Hammock::DescriptorSetLayout> descriptorSetLayout;
     std::vector<Hammock::ResourceHandle<Hammock::Buffer>> buffers{};
 
+    // Compact vertices for whole frames, full vertices for the brick meshes of the incremental mode and
+    // the compute extraction
     std::unique_ptr<Hammock::GraphicsPipeline> pipeline{};
+    std::unique_ptr<Hammock::GraphicsPipeline> brickPipeline{};
 
     HmckVec3 cameraPosition{-24.0f , 40.f, 40.f};
     HmckVec3 cameraTarget{0.0f, 0.0f, 0.0f};
     float azimuth{2.4f}, radius{40.0f}, elevation{0.56f};
     bool orbit{true};
-    float isovalue = .001f; // Threshold value for surface extraction
+    float fieldSize = 1.0f; // Total domain size from -0.5 to 0.5
+    int gridResolution = 40; // Grid points per axis
     float cubeSize = .00001f; // Size of the cubes in the marching cubes algorithm
     int vertexBufferId = 0;
     bool loop{true};
@@ -0,0 +1,153 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <algorithm>
+#include <memory>
+#include <new>
+
+// Dense scalar field backed by a single contiguous, cache line aligned allocation.
+//
+// Linear layout is x-fastest: index = x + y * rowStride + z * sliceStride. Rows are padded to a
+// multiple of ROW_ALIGNMENT floats so every row starts on a cache line and can be loaded with
+// aligned vector instructions.
+//
+// ZOrder layout stores samples in Morton order (interleaved bits of x, y and z). The 8 corners of
+// a cell then usually share one or two cache lines, which helps random access patterns at the cost
+// of some padding when the dimensions are not powers of two.
+class ScalarField3D {
+public:
+    enum class Layout {
+        Linear,
+        ZOrder
+    };
+
+    // Row padding in floats (64 bytes)
+    static constexpr uint32_t ROW_ALIGNMENT = 16;
+    static constexpr std::size_t ALLOCATION_ALIGNMENT = 64;
+
+    ScalarField3D() = default;
+
+    ScalarField3D(uint32_t nx, uint32_t ny, uint32_t nz, Layout layout = Layout::Linear, float value = 0.0f)
+        : nx(nx), ny(ny), nz(nz), layout_(layout) {
+        if (layout == Layout::Linear) {
+            rowStride_ = (static_cast<std::size_t>(nx) + ROW_ALIGNMENT - 1) & ~static_cast<std::size_t>(
+                             ROW_ALIGNMENT - 1);
+            sliceStride_ = rowStride_ * ny;
+            capacity_ = sliceStride_ * nz;
+        } else {
+            rowStride_ = 0;
+            sliceStride_ = 0;
+            // Morton code is monotonic along every axis, so the last sample bounds the allocation
+            capacity_ = (nx && ny && nz) ? morton(nx - 1, ny - 1, nz - 1) + 1 : 0;
+        }
+
+        if (capacity_ > 0) {
+            values = Storage(static_cast<float *>(::operator new[](capacity_ * sizeof(float),
+                                                                   std::align_val_t{ALLOCATION_ALIGNMENT})));
+            fill(value);
+        }
+    }
+
+    // Not copyable, fields can be large
+    ScalarField3D(const ScalarField3D &) = delete;
+
+    ScalarField3D &operator=(const ScalarField3D &) = delete;
+
+    ScalarField3D(ScalarField3D &&) noexcept = default;
+
+    ScalarField3D &operator=(ScalarField3D &&) noexcept = default;
+
+    [[nodiscard]] uint32_t sizeX() const { return nx; }
+    [[nodiscard]] uint32_t sizeY() const { return ny; }
+    [[nodiscard]] uint32_t sizeZ() const { return nz; }
+    [[nodiscard]] Layout layout() const { return layout_; }
+    [[nodiscard]] bool empty() const { return nx == 0 || ny == 0 || nz == 0; }
+
+    // Strides are only meaningful for the linear layout
+    [[nodiscard]] std::size_t rowStride() const { return rowStride_; }
+    [[nodiscard]] std::size_t sliceStride() const { return sliceStride_; }
+
+    // Number of allocated floats including padding
+    [[nodiscard]] std::size_t capacity() const { return capacity_; }
+    [[nodiscard]] std::size_t bytes() const { return capacity_ * sizeof(float); }
+
+    [[nodiscard]] float *data() { return values.get(); }
+    [[nodiscard]] const float *data() const { return values.get(); }
+
+    // Pointer to the first sample of row (y, z), linear layout only
+    [[nodiscard]] float *row(uint32_t y, uint32_t z) { return values.get() + y * rowStride_ + z * sliceStride_; }
+
+    [[nodiscard]] const float *row(uint32_t y, uint32_t z) const {
+        return values.get() + y * rowStride_ + z * sliceStride_;
+    }
+
+    [[nodiscard]] std::size_t index(uint32_t x, uint32_t y, uint32_t z) const {
+        if (layout_ == Layout::Linear) {
+            return x + y * rowStride_ + z * sliceStride_;
+        }
+        return morton(x, y, z);
+    }
+
+    [[nodiscard]] float &at(uint32_t x, uint32_t y, uint32_t z) { return values[index(x, y, z)]; }
+    [[nodiscard]] float at(uint32_t x, uint32_t y, uint32_t z) const { return values[index(x, y, z)]; }
+
+    // Fetches the 8 corners of cell (x, y, z) in marching cubes corner order
+    void cellCorners(uint32_t x, uint32_t y, uint32_t z, float corners[8]) const {
+        if (layout_ == Layout::Linear) {
+            const float *p = values.get() + x + y * rowStride_ + z * sliceStride_;
+            const float *pz = p + sliceStride_;
+            corners[0] = p[0];
+            corners[1] = p[1];
+            corners[2] = p[rowStride_ + 1];
+            corners[3] = p[rowStride_];
+            corners[4] = pz[0];
+            corners[5] = pz[1];
+            corners[6] = pz[rowStride_ + 1];
+            corners[7] = pz[rowStride_];
+            return;
+        }
+        corners[0] = at(x, y, z);
+        corners[1] = at(x + 1, y, z);
+        corners[2] = at(x + 1, y + 1, z);
+        corners[3] = at(x, y + 1, z);
+        corners[4] = at(x, y, z + 1);
+        corners[5] = at(x + 1, y, z + 1);
+        corners[6] = at(x + 1, y + 1, z + 1);
+        corners[7] = at(x, y + 1, z + 1);
+    }
+
+    void fill(float value) {
+        std::fill_n(values.get(), capacity_, value);
+    }
+
+    // Interleaves the lower 21 bits of x, y and z
+    static uint64_t morton(uint32_t x, uint32_t y, uint32_t z) {
+        return spreadBits(x) | (spreadBits(y) << 1) | (spreadBits(z) << 2);
+    }
+
+private:
+    struct AlignedDelete {
+        void operator()(float *p) const {
+            ::operator delete[](p, std::align_val_t{ALLOCATION_ALIGNMENT});
+        }
+    };
+
+    using Storage = std::unique_ptr<float[], AlignedDelete>;
+
+    static uint64_t spreadBits(uint32_t v) {
+        uint64_t x = v & 0x1fffff;
+        x = (x | x << 32) & 0x1f00000000ffffull;
+        x = (x | x << 16) & 0x1f0000ff0000ffull;
+        x = (x | x << 8) & 0x100f00f00f00f00full;
+        x = (x | x << 4) & 0x10c30c30c30c30c3ull;
+        x = (x | x << 2) & 0x1249249249249249ull;
+        return x;
+    }
+
+    uint32_t nx = 0, ny = 0, nz = 0;
+    Layout layout_ = Layout::Linear;
+    std::size_t rowStride_ = 0;
+    std::size_t sliceStride_ = 0;
+    std::size_t capacity_ = 0;
+    Storage values{};
+};
@@ -0,0 +1,207 @@
+#pragma once
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <numeric>
+#include <vector>
+
+#include <hammock/core/ThreadPool.h>
+
+#include "SurfaceNets.h"
+
+// Interval tree over the value ranges of the cells of a sparse field, the span space of the field.
+// A cell intersects the isovalue when its minimum lies below and its maximum at or above it, so a query
+// walks a single path from the root and collects the intersected cells in O(log n + k) instead of
+// classifying every cell. Built once per field, an isovalue change then only touches the cells that
+// produce triangles. Cells whose corners are all equal can never intersect and are left out.
+//
+// Cells are identified by brick * BRICK_VOLUME + x + BRICK_SIZE * (y + BRICK_SIZE * z), relative to
+// the brick origin, which is the order the brick marchers visit them in.
+class SpanSpaceIndex {
+public:
+    SpanSpaceIndex() = default;
+
+    explicit SpanSpaceIndex(const SparseScalarField3D &scalarField) {
+        if (scalarField.sizeX() < 2 || scalarField.sizeY() < 2 || scalarField.sizeZ() < 2) return;
+
+        constexpr int BRICK_SIZE = SparseScalarField3D::BRICK_SIZE;
+        const uint32_t bricksX = scalarField.bricksX(), bricksY = scalarField.bricksY();
+        std::vector<Interval> intervals;
+
+        for (const uint32_t brick: candidateBricks(scalarField)) {
+            const uint32_t bx = brick % bricksX, by = brick / bricksX % bricksY, bz = brick / (bricksX * bricksY);
+            float brickLo, brickHi;
+            scalarField.cellRange(bx, by, bz, brickLo, brickHi);
+            if (!(brickLo < brickHi)) continue;
+
+            const int x0 = static_cast<int>(bx * BRICK_SIZE), y0 = static_cast<int>(by * BRICK_SIZE);
+            const int z0 = static_cast<int>(bz * BRICK_SIZE);
+            const int x1 = std::min<int>(x0 + BRICK_SIZE, scalarField.sizeX() - 1);
+            const int y1 = std::min<int>(y0 + BRICK_SIZE, scalarField.sizeY() - 1);
+            const int z1 = std::min<int>(z0 + BRICK_SIZE, scalarField.sizeZ() - 1);
+            const BrickView<0, 1> view(scalarField, brick);
+            const auto slot = static_cast<uint32_t>(bricks.size());
+            bool indexed = false;
+
+            for (int z = z0; z < z1; ++z) {
+                for (int y = y0; y < y1; ++y) {
+                    for (int x = x0; x < x1; ++x) {
+                        float v[8];
+                        view.cellCorners(x, y, z, v);
+                        const auto [lo, hi] = std::minmax_element(v, v + 8);
+                        if (!(*lo < *hi)) continue;
+                        intervals.push_back({
+                            *lo, *hi,
+                            slot * SparseScalarField3D::BRICK_VOLUME +
+                            static_cast<uint32_t>((x - x0) + BRICK_SIZE * ((y - y0) + BRICK_SIZE * (z - z0)))
+                        });
+                        indexed = true;
+                    }
+                }
+            }
+            if (indexed) bricks.push_back(brick);
+        }
+
+        byMin.reserve(intervals.size());
+        byMax.reserve(intervals.size());
+        build(intervals, 0, intervals.size());
+    }
+
+    // Ids of the cells whose corners lie on both sides of the isovalue, ascending
+    void query(float isovalue, std::vector<uint32_t> &cells) const {
+        // The tree yields the cells in value order, they are put back in brick order through one bit per
+        // cell of every indexed brick rather than by sorting them
+        constexpr uint32_t WORDS = SparseScalarField3D::BRICK_VOLUME / 64;
+        std::vector<uint64_t> hits(bricks.size() * WORDS, 0);
+        auto hit = [&hits](uint32_t cell) { hits[cell >> 6] |= uint64_t{1} << (cell & 63); };
+
+        for (uint32_t node = nodes.empty() ? NONE : 0; node != NONE;) {
+            const Node &n = nodes[node];
+            if (isovalue < n.center) {
+                // Every interval of the node reaches above the center, only the minimum decides
+                for (uint32_t i = n.begin; i < n.end && byMin[i].value < isovalue; ++i) hit(byMin[i].cell);
+                node = n.left;
+            } else {
+                for (uint32_t i = n.begin; i < n.end && byMax[i].value >= isovalue; ++i) hit(byMax[i].cell);
+                node = n.right;
+            }
+        }
+
+        cells.clear();
+        for (std::size_t word = 0; word < hits.size(); ++word) {
+            uint64_t bits = hits[word];
+            const uint32_t base = bricks[word / WORDS] * SparseScalarField3D::BRICK_VOLUME +
+                                  static_cast<uint32_t>(word % WORDS * 64);
+            while (bits) {
+                cells.push_back(base + std::countr_zero(bits));
+                bits &= bits - 1;
+            }
+        }
+    }
+
+    [[nodiscard]] std::size_t cellCount() const { return byMin.size(); }
+
+    [[nodiscard]] std::size_t bytes() const {
+        return (byMin.size() + byMax.size()) * sizeof(Entry) + nodes.size() * sizeof(Node) +
+               bricks.size() * sizeof(uint32_t);
+    }
+
+private:
+    static constexpr uint32_t NONE = UINT32_MAX;
+
+    struct Interval {
+        float lo, hi;
+        uint32_t cell;
+    };
+
+    // Cells are slot * BRICK_VOLUME + local cell, bricks maps the slot to the brick
+    struct Entry {
+        float value;
+        uint32_t cell;
+    };
+
+    // The intervals containing the center, in byMin and byMax at [begin, end)
+    struct Node {
+        float center;
+        uint32_t begin, end;
+        uint32_t left, right;
+    };
+
+    // Splits at the median maximum. The interval that has it contains the center, so every node keeps at
+    // least one interval and both subtrees get at most half, the depth stays logarithmic.
+    uint32_t build(std::vector<Interval> &intervals, std::size_t begin, std::size_t end) {
+        if (begin == end) return NONE;
+
+        const auto first = intervals.begin() + static_cast<std::ptrdiff_t>(begin);
+        const auto last = intervals.begin() + static_cast<std::ptrdiff_t>(end);
+        const auto median = first + static_cast<std::ptrdiff_t>((end - begin) / 2);
+        std::nth_element(first, median, last, [](const Interval &a, const Interval &b) { return a.hi < b.hi; });
+        const float center = median->hi;
+
+        // Below the center | containing it | above it
+        const auto below = std::partition(first, last, [center](const Interval &i) { return i.hi < center; });
+        const auto above = std::partition(below, last, [center](const Interval &i) { return i.lo < center; });
+
+        const auto node = static_cast<uint32_t>(nodes.size());
+        nodes.push_back({center, static_cast<uint32_t>(byMin.size()), 0, NONE, NONE});
+        for (auto i = below; i != above; ++i) {
+            byMin.push_back({i->lo, i->cell});
+            byMax.push_back({i->hi, i->cell});
+        }
+        nodes[node].end = static_cast<uint32_t>(byMin.size());
+        std::sort(byMin.begin() + nodes[node].begin, byMin.end(),
+                  [](const Entry &a, const Entry &b) { return a.value < b.value; });
+        std::sort(byMax.begin() + nodes[node].begin, byMax.end(),
+                  [](const Entry &a, const Entry &b) { return a.value > b.value; });
+
+        const uint32_t left = build(intervals, begin, below - intervals.begin());
+        const uint32_t right = build(intervals, above - intervals.begin(), end);
+        nodes[node].left = left;
+        nodes[node].right = right;
+        return node;
+    }
+
+    std::vector<Node> nodes;
+    std::vector<Entry> byMin, byMax;
+    std::vector<uint32_t> bricks; // indexed bricks in ascending order, by slot
+};
+
+// Isosurface of a sparse field over the cells the index reports for the isovalue, the same mesh as
+// extractIsosurfaceSparse. Marching cubes only visits those cells, the dual methods mesh the bricks
+// holding them since a dual vertex needs the cells around it.
+inline IndexedMesh extractIsosurfaceIndexed(
+    const SparseScalarField3D &scalarField,
+    const SpanSpaceIndex &index,
+    float isovalue,
+    float cubeSize,
+    Hammock::ThreadPool &threadPool,
+    IsosurfaceMethod method = IsosurfaceMethod::MarchingCubes) {
+
+    std::vector<uint32_t> cells;
+    index.query(isovalue, cells);
+
+    // Runs of cells in the same brick
+    std::vector<uint32_t> bricks;
+    std::vector<std::size_t> runBegin;
+    for (std::size_t i = 0; i < cells.size(); ++i) {
+        const uint32_t brick = cells[i] / SparseScalarField3D::BRICK_VOLUME;
+        if (bricks.empty() || bricks.back() != brick) {
+            bricks.push_back(brick);
+            runBegin.push_back(i);
+        }
+    }
+    runBegin.push_back(cells.size());
+
+    if (method != IsosurfaceMethod::MarchingCubes) {
+        return meshBricks(bricks, threadPool, [&](uint32_t brick, IndexedMesh &out) {
+            meshBrickIndexed(scalarField, brick, isovalue, cubeSize, method, out);
+        });
+    }
+
+    std::vector<uint32_t> runs(bricks.size());
+    std::iota(runs.begin(), runs.end(), 0u);
+    return meshBricks(runs, threadPool, [&](uint32_t run, IndexedMesh &out) {
+        marchBrickIndexed(scalarField, bricks[run], isovalue, cubeSize, out, cells.data() + runBegin[run],
+                          runBegin[run + 1] - runBegin[run]);
+    });
+}
@@ -0,0 +1,295 @@
+#pragma once
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <vector>
+
+#include <hammock/core/ThreadPool.h>
+
+#include "MarchingCubes.h"
+#include "SparseScalarField3D.h"
+
+// Bricks of a sparse field that may hold cells with anything but background samples, in brick index
+// order. Those are the allocated bricks and the bricks right before them, whose cells reach into an
+// allocated brick.
+inline std::vector<uint32_t> candidateBricks(const SparseScalarField3D &scalarField) {
+    const uint32_t bricksX = scalarField.bricksX(), bricksY = scalarField.bricksY(), bricksZ = scalarField.bricksZ();
+    std::vector<uint64_t> candidates((scalarField.brickCount() + 63) / 64, 0);
+
+    scalarField.forEachAllocatedBrick([&](std::size_t brick) {
+        const uint32_t bx = brick % bricksX;
+        const uint32_t by = brick / bricksX % bricksY;
+        const uint32_t bz = brick / (static_cast<std::size_t>(bricksX) * bricksY);
+        for (uint32_t dz = 0; dz < 2 && dz <= bz; ++dz) {
+            for (uint32_t dy = 0; dy < 2 && dy <= by; ++dy) {
+                for (uint32_t dx = 0; dx < 2 && dx <= bx; ++dx) {
+                    const std::size_t candidate = scalarField.brickIndex(bx - dx, by - dy, bz - dz);
+                    candidates[candidate >> 6] |= uint64_t{1} << (candidate & 63);
+                }
+            }
+        }
+    });
+
+    std::vector<uint32_t> bricks;
+    for (std::size_t word = 0; word < candidates.size(); ++word) {
+        uint64_t bits = candidates[word];
+        while (bits) {
+            const auto brick = static_cast<uint32_t>(word * 64 + std::countr_zero(bits));
+            bits &= bits - 1;
+            if (brick / (bricksX * bricksY) < bricksZ) bricks.push_back(brick);
+        }
+    }
+    return bricks;
+}
+
+// Bricks of a sparse field whose cells may intersect the isovalue, in brick index order.
+// A brick full of background samples never produces triangles, so only the candidate bricks are
+// checked. Candidates whose value range does not straddle the isovalue are skipped.
+inline std::vector<uint32_t> activeBricks(const SparseScalarField3D &scalarField, float isovalue) {
+    const uint32_t bricksX = scalarField.bricksX(), bricksY = scalarField.bricksY();
+    std::vector<uint32_t> active;
+    for (const uint32_t brick: candidateBricks(scalarField)) {
+        // A cell has index 0 or 255 unless the range contains values on both sides of the isovalue
+        float lo, hi;
+        scalarField.cellRange(brick % bricksX, brick / bricksX % bricksY, brick / (bricksX * bricksY), lo, hi);
+        if (lo < isovalue && hi >= isovalue) {
+            active.push_back(brick);
+        }
+    }
+    return active;
+}
+
+// Dense copy of one brick with the samples around it that its cells and gradients read, by default one
+// sample before and two after the brick along every axis. Reads are then plain array accesses instead of
+// brick lookups. Coordinates stay global, the field size is kept for the gradient border handling.
+template<int Before = 1, int After = 2>
+class BrickView {
+public:
+    static constexpr int BEFORE = Before;
+    static constexpr int SIZE = SparseScalarField3D::BRICK_SIZE + Before + After;
+
+    BrickView(const SparseScalarField3D &scalarField, uint32_t brick)
+        : nx(scalarField.sizeX()), ny(scalarField.sizeY()), nz(scalarField.sizeZ()) {
+        constexpr int BRICK_SIZE = SparseScalarField3D::BRICK_SIZE;
+        const uint32_t bricksX = scalarField.bricksX(), bricksY = scalarField.bricksY();
+        origin[0] = static_cast<int>(brick % bricksX * BRICK_SIZE) - BEFORE;
+        origin[1] = static_cast<int>(brick / bricksX % bricksY * BRICK_SIZE) - BEFORE;
+        origin[2] = static_cast<int>(brick / (bricksX * bricksY) * BRICK_SIZE) - BEFORE;
+
+        const float background = scalarField.backgroundValue();
+        for (int z = 0; z < SIZE; ++z) {
+            const int gz = origin[2] + z;
+            for (int y = 0; y < SIZE; ++y) {
+                const int gy = origin[1] + y;
+                float *row = values + (z * SIZE + y) * SIZE;
+                if (gy < 0 || gz < 0 || gy >= static_cast<int>(ny) || gz >= static_cast<int>(nz)) {
+                    std::fill_n(row, SIZE, background);
+                    continue;
+                }
+
+                // The row spans at most three bricks, copy it brick by brick
+                for (int x = 0; x < SIZE;) {
+                    const int gx = origin[0] + x;
+                    const int runEnd = std::min(SIZE, x + BRICK_SIZE - (((gx % BRICK_SIZE) + BRICK_SIZE) % BRICK_SIZE));
+                    if (gx < 0 || gx >= static_cast<int>(nx)) {
+                        std::fill(row + x, row + runEnd, background);
+                    } else {
+                        const float *data = scalarField.brickData(scalarField.brickIndex(
+                            gx >> SparseScalarField3D::BRICK_SHIFT, gy >> SparseScalarField3D::BRICK_SHIFT,
+                            gz >> SparseScalarField3D::BRICK_SHIFT));
+                        if (data) {
+                            const float *src = data + (gx & (BRICK_SIZE - 1)) +
+                                               ((gy & (BRICK_SIZE - 1)) + (gz & (BRICK_SIZE - 1)) * BRICK_SIZE) *
+                                               BRICK_SIZE;
+                            std::copy(src, src + (runEnd - x), row + x);
+                        } else {
+                            std::fill(row + x, row + runEnd, background);
+                        }
+                    }
+                    x = runEnd;
+                }
+            }
+        }
+    }
+
+    [[nodiscard]] uint32_t sizeX() const { return nx; }
+    [[nodiscard]] uint32_t sizeY() const { return ny; }
+    [[nodiscard]] uint32_t sizeZ() const { return nz; }
+
+    [[nodiscard]] float at(uint32_t x, uint32_t y, uint32_t z) const {
+        return values[local(x, y, z)];
+    }
+
+    // Samples (x, y, z) to the end of the view along x
+    [[nodiscard]] const float *row(uint32_t x, uint32_t y, uint32_t z) const {
+        return values + local(x, y, z);
+    }
+
+    void cellCorners(uint32_t x, uint32_t y, uint32_t z, float corners[8]) const {
+        const float *p = values + local(x, y, z);
+        const float *pz = p + SIZE * SIZE;
+        corners[0] = p[0];
+        corners[1] = p[1];
+        corners[2] = p[SIZE + 1];
+        corners[3] = p[SIZE];
+        corners[4] = pz[0];
+        corners[5] = pz[1];
+        corners[6] = pz[SIZE + 1];
+        corners[7] = pz[SIZE];
+    }
+
+private:
+    [[nodiscard]] int local(uint32_t x, uint32_t y, uint32_t z) const {
+        return (static_cast<int>(x) - origin[0]) +
+               ((static_cast<int>(y) - origin[1]) + (static_cast<int>(z) - origin[2]) * SIZE) * SIZE;
+    }
+
+    uint32_t nx, ny, nz;
+    int origin[3];
+    float values[SIZE * SIZE * SIZE];
+};
+
+// Marches the cells of one brick and appends an indexed mesh to out. Vertices are shared within the
+// brick, vertices on the faces between two bricks are duplicated.
+// If cells is set only those cells are marched, given as x + BRICK_SIZE * (y + BRICK_SIZE * z) relative
+// to the brick in ascending order. Bits above BRICK_VOLUME are ignored.
+inline void marchBrickIndexed(const SparseScalarField3D &scalarField, uint32_t brick, float isovalue,
+                              float cubeSize, IndexedMesh &out, const uint32_t *cells = nullptr,
+                              std::size_t cellCount = 0) {
+    constexpr uint32_t INVALID = UINT32_MAX;
+    constexpr int POINTS = SparseScalarField3D::BRICK_SIZE + 1;
+    // Axis of every edge (0 = x, 1 = y, 2 = z), the cache slot is its lower grid point
+    static constexpr int edgeAxis[12] = {0, 1, 0, 1, 0, 1, 0, 1, 2, 2, 2, 2};
+
+    const uint32_t bricksX = scalarField.bricksX(), bricksY = scalarField.bricksY();
+    const int x0 = static_cast<int>(brick % bricksX * SparseScalarField3D::BRICK_SIZE);
+    const int y0 = static_cast<int>(brick / bricksX % bricksY * SparseScalarField3D::BRICK_SIZE);
+    const int z0 = static_cast<int>(brick / (bricksX * bricksY) * SparseScalarField3D::BRICK_SIZE);
+    const int x1 = std::min<int>(x0 + SparseScalarField3D::BRICK_SIZE, scalarField.sizeX() - 1);
+    const int y1 = std::min<int>(y0 + SparseScalarField3D::BRICK_SIZE, scalarField.sizeY() - 1);
+    const int z1 = std::min<int>(z0 + SparseScalarField3D::BRICK_SIZE, scalarField.sizeZ() - 1);
+
+    const BrickView<> view(scalarField, brick);
+
+    uint32_t edgeCache[3][POINTS * POINTS * POINTS];
+    std::fill_n(&edgeCache[0][0], 3 * POINTS * POINTS * POINTS, INVALID);
+
+    auto marchCell = [&](int x, int y, int z, const float v[8], int cubeIndex) {
+        uint32_t edgeVertex[12];
+        for (int e = 0; e < 12; ++e) {
+            if (!(edgeTable[cubeIndex] & (1 << e))) continue;
+
+            const int *lower = cornerOffset[edgeCorners[e][0]];
+            const int point = (x - x0 + lower[0]) + POINTS * ((y - y0 + lower[1]) + POINTS * (z - z0 + lower[2]));
+            uint32_t &cached = edgeCache[edgeAxis[e]][point];
+            if (cached == INVALID) {
+                cached = static_cast<uint32_t>(out.vertices.size());
+                out.vertices.push_back(createEdgeVertex(view, x, y, z, e, v, isovalue, cubeSize));
+            }
+            edgeVertex[e] = cached;
+        }
+
+        for (int i = 0; triTable[cubeIndex][i] != -1; i += 3) {
+            out.indices.push_back(edgeVertex[triTable[cubeIndex][i]]);
+            out.indices.push_back(edgeVertex[triTable[cubeIndex][i + 1]]);
+            out.indices.push_back(edgeVertex[triTable[cubeIndex][i + 2]]);
+        }
+    };
+
+    if (cells) {
+        constexpr uint32_t MASK = SparseScalarField3D::BRICK_SIZE - 1;
+        for (std::size_t i = 0; i < cellCount; ++i) {
+            const uint32_t local = cells[i] % SparseScalarField3D::BRICK_VOLUME;
+            const int x = x0 + static_cast<int>(local & MASK);
+            const int y = y0 + static_cast<int>(local >> SparseScalarField3D::BRICK_SHIFT & MASK);
+            const int z = z0 + static_cast<int>(local >> 2 * SparseScalarField3D::BRICK_SHIFT);
+
+            float v[8];
+            view.cellCorners(x, y, z, v);
+            int cubeIndex = 0;
+            for (int c = 0; c < 8; ++c) {
+                if (v[c] < isovalue) cubeIndex |= 1 << c;
+            }
+            if (cubeIndex != 0 && cubeIndex != 255) marchCell(x, y, z, v, cubeIndex);
+        }
+        return;
+    }
+
+    int activeCells[SparseScalarField3D::BRICK_SIZE];
+    uint8_t cubeIndices[SparseScalarField3D::BRICK_SIZE];
+
+    for (int z = z0; z < z1; ++z) {
+        for (int y = y0; y < y1; ++y) {
+            const int activeCount = CellClassifier::classifyRow(
+                view.row(x0, y, z), view.row(x0, y + 1, z), view.row(x0, y, z + 1), view.row(x0, y + 1, z + 1),
+                x1 - x0, isovalue, activeCells, cubeIndices);
+
+            for (int c = 0; c < activeCount; ++c) {
+                const int x = x0 + activeCells[c];
+                float v[8];
+                view.cellCorners(x, y, z, v);
+                marchCell(x, y, z, v, cubeIndices[c]);
+            }
+        }
+    }
+}
+
+// Meshes every brick with meshBrick(brick, out) and concatenates the brick meshes. The bricks are split
+// into contiguous runs, one per thread, and merged in order, so the result does not depend on the
+// thread count.
+template<typename MeshBrick>
+inline IndexedMesh meshBricks(const std::vector<uint32_t> &bricks, Hammock::ThreadPool &threadPool,
+                              const MeshBrick &meshBrick) {
+    const auto threadCount = static_cast<uint32_t>(threadPool.threads.size());
+    const uint32_t runCount = std::max(1u, std::min(static_cast<uint32_t>(bricks.size()), threadCount));
+
+    std::vector<IndexedMesh> runMeshes(runCount);
+    threadPool.parallelFor(runCount, [&](uint32_t first, uint32_t last) {
+        for (uint32_t run = first; run < last; ++run) {
+            const std::size_t begin = bricks.size() * run / runCount, end = bricks.size() * (run + 1) / runCount;
+            for (std::size_t i = begin; i < end; ++i) {
+                meshBrick(bricks[i], runMeshes[run]);
+            }
+        }
+    });
+    if (runCount == 1) {
+        return std::move(runMeshes[0]);
+    }
+
+    std::vector<std::size_t> vertexOffsets(runCount + 1, 0), indexOffsets(runCount + 1, 0);
+    for (uint32_t i = 0; i < runCount; ++i) {
+        vertexOffsets[i + 1] = vertexOffsets[i] + runMeshes[i].vertices.size();
+        indexOffsets[i + 1] = indexOffsets[i] + runMeshes[i].indices.size();
+    }
+
+    IndexedMesh mesh;
+    mesh.vertices.resize(vertexOffsets[runCount]);
+    mesh.indices.resize(indexOffsets[runCount]);
+    threadPool.parallelFor(runCount, [&](uint32_t first, uint32_t last) {
+        for (uint32_t i = first; i < last; ++i) {
+            const IndexedMesh &run = runMeshes[i];
+            const auto base = static_cast<uint32_t>(vertexOffsets[i]);
+            std::copy(run.vertices.begin(), run.vertices.end(), mesh.vertices.begin() + vertexOffsets[i]);
+            std::transform(run.indices.begin(), run.indices.end(), mesh.indices.begin() + indexOffsets[i],
+                           [base](uint32_t index) { return index + base; });
+        }
+    });
+
+    return mesh;
+}
+
+// Indexed marching cubes over the active bricks of a sparse field
+inline IndexedMesh marchingCubesSparse(
+    const SparseScalarField3D &scalarField,
+    float isovalue,
+    float cubeSize,
+    Hammock::ThreadPool &threadPool) {
+
+    if (scalarField.sizeX() < 2 || scalarField.sizeY() < 2 || scalarField.sizeZ() < 2) {
+        return {};
+    }
+
+    return meshBricks(activeBricks(scalarField, isovalue), threadPool, [&](uint32_t brick, IndexedMesh &out) {
+        marchBrickIndexed(scalarField, brick, isovalue, cubeSize, out);
+    });
+}
@@ -0,0 +1,228 @@
+#pragma once
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <cstddef>
+#include <limits>
+#include <vector>
+
+// Sparse scalar field made of 8^3 bricks that are only allocated once something is written to them.
+//
+// Unallocated bricks read as the background value. Allocated bricks are tracked in an occupancy
+// bitmask and carry the min/max of their samples, which lets the extractor skip every brick whose
+// cells cannot cross the isovalue. Memory and meshing time then scale with the area of the surface
+// instead of the volume of the domain.
+//
+// Samples inside a brick are x-fastest. Bricks at the far border may stick out of the field, their
+// samples past the end are never read.
+class SparseScalarField3D {
+public:
+    static constexpr uint32_t BRICK_SIZE = 8;
+    static constexpr uint32_t BRICK_SHIFT = 3;
+    static constexpr uint32_t BRICK_VOLUME = BRICK_SIZE * BRICK_SIZE * BRICK_SIZE;
+    static constexpr uint32_t INVALID_BRICK = UINT32_MAX;
+
+    SparseScalarField3D() = default;
+
+    SparseScalarField3D(uint32_t nx, uint32_t ny, uint32_t nz, float background = 0.0f)
+        : nx(nx), ny(ny), nz(nz), background(background) {
+        bricks[0] = (nx + BRICK_SIZE - 1) >> BRICK_SHIFT;
+        bricks[1] = (ny + BRICK_SIZE - 1) >> BRICK_SHIFT;
+        bricks[2] = (nz + BRICK_SIZE - 1) >> BRICK_SHIFT;
+        slots.assign(brickCount(), INVALID_BRICK);
+        occupancy.assign((brickCount() + 63) / 64, 0);
+    }
+
+    // Not copyable, fields can be large
+    SparseScalarField3D(const SparseScalarField3D &) = delete;
+
+    SparseScalarField3D &operator=(const SparseScalarField3D &) = delete;
+
+    SparseScalarField3D(SparseScalarField3D &&) noexcept = default;
+
+    SparseScalarField3D &operator=(SparseScalarField3D &&) noexcept = default;
+
+    [[nodiscard]] uint32_t sizeX() const { return nx; }
+    [[nodiscard]] uint32_t sizeY() const { return ny; }
+    [[nodiscard]] uint32_t sizeZ() const { return nz; }
+    [[nodiscard]] bool empty() const { return nx == 0 || ny == 0 || nz == 0; }
+    [[nodiscard]] float backgroundValue() const { return background; }
+
+    [[nodiscard]] uint32_t bricksX() const { return bricks[0]; }
+    [[nodiscard]] uint32_t bricksY() const { return bricks[1]; }
+    [[nodiscard]] uint32_t bricksZ() const { return bricks[2]; }
+    [[nodiscard]] std::size_t brickCount() const { return static_cast<std::size_t>(bricks[0]) * bricks[1] * bricks[2]; }
+    [[nodiscard]] std::size_t allocatedBricks() const { return brickMin.size(); }
+
+    [[nodiscard]] std::size_t brickIndex(uint32_t bx, uint32_t by, uint32_t bz) const {
+        return bx + bricks[0] * (by + static_cast<std::size_t>(bricks[1]) * bz);
+    }
+
+    [[nodiscard]] bool isAllocated(std::size_t brick) const {
+        return (occupancy[brick >> 6] >> (brick & 63)) & 1;
+    }
+
+    // Bytes of brick data and bookkeeping
+    [[nodiscard]] std::size_t bytes() const {
+        return values.size() * sizeof(float) + slots.size() * sizeof(uint32_t) +
+               occupancy.size() * sizeof(uint64_t) + (brickMin.size() + brickMax.size()) * sizeof(float);
+    }
+
+    // Calls func(brick) for every allocated brick in index order
+    template<typename Func>
+    void forEachAllocatedBrick(Func &&func) const {
+        for (std::size_t word = 0; word < occupancy.size(); ++word) {
+            uint64_t bits = occupancy[word];
+            while (bits) {
+                func(word * 64 + std::countr_zero(bits));
+                bits &= bits - 1;
+            }
+        }
+    }
+
+    // Allocates the brick filled with the background value, not thread safe
+    void allocateBrick(std::size_t brick) {
+        if (isAllocated(brick)) return;
+        slots[brick] = static_cast<uint32_t>(brickMin.size());
+        occupancy[brick >> 6] |= uint64_t{1} << (brick & 63);
+        values.resize(values.size() + BRICK_VOLUME, background);
+        brickMin.push_back(background);
+        brickMax.push_back(background);
+    }
+
+    // Samples of an allocated brick, nullptr if the brick is not allocated
+    [[nodiscard]] float *brickData(std::size_t brick) {
+        return slots[brick] == INVALID_BRICK ? nullptr : values.data() + slots[brick] * std::size_t{BRICK_VOLUME};
+    }
+
+    [[nodiscard]] const float *brickData(std::size_t brick) const {
+        return slots[brick] == INVALID_BRICK ? nullptr : values.data() + slots[brick] * std::size_t{BRICK_VOLUME};
+    }
+
+    // Write access, allocates the brick on demand. Allocation is not thread safe, concurrent writers
+    // must only touch bricks that are already allocated.
+    [[nodiscard]] float &at(uint32_t x, uint32_t y, uint32_t z) {
+        const std::size_t brick = brickIndex(x >> BRICK_SHIFT, y >> BRICK_SHIFT, z >> BRICK_SHIFT);
+        allocateBrick(brick);
+        return brickData(brick)[localIndex(x, y, z)];
+    }
+
+    [[nodiscard]] float at(uint32_t x, uint32_t y, uint32_t z) const {
+        const float *data = brickData(brickIndex(x >> BRICK_SHIFT, y >> BRICK_SHIFT, z >> BRICK_SHIFT));
+        return data ? data[localIndex(x, y, z)] : background;
+    }
+
+    // Fetches the 8 corners of cell (x, y, z) in marching cubes corner order
+    void cellCorners(uint32_t x, uint32_t y, uint32_t z, float corners[8]) const {
+        constexpr uint32_t LAST = BRICK_SIZE - 1;
+        if ((x & LAST) != LAST && (y & LAST) != LAST && (z & LAST) != LAST) {
+            // The whole cell lies in one brick
+            const float *data = brickData(brickIndex(x >> BRICK_SHIFT, y >> BRICK_SHIFT, z >> BRICK_SHIFT));
+            if (!data) {
+                std::fill_n(corners, 8, background);
+                return;
+            }
+            const float *p = data + localIndex(x, y, z);
+            const float *pz = p + BRICK_SIZE * BRICK_SIZE;
+            corners[0] = p[0];
+            corners[1] = p[1];
+            corners[2] = p[BRICK_SIZE + 1];
+            corners[3] = p[BRICK_SIZE];
+            corners[4] = pz[0];
+            corners[5] = pz[1];
+            corners[6] = pz[BRICK_SIZE + 1];
+            corners[7] = pz[BRICK_SIZE];
+            return;
+        }
+        corners[0] = at(x, y, z);
+        corners[1] = at(x + 1, y, z);
+        corners[2] = at(x + 1, y + 1, z);
+        corners[3] = at(x, y + 1, z);
+        corners[4] = at(x, y, z + 1);
+        corners[5] = at(x + 1, y, z + 1);
+        corners[6] = at(x + 1, y + 1, z + 1);
+        corners[7] = at(x, y + 1, z + 1);
+    }
+
+    // Recomputes the min/max of every allocated brick, call after writing
+    void updateRanges() {
+        forEachAllocatedBrick([this](std::size_t brick) {
+            const uint32_t bx = brick % bricks[0];
+            const uint32_t by = brick / bricks[0] % bricks[1];
+            const uint32_t bz = brick / (static_cast<std::size_t>(bricks[0]) * bricks[1]);
+            const uint32_t ex = std::min(BRICK_SIZE, nx - (bx << BRICK_SHIFT));
+            const uint32_t ey = std::min(BRICK_SIZE, ny - (by << BRICK_SHIFT));
+            const uint32_t ez = std::min(BRICK_SIZE, nz - (bz << BRICK_SHIFT));
+
+            const float *data = brickData(brick);
+            float lo = std::numeric_limits<float>::max(), hi = std::numeric_limits<float>::lowest();
+            for (uint32_t z = 0; z < ez; ++z) {
+                for (uint32_t y = 0; y < ey; ++y) {
+                    const float *row = data + (z * BRICK_SIZE + y) * BRICK_SIZE;
+                    for (uint32_t x = 0; x < ex; ++x) {
+                        lo = std::min(lo, row[x]);
+                        hi = std::max(hi, row[x]);
+                    }
+                }
+            }
+            brickMin[slots[brick]] = lo;
+            brickMax[slots[brick]] = hi;
+        });
+    }
+
+    // Writes every sample to out, x-fastest without padding, unallocated bricks as the background value
+    void copyDense(float *out) const {
+        std::fill_n(out, static_cast<std::size_t>(nx) * ny * nz, background);
+        forEachAllocatedBrick([this, out](std::size_t brick) {
+            const uint32_t bx = brick % bricks[0];
+            const uint32_t by = brick / bricks[0] % bricks[1];
+            const uint32_t bz = brick / (static_cast<std::size_t>(bricks[0]) * bricks[1]);
+            const uint32_t ex = std::min(BRICK_SIZE, nx - (bx << BRICK_SHIFT));
+            const uint32_t ey = std::min(BRICK_SIZE, ny - (by << BRICK_SHIFT));
+            const uint32_t ez = std::min(BRICK_SIZE, nz - (bz << BRICK_SHIFT));
+
+            const float *data = brickData(brick);
+            for (uint32_t z = 0; z < ez; ++z) {
+                for (uint32_t y = 0; y < ey; ++y) {
+                    const std::size_t first = (bx << BRICK_SHIFT) + nx * (
+                                                  (by << BRICK_SHIFT) + y + static_cast<std::size_t>(ny) * (
+                                                      (bz << BRICK_SHIFT) + z));
+                    std::copy_n(data + (z * BRICK_SIZE + y) * BRICK_SIZE, ex, out + first);
+                }
+            }
+        });
+    }
+
+    // Value range of all samples read by the cells of brick (bx, by, bz). Cells reach one sample into
+    // the next brick along every axis, so the forward neighbours are included.
+    void cellRange(uint32_t bx, uint32_t by, uint32_t bz, float &lo, float &hi) const {
+        lo = std::numeric_limits<float>::max();
+        hi = std::numeric_limits<float>::lowest();
+        for (uint32_t dz = 0; dz < 2; ++dz) {
+            for (uint32_t dy = 0; dy < 2; ++dy) {
+                for (uint32_t dx = 0; dx < 2; ++dx) {
+                    const uint32_t x = bx + dx, y = by + dy, z = bz + dz;
+                    if (x >= bricks[0] || y >= bricks[1] || z >= bricks[2]) continue;
+                    const uint32_t slot = slots[brickIndex(x, y, z)];
+                    lo = std::min(lo, slot == INVALID_BRICK ? background : brickMin[slot]);
+                    hi = std::max(hi, slot == INVALID_BRICK ? background : brickMax[slot]);
+                }
+            }
+        }
+    }
+
+private:
+    static uint32_t localIndex(uint32_t x, uint32_t y, uint32_t z) {
+        constexpr uint32_t MASK = BRICK_SIZE - 1;
+        return (x & MASK) + ((y & MASK) << BRICK_SHIFT) + ((z & MASK) << (2 * BRICK_SHIFT));
+    }
+
+    uint32_t nx = 0, ny = 0, nz = 0;
+    uint32_t bricks[3] = {0, 0, 0};
+    float background = 0.0f;
+
+    std::vector<uint32_t> slots; // brick index -> slot of its data, INVALID_BRICK if not allocated
+    std::vector<uint64_t> occupancy;
+    std::vector<float> values; // BRICK_VOLUME samples per allocated brick
+    std::vector<float> brickMin, brickMax; // per slot
+};
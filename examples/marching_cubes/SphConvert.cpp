@@ -0,0 +1,131 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <hammock/utils/ArgParser.h>
+#include <hammock/utils/Filesystem.h>
+#include <hammock/utils/Logger.h>
+
+#include "Particle.h"
+#include "SphSequence.h"
+
+// Packs a directory of .bin particle frames into one compressed sequence file the marching cubes example
+// picks up from data/sph/sequence.hsph. Frames are taken in file name order.
+
+namespace {
+    template<typename T>
+    T argumentOr(const Hammock::ArgParser &parser, const std::string &name, T fallback) {
+        try {
+            return parser.get<T>(name);
+        } catch (const std::invalid_argument &) {
+            return fallback;
+        }
+    }
+
+    double megabytes(uint64_t bytes) {
+        return static_cast<double>(bytes) / (1024.0 * 1024.0);
+    }
+}
+
+int main(int argc, char *argv[]) {
+    Hammock::ArgParser parser;
+    parser.addArgument<std::string>("input", "Directory with the .bin frames (default ../../../data/sph/)");
+    parser.addArgument<std::string>("output", "Sequence file to write (default <input>/sequence.hsph)");
+    parser.addArgument<uint32_t>("keyframe-interval", "Frames between keyframes, bounds the cost of a seek (default 16)");
+    parser.addArgument<int>("level", "Deflate level from 1 to 9 (default 1)");
+    parser.addArgument<uint32_t>("mantissa-bits", "Mantissa bits kept of every half, 10 is lossless (default 10)");
+    parser.addArgument<std::string>("skip-verify", "Do not decode the written file and compare it with the input");
+
+    try {
+        parser.parse(argc, argv);
+    } catch (const std::exception &e) {
+        Hammock::Logger::log(Hammock::LOG_LEVEL_ERROR, "%s\n", e.what());
+        parser.printHelp();
+        return EXIT_FAILURE;
+    }
+
+    std::string input = argumentOr<std::string>(parser, "input", "../../../data/sph/");
+    if (!input.empty() && input.back() != '/') input += '/';
+    const std::string output = argumentOr<std::string>(parser, "output", input + "sequence.hsph");
+    SphSequenceWriter::Settings settings{};
+    settings.keyframeInterval = std::max(1u, argumentOr<uint32_t>(parser, "keyframe-interval", 16));
+    settings.level = std::clamp(argumentOr<int>(parser, "level", 1), 1, 9);
+    settings.mantissaBits = std::min(argumentOr<uint32_t>(parser, "mantissa-bits", 10), 10u);
+    const bool verify = argumentOr<std::string>(parser, "skip-verify", "false") != "true";
+
+    std::vector<std::string> files;
+    for (const auto &file: Hammock::Filesystem::ls(input)) {
+        if (file.contains(".bin")) files.push_back(file);
+    }
+    std::ranges::sort(files);
+    if (files.empty()) {
+        Hammock::Logger::log(Hammock::LOG_LEVEL_ERROR, "No .bin frames in %s\n", input.c_str());
+        return EXIT_FAILURE;
+    }
+
+    Hammock::ThreadPool threadPool;
+    threadPool.setThreadCount(std::min<uint32_t>(std::max(1u, std::thread::hardware_concurrency()),
+                                                 SphSequenceFormat::ATTRIBUTES));
+
+    const auto start = std::chrono::steady_clock::now();
+    uint64_t inputBytes = 0;
+    uint64_t outputBytes = 0;
+    try {
+        SphSequenceWriter writer(output, settings);
+        std::vector<Particle> particles;
+        for (const std::string &file: files) {
+            if (!loadParticles(file, particles)) {
+                Hammock::Logger::log(Hammock::LOG_LEVEL_ERROR, "Failed to load particles from %s\n", file.c_str());
+                return EXIT_FAILURE;
+            }
+            if (!writer.append(particles.data(), particles.size(), threadPool)) {
+                Hammock::Logger::log(Hammock::LOG_LEVEL_ERROR, "Failed to write %s\n", output.c_str());
+                return EXIT_FAILURE;
+            }
+            inputBytes += particles.size() * sizeof(Particle);
+        }
+        if (!writer.finish()) {
+            Hammock::Logger::log(Hammock::LOG_LEVEL_ERROR, "Failed to write %s\n", output.c_str());
+            return EXIT_FAILURE;
+        }
+        outputBytes = writer.bytesWritten();
+    } catch (const std::exception &e) {
+        Hammock::Logger::log(Hammock::LOG_LEVEL_ERROR, "%s\n", e.what());
+        return EXIT_FAILURE;
+    }
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    Hammock::Logger::log(Hammock::LOG_LEVEL_DEBUG,
+                         "Wrote %zu frames to %s, %.1f MB of particles to %.1f MB (%.2fx) in %.1f s\n",
+                         files.size(), output.c_str(), megabytes(inputBytes), megabytes(outputBytes),
+                         outputBytes ? static_cast<double>(inputBytes) / static_cast<double>(outputBytes) : 0.0,
+                         seconds);
+
+    if (!verify) return EXIT_SUCCESS;
+
+    // Frames are compared in order, rounded mantissas are only checked for the particle count
+    try {
+        SphSequence sequence(output);
+        std::vector<Particle> expected, decoded;
+        for (std::size_t frame = 0; frame < files.size(); ++frame) {
+            if (!loadParticles(files[frame], expected) || !sequence.read(frame, decoded) ||
+                decoded.size() != expected.size() ||
+                (settings.mantissaBits >= 10 &&
+                 std::memcmp(decoded.data(), expected.data(), expected.size() * sizeof(Particle)) != 0)) {
+                Hammock::Logger::log(Hammock::LOG_LEVEL_ERROR, "Frame %zu of %s does not match %s\n", frame,
+                                     output.c_str(), files[frame].c_str());
+                return EXIT_FAILURE;
+            }
+        }
+    } catch (const std::exception &e) {
+        Hammock::Logger::log(Hammock::LOG_LEVEL_ERROR, "%s\n", e.what());
+        return EXIT_FAILURE;
+    }
+    Hammock::Logger::log(Hammock::LOG_LEVEL_DEBUG, "Verified %zu frames\n", files.size());
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,338 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <miniz.h>
+#include <hammock/core/ThreadPool.h>
+#include <hammock/utils/MappedFile.h>
+
+#include "Particle.h"
+
+// A whole SPH sequence in one file, every frame compressed and reachable through an index at the end.
+//
+//   Header | frame 0 | frame 1 | ... | FrameEntry[frameCount]
+//
+// A frame holds one deflate stream per Particle attribute. The halves are mapped to integers that keep
+// their order, predicted and the zigzag coded residuals are split into a plane of low and one of high
+// bytes, which leaves the high plane almost all zeros for deflate. Keyframes predict a particle from the
+// one before it, the other frames from the same particle in the previous frame, so particles have to keep
+// their order between frames. A frame with a different particle count than its predecessor is always a
+// keyframe.
+//
+// Lossless unless the writer drops mantissa bits, which rounds the halves to a coarser grid first.
+namespace SphSequenceFormat {
+    constexpr char MAGIC[8] = {'H', 'M', 'C', 'K', 'S', 'P', 'H', '1'};
+    constexpr uint32_t VERSION = 1;
+    constexpr std::size_t ATTRIBUTES = sizeof(Particle) / sizeof(uint16_t);
+
+    struct Header {
+        char magic[8];
+        uint32_t version;
+        uint32_t frameCount;
+        uint32_t keyframeInterval;
+        uint32_t mantissaBits; // kept of the 10 mantissa bits of a half
+        uint64_t indexOffset;
+    };
+
+    struct FrameEntry {
+        uint64_t offset;
+        uint32_t particleCount;
+        uint32_t keyframe;
+        uint32_t streamSizes[ATTRIBUTES]; // compressed, in attribute order
+        uint32_t reserved;
+    };
+
+    static_assert(sizeof(Header) == 32);
+    static_assert(sizeof(FrameEntry) == 56);
+
+    // Halves as integers in value order, -0 and +0 end up next to each other
+    inline uint16_t toOrdered(uint16_t half) {
+        return half & 0x8000u ? static_cast<uint16_t>(0x7fffu - (half & 0x7fffu)) : static_cast<uint16_t>(half | 0x8000u);
+    }
+
+    inline uint16_t fromOrdered(uint16_t ordered) {
+        return ordered & 0x8000u ? static_cast<uint16_t>(ordered & 0x7fffu) : static_cast<uint16_t>(0xffffu - ordered);
+    }
+
+    inline uint16_t zigzag(uint16_t residual) {
+        return static_cast<uint16_t>(residual << 1 ^ (residual & 0x8000u ? 0xffffu : 0u));
+    }
+
+    inline uint16_t unzigzag(uint16_t coded) {
+        return static_cast<uint16_t>(coded >> 1 ^ (coded & 1u ? 0xffffu : 0u));
+    }
+
+    // Rounds a half to the nearest value with only the given number of mantissa bits, ties to even.
+    // Infinities and NaNs are left alone and finite values never round up to infinity.
+    inline uint16_t roundMantissa(uint16_t half, uint32_t mantissaBits) {
+        if (mantissaBits >= 10 || (half & 0x7c00u) == 0x7c00u) return half;
+        const uint32_t dropped = 10 - mantissaBits;
+        const uint32_t mask = (1u << dropped) - 1;
+        const uint32_t rounded = (half + (mask >> 1) + (half >> dropped & 1u)) & ~mask;
+        if ((rounded & 0x7c00u) == 0x7c00u) return static_cast<uint16_t>(half & ~mask);
+        return static_cast<uint16_t>(rounded);
+    }
+}
+
+// Writes frames one after the other, the index and the final header are written by finish
+class SphSequenceWriter {
+public:
+    struct Settings {
+        uint32_t keyframeInterval = 16; // longest chain of frames a seek has to decode
+        int level = MZ_BEST_SPEED; // deflate level, 1 decodes as fast as 9 and encodes much faster
+        uint32_t mantissaBits = 10; // 10 is lossless
+    };
+
+    // Frames go to a temporary file that finish() renames to path, so an aborted capture never leaves a
+    // sequence behind that looks valid
+    SphSequenceWriter(const std::string &path, const Settings &settings)
+        : settings(settings), path(path), temporary(path + ".tmp") {
+        this->settings.keyframeInterval = std::max(1u, settings.keyframeInterval);
+        file = std::fopen(temporary.c_str(), "wb");
+        if (!file) throw std::runtime_error("Failed to create " + temporary);
+        SphSequenceFormat::Header header{};
+        std::fwrite(&header, sizeof(header), 1, file);
+        offset = sizeof(header);
+    }
+
+    ~SphSequenceWriter() {
+        if (file) {
+            std::fclose(file);
+            std::error_code error;
+            std::filesystem::remove(temporary, error);
+        }
+    }
+
+    SphSequenceWriter(const SphSequenceWriter &) = delete;
+
+    SphSequenceWriter &operator=(const SphSequenceWriter &) = delete;
+
+    // Compresses the attribute streams of a frame in parallel
+    bool append(const Particle *particles, std::size_t count, Hammock::ThreadPool &threadPool) {
+        using namespace SphSequenceFormat;
+        const bool keyframe = entries.size() % settings.keyframeInterval == 0 || count != previous[0].size();
+
+        std::array<std::vector<uint8_t>, ATTRIBUTES> streams;
+        auto encode = [&](std::size_t attribute) {
+            std::vector<uint16_t> &reference = previous[attribute];
+            if (keyframe) reference.resize(count);
+            std::vector<uint8_t> planes(count * 2);
+            uint16_t predicted = 0;
+            for (std::size_t i = 0; i < count; ++i) {
+                uint16_t half;
+                std::memcpy(&half, reinterpret_cast<const uint16_t *>(particles + i) + attribute, sizeof(half));
+                const uint16_t ordered = toOrdered(roundMantissa(half, settings.mantissaBits));
+                if (!keyframe) predicted = reference[i];
+                const uint16_t coded = zigzag(static_cast<uint16_t>(ordered - predicted));
+                planes[i] = static_cast<uint8_t>(coded);
+                planes[count + i] = static_cast<uint8_t>(coded >> 8);
+                predicted = ordered;
+                reference[i] = ordered;
+            }
+
+            mz_ulong size = mz_compressBound(static_cast<mz_ulong>(planes.size()));
+            streams[attribute].resize(size);
+            if (mz_compress2(streams[attribute].data(), &size, planes.data(), static_cast<mz_ulong>(planes.size()),
+                             settings.level) != MZ_OK) {
+                size = 0;
+            }
+            streams[attribute].resize(size);
+        };
+
+        threadPool.parallelFor(ATTRIBUTES, [&encode](uint32_t begin, uint32_t end) {
+            for (uint32_t attribute = begin; attribute < end; ++attribute) encode(attribute);
+        });
+
+        FrameEntry entry{offset, static_cast<uint32_t>(count), keyframe, {}, 0};
+        for (std::size_t attribute = 0; attribute < ATTRIBUTES; ++attribute) {
+            const std::vector<uint8_t> &stream = streams[attribute];
+            if (count > 0 && stream.empty()) return false;
+            if (std::fwrite(stream.data(), 1, stream.size(), file) != stream.size()) return false;
+            entry.streamSizes[attribute] = static_cast<uint32_t>(stream.size());
+            offset += stream.size();
+        }
+        entries.push_back(entry);
+        return true;
+    }
+
+    bool finish() {
+        using namespace SphSequenceFormat;
+        SphSequenceFormat::Header header{};
+        std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+        header.version = VERSION;
+        header.frameCount = static_cast<uint32_t>(entries.size());
+        header.keyframeInterval = settings.keyframeInterval;
+        header.mantissaBits = std::min(settings.mantissaBits, 10u);
+        header.indexOffset = offset;
+
+        const bool written = std::fwrite(entries.data(), sizeof(FrameEntry), entries.size(), file) == entries.size() &&
+                             std::fseek(file, 0, SEEK_SET) == 0 &&
+                             std::fwrite(&header, sizeof(header), 1, file) == 1;
+        const bool closed = std::fclose(file) == 0;
+        file = nullptr;
+
+        std::error_code error;
+        if (written && closed) {
+            std::filesystem::rename(temporary, path, error);
+            if (!error) return true;
+        }
+        std::filesystem::remove(temporary, error);
+        return false;
+    }
+
+    [[nodiscard]] uint64_t bytesWritten() const { return offset; }
+
+private:
+    Settings settings;
+    std::string path;
+    std::string temporary;
+    std::FILE *file = nullptr;
+    uint64_t offset = 0;
+    std::vector<SphSequenceFormat::FrameEntry> entries;
+    std::array<std::vector<uint16_t>, SphSequenceFormat::ATTRIBUTES> previous; // ordered values of the last frame
+};
+
+// Random access to the frames of a sequence file. The file is memory mapped, so only the frames that are
+// read are ever loaded from disk. The attributes decode in parallel, each one on its own chain from the
+// last keyframe. The last decoded frame is kept, so playing forward decodes every frame once and a seek
+// decodes at most keyframeInterval frames.
+class SphSequence {
+public:
+    explicit SphSequence(const std::string &path, uint32_t threadCount = SphSequenceFormat::ATTRIBUTES)
+        : file(path) {
+        using namespace SphSequenceFormat;
+        if (!file.isOpen() || file.size() < sizeof(Header)) throw std::runtime_error("Failed to open " + path);
+        Header header;
+        std::memcpy(&header, file.data(), sizeof(header));
+        if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.version != VERSION ||
+            header.indexOffset > file.size() ||
+            (file.size() - header.indexOffset) / sizeof(FrameEntry) < header.frameCount) {
+            throw std::runtime_error("Not an SPH sequence " + path);
+        }
+
+        entries.resize(header.frameCount);
+        std::memcpy(entries.data(), file.data() + header.indexOffset,
+                    entries.size() * sizeof(FrameEntry));
+        for (const FrameEntry &entry: entries) {
+            uint64_t size = 0;
+            for (const uint32_t streamSize: entry.streamSizes) size += streamSize;
+            if (entry.offset + size > header.indexOffset) throw std::runtime_error("Corrupt SPH sequence " + path);
+        }
+        if (!entries.empty() && !entries[0].keyframe) throw std::runtime_error("Corrupt SPH sequence " + path);
+        threadPool.setThreadCount(std::max(1u, std::min<uint32_t>(threadCount, ATTRIBUTES)));
+    }
+
+    [[nodiscard]] std::size_t frameCount() const { return entries.size(); }
+
+    [[nodiscard]] std::size_t particleCount(std::size_t frame) const { return entries[frame].particleCount; }
+
+    // Decodes a frame into float arrays, false if a stream is corrupt
+    bool read(std::size_t frame, ParticleArrays &particles) {
+        if (!decode(frame)) return false;
+
+        particles.resize(entries[frame].particleCount);
+        std::vector<float> *arrays[SphSequenceFormat::ATTRIBUTES] = {
+            &particles.positionX, &particles.positionY, &particles.positionZ,
+            &particles.velocityX, &particles.velocityY, &particles.velocityZ,
+            &particles.rho, &particles.pressure, &particles.radius
+        };
+        parallel([&](std::size_t attribute) {
+            std::vector<uint16_t> &halves = ordered[attribute];
+            std::vector<uint16_t> converted(halves.size());
+            std::ranges::transform(halves, converted.begin(), SphSequenceFormat::fromOrdered);
+            Hammock::halfToFloat(converted.data(), arrays[attribute]->data(), converted.size());
+            return true;
+        });
+        return true;
+    }
+
+    // Decodes a frame into the .bin record layout
+    bool read(std::size_t frame, std::vector<Particle> &particles) {
+        if (!decode(frame)) return false;
+
+        particles.resize(entries[frame].particleCount);
+        parallel([&](std::size_t attribute) {
+            for (std::size_t i = 0; i < particles.size(); ++i) {
+                const uint16_t half = SphSequenceFormat::fromOrdered(ordered[attribute][i]);
+                std::memcpy(reinterpret_cast<uint16_t *>(&particles[i]) + attribute, &half, sizeof(half));
+            }
+            return true;
+        });
+        return true;
+    }
+
+private:
+    // Brings the ordered values up to the given frame
+    bool decode(std::size_t frame) {
+        if (frame >= entries.size()) return false;
+
+        std::size_t first = frame;
+        while (!entries[first].keyframe) --first;
+        // Continue from the last decoded frame if it is on the way
+        if (decoded && *decoded >= first && *decoded <= frame) first = *decoded + 1;
+        if (first > frame) return true;
+
+        decoded.reset();
+        const bool ok = parallel([&](std::size_t attribute) {
+            std::vector<uint8_t> planes;
+            for (std::size_t f = first; f <= frame; ++f) {
+                if (!decodeStream(f, attribute, planes)) return false;
+            }
+            return true;
+        });
+        if (ok) decoded = frame;
+        return ok;
+    }
+
+    bool decodeStream(std::size_t frame, std::size_t attribute, std::vector<uint8_t> &planes) {
+        using namespace SphSequenceFormat;
+        const FrameEntry &entry = entries[frame];
+        const std::size_t count = entry.particleCount;
+        std::vector<uint16_t> &values = ordered[attribute];
+        if (entry.keyframe) values.resize(count);
+        else if (values.size() != count) return false;
+        if (count == 0) return true;
+
+        uint64_t offset = entry.offset;
+        for (std::size_t a = 0; a < attribute; ++a) offset += entry.streamSizes[a];
+        planes.resize(count * 2);
+        mz_ulong size = static_cast<mz_ulong>(planes.size());
+        if (mz_uncompress(planes.data(), &size, file.data() + offset,
+                          entry.streamSizes[attribute]) != MZ_OK || size != planes.size()) {
+            return false;
+        }
+
+        uint16_t predicted = 0;
+        for (std::size_t i = 0; i < count; ++i) {
+            if (!entry.keyframe) predicted = values[i];
+            const uint16_t coded = static_cast<uint16_t>(planes[i] | planes[count + i] << 8);
+            values[i] = static_cast<uint16_t>(predicted + unzigzag(coded));
+            predicted = values[i];
+        }
+        return true;
+    }
+
+    // Runs work for every attribute on the pool, true if all of them succeeded
+    template<typename Work>
+    bool parallel(const Work &work) {
+        std::array<bool, SphSequenceFormat::ATTRIBUTES> results{};
+        threadPool.parallelFor(SphSequenceFormat::ATTRIBUTES, [&](uint32_t begin, uint32_t end) {
+            for (uint32_t attribute = begin; attribute < end; ++attribute) results[attribute] = work(attribute);
+        });
+        return std::ranges::all_of(results, [](bool result) { return result; });
+    }
+
+    Hammock::MappedFile file;
+    std::vector<SphSequenceFormat::FrameEntry> entries;
+    Hammock::ThreadPool threadPool;
+    std::array<std::vector<uint16_t>, SphSequenceFormat::ATTRIBUTES> ordered; // values of the decoded frame
+    std::optional<std::size_t> decoded;
+};
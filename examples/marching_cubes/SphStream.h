@@ -0,0 +1,172 @@
+#pragma once
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <hammock/utils/Logger.h>
+
+#include "MarchingCubes.h"
+#include "Particle.h"
+#include "SphSequence.h"
+
+// Blocking queue with a fixed capacity, producers wait while it is full
+template<typename T>
+class BoundedQueue {
+public:
+    explicit BoundedQueue(std::size_t capacity) : capacity(capacity) {
+    }
+
+    // Returns false if the queue was closed while waiting
+    bool push(T value) {
+        std::unique_lock<std::mutex> lock(mutex);
+        notFull.wait(lock, [this] { return items.size() < capacity || closed; });
+        if (closed) return false;
+        items.push_back(std::move(value));
+        notEmpty.notify_one();
+        return true;
+    }
+
+    // Returns nothing if the queue was closed while waiting
+    std::optional<T> pop() {
+        std::unique_lock<std::mutex> lock(mutex);
+        notEmpty.wait(lock, [this] { return !items.empty() || closed; });
+        if (closed) return std::nullopt;
+        return take();
+    }
+
+    std::optional<T> tryPop() {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (items.empty() || closed) return std::nullopt;
+        return take();
+    }
+
+    void close() {
+        std::lock_guard<std::mutex> lock(mutex);
+        closed = true;
+        notFull.notify_all();
+        notEmpty.notify_all();
+    }
+
+private:
+    T take() {
+        T value = std::move(items.front());
+        items.pop_front();
+        notFull.notify_one();
+        return value;
+    }
+
+    std::size_t capacity;
+    std::deque<T> items;
+    std::mutex mutex;
+    std::condition_variable notFull;
+    std::condition_variable notEmpty;
+    bool closed = false;
+};
+
+// Where the frames of an SPH sequence come from, either one .bin file per frame or a sequence file
+struct SphSource {
+    std::size_t frameCount = 0;
+    std::function<bool(std::size_t, ParticleArrays &)> load;
+
+    static SphSource files(std::vector<std::string> files) {
+        const std::size_t count = files.size();
+        return {
+            count, [files = std::move(files)](std::size_t frame, ParticleArrays &particles) {
+                if (loadParticleArrays(files[frame], particles)) return true;
+                Hammock::Logger::log(Hammock::LOG_LEVEL_ERROR, "Failed to load particles from %s\n",
+                                     files[frame].c_str());
+                return false;
+            }
+        };
+    }
+
+    // Frames have to be loaded from one thread at a time
+    static SphSource sequence(std::shared_ptr<SphSequence> sequence) {
+        const std::size_t count = sequence->frameCount();
+        return {
+            count, [sequence = std::move(sequence)](std::size_t frame, ParticleArrays &particles) {
+                if (sequence->read(frame, particles)) return true;
+                Hammock::Logger::log(Hammock::LOG_LEVEL_ERROR, "Failed to decode SPH sequence frame %zu\n", frame);
+                return false;
+            }
+        };
+    }
+};
+
+// Streams an SPH sequence from disk instead of loading it all up front.
+// A loader thread reads the particle files and a mesher thread turns them into meshes. Both stages run
+// ahead of playback and block once their bounded queues are full, so memory stays constant no matter
+// how long the sequence is. The sequence loops, frame n of the stream is frame n % frameCount of the source.
+// Mesh is whatever the mesh function produces from the particles of one frame, frames are meshed in
+// sequence order so it may also depend on the previous frames.
+template<typename Mesh = IndexedMesh>
+class SphStream {
+public:
+    struct MeshedFrame {
+        uint64_t sequence;
+        Mesh mesh;
+    };
+
+    using MeshFunction = std::function<Mesh(const ParticleArrays &)>;
+
+    SphStream(SphSource source, MeshFunction meshFunction, uint32_t lookahead = 4)
+        : source(std::move(source)), meshFunction(std::move(meshFunction)),
+          loadedFrames(lookahead), meshedFrames(lookahead) {
+        if (this->source.frameCount == 0) {
+            throw std::runtime_error("SPH stream has no frames");
+        }
+        loader = std::thread(&SphStream::loadLoop, this);
+        mesher = std::thread(&SphStream::meshLoop, this);
+    }
+
+    ~SphStream() {
+        loadedFrames.close();
+        meshedFrames.close();
+        if (loader.joinable()) loader.join();
+        if (mesher.joinable()) mesher.join();
+    }
+
+    SphStream(const SphStream &) = delete;
+
+    SphStream &operator=(const SphStream &) = delete;
+
+    // Next meshed frame in sequence order if it is ready, never blocks
+    std::optional<MeshedFrame> tryPop() { return meshedFrames.tryPop(); }
+
+    [[nodiscard]] std::size_t frameCount() const { return source.frameCount; }
+
+private:
+    struct LoadedFrame {
+        uint64_t sequence;
+        ParticleArrays particles;
+    };
+
+    void loadLoop() {
+        for (uint64_t sequence = 0;; ++sequence) {
+            LoadedFrame frame{sequence, {}};
+            source.load(sequence % source.frameCount, frame.particles);
+            if (!loadedFrames.push(std::move(frame))) return;
+        }
+    }
+
+    void meshLoop() {
+        while (auto frame = loadedFrames.pop()) {
+            MeshedFrame meshed{frame->sequence, meshFunction(frame->particles)};
+            if (!meshedFrames.push(std::move(meshed))) return;
+        }
+    }
+
+    SphSource source;
+    MeshFunction meshFunction;
+    BoundedQueue<LoadedFrame> loadedFrames;
+    BoundedQueue<MeshedFrame> meshedFrames;
+    std::thread loader;
+    std::thread mesher;
+};
@@ -0,0 +1,219 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include <hammock/core/ThreadPool.h>
+
+#include "SparseMarchingCubes.h"
+
+// Surface extraction algorithms the sparse meshers can switch between
+enum class IsosurfaceMethod {
+    MarchingCubes,
+    // One vertex per active cell at the mean of its edge crossings, one quad per crossed edge
+    SurfaceNets,
+    // Surface nets with the vertex placed by minimizing the QEF of the edge crossing tangent planes,
+    // keeps sharp features that the mean rounds off
+    DualContouring
+};
+
+// Vertex of a surface nets cell, v holds the corners of the cell and g their field gradients.
+// The position is either the mean of the edge crossings or the regularized QEF minimizer, clamped to
+// the cell. The normal is the trilinearly interpolated gradient, pointing towards lower values and
+// mirrored in Y.
+inline Hammock::Vertex createCellVertex(int x, int y, int z, const float v[8], const HmckVec3 g[8], float isovalue,
+                                        float cubeSize, bool dualContouring) {
+    float points[12][3];
+    HmckVec3 normals[12];
+    int crossings = 0;
+    float mass[3] = {0.0f, 0.0f, 0.0f};
+
+    for (int e = 0; e < 12; ++e) {
+        const int a = edgeCorners[e][0], b = edgeCorners[e][1];
+        if ((v[a] < isovalue) == (v[b] < isovalue)) continue;
+
+        const float t = std::clamp((isovalue - v[a]) / (v[b] - v[a]), 0.0f, 1.0f);
+        for (int axis = 0; axis < 3; ++axis) {
+            points[crossings][axis] = cornerOffset[a][axis] + t * (cornerOffset[b][axis] - cornerOffset[a][axis]);
+            mass[axis] += points[crossings][axis];
+        }
+        normals[crossings] = HmckVec3{
+            g[a].X + t * (g[b].X - g[a].X), g[a].Y + t * (g[b].Y - g[a].Y), g[a].Z + t * (g[b].Z - g[a].Z)
+        };
+        ++crossings;
+    }
+
+    float position[3];
+    for (int axis = 0; axis < 3; ++axis) position[axis] = mass[axis] / static_cast<float>(std::max(crossings, 1));
+
+    if (dualContouring && crossings > 0) {
+        // Least squares over the planes n_i . (p - p_i) = 0, solved for the offset from the mass point.
+        // The regularization pulls degenerate directions (flat or edge-like cells) towards the mass point.
+        constexpr float REGULARIZATION = 0.05f;
+        float ata[3][3] = {{REGULARIZATION, 0, 0}, {0, REGULARIZATION, 0}, {0, 0, REGULARIZATION}};
+        float atb[3] = {0.0f, 0.0f, 0.0f};
+        for (int i = 0; i < crossings; ++i) {
+            const float length = HmckLenV3(normals[i]);
+            if (length < 1e-12f) continue;
+            const float n[3] = {normals[i].X / length, normals[i].Y / length, normals[i].Z / length};
+            const float d = n[0] * (points[i][0] - position[0]) + n[1] * (points[i][1] - position[1]) +
+                            n[2] * (points[i][2] - position[2]);
+            for (int r = 0; r < 3; ++r) {
+                for (int c = 0; c < 3; ++c) ata[r][c] += n[r] * n[c];
+                atb[r] += n[r] * d;
+            }
+        }
+
+        // Cramer's rule, the matrix is symmetric positive definite
+        const float c00 = ata[1][1] * ata[2][2] - ata[1][2] * ata[2][1];
+        const float c01 = ata[1][2] * ata[2][0] - ata[1][0] * ata[2][2];
+        const float c02 = ata[1][0] * ata[2][1] - ata[1][1] * ata[2][0];
+        const float determinant = ata[0][0] * c00 + ata[0][1] * c01 + ata[0][2] * c02;
+        if (std::abs(determinant) > 1e-12f) {
+            const float inverse[3][3] = {
+                {c00, ata[0][2] * ata[2][1] - ata[0][1] * ata[2][2], ata[0][1] * ata[1][2] - ata[0][2] * ata[1][1]},
+                {c01, ata[0][0] * ata[2][2] - ata[0][2] * ata[2][0], ata[0][2] * ata[1][0] - ata[0][0] * ata[1][2]},
+                {c02, ata[0][1] * ata[2][0] - ata[0][0] * ata[2][1], ata[0][0] * ata[1][1] - ata[0][1] * ata[1][0]}
+            };
+            for (int r = 0; r < 3; ++r) {
+                const float offset = (inverse[r][0] * atb[0] + inverse[r][1] * atb[1] + inverse[r][2] * atb[2]) /
+                                     determinant;
+                position[r] = std::clamp(position[r] + offset, 0.0f, 1.0f);
+            }
+        }
+    }
+
+    const float u = position[0], w = position[1], s = position[2];
+    const float weights[8] = {
+        (1 - u) * (1 - w) * (1 - s), u * (1 - w) * (1 - s), u * w * (1 - s), (1 - u) * w * (1 - s),
+        (1 - u) * (1 - w) * s, u * (1 - w) * s, u * w * s, (1 - u) * w * s
+    };
+    HmckVec3 normal{0.0f, 0.0f, 0.0f};
+    for (int c = 0; c < 8; ++c) {
+        normal = HmckSubV3(normal, HmckMulV3F(g[c], weights[c]));
+    }
+    normal.Y = -normal.Y; // Y-down, as createEdgeVertex
+    const float length = HmckLenV3(normal);
+    normal = length > 1e-12f ? HmckMulV3F(normal, 1.0f / length) : HmckVec3{0.0f, 1.0f, 0.0f};
+
+    return Hammock::Vertex{
+        HmckVec3{(x + u) * cubeSize, (y + w) * cubeSize, (z + s) * cubeSize},
+        normal,
+        HmckVec2{0, 0},
+        HmckVec4{0, 0, 0, 0}
+    };
+}
+
+// Surface nets over the cells of one brick, appends an indexed mesh to out.
+// Every grid edge crossing the isovalue becomes a quad joining the vertices of the four cells around it.
+// A brick owns the edges starting at its grid points, so the quads also reach into the layer of cells
+// right before the brick; those vertices are duplicated in both bricks, the same way marchBrickIndexed
+// duplicates vertices on brick faces. The samples read are those of marchBrickIndexed plus one more layer
+// before the brick for the gradients, so activeBricks and the IncrementalMesher diffing apply unchanged.
+inline void netBrickIndexed(const SparseScalarField3D &scalarField, uint32_t brick, float isovalue, float cubeSize,
+                            bool dualContouring, IndexedMesh &out) {
+    constexpr uint32_t INVALID = UINT32_MAX;
+    constexpr int CELLS = SparseScalarField3D::BRICK_SIZE + 1; // the brick's cells and the layer before it
+
+    const uint32_t bricksX = scalarField.bricksX(), bricksY = scalarField.bricksY();
+    const int x0 = static_cast<int>(brick % bricksX * SparseScalarField3D::BRICK_SIZE);
+    const int y0 = static_cast<int>(brick / bricksX % bricksY * SparseScalarField3D::BRICK_SIZE);
+    const int z0 = static_cast<int>(brick / (bricksX * bricksY) * SparseScalarField3D::BRICK_SIZE);
+    const int x1 = std::min<int>(x0 + SparseScalarField3D::BRICK_SIZE, scalarField.sizeX() - 1);
+    const int y1 = std::min<int>(y0 + SparseScalarField3D::BRICK_SIZE, scalarField.sizeY() - 1);
+    const int z1 = std::min<int>(z0 + SparseScalarField3D::BRICK_SIZE, scalarField.sizeZ() - 1);
+
+    const BrickView<2, 2> view(scalarField, brick);
+
+    uint32_t cellVertex[CELLS * CELLS * CELLS];
+    std::fill_n(cellVertex, CELLS * CELLS * CELLS, INVALID);
+
+    auto vertexOf = [&](const int cell[3]) {
+        uint32_t &cached = cellVertex[(cell[0] - x0 + 1) + CELLS * ((cell[1] - y0 + 1) + CELLS * (cell[2] - z0 + 1))];
+        if (cached == INVALID) {
+            float v[8];
+            HmckVec3 g[8];
+            view.cellCorners(cell[0], cell[1], cell[2], v);
+            for (int c = 0; c < 8; ++c) {
+                g[c] = fieldGradient(view, cell[0] + cornerOffset[c][0], cell[1] + cornerOffset[c][1],
+                                     cell[2] + cornerOffset[c][2]);
+            }
+            cached = static_cast<uint32_t>(out.vertices.size());
+            out.vertices.push_back(createCellVertex(cell[0], cell[1], cell[2], v, g, isovalue, cubeSize,
+                                                    dualContouring));
+        }
+        return cached;
+    };
+
+    for (int z = z0; z < z1; ++z) {
+        for (int y = y0; y < y1; ++y) {
+            for (int x = x0; x < x1; ++x) {
+                const int point[3] = {x, y, z};
+                const bool inside = view.at(x, y, z) < isovalue;
+
+                for (int axis = 0; axis < 3; ++axis) {
+                    const int u = (axis + 1) % 3, w = (axis + 2) % 3;
+                    if (point[u] == 0 || point[w] == 0) continue; // a border edge has fewer than four cells
+
+                    const bool otherInside = view.at(x + (axis == 0), y + (axis == 1), z + (axis == 2)) < isovalue;
+                    if (inside == otherInside) continue;
+
+                    // The four cells around the edge, counter clockwise when looking down the axis
+                    int cells[4][3];
+                    for (int c = 0; c < 4; ++c) {
+                        cells[c][0] = x;
+                        cells[c][1] = y;
+                        cells[c][2] = z;
+                    }
+                    cells[0][u] -= 1;
+                    cells[0][w] -= 1;
+                    cells[1][w] -= 1;
+                    cells[3][u] -= 1;
+
+                    uint32_t quad[4];
+                    for (int c = 0; c < 4; ++c) quad[c] = vertexOf(cells[c]);
+                    // Wind the quad so that it faces towards lower values, like the marching cubes triangles
+                    if (inside) std::swap(quad[1], quad[3]);
+
+                    // Split along the shorter diagonal, the longer one makes the slivers marching cubes is
+                    // prone to
+                    const HmckVec3 &p0 = out.vertices[quad[0]].position, &p1 = out.vertices[quad[1]].position;
+                    const HmckVec3 &p2 = out.vertices[quad[2]].position, &p3 = out.vertices[quad[3]].position;
+                    if (HmckLenSqrV3(HmckSubV3(p0, p2)) <= HmckLenSqrV3(HmckSubV3(p1, p3))) {
+                        out.indices.insert(out.indices.end(), {quad[0], quad[1], quad[2], quad[0], quad[2], quad[3]});
+                    } else {
+                        out.indices.insert(out.indices.end(), {quad[0], quad[1], quad[3], quad[1], quad[2], quad[3]});
+                    }
+                }
+            }
+        }
+    }
+}
+
+// Meshes one brick with the chosen method, brick meshes of every method are self-contained
+inline void meshBrickIndexed(const SparseScalarField3D &scalarField, uint32_t brick, float isovalue, float cubeSize,
+                             IsosurfaceMethod method, IndexedMesh &out) {
+    if (method == IsosurfaceMethod::MarchingCubes) {
+        marchBrickIndexed(scalarField, brick, isovalue, cubeSize, out);
+    } else {
+        netBrickIndexed(scalarField, brick, isovalue, cubeSize, method == IsosurfaceMethod::DualContouring, out);
+    }
+}
+
+// Indexed isosurface of a sparse field with the chosen method, see marchingCubesSparse
+inline IndexedMesh extractIsosurfaceSparse(
+    const SparseScalarField3D &scalarField,
+    float isovalue,
+    float cubeSize,
+    Hammock::ThreadPool &threadPool,
+    IsosurfaceMethod method = IsosurfaceMethod::MarchingCubes) {
+
+    if (scalarField.sizeX() < 2 || scalarField.sizeY() < 2 || scalarField.sizeZ() < 2) {
+        return {};
+    }
+
+    return meshBricks(activeBricks(scalarField, isovalue), threadPool, [&](uint32_t brick, IndexedMesh &out) {
+        meshBrickIndexed(scalarField, brick, isovalue, cubeSize, method, out);
+    });
+}
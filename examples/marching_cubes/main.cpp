@@ -1,8 +1,39 @@
+#include <cstdlib>
 #include <iostream>
 
 #include "Renderer.h"
 
-int main() {
-    Renderer renderer{};
+int main(int argc, char *argv[]) {
+    Hammock::ArgParser parser;
+    parser.addArgument<std::string>("preload", "Mesh the whole sequence before showing the window");
+    parser.addArgument<std::string>("incremental", "Only re-mesh the parts of the surface that changed between frames");
+    parser.addArgument<std::string>("particles", "Draw the particles as sphere impostors instead of meshing them");
+    parser.addArgument<std::string>("compute", "Extract the surface with compute shaders every frame");
+    parser.addArgument<std::string>("compute-check", "Compare the compute extraction of the first frames with the CPU one and exit");
+
+    try {
+        parser.parse(argc, argv);
+    } catch (const std::exception &e) {
+        Hammock::Logger::log(Hammock::LOG_LEVEL_ERROR, "%s\n", e.what());
+    }
+
+    auto flag = [&parser](const std::string &name) {
+        try {
+            return parser.get<std::string>(name) == "true";
+        } catch (const std::invalid_argument &) {
+            return false;
+        }
+    };
+
+    Renderer::PlaybackMode playbackMode = Renderer::PlaybackMode::Stream;
+    if (flag("preload")) playbackMode = Renderer::PlaybackMode::Preload;
+    else if (flag("incremental")) playbackMode = Renderer::PlaybackMode::Incremental;
+    else if (flag("particles")) playbackMode = Renderer::PlaybackMode::Particles;
+    else if (flag("compute") || flag("compute-check")) playbackMode = Renderer::PlaybackMode::Compute;
+
+    Renderer renderer{playbackMode};
+    if (flag("compute-check")) {
+        return renderer.checkCompute(4) ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
     renderer.draw();
-}
\ No newline at end of file
+}
@@ -0,0 +1,49 @@
+#pragma once
+#include <string>
+#include <vector>
+#include "hammock/core/Device.h"
+#include <memory>
+
+namespace Hammock {
+    class ComputePipeline {
+        struct ComputePipelineCreateInfo {
+            std::string debugName;
+            Device &device;
+
+            struct ShaderModuleInfo {
+                const std::vector<char> &byteCode;
+                std::string entryFunc = "main";
+            };
+
+            ShaderModuleInfo CS;
+
+            std::vector<VkDescriptorSetLayout> descriptorSetLayouts;
+            std::vector<VkPushConstantRange> pushConstantRanges;
+        };
+
+    public:
+        ComputePipeline(ComputePipelineCreateInfo &createInfo);
+
+        static std::unique_ptr<ComputePipeline> createComputePipelinePtr(ComputePipelineCreateInfo createInfo);
+
+        void bind(VkCommandBuffer commandBuffer);
+
+        void dispatch(VkCommandBuffer commandBuffer, uint32_t groupCountX, uint32_t groupCountY = 1,
+                      uint32_t groupCountZ = 1);
+
+        ~ComputePipeline();
+
+        ComputePipeline(const ComputePipeline &) = delete;
+
+        ComputePipeline &operator =(const ComputePipeline &) = delete;
+
+        VkPipelineLayout computePipelineLayout;
+
+    private:
+        void createShaderModule(const std::vector<char> &code, VkShaderModule *shaderModule) const;
+
+        Device &device;
+        VkPipeline computePipeline;
+        VkShaderModule compShaderModule;
+    };
+}
@@ -48,6 +48,8 @@ namespace Hammock {
         [[nodiscard]] VkSurfaceKHR surface() const { return surface_; }
         [[nodiscard]] VkQueue graphicsQueue() const { return graphicsQueue_; }
         [[nodiscard]] VkQueue presentQueue() const { return presentQueue_; }
+        // Core features the device was created with, optional ones are only enabled where supported
+        [[nodiscard]] const VkPhysicalDeviceFeatures &getEnabledFeatures() const { return enabledFeatures; }
         [[nodiscard]] SwapChainSupportDetails getSwapChainSupport() const {
             return querySwapChainSupport(physicalDevice);
         }
@@ -122,6 +124,7 @@ namespace Hammock {
 
         VulkanInstance &instance;
         VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
+        VkPhysicalDeviceFeatures enabledFeatures{};
         VkCommandPool commandPool;
 
         VkDevice device_;
@@ -122,6 +122,9 @@ namespace Hammock {
 
         [[nodiscard]] ResourceHandle<VkDescriptorSet> createDescriptorSet(const DescriptorSetCreateInfo &createInfo);
 
+        // Rewrites the bindings of an existing set, the set must not be in use by a pending command buffer
+        void updateDescriptorSet(ResourceHandle<VkDescriptorSet> handle, const DescriptorSetCreateInfo &createInfo);
+
         ResourceHandle<Texture2D> createEmptyTexture2D();
 
         struct Texture2DCreateSamplerInfo {
@@ -166,6 +169,9 @@ namespace Hammock {
             VkFormat format;
             VkImageLayout imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
             Texture3DCreateSamplerInfo samplerInfo{};
+            // Kept with the texture, see Texture3D::valueScale
+            float valueScale = 1.0f;
+            float valueBias = 0.0f;
         };
 
         [[nodiscard]] ResourceHandle<Texture3D> createTexture3D(const Texture3DCreateFromBufferInfo &createInfo);
@@ -206,6 +212,9 @@ namespace Hammock {
 
         void destroyBuffer(ResourceHandle<Buffer> handle);
 
+        // Returns the set to the pool, it must not be in use by a pending command buffer
+        void destroyDescriptorSet(ResourceHandle<VkDescriptorSet> handle);
+
         void destroyDescriptorSetLayout(ResourceHandle<DescriptorSetLayout> handle);
 
         void destroyTexture2D(ResourceHandle<Texture2D> handle);
@@ -218,6 +227,8 @@ namespace Hammock {
         VkDescriptorPool getDescriptorPool() {return descriptorPool->descriptorPool;}
 
     private:
+        DescriptorWriter createDescriptorWriter(const DescriptorSetCreateInfo &createInfo);
+
         Device &device;
         std::unique_ptr<DescriptorPool> descriptorPool;
 
@@ -227,6 +238,8 @@ namespace Hammock {
         descriptorSetLayouts;
         std::unordered_map<id_t, std::unique_ptr<Texture2D> > texture2Ds;
         std::unordered_map<id_t, std::unique_ptr<Texture3D> > texture3Ds;
+        // Handles are never reused, so a destroyed resource cannot alias one created after it
+        id_t nextId = 0;
 
     };
 }
@@ -33,6 +33,7 @@ namespace Hammock {
 
         [[nodiscard]] VkRenderPass getSwapChainRenderPass() const { return hmckSwapChain->getRenderPass(); }
         [[nodiscard]] float getAspectRatio() const { return hmckSwapChain->extentAspectRatio(); }
+        [[nodiscard]] VkExtent2D getSwapChainExtent() const { return hmckSwapChain->getSwapChainExtent(); }
         [[nodiscard]] bool isFrameInProgress() const { return isFrameStarted; }
 
 
@@ -1,3 +1,7 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
 #include <vector>
 #include <thread>
 #include <queue>
@@ -86,5 +90,23 @@ namespace Hammock {
                 thread->wait();
             }
         }
+
+        // Runs func(begin, end) over [0, count) split into one chunk per thread and waits for all of
+        // them, inline when the pool has no threads
+        template<typename Func>
+        void parallelFor(uint32_t count, Func &&func) {
+            const auto threadCount = static_cast<uint32_t>(threads.size());
+            if (threadCount == 0 || count < 2) {
+                func(0u, count);
+                return;
+            }
+            const uint32_t chunks = std::min(count, threadCount);
+            for (uint32_t i = 0; i < chunks; ++i) {
+                const auto begin = static_cast<uint32_t>(static_cast<uint64_t>(count) * i / chunks);
+                const auto end = static_cast<uint32_t>(static_cast<uint64_t>(count) * (i + 1) / chunks);
+                threads[i]->addJob([&func, begin, end] { func(begin, end); });
+            }
+            wait();
+        }
     };
 }
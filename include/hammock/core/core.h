@@ -1,6 +1,7 @@
 #pragma once
 
 #include "BindingTypes.h"
+#include "ComputePipeline.h"
 #include "Device.h"
 #include "DeviceStorage.h"
 #include "Framebuffer.h"
@@ -0,0 +1,134 @@
+#pragma once
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <list>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "hammock/core/DeviceStorage.h"
+#include "hammock/core/SwapChain.h"
+#include "hammock/resources/BrickedVolume.h"
+
+namespace Hammock {
+    // Keeps the bricks of a BrickedVolume that rays actually reach in a fixed size 3D texture atlas, so
+    // a volume larger than the device memory can be raymarched. A page table texture with one texel per
+    // brick holds the atlas slot of every resident brick, PAGE_MISSING or PAGE_EMPTY.
+    //
+    // The raymarcher writes the stamp of its frame into a feedback buffer for every brick it enters.
+    // Once that frame has finished, missing bricks it entered are requested from a background thread that
+    // reads them from the mapped file, and bricks that went unused the longest give up their slots first.
+    // Bricks entered by the latest frame whose feedback came back are never evicted, so when the working
+    // set does not fit into the atlas the bricks that do not fit stay missing instead of thrashing.
+    class BrickCache {
+    public:
+        // Page table values that are not atlas slots
+        static constexpr float PAGE_MISSING = -1.0f;
+        static constexpr float PAGE_EMPTY = -2.0f;
+
+        struct CreateInfo {
+            const BrickedVolume &volume;
+            // Atlas slots along every axis
+            uint32_t slots[3] = {8, 8, 8};
+            // Bricks copied into the atlas per frame at most
+            uint32_t uploadsPerFrame = 16;
+            uint32_t framesInFlight = SwapChain::MAX_FRAMES_IN_FLIGHT;
+        };
+
+        BrickCache(Device &device, DeviceStorage &deviceStorage, const CreateInfo &createInfo);
+
+        // Stops the loader, call destroy() first to release the device resources
+        ~BrickCache();
+
+        BrickCache(const BrickCache &) = delete;
+
+        BrickCache &operator=(const BrickCache &) = delete;
+
+        // Bricks whose value range misses [lo, hi] are marked empty and never loaded
+        void setVisibleRange(float lo, float hi);
+
+        // Reads the feedback of the frame that last used frameIndex, requests what it missed and records
+        // the uploads of loaded bricks. Has to be recorded outside of a render pass, before the raymarch.
+        void update(VkCommandBuffer commandBuffer, uint32_t frameIndex);
+
+        // Makes the feedback written by the raymarch of this frame visible to the host, record after it
+        void recordFeedbackBarrier(VkCommandBuffer commandBuffer) const;
+
+        // Stamp the raymarch of frameIndex writes into the feedback buffer
+        [[nodiscard]] uint32_t frameStamp(uint32_t frameIndex) const { return frames[frameIndex].stamp; }
+
+        [[nodiscard]] VkDescriptorImageInfo atlasDescriptor();
+        [[nodiscard]] VkDescriptorImageInfo pageTableDescriptor();
+        [[nodiscard]] VkDescriptorBufferInfo feedbackDescriptor(uint32_t frameIndex);
+
+        [[nodiscard]] uint32_t slotCount() const { return static_cast<uint32_t>(slotBricks.size()); }
+        [[nodiscard]] uint32_t residentBricks() const { return resident; }
+        [[nodiscard]] uint32_t pendingBricks() const { return pending; }
+        [[nodiscard]] uint32_t uploadedBricks() const { return uploaded; }
+        [[nodiscard]] uint32_t evictedBricks() const { return evicted; }
+
+        void destroy();
+
+    private:
+        static constexpr uint32_t NO_SLOT = UINT32_MAX;
+
+        struct Brick {
+            uint32_t slot = NO_SLOT;
+            bool empty = false;
+            bool requested = false;
+        };
+
+        struct Frame {
+            uint32_t stamp = 0;
+            ResourceHandle<Buffer> feedback{};
+            ResourceHandle<Buffer> staging{};
+        };
+
+        struct LoadedBrick {
+            uint32_t brick;
+            std::vector<float> samples;
+        };
+
+        void loaderLoop();
+        // Free slot, or the slot of the least recently used brick the latest feedback did not reach
+        uint32_t acquireSlot();
+        void touch(uint32_t slot);
+        [[nodiscard]] float pageValue(uint32_t brick) const;
+
+        Device &device;
+        DeviceStorage &deviceStorage;
+        const BrickedVolume &volume;
+        uint32_t slots[3];
+        uint32_t uploadsPerFrame;
+        // Requests the loader may be behind by, the rest is requested again by later feedback
+        uint32_t maxPending;
+
+        ResourceHandle<Texture3D> atlas{};
+        ResourceHandle<Texture3D> pageTable{};
+        std::vector<float> pageValues;
+        bool pageTableDirty = false;
+        std::vector<Frame> frames;
+        uint32_t currentStamp = 0;
+        // Stamp of the frame whose feedback was read last
+        uint32_t feedbackStamp = 0;
+
+        std::vector<Brick> bricks;
+        std::vector<uint32_t> slotBricks; // brick of every slot, NO_SLOT if free
+        std::vector<uint32_t> slotStamps; // last frame that entered the brick of every slot
+        std::vector<std::list<uint32_t>::iterator> slotEntries;
+        std::list<uint32_t> lru; // slots, most recently used first
+        std::vector<uint32_t> freeSlots;
+
+        uint32_t resident = 0, pending = 0, uploaded = 0, evicted = 0;
+
+        // Shared with the loader
+        std::mutex mutex;
+        std::condition_variable wake;
+        std::deque<uint32_t> requests;
+        std::vector<LoadedBrick> loaded;
+        bool stopping = false;
+        std::thread loader;
+    };
+}
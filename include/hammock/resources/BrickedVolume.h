@@ -0,0 +1,90 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "hammock/utils/MappedFile.h"
+
+namespace Hammock {
+    // Scalar volume split into cubic bricks in a memory mapped file, so that only the bricks a renderer
+    // actually needs have to be read. Every brick is stored with a one sample apron copied from its
+    // neighbours (clamped at the border of the volume), which lets trilinear filtering inside a brick
+    // work without its neighbours being resident.
+    //
+    // Layout: Header, the brick payloads in brick order, then the page table with one BrickInfo per brick.
+    // Payloads are paddedBrickSize()^3 floats, x-fastest. Bricks at the far border may stick out of the
+    // volume, their samples past the end repeat the last slice.
+    class BrickedVolume {
+    public:
+        static constexpr uint32_t MAGIC = 0x4c564248; // "HBVL"
+        static constexpr uint32_t VERSION = 1;
+        static constexpr uint32_t APRON = 1;
+
+        struct Header {
+            uint32_t magic;
+            uint32_t version;
+            uint32_t size[3];
+            uint32_t brickSize; // samples per brick along every axis, without the apron
+            uint32_t bricks[3];
+            float minValue;
+            float maxValue;
+            uint32_t reserved;
+            uint64_t pageTableOffset;
+        };
+
+        struct BrickInfo {
+            uint64_t offset; // of the payload from the start of the file
+            // Range of the payload including the apron, which is what filtering inside the brick can read
+            float minValue;
+            float maxValue;
+        };
+
+        // Maps the file, throws when it is not a bricked volume
+        explicit BrickedVolume(const std::string &path);
+
+        // Writes the slices as a bricked volume, only paddedBrickSize() slices are held in memory at a time.
+        // Slices are read like Filesystem::readVolume does, only the first channel is kept.
+        static void convert(const std::vector<std::string> &slices, const std::string &path,
+                            uint32_t brickSize = 32, uint32_t flags = 0);
+
+        // Whether path holds a complete bricked volume, checks the header and the file size without mapping it
+        static bool isValid(const std::string &path);
+
+        [[nodiscard]] uint32_t sizeX() const { return header.size[0]; }
+        [[nodiscard]] uint32_t sizeY() const { return header.size[1]; }
+        [[nodiscard]] uint32_t sizeZ() const { return header.size[2]; }
+        [[nodiscard]] float minValue() const { return header.minValue; }
+        [[nodiscard]] float maxValue() const { return header.maxValue; }
+
+        [[nodiscard]] uint32_t brickSize() const { return header.brickSize; }
+        [[nodiscard]] uint32_t paddedBrickSize() const { return header.brickSize + 2 * APRON; }
+        [[nodiscard]] std::size_t brickSamples() const {
+            const std::size_t padded = paddedBrickSize();
+            return padded * padded * padded;
+        }
+        [[nodiscard]] std::size_t brickBytes() const { return brickSamples() * sizeof(float); }
+
+        [[nodiscard]] uint32_t bricksX() const { return header.bricks[0]; }
+        [[nodiscard]] uint32_t bricksY() const { return header.bricks[1]; }
+        [[nodiscard]] uint32_t bricksZ() const { return header.bricks[2]; }
+        [[nodiscard]] std::size_t brickCount() const {
+            return static_cast<std::size_t>(header.bricks[0]) * header.bricks[1] * header.bricks[2];
+        }
+        [[nodiscard]] std::size_t brickIndex(uint32_t bx, uint32_t by, uint32_t bz) const {
+            return bx + header.bricks[0] * (by + static_cast<std::size_t>(header.bricks[1]) * bz);
+        }
+
+        [[nodiscard]] const BrickInfo &brickInfo(std::size_t brick) const { return pageTable[brick]; }
+
+        // Payload of a brick inside the mapping, touching it pages the brick in
+        [[nodiscard]] const float *brickData(std::size_t brick) const {
+            return reinterpret_cast<const float *>(file.data() + pageTable[brick].offset);
+        }
+
+    private:
+        MappedFile file;
+        Header header{};
+        const BrickInfo *pageTable = nullptr;
+    };
+}
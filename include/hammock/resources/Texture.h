@@ -87,8 +87,12 @@ namespace Hammock {
         }
 
         int depth{0};
+        VkDeviceSize instanceSize{0};
+        // Samples of a quantized volume decode to sample * valueScale + valueBias, the texture does not
+        // apply this itself, shaders do
+        float valueScale{1.0f}, valueBias{0.0f};
 
-        // Recommended format VK_FORMAT_R8_UNORM
+        // Recommended format VK_FORMAT_R8_UNORM, instanceSize is the size of one channel
         void loadFromBuffer(Device &device,
             const void * buffer,
             VkDeviceSize instanceSize,
@@ -99,6 +103,10 @@ namespace Hammock {
             VkFormat format,
             VkImageLayout imageLayout);
 
+        // Replaces the whole content with buffer, laid out like in loadFromBuffer. The texture must
+        // not be in use by the device.
+        void update(const void *buffer);
+
         void createSampler(Device& device,
             VkFilter filter = VK_FILTER_LINEAR,
             VkSamplerAddressMode addressMode = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE);
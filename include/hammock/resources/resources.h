@@ -1,5 +1,7 @@
 #pragma once
 
+#include "BrickCache.h"
+#include "BrickedVolume.h"
 #include "Buffer.h"
 #include "Descriptors.h"
 #include "Generator.h"
@@ -0,0 +1,315 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <vector>
+
+#include "hammock/core/HandmadeMath.h"
+#include "hammock/core/ThreadPool.h"
+#include "hammock/scene/Vertex.h"
+#include "hammock/utils/HalfFloat.h"
+
+namespace Hammock {
+    // Marching cubes case tables, bit i of a case is set when corner i lies below the isovalue
+    extern const int edgeTable[256];
+    extern const int triTable[256][16];
+
+    // Corner offsets in marching cubes corner order
+    inline constexpr int cornerOffset[8][3] = {
+        {0, 0, 0}, {1, 0, 0}, {1, 1, 0}, {0, 1, 0},
+        {0, 0, 1}, {1, 0, 1}, {1, 1, 1}, {0, 1, 1}
+    };
+
+    // Edge endpoints, always ordered from the lower to the higher grid point so that shared
+    // vertices are interpolated the same way from every cell
+    inline constexpr int edgeCorners[12][2] = {
+        {0, 1}, {1, 2}, {3, 2}, {0, 3},
+        {4, 5}, {5, 6}, {7, 6}, {4, 7},
+        {0, 4}, {1, 5}, {2, 6}, {3, 7}
+    };
+
+    // Samples in the layout Filesystem::readVolume returns: x-fastest, slice after slice, channels
+    // interleaved. Only the first channel is meshed, the view does not own the samples. Samples are
+    // decoded like a sampler of the matching format does and then mapped by scale and bias, the same
+    // way shaders apply Texture3D::valueScale and valueBias.
+    struct VolumeView {
+        enum class SampleType : uint8_t {
+            Float32, // R32_SFLOAT
+            Float16, // R16_SFLOAT
+            UNorm16, // R16_UNORM
+            UNorm8 // R8_UNORM
+        };
+
+        const void *data = nullptr;
+        uint32_t width = 0, height = 0, depth = 0, channels = 1;
+        SampleType type = SampleType::Float32;
+        float scale = 1.0f, bias = 0.0f;
+
+        // Field accessors of the isosurface extractor, a view without samples is empty
+        [[nodiscard]] uint32_t sizeX() const { return data ? width : 0; }
+        [[nodiscard]] uint32_t sizeY() const { return data ? height : 0; }
+        [[nodiscard]] uint32_t sizeZ() const { return data ? depth : 0; }
+
+        [[nodiscard]] float at(uint32_t x, uint32_t y, uint32_t z) const {
+            const std::size_t i = ((static_cast<std::size_t>(z) * height + y) * width + x) * channels;
+            switch (type) {
+                case SampleType::Float16:
+                    return halfToFloat(static_cast<const uint16_t *>(data)[i]) * scale + bias;
+                case SampleType::UNorm16:
+                    return static_cast<float>(static_cast<const uint16_t *>(data)[i]) * (scale / 65535.0f) + bias;
+                case SampleType::UNorm8:
+                    return static_cast<float>(static_cast<const uint8_t *>(data)[i]) * (scale / 255.0f) + bias;
+                default:
+                    return static_cast<const float *>(data)[i] * scale + bias;
+            }
+        }
+    };
+
+    struct IsosurfaceMesh {
+        std::vector<Vertex> vertices;
+        std::vector<uint32_t> indices;
+    };
+
+    namespace Isosurface {
+        struct ExtractInfo {
+            float isovalue = 0.5f;
+            // Grid point p ends up at p * scale + offset
+            HmckVec3 scale{1.0f, 1.0f, 1.0f};
+            HmckVec3 offset{0.0f, 0.0f, 0.0f};
+            // Mirrors normals in Y for meshes drawn in the Y-down convention of the engine
+            bool flipNormalY = false;
+        };
+
+        // The extractor works on any field with sizeX(), sizeY(), sizeZ() and at(x, y, z), such as
+        // VolumeView
+
+        // Central difference gradient at a grid point, one sided at the borders
+        template<typename Field>
+        HmckVec3 gradient(const Field &field, uint32_t x, uint32_t y, uint32_t z) {
+            const uint32_t x0 = x > 0 ? x - 1 : x, x1 = std::min(x + 1, field.sizeX() - 1);
+            const uint32_t y0 = y > 0 ? y - 1 : y, y1 = std::min(y + 1, field.sizeY() - 1);
+            const uint32_t z0 = z > 0 ? z - 1 : z, z1 = std::min(z + 1, field.sizeZ() - 1);
+            return HmckVec3{
+                (field.at(x1, y, z) - field.at(x0, y, z)) / static_cast<float>(std::max(1u, x1 - x0)),
+                (field.at(x, y1, z) - field.at(x, y0, z)) / static_cast<float>(std::max(1u, y1 - y0)),
+                (field.at(x, y, z1) - field.at(x, y, z0)) / static_cast<float>(std::max(1u, z1 - z0))
+            };
+        }
+
+        // Vertex where edge e of cell (x, y, z) crosses the isovalue, v holds the corners of the cell.
+        // The normal is interpolated from the gradient and points towards lower values.
+        template<typename Field>
+        Vertex edgeVertex(const Field &field, const ExtractInfo &info, uint32_t x, uint32_t y, uint32_t z, int e,
+                          const float v[8]) {
+            const int a = edgeCorners[e][0], b = edgeCorners[e][1];
+            const float va = v[a], vb = v[b];
+            const float t = std::abs(vb - va) < 1e-6f
+                                ? 0.0f
+                                : std::clamp((info.isovalue - va) / (vb - va), 0.0f, 1.0f);
+
+            const uint32_t ax = x + cornerOffset[a][0], ay = y + cornerOffset[a][1], az = z + cornerOffset[a][2];
+            const uint32_t bx = x + cornerOffset[b][0], by = y + cornerOffset[b][1], bz = z + cornerOffset[b][2];
+
+            // The gradient is per grid step, dividing by the scale turns it into the gradient of the placed surface
+            const HmckVec3 ga = gradient(field, ax, ay, az), gb = gradient(field, bx, by, bz);
+            HmckVec3 normal{
+                -(ga.X + t * (gb.X - ga.X)) / info.scale.X,
+                -(ga.Y + t * (gb.Y - ga.Y)) / info.scale.Y,
+                -(ga.Z + t * (gb.Z - ga.Z)) / info.scale.Z
+            };
+            if (info.flipNormalY) normal.Y = -normal.Y;
+            const float length = HmckLenV3(normal);
+            normal = length > 1e-12f ? HmckMulV3F(normal, 1.0f / length) : HmckVec3{0.0f, 1.0f, 0.0f};
+
+            return Vertex{
+                HmckVec3{
+                    (ax + t * (static_cast<float>(bx) - ax)) * info.scale.X + info.offset.X,
+                    (ay + t * (static_cast<float>(by) - ay)) * info.scale.Y + info.offset.Y,
+                    (az + t * (static_cast<float>(bz) - az)) * info.scale.Z + info.offset.Z
+                },
+                normal,
+                HmckVec2{0, 0},
+                HmckVec4{0, 0, 0, 0}
+            };
+        }
+
+        // Marches cells with z in [zBegin, zEnd) and appends them to out. Every edge intersection is
+        // shared by the cells around it. The edge cache only holds two planes of x/y edges and one
+        // layer of z edges, the grid point classification two planes.
+        template<typename Field>
+        void extractSlab(const Field &field, const ExtractInfo &info, uint32_t zBegin, uint32_t zEnd,
+                         IsosurfaceMesh &out) {
+            constexpr uint32_t INVALID_VERTEX = UINT32_MAX;
+            // Cache slot of every edge: axis (0 = x, 1 = y, 2 = z), offset of the owning grid point and plane
+            static constexpr int edgeSlot[12][4] = {
+                {0, 0, 0, 0}, {1, 1, 0, 0}, {0, 0, 1, 0}, {1, 0, 0, 0},
+                {0, 0, 0, 1}, {1, 1, 0, 1}, {0, 0, 1, 1}, {1, 0, 0, 1},
+                {2, 0, 0, 0}, {2, 1, 0, 0}, {2, 1, 1, 0}, {2, 0, 1, 0}
+            };
+
+            const uint32_t w = field.sizeX(), h = field.sizeY();
+            const std::size_t planeSize = static_cast<std::size_t>(w) * h;
+
+            std::vector<uint32_t> xEdges[2], yEdges[2], zEdges(planeSize, INVALID_VERTEX);
+            std::vector<uint8_t> below[2];
+            for (int p = 0; p < 2; ++p) {
+                xEdges[p].assign(planeSize, INVALID_VERTEX);
+                yEdges[p].assign(planeSize, INVALID_VERTEX);
+                below[p].resize(planeSize);
+            }
+            // Marks every grid point of plane z that lies below the isovalue
+            const auto classifyPlane = [&](uint32_t z, std::vector<uint8_t> &plane) {
+                std::size_t i = 0;
+                for (uint32_t y = 0; y < h; ++y) {
+                    for (uint32_t x = 0; x < w; ++x, ++i) {
+                        plane[i] = field.at(x, y, z) < info.isovalue;
+                    }
+                }
+            };
+            classifyPlane(zBegin, below[0]);
+
+            for (uint32_t z = zBegin; z < zEnd; ++z) {
+                classifyPlane(z + 1, below[1]);
+
+                for (uint32_t y = 0; y + 1 < h; ++y) {
+                    const uint8_t *b0 = below[0].data() + y * w, *b1 = b0 + w;
+                    const uint8_t *t0 = below[1].data() + y * w, *t1 = t0 + w;
+
+                    for (uint32_t x = 0; x + 1 < w; ++x) {
+                        const int cubeIndex = b0[x] | b0[x + 1] << 1 | b1[x + 1] << 2 | b1[x] << 3 |
+                                              t0[x] << 4 | t0[x + 1] << 5 | t1[x + 1] << 6 | t1[x] << 7;
+                        if (cubeIndex == 0 || cubeIndex == 255) continue;
+
+                        float v[8];
+                        for (int c = 0; c < 8; ++c) {
+                            v[c] = field.at(x + cornerOffset[c][0], y + cornerOffset[c][1], z + cornerOffset[c][2]);
+                        }
+
+                        uint32_t vertices[12];
+                        for (int e = 0; e < 12; ++e) {
+                            if (!(edgeTable[cubeIndex] & (1 << e))) continue;
+
+                            const int *slot = edgeSlot[e];
+                            const std::size_t point = (y + slot[2]) * static_cast<std::size_t>(w) + (x + slot[1]);
+                            uint32_t &cached = slot[0] == 0
+                                                   ? xEdges[slot[3]][point]
+                                                   : slot[0] == 1
+                                                         ? yEdges[slot[3]][point]
+                                                         : zEdges[point];
+
+                            if (cached == INVALID_VERTEX) {
+                                cached = static_cast<uint32_t>(out.vertices.size());
+                                out.vertices.push_back(edgeVertex(field, info, x, y, z, e, v));
+                            }
+                            vertices[e] = cached;
+                        }
+
+                        const int *triangles = triTable[cubeIndex];
+                        for (int i = 0; triangles[i] != -1; i += 3) {
+                            out.indices.push_back(vertices[triangles[i]]);
+                            out.indices.push_back(vertices[triangles[i + 1]]);
+                            out.indices.push_back(vertices[triangles[i + 2]]);
+                        }
+                    }
+                }
+
+                // The top planes become the bottom planes of the next layer of cells
+                std::swap(below[0], below[1]);
+                std::swap(xEdges[0], xEdges[1]);
+                std::swap(yEdges[0], yEdges[1]);
+                std::fill(xEdges[1].begin(), xEdges[1].end(), INVALID_VERTEX);
+                std::fill(yEdges[1].begin(), yEdges[1].end(), INVALID_VERTEX);
+                std::fill(zEdges.begin(), zEdges.end(), INVALID_VERTEX);
+            }
+        }
+
+        // Indexed marching cubes of the whole field
+        template<typename Field>
+        IsosurfaceMesh extract(const Field &field, const ExtractInfo &info) {
+            IsosurfaceMesh mesh;
+            if (field.sizeX() >= 2 && field.sizeY() >= 2 && field.sizeZ() >= 2) {
+                extractSlab(field, info, 0, field.sizeZ() - 1, mesh);
+            }
+            return mesh;
+        }
+
+        // Same surface meshed in z slabs on the pool and merged in slab order, so the result does not
+        // depend on scheduling. Vertices on the boundary between two slabs are duplicated.
+        template<typename Field>
+        IsosurfaceMesh extractParallel(const Field &field, const ExtractInfo &info, ThreadPool &threadPool) {
+            if (field.sizeX() < 2 || field.sizeY() < 2 || field.sizeZ() < 2) {
+                return {};
+            }
+
+            // Every slab boundary duplicates a plane of vertices, so there is one slab per thread
+            const uint32_t nz = field.sizeZ() - 1;
+            const uint32_t slabCount = std::min(nz, std::max(1u, static_cast<uint32_t>(threadPool.threads.size())));
+            std::vector<IsosurfaceMesh> slabMeshes(slabCount);
+            threadPool.parallelFor(slabCount, [&](uint32_t begin, uint32_t end) {
+                for (uint32_t i = begin; i < end; ++i) {
+                    const auto zBegin = static_cast<uint32_t>(static_cast<uint64_t>(nz) * i / slabCount);
+                    const auto zEnd = static_cast<uint32_t>(static_cast<uint64_t>(nz) * (i + 1) / slabCount);
+                    extractSlab(field, info, zBegin, zEnd, slabMeshes[i]);
+                }
+            });
+            if (slabCount == 1) {
+                return std::move(slabMeshes.front());
+            }
+
+            std::vector<std::size_t> vertexOffsets(slabCount + 1, 0), indexOffsets(slabCount + 1, 0);
+            for (uint32_t i = 0; i < slabCount; ++i) {
+                vertexOffsets[i + 1] = vertexOffsets[i] + slabMeshes[i].vertices.size();
+                indexOffsets[i + 1] = indexOffsets[i] + slabMeshes[i].indices.size();
+            }
+
+            IsosurfaceMesh mesh;
+            mesh.vertices.resize(vertexOffsets[slabCount]);
+            mesh.indices.resize(indexOffsets[slabCount]);
+            threadPool.parallelFor(slabCount, [&](uint32_t begin, uint32_t end) {
+                for (uint32_t i = begin; i < end; ++i) {
+                    const IsosurfaceMesh &slab = slabMeshes[i];
+                    const auto base = static_cast<uint32_t>(vertexOffsets[i]);
+                    std::copy(slab.vertices.begin(), slab.vertices.end(), mesh.vertices.begin() + vertexOffsets[i]);
+                    std::transform(slab.indices.begin(), slab.indices.end(), mesh.indices.begin() + indexOffsets[i],
+                                   [base](uint32_t index) { return index + base; });
+                }
+            });
+            return mesh;
+        }
+    }
+
+    // Keeps the most recently used meshes of one volume, going back to an isovalue that was meshed
+    // before does not touch the volume again
+    class IsosurfaceCache {
+    public:
+        explicit IsosurfaceCache(ThreadPool &threadPool, std::size_t capacity = 4)
+            : threadPool(threadPool), capacity(capacity) {
+        }
+
+        // The samples must outlive the cache, a new volume drops every mesh
+        void setVolume(const VolumeView &volume);
+
+        // Mesh for info, extracted in parallel on a miss. The reference is valid until the entry
+        // is evicted by capacity other meshes or the volume changes.
+        const IsosurfaceMesh &get(const Isosurface::ExtractInfo &info);
+
+        [[nodiscard]] bool contains(const Isosurface::ExtractInfo &info) const;
+
+        void clear() { entries.clear(); }
+
+    private:
+        struct Entry {
+            Isosurface::ExtractInfo info;
+            IsosurfaceMesh mesh;
+        };
+
+        static bool matches(const Isosurface::ExtractInfo &a, const Isosurface::ExtractInfo &b);
+
+        ThreadPool &threadPool;
+        std::size_t capacity;
+        VolumeView volume{};
+        std::list<Entry> entries; // most recently used first
+    };
+}
@@ -0,0 +1,52 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "hammock/core/ThreadPool.h"
+#include "hammock/scene/Isosurface.h"
+
+namespace Hammock {
+    // Coarse grid over a volume for empty space skipping. Every macrocell knows the value range of the
+    // samples that trilinear filtering can read inside it, which does not depend on the transfer
+    // function and is built once. What a raymarcher may skip under the current thresholds is derived
+    // from the ranges alone, so changing the thresholds never touches the volume again.
+    class MacrocellGrid {
+    public:
+        // Samples per macrocell along every axis
+        static constexpr uint32_t CELL_SIZE = 8;
+        // Skip distances are capped, a ray never jumps further than this many macrocells at once
+        static constexpr uint32_t MAX_SKIP = 255;
+
+        // Builds the value range of every macrocell, macrocell slices are spread over the pool
+        void build(const VolumeView &volume, ThreadPool &threadPool);
+
+        // Recomputes the skip distance of every macrocell for a transfer function that is fully
+        // transparent outside [lo, hi]. A macrocell whose range reaches into [lo, hi] gets 0, any other
+        // the Chebyshev distance in macrocells to the nearest such macrocell: a ray inside macrocell m
+        // with distance d can leave the box of macrocells [m - d + 1, m + d - 1] without sampling.
+        void updateSkipDistances(float lo, float hi, ThreadPool &threadPool);
+
+        [[nodiscard]] uint32_t sizeX() const { return size[0]; }
+        [[nodiscard]] uint32_t sizeY() const { return size[1]; }
+        [[nodiscard]] uint32_t sizeZ() const { return size[2]; }
+        [[nodiscard]] std::size_t cellCount() const { return static_cast<std::size_t>(size[0]) * size[1] * size[2]; }
+
+        // Minimum and maximum of every macrocell, x-fastest
+        [[nodiscard]] const std::vector<float> &minima() const { return rangeMin; }
+        [[nodiscard]] const std::vector<float> &maxima() const { return rangeMax; }
+
+        // Skip distance of every macrocell in macrocells, x-fastest. Stored as floats so that it can be
+        // uploaded as an R32_SFLOAT texture.
+        [[nodiscard]] const std::vector<float> &skipDistances() const { return distances; }
+
+    private:
+        [[nodiscard]] std::size_t index(uint32_t x, uint32_t y, uint32_t z) const {
+            return x + size[0] * (y + static_cast<std::size_t>(size[1]) * z);
+        }
+
+        uint32_t size[3]{};
+        std::vector<float> rangeMin, rangeMax;
+        std::vector<float> distances;
+    };
+}
@@ -0,0 +1,60 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "hammock/core/HandmadeMath.h"
+#include "hammock/core/ThreadPool.h"
+
+namespace Hammock {
+    // Maps densities in [0, 1] to colors by interpolating linearly between control points. Shaders do not
+    // evaluate it, they read it from two tables: a lookup table with the color of every density and a
+    // pre-integrated table with the color of a whole ray segment for every pair of densities at its ends.
+    // The latter catches features thinner than the step between two samples.
+    class TransferFunction {
+    public:
+        // Entries of the lookup table, and of the pre-integrated table along both axes
+        static constexpr uint32_t TABLE_SIZE = 256;
+        // Opacities of the control points are for segments this long, TRANSFER_FUNCTION_REFERENCE_STEP
+        // in the shaders
+        static constexpr float REFERENCE_STEP = 0.01f;
+
+        struct ControlPoint {
+            float density;
+            // Straight color in rgb, opacity of a REFERENCE_STEP long segment in a
+            HmckVec4 color;
+        };
+
+        // Points are sorted by density, densities before the first and after the last one take the color
+        // of that point. At least one point is required.
+        void setControlPoints(std::vector<ControlPoint> controlPoints);
+
+        [[nodiscard]] const std::vector<ControlPoint> &controlPoints() const { return points; }
+
+        [[nodiscard]] HmckVec4 evaluate(float density) const;
+
+        // Tabulates the function, the pre-integrated table for segments stepSize long. Rows of the
+        // pre-integrated table are spread over the pool.
+        void build(float stepSize, ThreadPool &threadPool);
+
+        // Step the tables were last built for, 0 before the first build
+        [[nodiscard]] float stepSize() const { return builtStepSize; }
+
+        // TABLE_SIZE colors, the first for density 0 and the last for density 1, as evaluate() returns them.
+        // Stored as floats so that it can be uploaded as an R32G32B32A32_SFLOAT texture.
+        [[nodiscard]] const std::vector<HmckVec4> &lookupTable() const { return lookup; }
+
+        // TABLE_SIZE x TABLE_SIZE colors of segments from the front density along x to the back density
+        // along y, rgb premultiplied by the opacity of the whole segment
+        [[nodiscard]] const std::vector<HmckVec4> &preintegratedTable() const { return preintegrated; }
+
+        // Densities outside [lo, hi] are fully transparent, lo > hi when all of them are
+        void visibleRange(float &lo, float &hi) const;
+
+    private:
+        std::vector<ControlPoint> points{{0.0f, {0.0f, 0.0f, 0.0f, 0.0f}}};
+        std::vector<HmckVec4> lookup;
+        std::vector<HmckVec4> preintegrated;
+        float builtStepSize = 0.0f;
+    };
+}
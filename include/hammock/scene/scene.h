@@ -3,4 +3,8 @@
 #include "AssetDelivery.h"
 #include "Camera.h"
 #include "Geometry.h"
+#include "GradientVolume.h"
+#include "Isosurface.h"
+#include "MacrocellGrid.h"
+#include "TransferFunction.h"
 #include "Vertex.h"
\ No newline at end of file
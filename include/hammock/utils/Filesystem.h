@@ -7,9 +7,12 @@
 #include <iostream>
 #include <string>
 #include <cmath>
+#include <cstring>
+#include <vector>
 #include <stb_image.h>
 #include <stb_image_write.h>
 
+#include "hammock/utils/HalfFloat.h"
 #include "hammock/utils/Logger.h"
 
 namespace Hammock{
@@ -131,13 +134,32 @@ namespace Hammock{
             R8_UNORM,
             R8G8_UNORM,
             R8G8B8_UNORM,
-            R8G8B8A8_UNORM
+            R8G8B8A8_UNORM,
+            R16_UNORM,
+            R16_SFLOAT
         };
 
+        // Bytes of one channel of a pixel in format
+        inline uint32_t channelSize(const ImageFormat format) {
+            switch (format) {
+                case ImageFormat::R8_UNORM:
+                case ImageFormat::R8G8_UNORM:
+                case ImageFormat::R8G8B8_UNORM:
+                case ImageFormat::R8G8B8A8_UNORM:
+                    return 1;
+                case ImageFormat::R16_UNORM:
+                case ImageFormat::R16_SFLOAT:
+                    return 2;
+                default:
+                    return 4;
+            }
+        }
+
         inline const void *readImage(const std::string &filename, int &width, int &height, int &channels,
                                      const ImageFormat format = ImageFormat::R32G32B32A32_SFLOAT, uint32_t flags = 0) {
             int desiredChannels = 4; // Default desired channels
-            if (format == ImageFormat::R32_SFLOAT || format == ImageFormat::R8_UNORM)
+            if (format == ImageFormat::R32_SFLOAT || format == ImageFormat::R8_UNORM ||
+                format == ImageFormat::R16_UNORM || format == ImageFormat::R16_SFLOAT)
                 desiredChannels = 1;
             else if (format == ImageFormat::R32G32_SFLOAT || format == ImageFormat::R8G8_UNORM)
                 desiredChannels = 2;
@@ -148,6 +170,39 @@ namespace Hammock{
 
             stbi_set_flip_vertically_on_load(flags & FLIP_Y); // Handle vertical flipping if requested
 
+            // Single channel 16 bit data, 8 bit images are widened to the full 16 bit range
+            if (format == ImageFormat::R16_UNORM) {
+                const stbi_us *data = stbi_load_16(filename.c_str(), &width, &height, &channels, desiredChannels);
+                stbi_set_flip_vertically_on_load(false); // Reset flipping after loading
+
+                if (!data) {
+                    Logger::log(LOG_LEVEL_ERROR, "Error: Failed to load image!\n");
+                    throw std::runtime_error("Image loading failed.");
+                }
+
+                channels = desiredChannels;
+                return data;
+            }
+
+            // Single channel half floats, decoded like R32_SFLOAT
+            if (format == ImageFormat::R16_SFLOAT) {
+                const float *data = stbi_loadf(filename.c_str(), &width, &height, &channels, desiredChannels);
+                stbi_set_flip_vertically_on_load(false); // Reset flipping after loading
+
+                if (!data) {
+                    Logger::log(LOG_LEVEL_ERROR, "Error: Failed to load image!\n");
+                    throw std::runtime_error("Image loading failed.");
+                }
+
+                const size_t pixelCount = static_cast<size_t>(width) * static_cast<size_t>(height);
+                uint16_t *processedData = new uint16_t[pixelCount];
+                floatToHalf(data, processedData, pixelCount);
+
+                stbi_image_free(const_cast<float *>(data));
+                channels = desiredChannels;
+                return processedData;
+            }
+
             // Load HDR data
             if (format == ImageFormat::R32_SFLOAT || format == ImageFormat::R32G32_SFLOAT ||
                 format == ImageFormat::R32G32B32_SFLOAT || format == ImageFormat::R32G32B32A32_SFLOAT) {
@@ -241,50 +296,46 @@ namespace Hammock{
 
 
         // Can also be used to read cube map faces
-        inline const float *readVolume(const std::vector<std::string> &slices, int &width, int &height, int &channels,
-                                       int &depth, const ImageFormat format = ImageFormat::R32G32B32A32_SFLOAT,
-                                       uint32_t flags = 0) {
+        // Reads the slices into one buffer, x-fastest and slice after slice, with samples in format. UNORM
+        // formats keep the values stored in the slices, SFLOAT formats hold what stb_image decodes them to,
+        // which for 8 bit images includes its LDR to HDR gamma.
+        inline const void *readVolume(const std::vector<std::string> &slices, int &width, int &height, int &channels,
+                                      int &depth, const ImageFormat format = ImageFormat::R32G32B32A32_SFLOAT,
+                                      uint32_t flags = 0) {
             if (slices.empty()) {
                 Logger::log(LOG_LEVEL_ERROR, "Error: No slice file paths provided\n");
                 throw std::runtime_error("Error: No slice file paths provided.");
             }
-            // TODO make this general to support uint buffer as well as float buffers
-            if (format == ImageFormat::R8_UNORM || format == ImageFormat::R8G8B8_UNORM || format ==
-                ImageFormat::R8G8B8A8_UNORM) {
-                Logger::log(LOG_LEVEL_ERROR, "Error: SDR content not supported\n");
-                throw std::runtime_error("Error: SDR content not supported.");
-            }
 
             // Read the first slice to determine width, height, and channels
-            const float *firstSlice = static_cast<const float *>(readImage(
-                slices[0], width, height, channels, format, flags));
+            const void *firstSlice = readImage(slices[0], width, height, channels, format, flags);
             depth = slices.size(); // The number of slices determines the depth
 
             // Allocate memory for the 3D texture
-            size_t sliceSize = width * height * channels;
-            float *volumeData = new float[sliceSize * depth];
+            const size_t sliceBytes = static_cast<size_t>(width) * height * channels * channelSize(format);
+            uint8_t *volumeData = new uint8_t[sliceBytes * depth];
 
             // Copy the first slice into the buffer
-            std::copy(firstSlice, firstSlice + sliceSize, volumeData);
-            stbi_image_free(const_cast<float *>(firstSlice)); // Free the first slice
+            std::memcpy(volumeData, firstSlice, sliceBytes);
+            stbi_image_free(const_cast<void *>(firstSlice)); // Free the first slice
 
             // Read and copy the remaining slices
             for (size_t i = 1; i < slices.size(); ++i) {
                 int currentWidth, currentHeight, currentChannels;
-                const float *sliceData = static_cast<const float *>(readImage(
-                    slices[i], currentWidth, currentHeight, currentChannels, format, flags));
+                const void *sliceData = readImage(slices[i], currentWidth, currentHeight, currentChannels, format,
+                                                  flags);
 
                 // Validate dimensions match
                 if (currentWidth != width || currentHeight != height || currentChannels != channels) {
                     delete[] volumeData;
-                    stbi_image_free(const_cast<float *>(sliceData));
+                    stbi_image_free(const_cast<void *>(sliceData));
                     Logger::log(LOG_LEVEL_ERROR, "Error: Slice dimensions or channels mismatch in slice %d\n", i);
                     throw std::runtime_error("Error: Slice dimensions or channels mismatch!");
                 }
 
                 // Copy the slice into the correct position in the 3D buffer
-                std::copy(sliceData, sliceData + sliceSize, volumeData + i * sliceSize);
-                stbi_image_free(const_cast<float *>(sliceData)); // Free the current slice
+                std::memcpy(volumeData + i * sliceBytes, sliceData, sliceBytes);
+                stbi_image_free(const_cast<void *>(sliceData)); // Free the current slice
             }
 
             return volumeData;
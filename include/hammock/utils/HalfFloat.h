@@ -0,0 +1,98 @@
+#pragma once
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+
+// F16C is not implied by -mavx2 on GCC and Clang, MSVC allows the intrinsics with /arch:AVX2
+#if defined(__F16C__) || (defined(_MSC_VER) && defined(__AVX2__))
+#include <immintrin.h>
+#define HAMMOCK_HALF_CONVERT_F16C
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define HAMMOCK_HALF_CONVERT_SSE2
+#endif
+
+namespace Hammock {
+    // IEEE 754 binary16 to binary32, exact for every input including subnormals, infinities and NaNs.
+    // Branch free, the SSE2 path below is the same computation four lanes at a time.
+    inline float halfToFloat(uint16_t half) {
+        const uint32_t shifted = static_cast<uint32_t>(half & 0x7fffu) << 13;
+        const uint32_t exponent = shifted & 0x0f800000u;
+        uint32_t bits = shifted + (112u << 23); // rebias the exponent
+        bits += exponent == 0x0f800000u ? 112u << 23 : 0u; // Inf and NaN keep the maximum exponent
+        // Subnormals are renormalized by the FPU, 2^-14 * (1 + m / 1024) - 2^-14
+        const float normal = std::bit_cast<float>(bits);
+        const float subnormal = std::bit_cast<float>(bits + (1u << 23)) - std::bit_cast<float>(113u << 23);
+        const uint32_t magnitude = std::bit_cast<uint32_t>(exponent == 0 ? subnormal : normal);
+        return std::bit_cast<float>(magnitude | static_cast<uint32_t>(half & 0x8000u) << 16);
+    }
+
+#if defined(HAMMOCK_HALF_CONVERT_SSE2)
+    // Four halves zero extended to 32 bit lanes
+    inline __m128 halfToFloat4(__m128i half) {
+        const __m128i shifted = _mm_slli_epi32(_mm_and_si128(half, _mm_set1_epi32(0x7fff)), 13);
+        const __m128i exponent = _mm_and_si128(shifted, _mm_set1_epi32(0x0f800000));
+        const __m128i infNan = _mm_cmpeq_epi32(exponent, _mm_set1_epi32(0x0f800000));
+        const __m128i rebias = _mm_set1_epi32(112 << 23);
+        const __m128i bits = _mm_add_epi32(_mm_add_epi32(shifted, rebias), _mm_and_si128(infNan, rebias));
+        const __m128 subnormal = _mm_sub_ps(_mm_castsi128_ps(_mm_add_epi32(bits, _mm_set1_epi32(1 << 23))),
+                                            _mm_castsi128_ps(_mm_set1_epi32(113 << 23)));
+        const __m128i isSubnormal = _mm_cmpeq_epi32(exponent, _mm_setzero_si128());
+        const __m128i magnitude = _mm_or_si128(_mm_and_si128(isSubnormal, _mm_castps_si128(subnormal)),
+                                               _mm_andnot_si128(isSubnormal, bits));
+        const __m128i sign = _mm_slli_epi32(_mm_and_si128(half, _mm_set1_epi32(0x8000)), 16);
+        return _mm_castsi128_ps(_mm_or_si128(magnitude, sign));
+    }
+#endif
+
+    // Converts count contiguous halves, 8 at a time with F16C or SSE2 when available
+    inline void halfToFloat(const uint16_t *in, float *out, std::size_t count) {
+        std::size_t i = 0;
+#if defined(HAMMOCK_HALF_CONVERT_F16C)
+        for (; i + 8 <= count; i += 8) {
+            _mm256_storeu_ps(out + i, _mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i))));
+        }
+#elif defined(HAMMOCK_HALF_CONVERT_SSE2)
+        for (; i + 8 <= count; i += 8) {
+            const __m128i halves = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i));
+            _mm_storeu_ps(out + i, halfToFloat4(_mm_unpacklo_epi16(halves, _mm_setzero_si128())));
+            _mm_storeu_ps(out + i + 4, halfToFloat4(_mm_unpackhi_epi16(halves, _mm_setzero_si128())));
+        }
+#endif
+        for (; i < count; ++i) {
+            out[i] = halfToFloat(in[i]);
+        }
+    }
+
+    // IEEE 754 binary32 to binary16, rounded to nearest even like the hardware conversion. Values beyond the
+    // half range become infinities, NaNs stay NaNs.
+    inline uint16_t floatToHalf(float value) {
+        const uint32_t bits = std::bit_cast<uint32_t>(value);
+        const auto sign = static_cast<uint16_t>(bits >> 16 & 0x8000u);
+        const uint32_t magnitude = bits & 0x7fffffffu;
+        if (magnitude > 0x7f800000u) return sign | 0x7e00u;
+        if (magnitude >= 0x477ff000u) return sign | 0x7c00u; // 65520 and above round up to infinity
+        if (magnitude >= 0x38800000u) {
+            // Normal half, rebias the exponent and round the 13 dropped mantissa bits
+            const uint32_t rebiased = magnitude - (112u << 23);
+            return sign | static_cast<uint16_t>((rebiased + 0x0fffu + (rebiased >> 13 & 1u)) >> 13);
+        }
+        // Subnormal half, adding 0.5 makes the FPU round the value to a multiple of 2^-24 in the low mantissa bits
+        const float rounded = std::bit_cast<float>(magnitude) + 0.5f;
+        return sign | static_cast<uint16_t>(std::bit_cast<uint32_t>(rounded) - 0x3f000000u);
+    }
+
+    // Converts count contiguous floats, 8 at a time with F16C when available
+    inline void floatToHalf(const float *in, uint16_t *out, std::size_t count) {
+        std::size_t i = 0;
+#if defined(HAMMOCK_HALF_CONVERT_F16C)
+        for (; i + 8 <= count; i += 8) {
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i),
+                             _mm256_cvtps_ph(_mm256_loadu_ps(in + i), _MM_FROUND_TO_NEAREST_INT));
+        }
+#endif
+        for (; i < count; ++i) {
+            out[i] = floatToHalf(in[i]);
+        }
+    }
+}
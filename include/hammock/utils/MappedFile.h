@@ -0,0 +1,35 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace Hammock {
+    // Read only memory mapping of a whole file, the mapping lives as long as the object.
+    // A file that cannot be opened or is empty leaves the object closed, check isOpen().
+    class MappedFile {
+    public:
+        MappedFile() = default;
+
+        explicit MappedFile(const std::string &path);
+
+        ~MappedFile() { close(); }
+
+        MappedFile(const MappedFile &) = delete;
+
+        MappedFile &operator=(const MappedFile &) = delete;
+
+        [[nodiscard]] bool isOpen() const { return data_ != nullptr; }
+        [[nodiscard]] const uint8_t *data() const { return static_cast<const uint8_t *>(data_); }
+        [[nodiscard]] std::size_t size() const { return size_; }
+
+    private:
+        void close();
+
+        // File and mapping handles on Windows, the descriptor elsewhere
+        void *file = nullptr;
+        void *mapping = nullptr;
+        int descriptor = -1;
+        void *data_ = nullptr;
+        std::size_t size_ = 0;
+    };
+}
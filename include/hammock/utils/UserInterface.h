@@ -9,6 +9,8 @@
 
 
 namespace Hammock {
+    class TransferFunction;
+
     class UserInterface {
     public:
         UserInterface(Device &device, VkRenderPass renderPass, VkDescriptorPool descriptorPool, Window &window);
@@ -26,6 +28,9 @@ namespace Hammock {
 
         void showColorSettings(float *exposure, float *gamma, float *whitePoint);
 
+        // Control point editor drawn into the current window, returns true when the points changed
+        static bool showTransferFunctionEditor(TransferFunction &transferFunction);
+
         static void forwardKeyDownEvent(ImGuiKey key, bool down){ImGui::GetIO().AddKeyEvent(key,down);}
         static void forwardButtonDownEvent(int button, bool down){ImGui::GetIO().AddMouseButtonEvent(button,down);}
         static void forwardMousePosition(float x, float y){ImGui::GetIO().AddMousePosEvent(x,y);}
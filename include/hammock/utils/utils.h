@@ -2,8 +2,10 @@
 
 #include "BenchmarkRunner.h"
 #include "EventEmitter.h"
+#include "HalfFloat.h"
 #include "Helpers.h"
 #include "Logger.h"
+#include "MappedFile.h"
 #include "ScopedMemory.h"
 #include "UserInterface.h"
 #include "Math.h"
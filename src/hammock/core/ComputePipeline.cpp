@@ -0,0 +1,73 @@
+#include "hammock/core/ComputePipeline.h"
+
+std::unique_ptr<Hammock::ComputePipeline> Hammock::ComputePipeline::createComputePipelinePtr(
+    ComputePipelineCreateInfo createInfo) {
+    return std::make_unique<ComputePipeline>(createInfo);
+}
+
+void Hammock::ComputePipeline::bind(VkCommandBuffer commandBuffer) {
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, computePipeline);
+}
+
+void Hammock::ComputePipeline::dispatch(VkCommandBuffer commandBuffer, uint32_t groupCountX, uint32_t groupCountY,
+                                        uint32_t groupCountZ) {
+    vkCmdDispatch(commandBuffer, groupCountX, groupCountY, groupCountZ);
+}
+
+Hammock::ComputePipeline::~ComputePipeline() {
+    vkDestroyShaderModule(device.device(), compShaderModule, nullptr);
+    vkDestroyPipelineLayout(device.device(), computePipelineLayout, nullptr);
+    vkDestroyPipeline(device.device(), computePipeline, nullptr);
+}
+
+Hammock::ComputePipeline::ComputePipeline(Hammock::ComputePipeline::ComputePipelineCreateInfo &createInfo) : device{
+    createInfo.device
+} {
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(createInfo.descriptorSetLayouts.size());
+    pipelineLayoutInfo.pSetLayouts = createInfo.descriptorSetLayouts.data();
+    pipelineLayoutInfo.pushConstantRangeCount = static_cast<uint32_t>(createInfo.pushConstantRanges.size());
+    pipelineLayoutInfo.pPushConstantRanges = createInfo.pushConstantRanges.data();
+
+    if (vkCreatePipelineLayout(createInfo.device.device(), &pipelineLayoutInfo, nullptr, &computePipelineLayout) !=
+        VK_SUCCESS) {
+        throw std::runtime_error("failed to create pipeline layout");
+    }
+
+    createShaderModule(createInfo.CS.byteCode, &compShaderModule);
+
+    VkPipelineShaderStageCreateInfo shaderStage{};
+    shaderStage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    shaderStage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+    shaderStage.module = compShaderModule;
+    shaderStage.pName = createInfo.CS.entryFunc.c_str();
+
+    VkComputePipelineCreateInfo pipelineInfo{};
+    pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    pipelineInfo.stage = shaderStage;
+    pipelineInfo.layout = computePipelineLayout;
+    pipelineInfo.basePipelineIndex = -1;
+    pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
+
+    if (vkCreateComputePipelines(
+            createInfo.device.device(),
+            VK_NULL_HANDLE,
+            1,
+            &pipelineInfo,
+            nullptr,
+            &computePipeline) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create compute pipeline");
+    }
+}
+
+void Hammock::ComputePipeline::createShaderModule(const std::vector<char> &code, VkShaderModule *shaderModule) const {
+    VkShaderModuleCreateInfo createInfo{};
+    createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+    createInfo.codeSize = code.size();
+    createInfo.pCode = reinterpret_cast<const uint32_t *>(code.data());
+
+    if (vkCreateShaderModule(device.device(), &createInfo, nullptr, shaderModule) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create shader module");
+    }
+}
@@ -69,9 +69,17 @@ namespace Hammock {
         deviceProperties2.pNext = &rayTracingPipelineProperties;
         vkGetPhysicalDeviceProperties2(physicalDevice, &deviceProperties2);
 
+        VkPhysicalDeviceFeatures supportedFeatures;
+        vkGetPhysicalDeviceFeatures(physicalDevice, &supportedFeatures);
+
         VkPhysicalDeviceFeatures deviceFeatures = {};
         deviceFeatures.samplerAnisotropy = VK_TRUE;
         deviceFeatures.fillModeNonSolid = VK_TRUE;
+        // Optional, the bricked raymarcher reports the bricks it touches from the fragment shader
+        deviceFeatures.fragmentStoresAndAtomics = supportedFeatures.fragmentStoresAndAtomics;
+        // Optional, brick meshes are drawn with one indirect draw of many commands where it is supported
+        deviceFeatures.multiDrawIndirect = supportedFeatures.multiDrawIndirect;
+        enabledFeatures = deviceFeatures;
 
         // Create the physical device features structures
 
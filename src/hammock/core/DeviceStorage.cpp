@@ -36,7 +36,7 @@ Hammock::ResourceHandle<Hammock::Buffer> Hammock::DeviceStorage::createBuffer(Bu
 
     if (createInfo.map) buffer->map();
 
-    ResourceHandle<Buffer> handle(static_cast<id_t>(buffers.size()));
+    ResourceHandle<Buffer> handle(nextId++);
     buffers.emplace(handle.id(), std::move(buffer));
     return handle;
 }
@@ -104,7 +104,7 @@ Hammock::ResourceHandle<Hammock::DescriptorSetLayout> Hammock::DeviceStorage::cr
     }
     auto descriptorSetLayout = descriptorSetLayoutBuilder.build();
 
-    ResourceHandle<DescriptorSetLayout> handle(static_cast<id_t>(descriptorSetLayouts.size()));
+    ResourceHandle<DescriptorSetLayout> handle(nextId++);
     descriptorSetLayouts.emplace(handle.id(), std::move(descriptorSetLayout));
     return handle;
 }
@@ -113,6 +113,21 @@ Hammock::ResourceHandle<VkDescriptorSet_T *> Hammock::DeviceStorage::createDescr
     const DescriptorSetCreateInfo &createInfo) {
     VkDescriptorSet descriptorSet;
 
+    if (createDescriptorWriter(createInfo).build(descriptorSet)) {
+        ResourceHandle<VkDescriptorSet> handle(nextId++);
+        descriptorSets.emplace(handle.id(), descriptorSet);
+        return handle;
+    }
+
+    throw std::runtime_error("Faild to create descriptor!");
+}
+
+void Hammock::DeviceStorage::updateDescriptorSet(ResourceHandle<VkDescriptorSet> handle,
+                                                 const DescriptorSetCreateInfo &createInfo) {
+    createDescriptorWriter(createInfo).overwrite(descriptorSets.at(handle.id()));
+}
+
+Hammock::DescriptorWriter Hammock::DeviceStorage::createDescriptorWriter(const DescriptorSetCreateInfo &createInfo) {
     auto writer = DescriptorWriter(getDescriptorSetLayout(createInfo.descriptorSetLayout), *descriptorPool);
 
     for (auto &buffer: createInfo.bufferWrites) {
@@ -136,13 +151,7 @@ Hammock::ResourceHandle<VkDescriptorSet_T *> Hammock::DeviceStorage::createDescr
                                           &accelerationStructure.accelerationStructureInfo);
     }
 
-    if (writer.build(descriptorSet)) {
-        ResourceHandle<VkDescriptorSet> handle(static_cast<id_t>(descriptorSets.size()));
-        descriptorSets.emplace(handle.id(), descriptorSet);
-        return handle;
-    }
-
-    throw std::runtime_error("Faild to create descriptor!");
+    return writer;
 }
 
 Hammock::ResourceHandle<Hammock::Texture2D> Hammock::DeviceStorage::createTexture2D(
@@ -172,14 +181,14 @@ Hammock::ResourceHandle<Hammock::Texture2D> Hammock::DeviceStorage::createTextur
     }
 
     texture->updateDescriptor();
-    ResourceHandle<Texture2D> handle(static_cast<id_t>(texture2Ds.size()));
+    ResourceHandle<Texture2D> handle(nextId++);
     texture2Ds.emplace(handle.id(), std::move(texture));
     return handle;
 }
 
 Hammock::ResourceHandle<Hammock::Texture2D> Hammock::DeviceStorage::createEmptyTexture2D() {
     std::unique_ptr<Texture2D> texture = std::make_unique<Texture2D>(device);
-    ResourceHandle<Texture2D> handle(static_cast<id_t>(texture2Ds.size()));
+    ResourceHandle<Texture2D> handle(nextId++);
     texture2Ds.emplace(handle.id(), std::move(texture));
     return handle;
 }
@@ -196,11 +205,13 @@ Hammock::ResourceHandle<Hammock::Texture3D> Hammock::DeviceStorage::createTextur
         createInfo.format,
         createInfo.imageLayout
     );
+    texture->valueScale = createInfo.valueScale;
+    texture->valueBias = createInfo.valueBias;
     if (createInfo.samplerInfo.createSampler) {
         texture->createSampler(device, createInfo.samplerInfo.filter, createInfo.samplerInfo.addressMode);
     }
     texture->updateDescriptor();
-    ResourceHandle<Texture3D> handle(static_cast<id_t>(texture3Ds.size()));
+    ResourceHandle<Texture3D> handle(nextId++);
     texture3Ds.emplace(handle.id(), std::move(texture));
     return handle;
 }
@@ -279,6 +290,13 @@ void Hammock::DeviceStorage::destroyBuffer(ResourceHandle<Buffer> handle) {
     buffers.erase(handle.id());
 }
 
+void Hammock::DeviceStorage::destroyDescriptorSet(ResourceHandle<VkDescriptorSet> handle) {
+    if (const auto it = descriptorSets.find(handle.id()); it != descriptorSets.end()) {
+        descriptorPool->freeDescriptors({it->second});
+        descriptorSets.erase(it);
+    }
+}
+
 void Hammock::DeviceStorage::destroyDescriptorSetLayout(ResourceHandle<DescriptorSetLayout> handle) {
     descriptorSetLayouts.erase(handle.id());
 }
@@ -0,0 +1,285 @@
+#include "hammock/resources/BrickCache.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+    void imageBarrier(VkCommandBuffer commandBuffer, VkImage image, VkImageLayout oldLayout,
+                      VkImageLayout newLayout, VkPipelineStageFlags srcStage, VkAccessFlags srcAccess,
+                      VkPipelineStageFlags dstStage, VkAccessFlags dstAccess) {
+        VkImageMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        barrier.oldLayout = oldLayout;
+        barrier.newLayout = newLayout;
+        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.image = image;
+        barrier.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
+        barrier.srcAccessMask = srcAccess;
+        barrier.dstAccessMask = dstAccess;
+        vkCmdPipelineBarrier(commandBuffer, srcStage, dstStage, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+    }
+}
+
+Hammock::BrickCache::BrickCache(Device &device, DeviceStorage &deviceStorage, const CreateInfo &createInfo)
+    : device(device), deviceStorage(deviceStorage), volume(createInfo.volume),
+      slots{createInfo.slots[0], createInfo.slots[1], createInfo.slots[2]},
+      uploadsPerFrame(createInfo.uploadsPerFrame),
+      maxPending(createInfo.uploadsPerFrame * createInfo.framesInFlight * 2) {
+    const uint32_t padded = volume.paddedBrickSize();
+    const uint32_t slotCount = slots[0] * slots[1] * slots[2];
+
+    bricks.resize(volume.brickCount());
+    pageValues.assign(volume.brickCount(), PAGE_MISSING);
+    slotBricks.assign(slotCount, NO_SLOT);
+    slotStamps.assign(slotCount, 0);
+    slotEntries.resize(slotCount);
+    // Handed out from the back, so slot 0 goes first
+    for (uint32_t slot = slotCount; slot > 0; slot--) freeSlots.push_back(slot - 1);
+
+    {
+        const std::vector<float> empty(static_cast<std::size_t>(slotCount) * volume.brickSamples(), 0.0f);
+        atlas = deviceStorage.createTexture3D({
+            .buffer = empty.data(),
+            .instanceSize = sizeof(float),
+            .width = slots[0] * padded, .height = slots[1] * padded,
+            .channels = 1, .depth = slots[2] * padded,
+            .format = VK_FORMAT_R32_SFLOAT,
+            .imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
+        });
+    }
+    pageTable = deviceStorage.createTexture3D({
+        .buffer = pageValues.data(),
+        .instanceSize = sizeof(float),
+        .width = volume.bricksX(), .height = volume.bricksY(),
+        .channels = 1, .depth = volume.bricksZ(),
+        .format = VK_FORMAT_R32_SFLOAT,
+        .imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+        .samplerInfo = {.filter = VK_FILTER_NEAREST}
+    });
+
+    frames.resize(createInfo.framesInFlight);
+    for (auto &frame: frames) {
+        frame.feedback = deviceStorage.createBuffer({
+            .instanceSize = sizeof(uint32_t),
+            .instanceCount = static_cast<uint32_t>(volume.brickCount()),
+            .usageFlags = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+            .memoryPropertyFlags = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
+        });
+        std::memset(deviceStorage.getBuffer(frame.feedback)->getMappedMemory(), 0,
+                    volume.brickCount() * sizeof(uint32_t));
+        // Brick payloads followed by the page table
+        frame.staging = deviceStorage.createBuffer({
+            .instanceSize = 1,
+            .instanceCount = static_cast<uint32_t>(uploadsPerFrame * volume.brickBytes() +
+                                                   volume.brickCount() * sizeof(float)),
+            .usageFlags = VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+            .memoryPropertyFlags = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
+        });
+    }
+
+    loader = std::thread(&BrickCache::loaderLoop, this);
+}
+
+Hammock::BrickCache::~BrickCache() {
+    {
+        std::lock_guard lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    if (loader.joinable()) loader.join();
+}
+
+void Hammock::BrickCache::loaderLoop() {
+    std::unique_lock lock(mutex);
+    while (true) {
+        wake.wait(lock, [this] { return stopping || !requests.empty(); });
+        if (stopping) return;
+        const uint32_t brick = requests.front();
+        requests.pop_front();
+
+        // Reading the payload is what pages it in, the lock is not held meanwhile
+        lock.unlock();
+        const float *samples = volume.brickData(brick);
+        LoadedBrick result{brick, std::vector<float>(samples, samples + volume.brickSamples())};
+        lock.lock();
+        loaded.push_back(std::move(result));
+    }
+}
+
+float Hammock::BrickCache::pageValue(uint32_t brick) const {
+    if (bricks[brick].empty) return PAGE_EMPTY;
+    if (bricks[brick].slot == NO_SLOT) return PAGE_MISSING;
+    return static_cast<float>(bricks[brick].slot);
+}
+
+void Hammock::BrickCache::setVisibleRange(float lo, float hi) {
+    for (uint32_t brick = 0; brick < bricks.size(); brick++) {
+        const BrickedVolume::BrickInfo &info = volume.brickInfo(brick);
+        bricks[brick].empty = info.maxValue < lo || info.minValue > hi;
+        // Resident bricks keep their slots, they are still valid when the range widens again
+        const float value = pageValue(brick);
+        if (value != pageValues[brick]) {
+            pageValues[brick] = value;
+            pageTableDirty = true;
+        }
+    }
+}
+
+void Hammock::BrickCache::touch(uint32_t slot) {
+    slotStamps[slot] = feedbackStamp;
+    lru.splice(lru.begin(), lru, slotEntries[slot]);
+}
+
+uint32_t Hammock::BrickCache::acquireSlot() {
+    uint32_t slot;
+    if (!freeSlots.empty()) {
+        slot = freeSlots.back();
+        freeSlots.pop_back();
+        lru.push_front(slot);
+        slotEntries[slot] = lru.begin();
+    } else {
+        slot = lru.back();
+        if (slotStamps[slot] >= feedbackStamp) return NO_SLOT;
+
+        const uint32_t brick = slotBricks[slot];
+        bricks[brick].slot = NO_SLOT;
+        pageValues[brick] = pageValue(brick);
+        resident--;
+        evicted++;
+        lru.splice(lru.begin(), lru, slotEntries[slot]);
+    }
+    slotStamps[slot] = feedbackStamp;
+    return slot;
+}
+
+void Hammock::BrickCache::update(VkCommandBuffer commandBuffer, uint32_t frameIndex) {
+    Frame &frame = frames[frameIndex];
+
+    // The fence of this frame has been waited for, its feedback is complete
+    std::vector<uint32_t> missing;
+    if (frame.stamp != 0) {
+        feedbackStamp = frame.stamp;
+        const auto *usage = static_cast<const uint32_t *>(deviceStorage.getBuffer(frame.feedback)->getMappedMemory());
+        for (uint32_t brick = 0; brick < bricks.size(); brick++) {
+            if (usage[brick] != feedbackStamp) continue;
+            if (bricks[brick].slot != NO_SLOT) {
+                touch(bricks[brick].slot);
+            } else if (!bricks[brick].empty && !bricks[brick].requested && pending + missing.size() < maxPending) {
+                bricks[brick].requested = true;
+                missing.push_back(brick);
+            }
+        }
+    }
+    frame.stamp = ++currentStamp;
+
+    std::vector<LoadedBrick> ready;
+    {
+        std::lock_guard lock(mutex);
+        requests.insert(requests.end(), missing.begin(), missing.end());
+        const std::size_t count = std::min<std::size_t>(loaded.size(), uploadsPerFrame);
+        ready.assign(std::make_move_iterator(loaded.begin()), std::make_move_iterator(loaded.begin() + count));
+        loaded.erase(loaded.begin(), loaded.begin() + count);
+    }
+    if (!missing.empty()) wake.notify_one();
+    pending += static_cast<uint32_t>(missing.size());
+    pending -= static_cast<uint32_t>(ready.size());
+
+    // Copy what still needs a slot into the staging buffer of this frame
+    const uint32_t padded = volume.paddedBrickSize();
+    auto *staging = static_cast<uint8_t *>(deviceStorage.getBuffer(frame.staging)->getMappedMemory());
+    std::vector<VkBufferImageCopy> regions;
+    for (const LoadedBrick &brick: ready) {
+        bricks[brick.brick].requested = false;
+        // Became empty while loading, or the atlas is full of bricks in use
+        if (bricks[brick.brick].empty || bricks[brick.brick].slot != NO_SLOT) continue;
+        const uint32_t slot = acquireSlot();
+        if (slot == NO_SLOT) continue;
+
+        slotBricks[slot] = brick.brick;
+        bricks[brick.brick].slot = slot;
+        pageValues[brick.brick] = pageValue(brick.brick);
+        pageTableDirty = true;
+        resident++;
+        uploaded++;
+
+        const VkDeviceSize offset = regions.size() * volume.brickBytes();
+        std::memcpy(staging + offset, brick.samples.data(), volume.brickBytes());
+
+        VkBufferImageCopy region{};
+        region.bufferOffset = offset;
+        region.imageSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1};
+        region.imageOffset = {
+            static_cast<int32_t>(slot % slots[0] * padded),
+            static_cast<int32_t>(slot / slots[0] % slots[1] * padded),
+            static_cast<int32_t>(slot / (slots[0] * slots[1]) * padded)
+        };
+        region.imageExtent = {padded, padded, padded};
+        regions.push_back(region);
+    }
+
+    if (!regions.empty()) {
+        const VkImage image = deviceStorage.getTexture3D(atlas)->image;
+        // Earlier frames may still sample the slots that get overwritten
+        imageBarrier(commandBuffer, image, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                     VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0,
+                     VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT);
+        vkCmdCopyBufferToImage(commandBuffer, deviceStorage.getBuffer(frame.staging)->getBuffer(), image,
+                               VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, static_cast<uint32_t>(regions.size()),
+                               regions.data());
+        imageBarrier(commandBuffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                     VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                     VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
+    }
+
+    if (pageTableDirty) {
+        pageTableDirty = false;
+        const VkDeviceSize offset = uploadsPerFrame * volume.brickBytes();
+        std::memcpy(staging + offset, pageValues.data(), pageValues.size() * sizeof(float));
+
+        VkBufferImageCopy region{};
+        region.bufferOffset = offset;
+        region.imageSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1};
+        region.imageExtent = {volume.bricksX(), volume.bricksY(), volume.bricksZ()};
+
+        const VkImage image = deviceStorage.getTexture3D(pageTable)->image;
+        imageBarrier(commandBuffer, image, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                     VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0,
+                     VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT);
+        vkCmdCopyBufferToImage(commandBuffer, deviceStorage.getBuffer(frame.staging)->getBuffer(), image,
+                               VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+        imageBarrier(commandBuffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                     VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                     VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
+    }
+}
+
+void Hammock::BrickCache::recordFeedbackBarrier(VkCommandBuffer commandBuffer) const {
+    VkMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0,
+                         1, &barrier, 0, nullptr, 0, nullptr);
+}
+
+VkDescriptorImageInfo Hammock::BrickCache::atlasDescriptor() {
+    return deviceStorage.getTexture3DDescriptorImageInfo(atlas);
+}
+
+VkDescriptorImageInfo Hammock::BrickCache::pageTableDescriptor() {
+    return deviceStorage.getTexture3DDescriptorImageInfo(pageTable);
+}
+
+VkDescriptorBufferInfo Hammock::BrickCache::feedbackDescriptor(uint32_t frameIndex) {
+    return deviceStorage.getBuffer(frames[frameIndex].feedback)->descriptorInfo();
+}
+
+void Hammock::BrickCache::destroy() {
+    for (auto &frame: frames) {
+        deviceStorage.destroyBuffer(frame.feedback);
+        deviceStorage.destroyBuffer(frame.staging);
+    }
+    deviceStorage.destroyTexture3D(atlas);
+    deviceStorage.destroyTexture3D(pageTable);
+}
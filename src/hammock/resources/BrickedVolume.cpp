@@ -0,0 +1,180 @@
+#include "hammock/resources/BrickedVolume.h"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <map>
+#include <stdexcept>
+
+#include "hammock/utils/Filesystem.h"
+#include "hammock/utils/Logger.h"
+#include "hammock/utils/ScopedMemory.h"
+
+static_assert(sizeof(Hammock::BrickedVolume::Header) == 56);
+static_assert(sizeof(Hammock::BrickedVolume::BrickInfo) == 16);
+
+Hammock::BrickedVolume::BrickedVolume(const std::string &path) : file(path) {
+    if (!file.isOpen() || file.size() < sizeof(Header)) {
+        Logger::log(LOG_LEVEL_ERROR, "Error: Could not open bricked volume %s\n", path.c_str());
+        throw std::runtime_error("Could not open bricked volume.");
+    }
+    std::memcpy(&header, file.data(), sizeof(Header));
+    if (header.magic != MAGIC || header.version != VERSION || header.brickSize == 0) {
+        Logger::log(LOG_LEVEL_ERROR, "Error: %s is not a bricked volume\n", path.c_str());
+        throw std::runtime_error("Not a bricked volume.");
+    }
+
+    const std::size_t tableBytes = brickCount() * sizeof(BrickInfo);
+    if (header.pageTableOffset % alignof(BrickInfo) != 0 || header.pageTableOffset > file.size() ||
+        file.size() - header.pageTableOffset < tableBytes) {
+        Logger::log(LOG_LEVEL_ERROR, "Error: Page table of %s is truncated\n", path.c_str());
+        throw std::runtime_error("Bricked volume is truncated.");
+    }
+    pageTable = reinterpret_cast<const BrickInfo *>(file.data() + header.pageTableOffset);
+
+    for (std::size_t brick = 0; brick < brickCount(); brick++) {
+        if (pageTable[brick].offset > file.size() || file.size() - pageTable[brick].offset < brickBytes()) {
+            Logger::log(LOG_LEVEL_ERROR, "Error: Brick %zu of %s is truncated\n", brick, path.c_str());
+            throw std::runtime_error("Bricked volume is truncated.");
+        }
+    }
+}
+
+void Hammock::BrickedVolume::convert(const std::vector<std::string> &slices, const std::string &path,
+                                     uint32_t brickSize, uint32_t flags) {
+    if (slices.empty() || brickSize == 0) {
+        Logger::log(LOG_LEVEL_ERROR, "Error: Nothing to convert into %s\n", path.c_str());
+        throw std::runtime_error("Nothing to convert into a bricked volume.");
+    }
+
+    // Slices are read on demand and dropped once no brick layer needs them anymore
+    std::map<uint32_t, ScopedMemory> window;
+    int width = 0, height = 0;
+    const auto slice = [&](uint32_t z) -> const float * {
+        auto it = window.find(z);
+        if (it == window.end()) {
+            int w, h, c;
+            ScopedMemory data{
+                Filesystem::readImage(slices[z], w, h, c, Filesystem::ImageFormat::R32_SFLOAT, flags)
+            };
+            if (width == 0) {
+                width = w;
+                height = h;
+            } else if (w != width || h != height) {
+                Logger::log(LOG_LEVEL_ERROR, "Error: Slice %s does not match the first slice\n",
+                            slices[z].c_str());
+                throw std::runtime_error("Slice dimensions do not match.");
+            }
+            it = window.emplace(z, std::move(data)).first;
+        }
+        return static_cast<const float *>(it->second.get());
+    };
+    slice(0);
+
+    Header header{};
+    header.magic = MAGIC;
+    header.version = VERSION;
+    header.size[0] = static_cast<uint32_t>(width);
+    header.size[1] = static_cast<uint32_t>(height);
+    header.size[2] = static_cast<uint32_t>(slices.size());
+    header.brickSize = brickSize;
+    for (int axis = 0; axis < 3; axis++) {
+        header.bricks[axis] = (header.size[axis] + brickSize - 1) / brickSize;
+    }
+    header.minValue = std::numeric_limits<float>::max();
+    header.maxValue = std::numeric_limits<float>::lowest();
+
+    const uint32_t padded = brickSize + 2 * APRON;
+    const std::size_t brickBytes = static_cast<std::size_t>(padded) * padded * padded * sizeof(float);
+    const std::size_t brickCount = static_cast<std::size_t>(header.bricks[0]) * header.bricks[1] * header.bricks[2];
+    const uint64_t payloadEnd = sizeof(Header) + brickCount * brickBytes;
+    header.pageTableOffset = (payloadEnd + alignof(BrickInfo) - 1) / alignof(BrickInfo) * alignof(BrickInfo);
+
+    // Written to a temporary file and renamed once complete, so an interrupted conversion never leaves
+    // a truncated volume at path
+    const std::string temporary = path + ".tmp";
+    std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+    if (!out) {
+        Logger::log(LOG_LEVEL_ERROR, "Error: Could not create %s\n", path.c_str());
+        throw std::runtime_error("Could not create bricked volume.");
+    }
+    out.write(reinterpret_cast<const char *>(&header), sizeof(Header));
+
+    std::vector<BrickInfo> pageTable(brickCount);
+    std::vector<float> payload(static_cast<std::size_t>(padded) * padded * padded);
+    std::vector<const float *> rows(padded);
+    const auto clampCoord = [](int64_t v, uint32_t size) {
+        return static_cast<uint32_t>(std::clamp<int64_t>(v, 0, static_cast<int64_t>(size) - 1));
+    };
+
+    for (uint32_t bz = 0; bz < header.bricks[2]; bz++) {
+        const int64_t firstZ = static_cast<int64_t>(bz) * brickSize - APRON;
+        while (!window.empty() && window.begin()->first < clampCoord(firstZ, header.size[2])) {
+            window.erase(window.begin());
+        }
+
+        for (uint32_t by = 0; by < header.bricks[1]; by++) {
+            for (uint32_t bx = 0; bx < header.bricks[0]; bx++) {
+                const int64_t firstY = static_cast<int64_t>(by) * brickSize - APRON;
+                const int64_t firstX = static_cast<int64_t>(bx) * brickSize - APRON;
+
+                float lo = std::numeric_limits<float>::max(), hi = std::numeric_limits<float>::lowest();
+                float *dst = payload.data();
+                for (uint32_t lz = 0; lz < padded; lz++) {
+                    const float *samples = slice(clampCoord(firstZ + lz, header.size[2]));
+                    for (uint32_t ly = 0; ly < padded; ly++) {
+                        const float *row = samples + static_cast<std::size_t>(
+                                               clampCoord(firstY + ly, header.size[1])) * header.size[0];
+                        for (uint32_t lx = 0; lx < padded; lx++) {
+                            const float value = row[clampCoord(firstX + lx, header.size[0])];
+                            lo = std::min(lo, value);
+                            hi = std::max(hi, value);
+                            *dst++ = value;
+                        }
+                    }
+                }
+
+                const std::size_t brick = bx + header.bricks[0] * (by + static_cast<std::size_t>(
+                                                                       header.bricks[1]) * bz);
+                pageTable[brick] = {sizeof(Header) + brick * brickBytes, lo, hi};
+                header.minValue = std::min(header.minValue, lo);
+                header.maxValue = std::max(header.maxValue, hi);
+                out.write(reinterpret_cast<const char *>(payload.data()), static_cast<std::streamsize>(brickBytes));
+            }
+        }
+    }
+
+    // Padding up to the page table, then the table and the final value range
+    const char zeros[alignof(BrickInfo)]{};
+    out.write(zeros, static_cast<std::streamsize>(header.pageTableOffset - payloadEnd));
+    out.write(reinterpret_cast<const char *>(pageTable.data()),
+              static_cast<std::streamsize>(pageTable.size() * sizeof(BrickInfo)));
+    out.seekp(0);
+    out.write(reinterpret_cast<const char *>(&header), sizeof(Header));
+    out.close();
+
+    std::error_code error;
+    if (!out.fail()) {
+        std::filesystem::rename(temporary, path, error);
+    }
+    if (out.fail() || error) {
+        std::filesystem::remove(temporary, error);
+        Logger::log(LOG_LEVEL_ERROR, "Error: Failed to write %s\n", path.c_str());
+        throw std::runtime_error("Failed to write bricked volume.");
+    }
+}
+
+bool Hammock::BrickedVolume::isValid(const std::string &path) {
+    std::ifstream in(path, std::ios::binary);
+    Header header{};
+    if (!in.read(reinterpret_cast<char *>(&header), sizeof(Header))) return false;
+    if (header.magic != MAGIC || header.version != VERSION || header.brickSize == 0) return false;
+
+    // The page table is written last, a file that ends exactly after it was written completely
+    std::error_code error;
+    const uint64_t size = std::filesystem::file_size(path, error);
+    const uint64_t brickCount = static_cast<uint64_t>(header.bricks[0]) * header.bricks[1] * header.bricks[2];
+    return !error && size == header.pageTableOffset + brickCount * sizeof(BrickInfo);
+}
@@ -342,6 +342,7 @@ void Hammock::Texture3D::loadFromBuffer(Device &device, const void *buffer, VkDe
     this->depth = depth;
     this->channels = channels;
     this->layout = imageLayout;
+    this->instanceSize = instanceSize;
 
     // Format support check
     // 3D texture support in Vulkan is mandatory so there is no need to check if it is supported
@@ -361,15 +362,6 @@ void Hammock::Texture3D::loadFromBuffer(Device &device, const void *buffer, VkDe
         throw std::runtime_error("Error: Requested texture dimensions is greater than supported 3D texture dimension!");
     }
 
-    // Calculate aligned dimensions based on device properties
-    VkDeviceSize alignedRowPitch = (width * instanceSize + 
-        device.properties.limits.optimalBufferCopyRowPitchAlignment - 1) & 
-        ~(device.properties.limits.optimalBufferCopyRowPitchAlignment - 1);
-    
-    VkDeviceSize alignedSlicePitch = alignedRowPitch * height;
-    VkDeviceSize totalSize = alignedSlicePitch * depth;
-
-
     VkImageCreateInfo imageCreateInfo = Init::imageCreateInfo();
     imageCreateInfo.imageType = VK_IMAGE_TYPE_3D;
     imageCreateInfo.format = format;
@@ -395,40 +387,66 @@ void Hammock::Texture3D::loadFromBuffer(Device &device, const void *buffer, VkDe
     checkResult(vkAllocateMemory(device.device(), &memAllocInfo, nullptr, &this->memory));
     checkResult(vkBindImageMemory(device.device(), this->image, this->memory, 0));
 
+    update(buffer);
+
+    // create image view
+    VkImageViewCreateInfo view = Init::imageViewCreateInfo();
+    view.image = this->image;
+    view.viewType = VK_IMAGE_VIEW_TYPE_3D;
+    view.format = format;
+    view.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    view.subresourceRange.baseMipLevel = 0;
+    view.subresourceRange.baseArrayLayer = 0;
+    view.subresourceRange.layerCount = 1;
+    view.subresourceRange.levelCount = 1;
+    checkResult(vkCreateImageView(device.device(), &view, nullptr, &this->view));
+}
+
+void Hammock::Texture3D::update(const void *buffer) {
+    const uint32_t width = this->width, height = this->height, depth = this->depth;
+
+    // A texel is one instance per channel, rows are padded to the optimal copy pitch as long as that
+    // stays a whole number of texels
+    const VkDeviceSize texelSize = instanceSize * channels;
+    const VkDeviceSize unalignedRowPitch = width * texelSize;
+    const VkDeviceSize rowPitchAlignment = device.properties.limits.optimalBufferCopyRowPitchAlignment;
+    VkDeviceSize alignedRowPitch = (unalignedRowPitch + rowPitchAlignment - 1) / rowPitchAlignment * rowPitchAlignment;
+    if (alignedRowPitch % texelSize != 0) alignedRowPitch = unalignedRowPitch;
+
+    VkDeviceSize alignedSlicePitch = alignedRowPitch * height;
+    VkDeviceSize totalSize = alignedSlicePitch * depth;
+
+
     // Create a host-visible staging buffer that contains the raw image data
     Buffer stagingBuffer{
         device,
-        instanceSize, // Size of each element (4 bytes for float)
-        static_cast<uint32_t>(totalSize),  // Total size including padding
+        1,
+        static_cast<uint32_t>(totalSize),  // Total size in bytes including padding
         VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
         VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
     };
 
     stagingBuffer.map();
 
-    // Copy data slice by slice with proper alignment
-    const float* srcData = static_cast<const float*>(buffer);
-    float* dstData = static_cast<float*>(stagingBuffer.getMappedMemory());
-
-    // Calculate pitches in bytes
-    VkDeviceSize unalignedRowPitch = width * sizeof(float);
-    VkDeviceSize unalignedSlicePitch = unalignedRowPitch * height;
+    // Copy data row by row with proper alignment
+    const auto *srcData = static_cast<const uint8_t *>(buffer);
+    auto *dstData = static_cast<uint8_t *>(stagingBuffer.getMappedMemory());
 
     // Debug prints
     Logger::log(LOG_LEVEL_DEBUG, "Width: %d, Height: %d, Depth: %d\n", width, height, depth);
     Logger::log(LOG_LEVEL_DEBUG, "Unaligned row pitch: %zu bytes\n", unalignedRowPitch);
     Logger::log(LOG_LEVEL_DEBUG, "Aligned row pitch: %zu bytes\n", alignedRowPitch);
     Logger::log(LOG_LEVEL_DEBUG, "Aligned slice pitch: %zu bytes\n", alignedSlicePitch);
-    Logger::log(LOG_LEVEL_DEBUG, "Unligned slice pitch: %zu bytes\n", alignedSlicePitch);
-    
-    for (uint32_t z = 0; z < depth; z++) {
-        for (uint32_t y = 0; y < height; y++) {
-            const float* srcRow = srcData + (z * height * width) + (y * width);
-            float* dstRow = dstData + (z * alignedSlicePitch / sizeof(float)) + 
-                                    (y * alignedRowPitch / sizeof(float));
-            
-            // Copy one row of floats
-            memcpy(dstRow, srcRow, unalignedRowPitch);
+
+    if (alignedRowPitch == unalignedRowPitch) {
+        memcpy(dstData, srcData, totalSize);
+    } else {
+        for (uint32_t z = 0; z < depth; z++) {
+            for (uint32_t y = 0; y < height; y++) {
+                const uint8_t *srcRow = srcData + (static_cast<VkDeviceSize>(z) * height + y) * unalignedRowPitch;
+                uint8_t *dstRow = dstData + z * alignedSlicePitch + y * alignedRowPitch;
+                memcpy(dstRow, srcRow, unalignedRowPitch);
+            }
         }
     }
     stagingBuffer.unmap();
@@ -436,7 +454,7 @@ void Hammock::Texture3D::loadFromBuffer(Device &device, const void *buffer, VkDe
     // Setup buffer copy regions with proper alignment
     VkBufferImageCopy copyRegion{};
     copyRegion.bufferOffset = 0;
-    copyRegion.bufferRowLength = alignedRowPitch / instanceSize;  // In texels
+    copyRegion.bufferRowLength = static_cast<uint32_t>(alignedRowPitch / texelSize);  // In texels
     copyRegion.bufferImageHeight = height;
     copyRegion.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
     copyRegion.imageSubresource.mipLevel = 0;
@@ -467,20 +485,8 @@ void Hammock::Texture3D::loadFromBuffer(Device &device, const void *buffer, VkDe
     device.transitionImageLayout(
         this->image,
         VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-        imageLayout
+        this->layout
     );
-
-    // create image view
-    VkImageViewCreateInfo view = Init::imageViewCreateInfo();
-    view.image = this->image;
-    view.viewType = VK_IMAGE_VIEW_TYPE_3D;
-    view.format = format;
-    view.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-    view.subresourceRange.baseMipLevel = 0;
-    view.subresourceRange.baseArrayLayer = 0;
-    view.subresourceRange.layerCount = 1;
-    view.subresourceRange.levelCount = 1;
-    checkResult(vkCreateImageView(device.device(), &view, nullptr, &this->view));
 }
 
 void Hammock::Texture3D::createSampler(Device &device, VkFilter filter, VkSamplerAddressMode addressMode) {
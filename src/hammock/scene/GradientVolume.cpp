@@ -0,0 +1,177 @@
+#include "hammock/scene/GradientVolume.h"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define HAMMOCK_GRADIENT_SSE2
+#endif
+
+namespace {
+    // The three decoded slices around the current one. Slices are requested in increasing order, so the
+    // one decoded first is always the one that is no longer needed.
+    class SliceWindow {
+    public:
+        explicit SliceWindow(const Hammock::VolumeView &volume) : volume(volume) {
+        }
+
+        const float *slice(uint32_t z) {
+            for (const Slot &slot: slots) {
+                if (slot.z == z) return slot.samples.data();
+            }
+            Slot &slot = slots[next];
+            next = (next + 1) % 3;
+            slot.z = z;
+            slot.samples.resize(static_cast<std::size_t>(volume.width) * volume.height);
+            float *out = slot.samples.data();
+            for (uint32_t y = 0; y < volume.height; ++y) {
+                for (uint32_t x = 0; x < volume.width; ++x) {
+                    *out++ = volume.at(x, y, z);
+                }
+            }
+            return slot.samples.data();
+        }
+
+    private:
+        struct Slot {
+            uint32_t z = UINT32_MAX;
+            std::vector<float> samples;
+        };
+
+        const Hammock::VolumeView &volume;
+        Slot slots[3];
+        uint32_t next = 0;
+    };
+
+    // Gradient components of one row, one array per axis
+    struct RowGradients {
+        std::vector<float> x, y, z;
+    };
+
+    void rowGradients(SliceWindow &window, const Hammock::VolumeView &volume, const float inverseSpacing[3],
+                      uint32_t y, uint32_t z, RowGradients &row) {
+        const uint32_t w = volume.width;
+        const uint32_t y0 = y > 0 ? y - 1 : y, y1 = std::min(y + 1, volume.height - 1);
+        const uint32_t z0 = z > 0 ? z - 1 : z, z1 = std::min(z + 1, volume.depth - 1);
+        // Requested in increasing order, see SliceWindow
+        const float *below = window.slice(z0) + static_cast<std::size_t>(y) * w;
+        const float *slice = window.slice(z);
+        const float *above = window.slice(z1) + static_cast<std::size_t>(y) * w;
+        const float *center = slice + static_cast<std::size_t>(y) * w;
+        const float *front = slice + static_cast<std::size_t>(y0) * w;
+        const float *back = slice + static_cast<std::size_t>(y1) * w;
+
+        const float sx = inverseSpacing[0] * 0.5f;
+        const float sy = inverseSpacing[1] / static_cast<float>(std::max(1u, y1 - y0));
+        const float sz = inverseSpacing[2] / static_cast<float>(std::max(1u, z1 - z0));
+        for (uint32_t x = 0; x < w; ++x) {
+            row.y[x] = (back[x] - front[x]) * sy;
+            row.z[x] = (above[x] - below[x]) * sz;
+        }
+        for (uint32_t x = 1; x + 1 < w; ++x) {
+            row.x[x] = (center[x + 1] - center[x - 1]) * sx;
+        }
+        row.x[0] = w > 1 ? (center[1] - center[0]) * inverseSpacing[0] : 0.0f;
+        if (w > 1) row.x[w - 1] = (center[w - 1] - center[w - 2]) * inverseSpacing[0];
+    }
+
+    float maxSquaredMagnitude(const RowGradients &row, uint32_t count) {
+        uint32_t x = 0;
+        float result = 0.0f;
+#if defined(HAMMOCK_GRADIENT_SSE2)
+        __m128 maximum = _mm_setzero_ps();
+        for (; x + 4 <= count; x += 4) {
+            const __m128 gx = _mm_loadu_ps(row.x.data() + x);
+            const __m128 gy = _mm_loadu_ps(row.y.data() + x);
+            const __m128 gz = _mm_loadu_ps(row.z.data() + x);
+            const __m128 squared = _mm_add_ps(_mm_add_ps(_mm_mul_ps(gx, gx), _mm_mul_ps(gy, gy)), _mm_mul_ps(gz, gz));
+            maximum = _mm_max_ps(maximum, squared);
+        }
+        alignas(16) float lanes[4];
+        _mm_store_ps(lanes, maximum);
+        result = std::max(std::max(lanes[0], lanes[1]), std::max(lanes[2], lanes[3]));
+#endif
+        for (; x < count; ++x) {
+            result = std::max(result, row.x[x] * row.x[x] + row.y[x] * row.y[x] + row.z[x] * row.z[x]);
+        }
+        return result;
+    }
+
+    uint32_t packTexel(float gx, float gy, float gz, float alphaScale) {
+        const float magnitude = std::sqrt(gx * gx + gy * gy + gz * gz);
+        const float inverse = magnitude > 0.0f ? 0.5f / magnitude : 0.0f;
+        const auto channel = [](float value) { return static_cast<uint32_t>(value * 255.0f + 0.5f); };
+        const auto alpha = static_cast<uint32_t>(std::min(magnitude * alphaScale, 255.0f) + 0.5f);
+        return channel(gx * inverse + 0.5f) | channel(gy * inverse + 0.5f) << 8 |
+               channel(gz * inverse + 0.5f) << 16 | alpha << 24;
+    }
+
+    // Same arithmetic as packTexel four texels at a time, the results are identical
+    void packRow(const RowGradients &row, uint32_t count, float alphaScale, uint32_t *out) {
+        uint32_t x = 0;
+#if defined(HAMMOCK_GRADIENT_SSE2)
+        const __m128 half = _mm_set1_ps(0.5f), full = _mm_set1_ps(255.0f), zero = _mm_setzero_ps();
+        const __m128 alpha = _mm_set1_ps(alphaScale);
+        const auto channel = [&](__m128 component, __m128 inverse) {
+            return _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(_mm_add_ps(_mm_mul_ps(component, inverse), half), full),
+                                               half));
+        };
+        for (; x + 4 <= count; x += 4) {
+            const __m128 gx = _mm_loadu_ps(row.x.data() + x);
+            const __m128 gy = _mm_loadu_ps(row.y.data() + x);
+            const __m128 gz = _mm_loadu_ps(row.z.data() + x);
+            const __m128 magnitude = _mm_sqrt_ps(
+                _mm_add_ps(_mm_add_ps(_mm_mul_ps(gx, gx), _mm_mul_ps(gy, gy)), _mm_mul_ps(gz, gz)));
+            // Zero where the magnitude is, the division by zero is masked out
+            const __m128 inverse = _mm_and_ps(_mm_cmpgt_ps(magnitude, zero), _mm_div_ps(half, magnitude));
+            const __m128i a = _mm_cvttps_epi32(_mm_add_ps(_mm_min_ps(_mm_mul_ps(magnitude, alpha), full), half));
+            const __m128i texels = _mm_or_si128(
+                _mm_or_si128(channel(gx, inverse), _mm_slli_epi32(channel(gy, inverse), 8)),
+                _mm_or_si128(_mm_slli_epi32(channel(gz, inverse), 16), _mm_slli_epi32(a, 24)));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(out + x), texels);
+        }
+#endif
+        for (; x < count; ++x) {
+            out[x] = packTexel(row.x[x], row.y[x], row.z[x], alphaScale);
+        }
+    }
+}
+
+void Hammock::GradientVolume::build(const VolumeView &volume, const HmckVec3 &spacing, ThreadPool &threadPool) {
+    size[0] = volume.width;
+    size[1] = volume.height;
+    size[2] = volume.depth;
+    packed.assign(static_cast<std::size_t>(size[0]) * size[1] * size[2], 0);
+    magnitudeRange = 0.0f;
+    if (packed.empty()) return;
+
+    const float inverseSpacing[3] = {1.0f / spacing.X, 1.0f / spacing.Y, 1.0f / spacing.Z};
+
+    // The largest magnitude sets the alpha scale, so the gradients are computed twice instead of
+    // being kept as floats in between
+    std::vector<float> sliceMaxima(size[2], 0.0f);
+    threadPool.parallelFor(size[2], [&](uint32_t zBegin, uint32_t zEnd) {
+        SliceWindow window(volume);
+        RowGradients row{std::vector<float>(size[0]), std::vector<float>(size[0]), std::vector<float>(size[0])};
+        for (uint32_t z = zBegin; z < zEnd; ++z) {
+            for (uint32_t y = 0; y < size[1]; ++y) {
+                rowGradients(window, volume, inverseSpacing, y, z, row);
+                sliceMaxima[z] = std::max(sliceMaxima[z], maxSquaredMagnitude(row, size[0]));
+            }
+        }
+    });
+    magnitudeRange = std::sqrt(*std::max_element(sliceMaxima.begin(), sliceMaxima.end()));
+
+    const float alphaScale = magnitudeRange > 0.0f ? 255.0f / magnitudeRange : 0.0f;
+    threadPool.parallelFor(size[2], [&](uint32_t zBegin, uint32_t zEnd) {
+        SliceWindow window(volume);
+        RowGradients row{std::vector<float>(size[0]), std::vector<float>(size[0]), std::vector<float>(size[0])};
+        for (uint32_t z = zBegin; z < zEnd; ++z) {
+            for (uint32_t y = 0; y < size[1]; ++y) {
+                rowGradients(window, volume, inverseSpacing, y, z, row);
+                packRow(row, size[0], alphaScale, packed.data() + (static_cast<std::size_t>(z) * size[1] + y) * size[0]);
+            }
+        }
+    });
+}
@@ -0,0 +1,99 @@
+#include "hammock/scene/MacrocellGrid.h"
+
+#include <algorithm>
+#include <limits>
+
+namespace {
+    // Chebyshev distance along one axis: out[i] = min over j of max(in[j], |i - j|), read and written
+    // with the given stride. Distances never exceed the largest input so the search ends early.
+    void chebyshevLine(const uint32_t *in, uint32_t *out, uint32_t count, std::size_t stride) {
+        for (uint32_t i = 0; i < count; ++i) {
+            uint32_t best = in[i * stride];
+            for (uint32_t r = 1; r < best; ++r) {
+                if (i >= r) best = std::min(best, std::max(in[(i - r) * stride], r));
+                if (i + r < count) best = std::min(best, std::max(in[(i + r) * stride], r));
+                if (i < r && i + r >= count) break;
+            }
+            out[i * stride] = best;
+        }
+    }
+}
+
+void Hammock::MacrocellGrid::build(const VolumeView &volume, ThreadPool &threadPool) {
+    size[0] = (volume.width + CELL_SIZE - 1) / CELL_SIZE;
+    size[1] = (volume.height + CELL_SIZE - 1) / CELL_SIZE;
+    size[2] = (volume.depth + CELL_SIZE - 1) / CELL_SIZE;
+    rangeMin.assign(cellCount(), 0.0f);
+    rangeMax.assign(cellCount(), 0.0f);
+    distances.assign(cellCount(), 0.0f);
+    if (cellCount() == 0) return;
+
+    // A sample point inside macrocell m filters samples from m * CELL_SIZE - 1 to (m + 1) * CELL_SIZE
+    const auto first = [](uint32_t m) { return m > 0 ? m * CELL_SIZE - 1 : 0; };
+    const auto last = [](uint32_t m, uint32_t n) { return std::min((m + 1) * CELL_SIZE, n - 1); };
+
+    threadPool.parallelFor(size[2], [&](uint32_t zBegin, uint32_t zEnd) {
+        for (uint32_t mz = zBegin; mz < zEnd; ++mz) {
+            for (uint32_t my = 0; my < size[1]; ++my) {
+                for (uint32_t mx = 0; mx < size[0]; ++mx) {
+                    float lo = std::numeric_limits<float>::max(), hi = std::numeric_limits<float>::lowest();
+                    for (uint32_t z = first(mz); z <= last(mz, volume.depth); ++z) {
+                        for (uint32_t y = first(my); y <= last(my, volume.height); ++y) {
+                            for (uint32_t x = first(mx); x <= last(mx, volume.width); ++x) {
+                                const float value = volume.at(x, y, z);
+                                lo = std::min(lo, value);
+                                hi = std::max(hi, value);
+                            }
+                        }
+                    }
+                    rangeMin[index(mx, my, mz)] = lo;
+                    rangeMax[index(mx, my, mz)] = hi;
+                }
+            }
+        }
+    });
+}
+
+void Hammock::MacrocellGrid::updateSkipDistances(float lo, float hi, ThreadPool &threadPool) {
+    if (cellCount() == 0) return;
+
+    // Separable transform, first along x from the visible macrocells, then along y and z
+    std::vector<uint32_t> a(cellCount()), b(cellCount());
+    threadPool.parallelFor(size[2], [&](uint32_t zBegin, uint32_t zEnd) {
+        for (uint32_t z = zBegin; z < zEnd; ++z) {
+            for (uint32_t y = 0; y < size[1]; ++y) {
+                const std::size_t row = index(0, y, z);
+                uint32_t distance = MAX_SKIP;
+                for (uint32_t x = 0; x < size[0]; ++x) {
+                    const bool visible = rangeMax[row + x] >= lo && rangeMin[row + x] <= hi;
+                    distance = visible ? 0 : std::min(distance + 1, MAX_SKIP);
+                    a[row + x] = distance;
+                }
+                distance = MAX_SKIP;
+                for (uint32_t x = size[0]; x-- > 0;) {
+                    distance = a[row + x] == 0 ? 0 : std::min(distance + 1, MAX_SKIP);
+                    a[row + x] = std::min(a[row + x], distance);
+                }
+            }
+        }
+    });
+
+    threadPool.parallelFor(size[2], [&](uint32_t zBegin, uint32_t zEnd) {
+        for (uint32_t z = zBegin; z < zEnd; ++z) {
+            for (uint32_t x = 0; x < size[0]; ++x) {
+                chebyshevLine(a.data() + index(x, 0, z), b.data() + index(x, 0, z), size[1], size[0]);
+            }
+        }
+    });
+
+    const std::size_t sliceSize = static_cast<std::size_t>(size[0]) * size[1];
+    threadPool.parallelFor(size[1], [&](uint32_t yBegin, uint32_t yEnd) {
+        for (uint32_t y = yBegin; y < yEnd; ++y) {
+            for (uint32_t x = 0; x < size[0]; ++x) {
+                chebyshevLine(b.data() + index(x, y, 0), a.data() + index(x, y, 0), size[2], sliceSize);
+            }
+        }
+    });
+
+    std::transform(a.begin(), a.end(), distances.begin(), [](uint32_t d) { return static_cast<float>(d); });
+}
@@ -0,0 +1,118 @@
+#include "hammock/scene/TransferFunction.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+#include "hammock/utils/Logger.h"
+
+namespace {
+    // Straight color and extinction per unit of length, which unlike opacity can be interpolated and
+    // integrated over segments of any length
+    struct Medium {
+        float r, g, b, extinction;
+    };
+
+    Medium medium(const HmckVec4 &color) {
+        // A fully opaque point would need an infinite extinction
+        const float opacity = std::clamp(color.W, 0.0f, 0.99999f);
+        return {color.X, color.Y, color.Z, -std::log(1.0f - opacity) / Hammock::TransferFunction::REFERENCE_STEP};
+    }
+}
+
+void Hammock::TransferFunction::setControlPoints(std::vector<ControlPoint> controlPoints) {
+    if (controlPoints.empty()) {
+        Logger::log(LOG_LEVEL_ERROR, "Error: A transfer function needs at least one control point\n");
+        throw std::invalid_argument("Transfer function without control points.");
+    }
+    std::stable_sort(controlPoints.begin(), controlPoints.end(),
+                     [](const ControlPoint &a, const ControlPoint &b) { return a.density < b.density; });
+    points = std::move(controlPoints);
+}
+
+HmckVec4 Hammock::TransferFunction::evaluate(float density) const {
+    const auto next = std::upper_bound(points.begin(), points.end(), density,
+                                       [](float value, const ControlPoint &point) { return value < point.density; });
+    if (next == points.begin()) return points.front().color;
+    if (next == points.end()) return points.back().color;
+    const ControlPoint &previous = *(next - 1);
+    const float t = (density - previous.density) / (next->density - previous.density);
+    return HmckLerpV4(previous.color, t, next->color);
+}
+
+void Hammock::TransferFunction::build(float stepSize, ThreadPool &threadPool) {
+    constexpr uint32_t n = TABLE_SIZE;
+    lookup.resize(n);
+    std::vector<Medium> media(n);
+    for (uint32_t i = 0; i < n; ++i) {
+        lookup[i] = evaluate(static_cast<float>(i) / static_cast<float>(n - 1));
+        media[i] = medium(lookup[i]);
+    }
+
+    // The medium halfway between every two neighbouring entries, the samples the segments are integrated from
+    std::vector<Medium> halfway(n - 1);
+    for (uint32_t i = 0; i + 1 < n; ++i) {
+        halfway[i] = {
+            (media[i].r + media[i + 1].r) * 0.5f, (media[i].g + media[i + 1].g) * 0.5f,
+            (media[i].b + media[i + 1].b) * 0.5f, (media[i].extinction + media[i + 1].extinction) * 0.5f
+        };
+    }
+
+    // A segment passing k entries is sampled k times, k steps of the same length. The opacity of every
+    // sample only depends on k, so it is computed once per k instead of once per segment.
+    std::vector<float> opacities(static_cast<std::size_t>(n) * n);
+    for (uint32_t samples = 1; samples < n; ++samples) {
+        const float length = stepSize / static_cast<float>(samples);
+        for (uint32_t i = 0; i + 1 < n; ++i) {
+            opacities[static_cast<std::size_t>(samples) * n + i] = 1.0f - std::exp(-halfway[i].extinction * length);
+        }
+    }
+    for (uint32_t i = 0; i < n; ++i) {
+        opacities[i] = 1.0f - std::exp(-media[i].extinction * stepSize);
+    }
+
+    // The density is assumed to change linearly along a segment, which is integrated front to back with
+    // one sample per table entry it passes. A segment that does not change stays a single sample.
+    preintegrated.resize(static_cast<std::size_t>(n) * n);
+    threadPool.parallelFor(n, [&](uint32_t backBegin, uint32_t backEnd) {
+        for (uint32_t back = backBegin; back < backEnd; ++back) {
+            for (uint32_t front = 0; front < n; ++front) {
+                const uint32_t samples = front > back ? front - back : back - front;
+                if (samples == 0) {
+                    const Medium &sample = media[front];
+                    const float opacity = opacities[front];
+                    preintegrated[static_cast<std::size_t>(back) * n + front] = {
+                        sample.r * opacity, sample.g * opacity, sample.b * opacity, opacity
+                    };
+                    continue;
+                }
+                const float *sampleOpacities = opacities.data() + static_cast<std::size_t>(samples) * n;
+                float r = 0.0f, g = 0.0f, b = 0.0f, transmittance = 1.0f;
+                for (uint32_t k = 0; k < samples; ++k) {
+                    const uint32_t i = front < back ? front + k : front - 1 - k;
+                    const float weight = transmittance * sampleOpacities[i];
+                    r += weight * halfway[i].r;
+                    g += weight * halfway[i].g;
+                    b += weight * halfway[i].b;
+                    transmittance *= 1.0f - sampleOpacities[i];
+                }
+                preintegrated[static_cast<std::size_t>(back) * n + front] = {r, g, b, 1.0f - transmittance};
+            }
+        }
+    });
+    builtStepSize = stepSize;
+}
+
+void Hammock::TransferFunction::visibleRange(float &lo, float &hi) const {
+    lo = std::numeric_limits<float>::max();
+    hi = std::numeric_limits<float>::lowest();
+    const auto visible = [](const ControlPoint &point) { return point.color.W > 0.0f; };
+    const auto first = std::find_if(points.begin(), points.end(), visible);
+    if (first == points.end()) return;
+    const auto last = std::find_if(points.rbegin(), points.rend(), visible).base() - 1;
+
+    // Opacity rises from the point before the first visible one and falls until the point after the last
+    lo = first == points.begin() ? std::numeric_limits<float>::lowest() : (first - 1)->density;
+    hi = last + 1 == points.end() ? std::numeric_limits<float>::max() : (last + 1)->density;
+}
@@ -0,0 +1,91 @@
+#ifndef MARCHING_CUBES_BINDING_GLSL
+#define MARCHING_CUBES_BINDING_GLSL
+
+// Shared by the compute marching cubes passes, see examples/marching_cubes/GpuMarchingCubes.h
+
+// Dense field, x-fastest without padding, starts at push.firstSample
+layout (std430, set = 0, binding = 0) readonly buffer Field {
+    float samples[];
+} field;
+
+layout (std430, set = 0, binding = 1) readonly buffer Tables {
+    uint caseTriangles[256];
+    int triTable[256 * 16];
+} tables;
+
+// Triangle counts of the cells, then the block sums of every level of the prefix sum
+layout (std430, set = 0, binding = 2) buffer Scan {
+    uint values[];
+} scan;
+
+// Hammock::Vertex, position, normal, uv and tangent as 12 floats
+layout (std430, set = 0, binding = 3) writeonly buffer Vertices {
+    float values[];
+} vertices;
+
+// VkDrawIndirectCommand followed by the triangle count before clamping to the capacity
+layout (std430, set = 0, binding = 4) buffer Draw {
+    uint vertexCount;
+    uint instanceCount;
+    uint firstVertex;
+    uint firstInstance;
+    uint triangleCount;
+} draw;
+
+layout (push_constant) uniform PushConstants {
+    uint sizeX;
+    uint sizeY;
+    uint sizeZ;
+    uint firstSample;
+    float isovalue;
+    float cubeSize;
+    uint vertexCapacity;
+    // Level of the prefix sum
+    uint count;
+    uint offset;
+    uint sumsOffset;
+    // Where the last level leaves the total
+    uint totalOffset;
+} push;
+
+const uvec3 cornerOffset[8] = uvec3[](
+    uvec3(0, 0, 0), uvec3(1, 0, 0), uvec3(1, 1, 0), uvec3(0, 1, 0),
+    uvec3(0, 0, 1), uvec3(1, 0, 1), uvec3(1, 1, 1), uvec3(0, 1, 1)
+);
+
+// Ordered from the lower to the higher grid point like edgeCorners in MarchingCubes.h
+const uvec2 edgeCorners[12] = uvec2[](
+    uvec2(0, 1), uvec2(1, 2), uvec2(3, 2), uvec2(0, 3),
+    uvec2(4, 5), uvec2(5, 6), uvec2(7, 6), uvec2(4, 7),
+    uvec2(0, 4), uvec2(1, 5), uvec2(2, 6), uvec2(3, 7)
+);
+
+// Dispatches are two dimensional when one row of groups is not enough
+uint groupIndex() {
+    return gl_WorkGroupID.y * gl_NumWorkGroups.x + gl_WorkGroupID.x;
+}
+
+uint cellCount() {
+    return (push.sizeX - 1) * (push.sizeY - 1) * (push.sizeZ - 1);
+}
+
+uvec3 cellPosition(uint cell) {
+    const uint cellsX = push.sizeX - 1, cellsY = push.sizeY - 1;
+    return uvec3(cell % cellsX, (cell / cellsX) % cellsY, cell / (cellsX * cellsY));
+}
+
+float sampleAt(uvec3 p) {
+    return field.samples[push.firstSample + p.x + push.sizeX * (p.y + push.sizeY * p.z)];
+}
+
+// Bit i is set when corner i is below the isovalue
+uint cubeIndex(uvec3 cell, out float v[8]) {
+    uint index = 0;
+    for (int i = 0; i < 8; ++i) {
+        v[i] = sampleAt(cell + cornerOffset[i]);
+        if (v[i] < push.isovalue) index |= 1u << i;
+    }
+    return index;
+}
+
+#endif
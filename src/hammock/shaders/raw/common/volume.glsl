@@ -0,0 +1,36 @@
+#ifndef VOLUME_GLSL
+#define VOLUME_GLSL
+
+// Entry and exit depth of the ray through the box, entry > exit when the ray misses it
+vec2 intersectBox(vec3 rayOrigin, vec3 inverseDirection, vec3 boxMin, vec3 boxMax) {
+    const vec3 t0 = (boxMin - rayOrigin) * inverseDirection;
+    const vec3 t1 = (boxMax - rayOrigin) * inverseDirection;
+    const vec3 tMin = min(t0, t1), tMax = max(t0, t1);
+    return vec2(max(max(tMin.x, tMin.y), tMin.z), min(min(tMax.x, tMax.y), tMax.z));
+}
+
+// Opacities in the transfer function tables are for segments this long, see TransferFunction
+const float TRANSFER_FUNCTION_REFERENCE_STEP = 0.01;
+
+// Table coordinate of a density, 0 and 1 fall on the centers of the first and the last entry
+float transferFunctionCoord(float density, float size) {
+    return (clamp(density, 0.0, 1.0) * (size - 1.0) + 0.5) / size;
+}
+
+// Color of a sample stepSize long from the lookup table, rgb premultiplied by the opacity
+vec4 classify(sampler3D lookupTable, float density, float stepSize) {
+    const float size = float(textureSize(lookupTable, 0).x);
+    vec4 color = texture(lookupTable, vec3(transferFunctionCoord(density, size), 0.5, 0.5));
+    color.a = 1.0 - pow(1.0 - color.a, stepSize / TRANSFER_FUNCTION_REFERENCE_STEP);
+    return vec4(color.rgb * color.a, color.a);
+}
+
+// Color of the segment between two samples from the pre-integrated table, rgb premultiplied by the
+// opacity. The table holds segments of the step it was built for.
+vec4 classifySegment(sampler3D preintegratedTable, float frontDensity, float backDensity) {
+    const vec2 size = vec2(textureSize(preintegratedTable, 0).xy);
+    return texture(preintegratedTable, vec3(transferFunctionCoord(frontDensity, size.x),
+                                            transferFunctionCoord(backDensity, size.y), 0.5));
+}
+
+#endif // VOLUME_GLSL
@@ -0,0 +1,65 @@
+#version 450
+
+layout (location = 0) in vec2 uv;
+
+layout (location = 0) out vec4 color;
+
+layout (set = 0, binding = 0) uniform UBO{
+    mat4 mvp;
+    vec4 lightPos;
+    mat4 modelView;
+    mat4 projection;
+    vec4 viewLightPos;
+} projection;
+
+layout (set = 1, binding = 0) uniform sampler2D depthSampler;
+
+layout (push_constant) uniform PushConstants {
+    vec4 positionOffset;
+    vec4 positionScale;
+    vec2 texelSize;
+    int filterRadius;
+    float depthFalloff;
+} push;
+
+
+// View space position of the surface seen through uv at the given linear depth
+vec3 viewPosition(vec2 at, float depth) {
+    vec2 ndc = at * 2.0 - 1.0;
+    return vec3(ndc.x * depth / projection.projection[0][0], ndc.y * depth / projection.projection[1][1], -depth);
+}
+
+// Difference to the neighbour along step, the one on the side with the smaller depth change is taken
+// so that normals do not bend over silhouettes
+vec3 derivative(vec3 position, vec2 step) {
+    float forwardDepth = texture(depthSampler, uv + step).r;
+    float backwardDepth = texture(depthSampler, uv - step).r;
+    vec3 forward = forwardDepth > 0.0 ? viewPosition(uv + step, forwardDepth) - position : vec3(0.0);
+    vec3 backward = backwardDepth > 0.0 ? position - viewPosition(uv - step, backwardDepth) : vec3(0.0);
+    if (forwardDepth <= 0.0) return backward;
+    if (backwardDepth <= 0.0) return forward;
+    return abs(forward.z) < abs(backward.z) ? forward : backward;
+}
+
+
+void main() {
+    float depth = texture(depthSampler, uv).r;
+    if (depth <= 0.0) discard;
+
+    vec3 position = viewPosition(uv, depth);
+    vec3 normal = normalize(cross(derivative(position, vec2(push.texelSize.x, 0.0)),
+                                  derivative(position, vec2(0.0, push.texelSize.y))));
+    if (normal.z < 0.0) normal = -normal;
+
+    vec4 clip = projection.projection * vec4(position, 1.0);
+    gl_FragDepth = clip.z / clip.w;
+
+    // Same lighting as the meshes, in view space
+    vec3 lightDir = normalize(projection.viewLightPos.xyz - position);
+    vec3 ambient = vec3(0.1);
+    vec3 diffuse = max(dot(normal, lightDir), 0.0) * vec3(1.0);
+    vec3 viewDir = normalize(-position);
+    vec3 specular = pow(max(dot(viewDir, reflect(-lightDir, normal)), 0.0), 32.0) * vec3(1.0);
+
+    color = vec4(ambient + diffuse + specular, 1.0);
+}
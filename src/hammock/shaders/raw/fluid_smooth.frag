@@ -0,0 +1,45 @@
+#version 450
+
+layout (location = 0) in vec2 uv;
+
+layout (location = 0) out float smoothedDepth;
+
+layout (set = 1, binding = 0) uniform sampler2D depthSampler;
+
+layout (push_constant) uniform PushConstants {
+    vec4 positionOffset;
+    vec4 positionScale;
+    vec2 texelSize;
+    int filterRadius;
+    float depthFalloff;
+} push;
+
+
+// Bilateral filter of the linear particle depth. Samples are weighted by distance and by depth difference,
+// so the spheres melt into one surface while the edges against the background and against particles
+// further behind stay sharp.
+void main() {
+    float depth = texture(depthSampler, uv).r;
+    if (depth <= 0.0) {
+        smoothedDepth = 0.0;
+        return;
+    }
+
+    int filterRadius = clamp(push.filterRadius, 0, 16);
+    float sigma = max(float(filterRadius) / 2.0, 1.0);
+    float sum = 0.0;
+    float weightSum = 0.0;
+    for (int y = -filterRadius; y <= filterRadius; y++) {
+        for (int x = -filterRadius; x <= filterRadius; x++) {
+            float sampleDepth = texture(depthSampler, uv + vec2(x, y) * push.texelSize).r;
+            if (sampleDepth <= 0.0) continue;
+
+            float spatial = exp(-float(x * x + y * y) / (2.0 * sigma * sigma));
+            float difference = (sampleDepth - depth) * push.depthFalloff;
+            float weight = spatial * exp(-difference * difference);
+            sum += sampleDepth * weight;
+            weightSum += weight;
+        }
+    }
+    smoothedDepth = sum / weightSum;
+}
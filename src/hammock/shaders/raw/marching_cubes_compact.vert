@@ -0,0 +1,45 @@
+#version 450
+
+// inputs, see CompactVertex in examples/marching_cubes/MeshCache.h
+layout (location = 0) in vec4 quantizedPosition;
+layout (location = 1) in vec2 octahedralNormal;
+
+// outputs
+layout (location = 0) out vec3 _normal;
+layout (location = 1) out vec2 _uv;
+layout (location = 2) out vec3 _position;
+layout (location = 3) out vec4 _tangent;
+
+
+
+layout (set = 0, binding = 0) uniform UBO{
+    mat4 mvp;
+    vec4 lightPos;
+} projection;
+
+
+layout (push_constant) uniform PushConstants {
+    float time;
+    vec4 boundsMin;
+    vec4 boundsExtent;
+} push;
+
+
+vec3 decodeOctahedral(vec2 e) {
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    if (n.z < 0.0) {
+        n.xy = (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+    }
+    return normalize(n);
+}
+
+
+void main() {
+    vec3 position = push.boundsMin.xyz + quantizedPosition.xyz * push.boundsExtent.xyz;
+    gl_Position = projection.mvp * vec4(position, 1.0);
+
+    _position = position;
+    _normal = decodeOctahedral(octahedralNormal);
+    _tangent = vec4(0.0);
+    _uv = vec2(0.0);
+}
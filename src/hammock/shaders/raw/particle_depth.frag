@@ -0,0 +1,27 @@
+#version 450
+
+layout (location = 0) in vec2 offset;
+layout (location = 1) in vec3 center;
+layout (location = 2) in float radius;
+
+// Linear depth for fluid_smooth.frag, the target is cleared to zero
+layout (location = 0) out float depth;
+
+layout (set = 0, binding = 0) uniform UBO{
+    mat4 mvp;
+    vec4 lightPos;
+    mat4 modelView;
+    mat4 projection;
+    vec4 viewLightPos;
+} projection;
+
+
+void main() {
+    float r2 = dot(offset, offset);
+    if (r2 > 1.0) discard;
+    vec3 position = center + vec3(offset, sqrt(1.0 - r2)) * radius;
+
+    vec4 clip = projection.projection * vec4(position, 1.0);
+    gl_FragDepth = clip.z / clip.w;
+    depth = -position.z;
+}
@@ -0,0 +1,36 @@
+#version 450
+
+layout (location = 0) in vec2 offset;
+layout (location = 1) in vec3 center;
+layout (location = 2) in float radius;
+
+layout (location = 0) out vec4 color;
+
+layout (set = 0, binding = 0) uniform UBO{
+    mat4 mvp;
+    vec4 lightPos;
+    mat4 modelView;
+    mat4 projection;
+    vec4 viewLightPos;
+} projection;
+
+
+void main() {
+    // Point on the sphere in view space, outside of the circle the quad is empty
+    float r2 = dot(offset, offset);
+    if (r2 > 1.0) discard;
+    vec3 normal = vec3(offset, sqrt(1.0 - r2));
+    vec3 position = center + normal * radius;
+
+    vec4 clip = projection.projection * vec4(position, 1.0);
+    gl_FragDepth = clip.z / clip.w;
+
+    // Same lighting as the meshes, in view space
+    vec3 lightDir = normalize(projection.viewLightPos.xyz - position);
+    vec3 ambient = vec3(0.1);
+    vec3 diffuse = max(dot(normal, lightDir), 0.0) * vec3(1.0);
+    vec3 viewDir = normalize(-position);
+    vec3 specular = pow(max(dot(viewDir, reflect(-lightDir, normal)), 0.0), 32.0) * vec3(1.0);
+
+    color = vec4(ambient + diffuse + specular, 1.0);
+}
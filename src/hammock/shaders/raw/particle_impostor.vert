@@ -0,0 +1,49 @@
+#version 450
+
+// inputs, see ImpostorParticle in examples/marching_cubes/ParticleImpostors.h, one per instance
+layout (location = 0) in vec4 particle;
+
+// outputs
+layout (location = 0) out vec2 _offset;
+layout (location = 1) out vec3 _center;
+layout (location = 2) out float _radius;
+
+
+layout (set = 0, binding = 0) uniform UBO{
+    mat4 mvp;
+    vec4 lightPos;
+    mat4 modelView;
+    mat4 projection;
+    vec4 viewLightPos;
+} projection;
+
+
+layout (push_constant) uniform PushConstants {
+    vec4 positionOffset;
+    vec4 positionScale;
+    vec2 texelSize;
+    int filterRadius;
+    float depthFalloff;
+} push;
+
+
+const vec2 corners[6] = vec2[](
+    vec2(-1.0, -1.0), vec2(1.0, -1.0), vec2(1.0, 1.0),
+    vec2(-1.0, -1.0), vec2(1.0, 1.0), vec2(-1.0, 1.0)
+);
+
+
+void main() {
+    vec3 position = push.positionOffset.xyz + particle.xyz * push.positionScale.xyz;
+    // The model matrix scales uniformly
+    float radius = particle.w * push.positionScale.w * length(projection.modelView[0].xyz);
+    vec3 center = (projection.modelView * vec4(position, 1.0)).xyz;
+
+    // The quad sits in front of the sphere, so that it covers the whole silhouette under perspective
+    vec2 corner = corners[gl_VertexIndex];
+    gl_Position = projection.projection * vec4(center.xy + corner * radius, center.z + radius, 1.0);
+
+    _offset = corner;
+    _center = center;
+    _radius = radius;
+}
@@ -1,5 +1,7 @@
 #version 450
 
+#include "common/volume.glsl"
+
 // Inputs
 layout (location = 0) in vec2 inUv;
 
@@ -14,13 +16,20 @@ layout (set = 0, binding = 0) uniform SceneUbo {
     vec4 textureDim;
     vec4 lightPosition;
     vec4 baseSkyColor;
-    vec4 tissueColor;
-    vec4 fatColor;
-    vec4 boneColor;
+    vec4 tissueColor; // Blinn-Phong surface color
     vec4 cameraPosition;
+    vec4 macrocellDim; // macrocells along every axis, samples per macrocell in w
+    vec4 valueTransform; // scale in x and bias in y that map volume samples to densities
 } data;
 
 layout (set = 0, binding = 1) uniform sampler3D volumeSampler;
+// Skip distance of every macrocell, see MacrocellGrid
+layout (set = 0, binding = 2) uniform sampler3D macrocellSampler;
+// Gradient direction as xyz * 0.5 + 0.5 and relative magnitude in a, see GradientVolume
+layout (set = 0, binding = 3) uniform sampler3D gradientSampler;
+// Transfer function tables, see TransferFunction
+layout (set = 0, binding = 4) uniform sampler3D lookupTableSampler;
+layout (set = 0, binding = 5) uniform sampler3D preintegratedTableSampler;
 
 // Push constants
 layout (push_constant) uniform PushConstants {
@@ -31,64 +40,83 @@ layout (push_constant) uniform PushConstants {
     float marchSize;
     float airFactor;
     float tissueFactor;
-    float fatFactor;
     int nDotL;
+    int emptySpaceSkipping;
+    int precomputedGradients;
+    int preintegrated;
 } push;
 
-// Transfer function with smooth transitions
-vec4 transferFunction(float density) {
-    vec4 color = vec4(0.0);
-
-    if (density < push.airFactor) {
-        color = vec4(0.0, 0.0, 0.0, 0.0);
-    }
-    else if (density < push.tissueFactor) {
-        float t = (density - push.airFactor) / (push.tissueFactor - push.airFactor);
-        color = mix(vec4(0.0, 0.0, 0.0, 0.0), data.tissueColor, t);
-    }
-    else if (density < push.fatFactor) {
-        float t = (density - push.tissueFactor) / (push.fatFactor - push.tissueFactor);
-        color = mix(data.tissueColor, data.fatColor, t);
-    }
-    else {
-        float t = (density - push.fatFactor) / (1.0 - push.fatFactor);
-        color = mix(data.fatColor, data.boneColor, t);
-    }
-
-    return color;
-}
-
 // Density function
 float density(vec3 p) {
     if (any(lessThan(p, vec3(0.0))) || any(greaterThan(p, vec3(1.0)))) {
         return 0.0; // Outside the volume
     }
-    return texture(volumeSampler, p).r;
+    return texture(volumeSampler, p).r * data.valueTransform.x + data.valueTransform.y;
+}
+
+// Depths at which the ray has to be marched. Without empty space skipping that is everything in front
+// of the camera, with it only the part inside the volume. Depths are rounded to multiples of the march
+// size so that the samples which are taken stay where they were.
+vec2 marchRange(vec3 rayOrigin, vec3 inverseDirection, vec3 aspectRatio) {
+    if (push.emptySpaceSkipping == 0) return vec2(0.0, 1e30);
+    const vec2 range = intersectBox(rayOrigin, inverseDirection, vec3(-1.0), aspectRatio * 2.0 - 1.0);
+    return vec2(ceil(max(range.x, 0.0) / push.marchSize) * push.marchSize, range.y);
+}
+
+// First depth past the empty macrocells around the sample, depth itself when the sample can be visible
+float skipEmptySpace(vec3 textureCoords, vec3 rayOrigin, vec3 inverseDirection, float depth, vec3 aspectRatio) {
+    if (push.emptySpaceSkipping == 0) return depth;
+
+    const float cellSize = data.macrocellDim.w;
+    const ivec3 cell = clamp(ivec3(textureCoords * data.textureDim.xyz / cellSize), ivec3(0),
+                             ivec3(data.macrocellDim.xyz) - 1);
+    const float skipDistance = texelFetch(macrocellSampler, cell, 0).r;
+    if (skipDistance < 1.0) return depth;
+
+    // Every macrocell in this box is empty, leave it through the far side
+    const vec3 boxMin = (vec3(cell) - skipDistance + 1.0) * cellSize / data.textureDim.xyz;
+    const vec3 boxMax = (vec3(cell) + skipDistance) * cellSize / data.textureDim.xyz;
+    const float exitDepth = intersectBox(rayOrigin, inverseDirection, boxMin * aspectRatio * 2.0 - 1.0,
+                                         boxMax * aspectRatio * 2.0 - 1.0).y;
+    return max(depth, ceil(exitDepth / push.marchSize) * push.marchSize);
 }
 
 // Raymarching function
-vec4 raymarch(vec3 rayOrigin, vec3 rayDirection) {
-    float depth = 0.0;
+vec4 raymarch(vec3 rayOrigin, vec3 rayDirection, vec3 inverseDirection) {
     vec3 p = rayOrigin;
     vec4 accumulatedColor = vec4(0.0);
 
     // Aspect ratio of the texture: 512x512x150
     const vec3 aspectRatio = vec3(1.0, 1.0, data.textureDim.b / data.textureDim.r);
 
-    for (int i = 0; i < int(push.maxSteps); i++) {
+    const vec2 range = marchRange(rayOrigin, inverseDirection, aspectRatio);
+    float depth = range.x;
+    // Density of the previous sample, negative when there is none to integrate from
+    float previousDensity = -1.0;
+
+    for (int i = 0; i < int(push.maxSteps) && depth <= range.y; i++) {
         // Compute the current position in the volume
         p = rayOrigin + depth * rayDirection;
 
         // Convert world coordinates to texture coordinates
         vec3 textureCoords = (p * 0.5 + 0.5) / aspectRatio; // Normalize by aspect ratio
 
+        const float skipped = skipEmptySpace(textureCoords, rayOrigin, inverseDirection, depth, aspectRatio);
+        if (skipped > depth) {
+            depth = skipped;
+            previousDensity = -1.0;
+            continue;
+        }
+
         // Sample density
         float d = density(textureCoords);
 
-        // Apply transfer function and compositing
-        vec4 color = transferFunction(d);
-        accumulatedColor.rgb += (1.0 - accumulatedColor.a) * color.rgb * color.a;
-        accumulatedColor.a += (1.0 - accumulatedColor.a) * color.a;
+        // Apply transfer function and compositing, the colors are premultiplied
+        vec4 color = push.preintegrated == 1
+                     ? classifySegment(preintegratedTableSampler, previousDensity < 0.0 ? d : previousDensity, d)
+                     : classify(lookupTableSampler, d, push.marchSize);
+        previousDensity = d;
+        accumulatedColor += (1.0 - accumulatedColor.a) * color;
 
         if (accumulatedColor.a >= 1.0) break; // Early termination
 
@@ -109,28 +137,37 @@ void main() {
 
     vec3 rayOrigin = (data.cameraPosition).xyz;
     vec3 rayDirection = normalize((data.view * vec4(cameraSpace.xyz, 0.0)).xyz);
+    vec3 inverseDirection = 1.0 / mix(rayDirection, vec3(1e-8), lessThan(abs(rayDirection), vec3(1e-8)));
 
     vec3 color = data.baseSkyColor.rgb;
 
     // Volume rendering with corrected aspect ratio
     if (push.nDotL == 1) {
         // Raymarch to find the first tissue voxel
-        float depth = 0.0;
         vec3 hitPos = vec3(0.0);
         vec3 p = rayOrigin;
 
         // Aspect ratio of the texture: 512x512x150
         const vec3 aspectRatio = vec3(1.0, 1.0, data.textureDim.b / data.textureDim.r);
 
+        const vec2 range = marchRange(rayOrigin, inverseDirection, aspectRatio);
+        float depth = range.x;
+
         bool foundTissue = false;
 
-        for (int i = 0; i < int(push.maxSteps); i++) {
+        for (int i = 0; i < int(push.maxSteps) && depth <= range.y; i++) {
             // Compute the current position in the volume
             p = rayOrigin + depth * rayDirection;
 
             // Convert world coordinates to texture coordinates
             vec3 textureCoords = (p * 0.5 + 0.5) / aspectRatio; // Normalize by aspect ratio
 
+            const float skipped = skipEmptySpace(textureCoords, rayOrigin, inverseDirection, depth, aspectRatio);
+            if (skipped > depth) {
+                depth = skipped;
+                continue;
+            }
+
             // Sample density
             float d = density(textureCoords);
 
@@ -146,12 +183,17 @@ void main() {
         }
 
         if (foundTissue) {
-            // Compute normals via central differences
-            vec3 gradient = vec3(
-            density(hitPos + vec3(push.marchSize, 0.0, 0.0)) - density(hitPos - vec3(push.marchSize, 0.0, 0.0)),
-            density(hitPos + vec3(0.0, push.marchSize, 0.0)) - density(hitPos - vec3(0.0, push.marchSize, 0.0)),
-            density(hitPos + vec3(0.0, 0.0, push.marchSize)) - density(hitPos - vec3(0.0, 0.0, push.marchSize))
-            );
+            // Compute normals via central differences, or read the ones computed when loading
+            vec3 gradient;
+            if (push.precomputedGradients == 1) {
+                gradient = texture(gradientSampler, hitPos).xyz * 2.0 - 1.0;
+            } else {
+                gradient = vec3(
+                density(hitPos + vec3(push.marchSize, 0.0, 0.0)) - density(hitPos - vec3(push.marchSize, 0.0, 0.0)),
+                density(hitPos + vec3(0.0, push.marchSize, 0.0)) - density(hitPos - vec3(0.0, push.marchSize, 0.0)),
+                density(hitPos + vec3(0.0, 0.0, push.marchSize)) - density(hitPos - vec3(0.0, 0.0, push.marchSize))
+                );
+            }
 
             vec3 normal = normalize(gradient); // Surface normal
 
@@ -184,7 +226,7 @@ void main() {
         return;
     }
 
-    vec4 volumeColor = raymarch(rayOrigin, rayDirection);
+    vec4 volumeColor = raymarch(rayOrigin, rayDirection, inverseDirection);
     color = color * (1.0 - volumeColor.a) + volumeColor.rgb;
     outColor = vec4(color, 1.0);
 }
@@ -0,0 +1,134 @@
+#version 450
+
+#include "common/volume.glsl"
+
+// Inputs
+layout (location = 0) in vec2 inUv;
+
+// Outputs
+layout (location = 0) out vec4 outColor;
+
+// Page table values that are not atlas slots, see BrickCache
+const float PAGE_MISSING = -1.0;
+const float PAGE_EMPTY = -2.0;
+// Samples copied from the neighbours around every brick in the atlas
+const float APRON = 1.0;
+
+// Uniforms
+layout (set = 0, binding = 0) uniform SceneUbo {
+    mat4 inverseProjection;
+    mat4 view;
+    mat4 inverseView;
+    vec4 textureDim;
+    vec4 baseSkyColor;
+    vec4 cameraPosition;
+    vec4 brickDim; // bricks along every axis, samples per brick without the apron in w
+} data;
+
+// Resident bricks with their aprons
+layout (set = 0, binding = 1) uniform sampler3D atlasSampler;
+// Atlas slot of every brick
+layout (set = 0, binding = 2) uniform sampler3D pageTableSampler;
+// Stamp of the last frame that entered every brick
+layout (set = 0, binding = 3) writeonly buffer Feedback {
+    uint stamps[];
+} feedback;
+// Transfer function tables, see TransferFunction
+layout (set = 0, binding = 4) uniform sampler3D lookupTableSampler;
+layout (set = 0, binding = 5) uniform sampler3D preintegratedTableSampler;
+
+// Push constants
+layout (push_constant) uniform PushConstants {
+    float resX;
+    float resY;
+    float maxSteps;
+    float marchSize;
+    uint frameStamp;
+    int preintegrated;
+} push;
+
+// Atlas coordinates of a position in volume samples inside the brick stored in slot
+vec3 atlasCoords(vec3 voxel, ivec3 brick, int slot) {
+    const float padded = data.brickDim.w + 2.0 * APRON;
+    const ivec3 atlasSize = textureSize(atlasSampler, 0);
+    const ivec3 slots = atlasSize / int(padded);
+    const ivec3 slotPosition = ivec3(slot % slots.x, (slot / slots.x) % slots.y, slot / (slots.x * slots.y));
+    const vec3 local = voxel - vec3(brick) * data.brickDim.w;
+    return (vec3(slotPosition) * padded + APRON + local) / vec3(atlasSize);
+}
+
+vec4 raymarch(vec3 rayOrigin, vec3 rayDirection, vec3 inverseDirection) {
+    vec4 accumulatedColor = vec4(0.0);
+
+    const vec3 aspectRatio = vec3(1.0, 1.0, data.textureDim.b / data.textureDim.r);
+    const ivec3 bricks = ivec3(data.brickDim.xyz);
+    const float brickSize = data.brickDim.w;
+
+    // Only the part of the ray inside the volume is marched, on multiples of the march size
+    const vec2 range = intersectBox(rayOrigin, inverseDirection, vec3(-1.0), aspectRatio * 2.0 - 1.0);
+    float depth = ceil(max(range.x, 0.0) / push.marchSize) * push.marchSize;
+
+    ivec3 currentBrick = ivec3(-1);
+    float page = PAGE_MISSING;
+    // Density of the previous sample, negative when there is none to integrate from
+    float previousDensity = -1.0;
+
+    for (int i = 0; i < int(push.maxSteps) && depth <= range.y; i++) {
+        const vec3 p = rayOrigin + depth * rayDirection;
+        const vec3 textureCoords = clamp((p * 0.5 + 0.5) / aspectRatio, 0.0, 1.0);
+        const vec3 voxel = textureCoords * data.textureDim.xyz;
+        const ivec3 brick = clamp(ivec3(voxel / brickSize), ivec3(0), bricks - 1);
+
+        if (brick != currentBrick) {
+            currentBrick = brick;
+            page = texelFetch(pageTableSampler, brick, 0).r;
+            // Report the brick once per entry, empty bricks are never needed
+            if (page != PAGE_EMPTY) {
+                feedback.stamps[brick.x + bricks.x * (brick.y + bricks.y * brick.z)] = push.frameStamp;
+            }
+        }
+
+        if (page < 0.0) {
+            // Empty or not resident yet, continue behind the brick
+            const vec3 boxMin = vec3(brick) * brickSize / data.textureDim.xyz;
+            const vec3 boxMax = vec3(brick + 1) * brickSize / data.textureDim.xyz;
+            const float exitDepth = intersectBox(rayOrigin, inverseDirection, boxMin * aspectRatio * 2.0 - 1.0,
+                                                 boxMax * aspectRatio * 2.0 - 1.0).y;
+            depth = max(depth + push.marchSize, ceil(exitDepth / push.marchSize) * push.marchSize);
+            previousDensity = -1.0;
+            continue;
+        }
+
+        const float d = texture(atlasSampler, atlasCoords(voxel, brick, int(page))).r;
+
+        // Colors are premultiplied
+        vec4 color = push.preintegrated == 1
+                     ? classifySegment(preintegratedTableSampler, previousDensity < 0.0 ? d : previousDensity, d)
+                     : classify(lookupTableSampler, d, push.marchSize);
+        previousDensity = d;
+        accumulatedColor += (1.0 - accumulatedColor.a) * color;
+
+        if (accumulatedColor.a >= 1.0) break; // Early termination
+
+        depth += push.marchSize;
+    }
+
+    return accumulatedColor;
+}
+
+void main() {
+    vec2 ndc = gl_FragCoord.xy / vec2(push.resX, push.resY);
+    vec2 uv = ndc - vec2(0.5, 0.5); // Center UV in NDC
+
+    vec4 clipSpace = vec4(uv, -1.0, 1.0);
+    vec4 cameraSpace = data.inverseProjection * clipSpace;
+    cameraSpace.xyz /= cameraSpace.w;
+
+    vec3 rayOrigin = data.cameraPosition.xyz;
+    vec3 rayDirection = normalize((data.view * vec4(cameraSpace.xyz, 0.0)).xyz);
+    vec3 inverseDirection = 1.0 / mix(rayDirection, vec3(1e-8), lessThan(abs(rayDirection), vec3(1e-8)));
+
+    vec4 volumeColor = raymarch(rayOrigin, rayDirection, inverseDirection);
+    vec3 color = data.baseSkyColor.rgb * (1.0 - volumeColor.a) + volumeColor.rgb;
+    outColor = vec4(color, 1.0);
+}
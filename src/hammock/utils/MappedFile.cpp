@@ -0,0 +1,70 @@
+#include "hammock/utils/MappedFile.h"
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+Hammock::MappedFile::MappedFile(const std::string &path) {
+#if defined(_WIN32)
+    HANDLE handle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                                FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (handle == INVALID_HANDLE_VALUE) return;
+    file = handle;
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(handle, &fileSize) || fileSize.QuadPart == 0) {
+        close();
+        return;
+    }
+    mapping = CreateFileMappingA(handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!mapping) {
+        close();
+        return;
+    }
+    data_ = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (!data_) {
+        close();
+        return;
+    }
+    size_ = static_cast<std::size_t>(fileSize.QuadPart);
+#else
+    descriptor = ::open(path.c_str(), O_RDONLY);
+    if (descriptor < 0) return;
+
+    struct stat status{};
+    if (fstat(descriptor, &status) != 0 || status.st_size == 0) {
+        close();
+        return;
+    }
+    void *mapped = mmap(nullptr, static_cast<std::size_t>(status.st_size), PROT_READ, MAP_PRIVATE, descriptor, 0);
+    if (mapped == MAP_FAILED) {
+        close();
+        return;
+    }
+    data_ = mapped;
+    size_ = static_cast<std::size_t>(status.st_size);
+#endif
+}
+
+void Hammock::MappedFile::close() {
+#if defined(_WIN32)
+    if (data_) UnmapViewOfFile(data_);
+    if (mapping) CloseHandle(mapping);
+    if (file) CloseHandle(file);
+    mapping = nullptr;
+    file = nullptr;
+#else
+    if (data_) munmap(data_, size_);
+    if (descriptor >= 0) ::close(descriptor);
+    descriptor = -1;
+#endif
+    data_ = nullptr;
+    size_ = 0;
+}
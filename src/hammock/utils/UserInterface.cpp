@@ -2,6 +2,7 @@
 #include "hammock/core/GraphicsPipeline.h"
 #include "backends/imgui_impl_vulkan.h"
 #include "hammock/utils/Helpers.h"
+#include "hammock/scene/TransferFunction.h"
 #include <deque>
 #include <string>
 
@@ -57,6 +58,52 @@ void Hammock::UserInterface::showColorSettings(float *exposure, float *gamma, fl
     endWindow();
 }
 
+bool Hammock::UserInterface::showTransferFunctionEditor(TransferFunction &transferFunction) {
+    if (!ImGui::TreeNodeEx("Transfer function", ImGuiTreeNodeFlags_DefaultOpen)) return false;
+
+    auto points = transferFunction.controlPoints();
+    bool changed = false;
+    int removed = -1;
+    for (int i = 0; i < static_cast<int>(points.size()); i++) {
+        ImGui::PushID(i);
+        // Points cannot pass their neighbours, so they keep their order and their widgets while dragged
+        const float lo = i > 0 ? points[i - 1].density : 0.0f;
+        const float hi = i + 1 < static_cast<int>(points.size()) ? points[i + 1].density : 1.0f;
+        ImGui::SetNextItemWidth(80.0f);
+        changed |= ImGui::DragFloat("##density", &points[i].density, 0.005f, lo, hi);
+        ImGui::SameLine();
+        changed |= ImGui::ColorEdit4("##color", &points[i].color.Elements[0], ImGuiColorEditFlags_NoInputs);
+        if (points.size() > 1) {
+            ImGui::SameLine();
+            if (ImGui::SmallButton("Remove")) removed = i;
+        }
+        ImGui::PopID();
+    }
+    if (removed >= 0) {
+        points.erase(points.begin() + removed);
+        changed = true;
+    }
+    if (ImGui::Button("Add point")) {
+        // Splits the widest gap without changing the function
+        float gapStart = 0.0f, gapEnd = points.front().density;
+        for (size_t i = 0; i <= points.size(); i++) {
+            const float start = i > 0 ? points[i - 1].density : 0.0f;
+            const float end = i < points.size() ? points[i].density : 1.0f;
+            if (end - start > gapEnd - gapStart) {
+                gapStart = start;
+                gapEnd = end;
+            }
+        }
+        const float density = (gapStart + gapEnd) * 0.5f;
+        points.push_back({density, transferFunction.evaluate(density)});
+        changed = true;
+    }
+    ImGui::TreePop();
+
+    if (changed) transferFunction.setControlPoints(std::move(points));
+    return changed;
+}
+
 void Hammock::UserInterface::init() {
     ImGui::CreateContext();
 